@@ -0,0 +1,200 @@
+/// @file Arrhenius.c
+
+#include <stdlib.h>
+#include <math.h>
+#include "Arrhenius.h"
+
+#define ARRHENIUS_MAX_INTERVALS (1<<22)
+
+// Upper bound of |k''''(T)|/k(T) on [T, infinity), since every term decreases with T
+static double fourth_derivative_bound(
+    double a,
+    double T
+){
+    double T2 = T*T;
+    double T4 = T2*T2;
+    return (a*a*a*a+12*a*a*a*T+36*a*a*T2+24*a*T2*T)/(T4*T4);
+}
+
+// Largest relative error bound over the intervals of a table with num_intervals intervals
+static double interpolation_bound(
+    double EaR,
+    double T_min,
+    double T_max,
+    int num_intervals
+){
+    double h = (T_max-T_min)/num_intervals;
+    double h4 = h*h*h*h;
+    double bound = 0;
+    int i;
+    for (i=0;i<num_intervals;i++){
+        double T_low = T_min+i*h;
+        double T_high = T_low+h;
+        // k is increasing, so k(T_high)/k(T_low) bounds the ratio of the largest to the smallest value of k
+        double ratio = exp(EaR*(1/T_low-1/T_high));
+        bound = fmax(bound,h4/384*fourth_derivative_bound(EaR,T_low)*ratio);
+    }
+    return bound;
+}
+
+// Computes the coefficients of the table for its parameters, range and number of intervals
+static void fill_coefficients(
+    arrhenius_table *ptable
+){
+    double h = (ptable->T_max-ptable->T_min)/ptable->num_intervals;
+    double k_low = ptable->k0*exp(ptable->EaR*(-1/ptable->T_min));
+    double dk_low = h*k_low*ptable->EaR/(ptable->T_min*ptable->T_min);
+    int i;
+    for (i=0;i<ptable->num_intervals;i++){
+        double T_high = ptable->T_min+(i+1)*h;
+        double k_high = ptable->k0*exp(ptable->EaR*(-1/T_high));
+        double dk_high = h*k_high*ptable->EaR/(T_high*T_high);
+        double *pc = &ptable->pcoefficients[4*i];
+
+        // Cubic Hermite polynomial in s of the values and the derivatives scaled by h
+        pc[0] = k_low;
+        pc[1] = dk_low;
+        pc[2] = 3*(k_high-k_low)-2*dk_low-dk_high;
+        pc[3] = 2*(k_low-k_high)+dk_low+dk_high;
+        k_low = k_high;
+        dk_low = dk_high;
+    }
+}
+
+// Chooses the number of intervals and allocates and fills the coefficients
+static int build(
+    arrhenius_table *ptable
+){
+    double width = ptable->T_max-ptable->T_min;
+
+    // The bound of the first interval, which is the largest, gives the initial guess
+    double h = pow(384*ptable->relative_tolerance/fourth_derivative_bound(ptable->EaR,ptable->T_min),0.25);
+    double guess = ceil(width/h);
+    if (!(guess <= ARRHENIUS_MAX_INTERVALS)){
+        return -1;
+    }
+    int num_intervals = (guess > 1) ? (int) guess : 1;
+    double bound = interpolation_bound(ptable->EaR,ptable->T_min,ptable->T_max,num_intervals);
+    while (bound > ptable->relative_tolerance){
+        num_intervals += num_intervals/8+1;
+        if (num_intervals > ARRHENIUS_MAX_INTERVALS){
+            return -1;
+        }
+        bound = interpolation_bound(ptable->EaR,ptable->T_min,ptable->T_max,num_intervals);
+    }
+    double *pcoefficients = (double*) malloc(4*(size_t) num_intervals*sizeof(double));
+    if (pcoefficients == NULL){
+        return -1;
+    }
+    free(ptable->pcoefficients);
+    ptable->pcoefficients = pcoefficients;
+    ptable->num_intervals = num_intervals;
+    ptable->inv_h = num_intervals/width;
+    ptable->relative_error = bound;
+    fill_coefficients(ptable);
+    return 0;
+}
+
+arrhenius_table *arrhenius_table_create(
+    double k0,
+    double EaR,
+    double T_min,
+    double T_max,
+    double relative_tolerance
+){
+    if (!(EaR > 0) || !(T_min > 0) || !(T_max > T_min) || !(relative_tolerance > 0) || !isfinite(k0)){
+        return NULL;
+    }
+    arrhenius_table *ptable = (arrhenius_table*) calloc(1,sizeof(arrhenius_table));
+    if (ptable == NULL){
+        return NULL;
+    }
+    ptable->k0 = k0;
+    ptable->EaR = EaR;
+    ptable->T_min = T_min;
+    ptable->T_max = T_max;
+    ptable->relative_tolerance = relative_tolerance;
+    if (build(ptable) != 0){
+        free(ptable);
+        return NULL;
+    }
+    return ptable;
+}
+
+int arrhenius_table_update(
+    arrhenius_table *ptable,
+    double k0,
+    double EaR
+){
+    if (ptable->k0 == k0 && ptable->EaR == EaR){
+        return 0;
+    }
+    if (!(EaR > 0) || !isfinite(k0)){
+        return -1;
+    }
+    arrhenius_table updated = *ptable;
+    updated.k0 = k0;
+    updated.EaR = EaR;
+    updated.pcoefficients = NULL;
+    if (build(&updated) != 0){
+        return -1;
+    }
+    free(ptable->pcoefficients);
+    *ptable = updated;
+    return 1;
+}
+
+void arrhenius_table_destroy(
+    arrhenius_table *ptable
+){
+    if (ptable == NULL){
+        return;
+    }
+    free(ptable->pcoefficients);
+    free(ptable);
+}
+
+void arrhenius_rate_batch(
+    const arrhenius_table *ptable,
+    double k0,
+    double EaR,
+    const double *pT,
+    double *pk,
+    int count
+){
+    int i;
+    if (ptable == NULL || ptable->k0 != k0 || ptable->EaR != EaR){
+        for (i=0;i<count;i++){
+            pk[i] = k0*exp(EaR*(-1/pT[i]));
+        }
+        return;
+    }
+    const double *restrict pc = ptable->pcoefficients;
+    double T_min = ptable->T_min;
+    double inv_h = ptable->inv_h;
+    double end = ptable->num_intervals;
+    double last = ptable->num_intervals-1;
+    int outside = 0;
+
+    // The interval is clamped, so every lane reads inside the table
+    #pragma omp simd reduction(+:outside)
+    for (i=0;i<count;i++){
+        double s = (pT[i]-T_min)*inv_h;
+        outside += !(s >= 0 && s < end);
+        double clamped = (s > 0) ? s : 0;
+        clamped = (clamped < last) ? clamped : last;
+        int j = (int) clamped;
+        s -= j;
+        pk[i] = pc[4*j]+s*(pc[4*j+1]+s*(pc[4*j+2]+s*pc[4*j+3]));
+    }
+
+    // Temperatures outside the table
+    if (outside > 0){
+        for (i=0;i<count;i++){
+            double s = (pT[i]-T_min)*inv_h;
+            if (!(s >= 0 && s < end)){
+                pk[i] = k0*exp(EaR*(-1/pT[i]));
+            }
+        }
+    }
+}
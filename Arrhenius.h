@@ -0,0 +1,149 @@
+/// @file Arrhenius.h
+
+#ifndef CSTR_ARRHENIUS
+#define CSTR_ARRHENIUS
+
+#include <math.h>
+
+/**
+ * Interpolation table of the Arrhenius rate constant \f$k(T)=k_0e^{-E_a/(RT)}\f$, which replaces the call to exp() in
+ * the drift and its Jacobian by a table lookup and a cubic polynomial. The table covers \f$[T_{min},T_{max})\f$ with
+ * intervals of equal width \f$h\f$, and on every interval \f$k\f$ is interpolated by the cubic Hermite polynomial of
+ * its values and derivatives at the ends, stored in powers of the position \f$s\in[0,1)\f$ in the interval. The
+ * error of the interpolation is at most \f$\frac{h^4}{384}\max|k^{(4)}|\f$ on an interval, where
+ * \f$k^{(4)}(T)=k(T)\,(a^4-12a^3T+36a^2T^2-24aT^3)/T^8\f$ with \f$a=E_a/R\f$. arrhenius_table_create() chooses the
+ * number of intervals such that this bound, relative to the smallest value of \f$k\f$ on every interval, is below the
+ * requested tolerance, and stores the largest bound of all intervals in relative_error. The rounding of the
+ * evaluation adds a few units in the last place.
+ *
+ * The table is built for one pair of \f$k_0\f$ and \f$E_a/R\f$. The evaluation takes the parameters of the caller and
+ * falls back to exp() if they differ from those of the table, as for the candidates of a parameter estimation, or if
+ * the temperature is outside the table, so a stale table never gives a wrong rate. arrhenius_table_update() rebuilds
+ * the table for new parameters. A table is read-only during evaluations and can be shared by all threads.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct arrhenius_table{
+    double k0;                  // Pre-exponential factor of the table
+    double EaR;                 // Activation temperature of the table
+    double T_min;               // Lower end of the table
+    double T_max;               // Upper end of the table
+    double relative_tolerance;  // Requested bound of the relative error
+    double relative_error;      // Proven bound of the relative interpolation error
+    double inv_h;               // Number of intervals per kelvin
+    int num_intervals;          // Number of intervals
+    double *pcoefficients;      // Coefficients of the powers 0 to 3 of s on every interval, 4*num_intervals
+} arrhenius_table;
+
+/**
+ * Builds a table.
+ *
+ * @param[in] k0: Pre-exponential factor.
+ * @param[in] EaR: Activation temperature \f$E_a/R\f$ in kelvin. Must be positive.
+ * @param[in] T_min: Lower end of the table in kelvin. Must be positive.
+ * @param[in] T_max: Upper end of the table in kelvin.
+ * @param[in] relative_tolerance: Bound of the relative interpolation error, e.g. 1e-12.
+ *
+ * @return Pointer to the table or NULL if an argument is invalid, the tolerance needs more than \f$2^{22}\f$
+ * intervals or memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+arrhenius_table *arrhenius_table_create(
+    double k0,
+    double EaR,
+    double T_min,
+    double T_max,
+    double relative_tolerance
+);
+
+/**
+ * Rebuilds a table for new parameters with its range and tolerance. Must not be called during evaluations.
+ *
+ * @param[in,out] ptable: Pointer to the table.
+ * @param[in] k0: Pre-exponential factor.
+ * @param[in] EaR: Activation temperature in kelvin.
+ *
+ * @return 1 if the table was rebuilt, 0 if the parameters are those of the table and -1 if the table could not be
+ * rebuilt, in which case it is left unchanged.
+ *
+ * @date 19th of October 2026
+ */
+
+int arrhenius_table_update(
+    arrhenius_table *ptable,
+    double k0,
+    double EaR
+);
+
+/**
+ * Frees a table.
+ *
+ * @param[in] ptable: Pointer to the table. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void arrhenius_table_destroy(
+    arrhenius_table *ptable
+);
+
+/**
+ * Evaluates \f$k_0e^{-E_a/(RT)}\f$ with the table, or with exp() if the table is NULL, was built for other parameters
+ * or does not cover T. Without a table the result is bitwise that of k0*exp(EaR*(-1/T)).
+ *
+ * @param[in] ptable: Pointer to the table. May be NULL.
+ * @param[in] k0: Pre-exponential factor.
+ * @param[in] EaR: Activation temperature in kelvin.
+ * @param[in] T: Temperature in kelvin.
+ *
+ * @return The rate constant.
+ *
+ * @date 19th of October 2026
+ */
+
+static inline double arrhenius_rate(
+    const arrhenius_table *ptable,
+    double k0,
+    double EaR,
+    double T
+){
+    if (ptable != NULL && ptable->k0 == k0 && ptable->EaR == EaR){
+        double s = (T-ptable->T_min)*ptable->inv_h;
+        if (s >= 0 && s < ptable->num_intervals){
+            int i = (int) s;
+            const double *pc = &ptable->pcoefficients[4*i];
+            s -= i;
+            return pc[0]+s*(pc[1]+s*(pc[2]+s*pc[3]));
+        }
+    }
+    return k0*exp(EaR*(-1/T));
+}
+
+/**
+ * Evaluates the rate constant at many temperatures with the same result as arrhenius_rate(). The temperatures in the
+ * table are interpolated in a loop which the compiler vectorizes with gathers of the coefficients, and the others
+ * are evaluated with exp() afterwards.
+ *
+ * @param[in] ptable: Pointer to the table. May be NULL.
+ * @param[in] k0: Pre-exponential factor.
+ * @param[in] EaR: Activation temperature in kelvin.
+ * @param[in] pT: Temperatures in kelvin. Must be of size \f$\text{count}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] pk: Rate constants. Must be of size \f$\text{count}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] count: Number of temperatures.
+ *
+ * @date 19th of October 2026
+ */
+
+void arrhenius_rate_batch(
+    const arrhenius_table *ptable,
+    double k0,
+    double EaR,
+    const double *pT,
+    double *pk,
+    int count
+);
+
+#endif
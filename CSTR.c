@@ -60,6 +60,10 @@ CSTR_parameters default_parameters(){
     params.V = 0.105;
     params.k0 = 48266327438.6281;
     params.sigma = 10;
+    params.flow_rate = NULL;
+    params.sensitivity_parameters = NULL;
+    params.num_sensitivity_parameters = 0;
+    params.parrhenius = NULL;
     return params;
 }
 
@@ -78,7 +82,7 @@ void CSTR_3D_drift(
     double f = pu[0]; // scaling to [seconds / 10000]
 
     //  Arrhenius expression
-    double k_arrhenius = params->k0*exp(params->EaR*(-1/temperature));
+    double k_arrhenius = arrhenius_rate(params->parrhenius,params->k0,params->EaR,temperature);
     double r = k_arrhenius*CA*CB;
 
     // Production rate and rate of change in temperature
@@ -124,12 +128,12 @@ void CSTR_3D_drift_jacobian(
     double f = pu[0]; // scaling to [seconds / 10000]
 
     //  Arrhenius expression
-    double k_arrhenius = params->k0*exp(params->EaR*(-1/temperature));
+    double k_arrhenius = arrhenius_rate(params->parrhenius,params->k0,params->EaR,temperature);
 
     double FV = f/params->V;
     double kCA = k_arrhenius*CA;
     double kCB = k_arrhenius*CB;
-    double kT = CA*CB*params->EaR*params->k0*exp(params->EaR*(-1/temperature));
+    double kT = CA*CB*params->EaR*k_arrhenius;
     kT /= (temperature*temperature);
     // It may look like the jacobian is implemented as the transpose, but it simply uses col major storage
     pxdot[0] = -FV-kCB;
@@ -140,13 +144,218 @@ void CSTR_3D_drift_jacobian(
     pxdot[4] = -FV-(kCA+kCA);
     pxdot[5] = params->beta*kCA;
 
-    pxdot[6] = kT;
+    pxdot[6] = -kT;
     pxdot[7] = -(kT+kT);
     pxdot[8] = -FV+params->beta*kT;
 }
 
+void CSTR_3D_drift_jacobian_float(
+    double *pt,
+    float *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    float *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    float CA = px[0];
+    float CB = px[1];
+    float temperature = px[2];
+    float EaR = (float) params->EaR;
+    float beta = (float) params->beta;
+
+    //  Arrhenius expression
+    float k_arrhenius = (float) params->k0*expf(-EaR/temperature);
+
+    float FV = (float) (pu[0]/params->V);
+    float kCA = k_arrhenius*CA;
+    float kCB = k_arrhenius*CB;
+    float kT = CA*CB*EaR*k_arrhenius/(temperature*temperature);
+    pxdot[0] = -FV-kCB;
+    pxdot[1] = -(kCB+kCB);
+    pxdot[2] = beta*kCB;
+
+    pxdot[3] = -kCA;
+    pxdot[4] = -FV-(kCA+kCA);
+    pxdot[5] = beta*kCA;
+
+    pxdot[6] = -kT;
+    pxdot[7] = -(kT+kT);
+    pxdot[8] = -FV+beta*kT;
+}
+
+// The drift of CSTR_3D_drift() in dual numbers given the Arrhenius rate at the temperature, with the operations in
+// the same order, so the values are bitwise those of CSTR_3D_drift()
+DUAL_INLINE void drift_dual(
+    const dual3 *px,
+    double f,
+    const CSTR_parameters *params,
+    double k_arrhenius,
+    dual3 *pxdot
+){
+    dual3 CA = px[0];
+    dual3 CB = px[1];
+    dual3 temperature = px[2];
+
+    //  Arrhenius expression, dk/dT = k EaR/T^2
+    dual3 k = dual3_apply(temperature,k_arrhenius,k_arrhenius*params->EaR/(temperature.v*temperature.v));
+    dual3 r = dual3_mul(dual3_mul(k,CA),CB);
+
+    double FV = f/params->V;
+
+    // Derivatives
+    pxdot[0] = dual3_add(dual3_scale(dual3_rsub(params->CAin,CA),FV),dual3_neg(r));
+    pxdot[1] = dual3_add(dual3_scale(dual3_rsub(params->CBin,CB),FV),dual3_scale(r,-2));
+    pxdot[2] = dual3_add(dual3_scale(dual3_rsub(params->Tin,temperature),FV),dual3_scale(r,params->beta));
+}
 
-void implicit_simulation(
+void CSTR_3D_drift_dual(
+    double *pt,
+    dual3 *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    dual3 *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    drift_dual(px,pu[0],params,arrhenius_rate(params->parrhenius,params->k0,params->EaR,px[2].v),pxdot);
+}
+
+void CSTR_3D_drift_jacobian_ad(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    dual3 x[3] = {dual3_variable(px[0],0), dual3_variable(px[1],1), dual3_variable(px[2],2)};
+    dual3 xdot[3];
+    drift_dual(x,pu[0],params,arrhenius_rate(params->parrhenius,params->k0,params->EaR,px[2]),xdot);
+    dual3_store(xdot[0],0,3,pxdot);
+    dual3_store(xdot[1],1,3,pxdot);
+    dual3_store(xdot[2],2,3,pxdot);
+}
+
+void CSTR_3D_drift_fused(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    dual3 x[3] = {dual3_variable(px[0],0), dual3_variable(px[1],1), dual3_variable(px[2],2)};
+    dual3 xdot[3];
+    drift_dual(x,pu[0],params,arrhenius_rate(params->parrhenius,params->k0,params->EaR,px[2]),xdot);
+    pxdot[0] = xdot[0].v;
+    pxdot[1] = xdot[1].v;
+    pxdot[2] = xdot[2].v;
+    dual3_store(xdot[0],0,3,&pxdot[3]);
+    dual3_store(xdot[1],1,3,&pxdot[3]);
+    dual3_store(xdot[2],2,3,&pxdot[3]);
+}
+
+void CSTR_3D_drift_fused_batch(
+    int count,
+    double *px,
+    double *pu,
+    int u_increment,
+    void *pP,
+    double *pworkspace,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    double *ptemperature = pworkspace;
+    double *pk = &pworkspace[count];
+    int i;
+    for (i=0;i<count;i++){
+        ptemperature[i] = px[3*i+2];
+    }
+    arrhenius_rate_batch(params->parrhenius,params->k0,params->EaR,ptemperature,pk,count);
+
+    // A local copy of the parameters cannot alias the output, which lets the compiler vectorize the loop across the
+    // states. With omp simd the dual arrays would become per lane arrays in memory instead.
+    CSTR_parameters local = *params;
+    for (i=0;i<count;i++){
+        dual3 x[3] = {dual3_variable(px[3*i],0), dual3_variable(px[3*i+1],1), dual3_variable(px[3*i+2],2)};
+        dual3 xdot[3];
+        drift_dual(x,pu[i*u_increment],&local,pk[i],xdot);
+        pxdot[12*i] = xdot[0].v;
+        pxdot[12*i+1] = xdot[1].v;
+        pxdot[12*i+2] = xdot[2].v;
+        dual3_store(xdot[0],0,3,&pxdot[12*i+3]);
+        dual3_store(xdot[1],1,3,&pxdot[12*i+3]);
+        dual3_store(xdot[2],2,3,&pxdot[12*i+3]);
+    }
+}
+
+void CSTR_3D_dilution(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    double FV = pu[0]/params->V;
+    pxdot[0] = FV;
+    pxdot[1] = FV;
+    pxdot[2] = FV;
+    pxdot[3] = params->CAin;
+    pxdot[4] = params->CBin;
+    pxdot[5] = params->Tin;
+}
+
+void CSTR_3D_reaction(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    double r = arrhenius_rate(params->parrhenius,params->k0,params->EaR,px[2])*px[0]*px[1];
+    pxdot[0] = -r;
+    pxdot[1] = -2*r;
+    pxdot[2] = params->beta*r;
+}
+
+void CSTR_3D_reaction_jacobian(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    double CA = px[0];
+    double CB = px[1];
+    double temperature = px[2];
+    double k_arrhenius = arrhenius_rate(params->parrhenius,params->k0,params->EaR,temperature);
+    double kCA = k_arrhenius*CA;
+    double kCB = k_arrhenius*CB;
+    double kT = k_arrhenius*CA*CB*params->EaR/(temperature*temperature);
+    pxdot[0] = -kCB;
+    pxdot[1] = -(kCB+kCB);
+    pxdot[2] = params->beta*kCB;
+
+    pxdot[3] = -kCA;
+    pxdot[4] = -(kCA+kCA);
+    pxdot[5] = params->beta*kCA;
+
+    pxdot[6] = -kT;
+    pxdot[7] = -(kT+kT);
+    pxdot[8] = params->beta*kT;
+}
+
+
+int implicit_simulation(
     double *pt,
     double *px,
     double *pdW,
@@ -166,9 +375,12 @@ void implicit_simulation(
     int N,
     int n,
     int dw_increment, // if 0, the same measurement noise will be used in all simulations
-    int p_increment // if 0, the same parameter vector will be used in all simulations
+    int p_increment, // if 0, the same parameter vector will be used in all simulations
+    int u_increment // if 0, the same flow rates will be used in all simulations
 ){
     int i = 0;
+    int failures;
+    int failed_realizations = 0;
     int j = 0;
     int x_index_outer = 0;
     int x_index_inner = 0;
@@ -176,13 +388,15 @@ void implicit_simulation(
     int dw_index_inner = 0;
     int t_index = 0;
     int p_index = 0;
+    int u_index = 0;
     int x_increment = n*(N+1);
     int sample_size = n*time_steps_per_sample;
     for (i=0;i<num_realizations;i++){
+        failures = 0;
         x_index_inner = x_index_outer;
         dw_index_inner = dw_index_outer;
         for (j=0;j<num_samples;j++){
-            vector_implicit_euler(
+            failures += vector_implicit_euler(
                 time_steps_per_sample,
                 n,
                 1,
@@ -196,7 +410,7 @@ void implicit_simulation(
                 f_func,
                 g_func,
                 J_func,
-                &pu[j],
+                &pu[u_index+j],
                 pd,
                 &pP[p_index],
                 &px[x_index_inner]
@@ -205,9 +419,194 @@ void implicit_simulation(
             dw_index_inner += sample_size;
             t_index += time_steps_per_sample;
         }
+        failed_realizations += failures > 0;
+        x_index_outer += x_increment;
+        dw_index_outer += dw_increment;
+        t_index = 0;
+        p_index += p_increment;
+        u_index += u_increment;
+    }
+    return failed_realizations;
+}
+
+void CSTR_3D_drift_parameter_jacobian(
+    double *pt,
+    double *px, 
+    double *pu, 
+    double *pd, 
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    double CA = px[0]; // Concentration of compound A 
+    double CB = px[1]; // Concentration of compound B 
+    double temperature = px[2]; // Temperature named T in the model
+    double f = pu[0];
+
+    //  Arrhenius expression
+    double k_arrhenius = arrhenius_rate(params->parrhenius,params->k0,params->EaR,temperature);
+    double r = k_arrhenius*CA*CB;
+    double FV = f/params->V;
+
+    // Derivatives with respect to F
+    pxdot[0] = (params->CAin-CA)/params->V;
+    pxdot[1] = (params->CBin-CB)/params->V;
+    pxdot[2] = (params->Tin-temperature)/params->V;
+
+    // Derivatives with respect to the selected parameters
+    int i;
+    double *pcolumn;
+    for (i=0;i<params->num_sensitivity_parameters;i++){
+        pcolumn = &pxdot[3*(i+1)];
+        pcolumn[0] = 0;
+        pcolumn[1] = 0;
+        pcolumn[2] = 0;
+        switch (params->sensitivity_parameters[i]){
+            case CSTR_SENSITIVITY_K0:
+                pcolumn[0] = -r/params->k0;
+                pcolumn[1] = -2*r/params->k0;
+                pcolumn[2] = params->beta*r/params->k0;
+                break;
+            case CSTR_SENSITIVITY_EAR:
+                pcolumn[0] = r/temperature;
+                pcolumn[1] = 2*r/temperature;
+                pcolumn[2] = -params->beta*r/temperature;
+                break;
+            case CSTR_SENSITIVITY_BETA:
+                pcolumn[2] = r;
+                break;
+            case CSTR_SENSITIVITY_CAIN:
+                pcolumn[0] = FV;
+                break;
+            case CSTR_SENSITIVITY_CBIN:
+                pcolumn[1] = FV;
+                break;
+            case CSTR_SENSITIVITY_TIN:
+                pcolumn[2] = FV;
+                break;
+            default: // sigma only enters the diffusion
+                break;
+        }
+    }
+}
+
+void CSTR_3D_diffusion_parameter_jacobian(
+    double *pt,
+    double *px, 
+    double *pu, 
+    double *pd, 
+    void *pP,
+    double *pxdot
+){
+    CSTR_parameters *params = (CSTR_parameters *) pP;
+    double f = pu[0];
+    int i;
+
+    // Derivatives with respect to F
+    pxdot[0] = 0;
+    pxdot[1] = 0;
+    pxdot[2] = params->sigma/params->V;
+
+    // Only sigma enters the diffusion
+    for (i=0;i<params->num_sensitivity_parameters;i++){
+        pxdot[3*(i+1)+0] = 0;
+        pxdot[3*(i+1)+1] = 0;
+        pxdot[3*(i+1)+2] = (params->sensitivity_parameters[i] == CSTR_SENSITIVITY_SIGMA) ? f/params->V : 0;
+    }
+}
+
+int implicit_simulation_sensitivity(
+    double *pt,
+    double *px,
+    double *pS,
+    double *pdW,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    int max_iterations,
+    double tolerance,
+    double *pu,
+    double *pd,
+    CSTR_parameters *pP,
+    int num_realizations,
+    int num_samples,
+    int time_steps_per_sample,
+    int N,
+    int n,
+    int dw_increment,
+    int p_increment
+){
+    int i = 0;
+    int failures;
+    int failed_realizations = 0;
+    int j = 0;
+    int c = 0;
+    int x_index_outer = 0;
+    int x_index_inner = 0;
+    int s_index_outer = 0;
+    int s_index_inner = 0;
+    int dw_index_outer = 0;
+    int dw_index_inner = 0;
+    int t_index = 0;
+    int p_index = 0;
+    int np = 1+pP->num_sensitivity_parameters;
+    int ns = num_samples+pP->num_sensitivity_parameters;
+    int x_increment = n*(N+1);
+    int s_increment = n*ns*(N+1);
+    int sample_size = n*time_steps_per_sample;
+    int sample_size_S = n*ns*time_steps_per_sample;
+    // Mapping the parameter columns to the sensitivity matrix
+    int *pcolumns = &pworkspace_d[n];
+    for (c=1;c<np;c++){
+        pcolumns[c] = num_samples+c-1;
+    }
+    for (i=0;i<num_realizations;i++){
+        failures = 0;
+        x_index_inner = x_index_outer;
+        s_index_inner = s_index_outer;
+        dw_index_inner = dw_index_outer;
+        // No dependency in the initial condition
+        for (c=0;c<n*ns;c++){
+            pS[s_index_inner+c] = 0;
+        }
+        for (j=0;j<num_samples;j++){
+            // The flow rate of this sample enters column j
+            pcolumns[0] = j;
+            failures += vector_implicit_euler_sensitivity(
+                time_steps_per_sample,
+                n,
+                ns,
+                &pt[t_index],
+                &px[x_index_inner],
+                &pS[s_index_inner],
+                &pdW[dw_index_inner],
+                pworkspace_lf,
+                pworkspace_d,
+                max_iterations,
+                tolerance,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                CSTR_3D_drift_parameter_jacobian,
+                CSTR_3D_diffusion_parameter_jacobian,
+                np,
+                pcolumns,
+                &pu[j],
+                pd,
+                &pP[p_index],
+                &px[x_index_inner],
+                &pS[s_index_inner]
+            );
+            x_index_inner += sample_size;
+            s_index_inner += sample_size_S;
+            dw_index_inner += sample_size;
+            t_index += time_steps_per_sample;
+        }
+        failed_realizations += failures > 0;
         x_index_outer += x_increment;
+        s_index_outer += s_increment;
         dw_index_outer += dw_increment;
         t_index = 0;
         p_index += p_increment;
     }
+    return failed_realizations;
 }
@@ -1,6 +1,9 @@
 #ifndef CSTR_MODEL_PARAMETERS
 #define CSTR_MODEL_PARAMETERS
 
+#include "Arrhenius.h"
+#include "Dual.h"
+
 /**
  * This generec function type will be used throughout all solvers in this library. It is meant for returning \f$f\f$ in 
  * \f$dx = f(t,x,u,d,p) dt\f$ where \f$t\f$ is the temporal solution, \f$x\f$ is the spatial solution, \f$u\f$ is the control parameter,
@@ -52,6 +55,8 @@ void flow_rate(double *parray);
 
 typedef struct CSTR_parameters{
    double *flow_rate;
+   int *sensitivity_parameters; // CSTR_sensitivity values, used by the sensitivity functions
+   int num_sensitivity_parameters;
    double final_time;
    double EaR;
    double rho;
@@ -64,8 +69,26 @@ typedef struct CSTR_parameters{
    double V;
    double k0;
    double sigma;
+   arrhenius_table *parrhenius; // Optional table of the rate constant, see arrhenius_rate(), NULL to use exp()
 } CSTR_parameters;
 
+/**
+ * The parameters of the CSTR model which sensitivities can be computed with respect to. The parameters are
+ * selected by setting sensitivity_parameters and num_sensitivity_parameters in CSTR_parameters.
+ *
+ *@date: 19th of October 2026
+ */
+
+typedef enum CSTR_sensitivity{
+   CSTR_SENSITIVITY_K0,
+   CSTR_SENSITIVITY_EAR,
+   CSTR_SENSITIVITY_BETA,
+   CSTR_SENSITIVITY_SIGMA,
+   CSTR_SENSITIVITY_CAIN,
+   CSTR_SENSITIVITY_CBIN,
+   CSTR_SENSITIVITY_TIN
+} CSTR_sensitivity;
+
 /**
  * The following values and units are used for the parameters:
  * flow_rate:           [mL / min]
@@ -81,6 +104,8 @@ typedef struct CSTR_parameters{
  * V: 0.105             [L]
  * k0: 4.8266*10^10     [L / (mol * S)]
  * sigma: 10 
+ * sensitivity_parameters: NULL
+ * num_sensitivity_parameters: 0
  *
  *@author: Anton Rydahl
  *@date: 8th of October 2020        
@@ -141,9 +166,235 @@ void CSTR_3D_diffusion(double *pt,double *px, double *pu, double *pd, void *pP,d
 
 void CSTR_3D_drift_jacobian(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
 
+/**
+ * Single precision version of CSTR_3D_drift_jacobian() of the type functiontype_float(), for the mixed precision
+ * solver vector_implicit_euler_mixed().
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(float).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the Jacobian in column major order. Must be of size 9*sizeof(float).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_drift_jacobian_float(double *pt,float *px, double *pu, double *pd, void *pP,float *pxdot);
+
+/**
+ * CSTR_3D_drift() in dual numbers, see Dual.h. The values of the outputs are bitwise those of CSTR_3D_drift(), and
+ * their derivatives are the products of the Jacobian of the drift and the derivatives of the states.
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution with its derivatives. Must be 3*sizeof(dual3).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the drift with its derivatives. Must be 3*sizeof(dual3).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_drift_dual(double *pt,dual3 *px, double *pu, double *pd, void *pP,dual3 *pxdot);
+
+/**
+ * Jacobian of the drift in column major order by forward mode automatic differentiation of CSTR_3D_drift_dual(),
+ * which can be used in place of CSTR_3D_drift_jacobian().
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(double).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the Jacobian. Must be of size 9*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_drift_jacobian_ad(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Drift and its Jacobian from one evaluation of CSTR_3D_drift_dual(), for newton_solver() and
+ * vector_implicit_euler() with J_func NULL, which evaluate the drift and the Jacobian at the same states.
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(double).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the drift followed by the Jacobian in column major order. Must be of size
+ * 12*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_drift_fused(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * CSTR_3D_drift_fused() for many states. The rate constants are evaluated first with arrhenius_rate_batch(), and the
+ * dual number drift is then evaluated in a loop which the compiler vectorizes across the states.
+ *
+ * @param[in] count: Number of states.
+ * @param[in] px: The states, \f$C_A\f$, \f$C_B\f$ and \f$T\f$ of every state. Must be 3*count*sizeof(double).
+ * @param[in] pu: Flow rates. State i uses pu[i*u_increment].
+ * @param[in] u_increment: Offset between the flow rates of consecutive states, 0 for one flow rate for all.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in] pworkspace: Memory for the temperatures and rate constants. Must be 2*count*sizeof(double).
+ * @param[out] pxdot: The drift followed by the Jacobian of every state. Must be 12*count*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_drift_fused_batch(int count, double *px, double *pu, int u_increment, void *pP, double *pworkspace,
+    double *pxdot);
+
+/**
+ * Linear dilution part of CSTR_3D_drift() for vector_exponential_euler(). All three states relax to their inflow
+ * values at the rate \f$F/V\f$.
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Unused.
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the rates \f$F/V\f$ followed by \f$C_{A,in}\f$, \f$C_{B,in}\f$ and \f$T_{in}\f$. Must be of size 6*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_dilution(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Reaction part of CSTR_3D_drift(), i.e. the drift without the dilution of CSTR_3D_dilution().
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(double).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the production rates of \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order.
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_reaction(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Jacobian of CSTR_3D_reaction() in column major order.
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(double).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the Jacobian. Must be of size 9*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_reaction_jacobian(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+
+/**
+ * Derivative of the drift term with respect to the flow rate and the selected parameters. The first column is the
+ * derivative with respect to \f$F\f$ and column \f$i+1\f$ is the derivative with respect to
+ * sensitivity_parameters[i]. The matrix is stored in column major order.
+ * 
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(double).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the derivatives. Must be of size 3*(1+num_sensitivity_parameters)*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_drift_parameter_jacobian(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Derivative of the diffusion term with respect to the flow rate and the selected parameters, with the same
+ * column order as CSTR_3D_drift_parameter_jacobian().
+ * 
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The spatial solution. Must contain \f$C_A\f$, \f$C_B\f$ and \f$T\f$ in this order. Must be 3*sizeof(double).
+ * @param[in] pu: Pointer to the control parameter \f$F(t)\f$.
+ * @param[in] pd: Pointer to disturbance. the input is unused in this case and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_parameters pointer containing all the constants used in the function.
+ * @param[in,out] pxdot: Will contain the derivatives. Must be of size 3*(1+num_sensitivity_parameters)*sizeof(double).
+ *
+ * @date: 19th of October 2026
+ */
+
+void CSTR_3D_diffusion_parameter_jacobian(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Sensitivity augmented version of implicit_simulation(). Besides the trajectories it computes the sensitivities of
+ * the states with respect to the flow rate in every sample and to the parameters selected in pP. The sensitivity
+ * matrix has \f$n_s=\text{num\_samples}+\text{num\_sensitivity\_parameters}\f$ columns: column \f$j<\text{num\_samples}\f$ is the
+ * derivative with respect to the flow rate in sample \f$j\f$ and the remaining columns are the derivatives with respect to
+ * the selected parameters. The initial condition is assumed independent of all of them.
+ * Realizations with a singular Newton system have NaN sensitivities, see vector_implicit_euler_sensitivity().
+ *
+ * @param[in] pt: Pointer to the temporal solution. Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in,out] px: Spatial solution. The initial condition of every realization must be imposed on input.
+ * @param[out] pS: Sensitivities, one \f$n\times n_s\f$ matrix per time step. Must be of size \f$n\cdot n_s\cdot(N+1)\cdot\text{num\_realizations}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pdW: White noise.
+ * @param[in] pworkspace_lf: Workspace. Must be of size \f$n\cdot(5+2n+2(1+\text{num\_sensitivity\_parameters})+n_s)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pworkspace_d: Workspace for DGESV. Must be of size \f$(n+1+\text{num\_sensitivity\_parameters})\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] pu: The flow rate in every sample.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Parameters, including the selected sensitivity parameters.
+ * @param[in] num_realizations: Number of realizations.
+ * @param[in] num_samples: Number of samples.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ * @param[in] N: Total number of time steps.
+ * @param[in] n: Number of states.
+ * @param[in] dw_increment: Offset between the noise of two realizations.
+ * @param[in] p_increment: Offset between the parameters of two realizations.
+ *
+ * @return The number of realizations in which a Newton solve did not converge.
+ *
+ * @date: 19th of October 2026
+ */
+
+int implicit_simulation_sensitivity(
+    double *pt,
+    double *px,
+    double *pS,
+    double *pdW,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    int max_iterations,
+    double tolerance,
+    double *pu,
+    double *pd,
+    CSTR_parameters *pP,
+    int num_realizations,
+    int num_samples,
+    int time_steps_per_sample,
+    int N,
+    int n,
+    int dw_increment,
+    int p_increment
+);
 
+/**
+ * Simulates num_realizations realizations of an experiment of num_samples samples with vector_implicit_euler(),
+ * where the flow rate is constant within a sample. The initial condition of every realization must be imposed on
+ * input. Realization \f$i\f$ uses the noise at offset \f$i\cdot\text{dw\_increment}\f$ of pdW, the parameters at
+ * offset \f$i\cdot\text{p\_increment}\f$ of pP and the flow rates at offset \f$i\cdot\text{u\_increment}\f$ of pu, so
+ * distinct scenarios, e.g. those of scenario_expand(), can be simulated in one call.
+ *
+ * @return The number of realizations in which a Newton solve did not converge, see vector_implicit_euler().
+ *
+ * @date: 19th of October 2026
+ */
 
-void implicit_simulation(
+int implicit_simulation(
     double *pt,
     double *px,
     double *pdW,
@@ -163,7 +414,8 @@ void implicit_simulation(
     int N,
     int n,
     int dw_increment, // if 0, the same measurement noise will be used in all simulations
-    int p_increment // if 0, the same parameter vector will be used in all simulations
+    int p_increment, // if 0, the same parameter vector will be used in all simulations
+    int u_increment // if 0, the same flow rates will be used in all simulations
 );
 
 
@@ -0,0 +1,201 @@
+/// @file CSTRCascade.c
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "CSTRCascade.h"
+
+CSTR_cascade_parameters *CSTR_cascade_create(
+    CSTR_parameters *pP,
+    int num_tanks,
+    int *pupstream
+){
+    if (num_tanks < 1){
+        return NULL;
+    }
+    int i;
+    if (pupstream != NULL){
+        for (i=0;i<num_tanks;i++){
+            if (pupstream[i] >= i){
+                return NULL;
+            }
+        }
+    }
+    CSTR_cascade_parameters *pcascade = (CSTR_cascade_parameters*) calloc(1,sizeof(CSTR_cascade_parameters));
+    if (pcascade == NULL){
+        return NULL;
+    }
+    pcascade->pupstream = (int*) malloc(num_tanks*sizeof(int));
+    pcascade->pfraction = (double*) malloc(num_tanks*sizeof(double));
+    int *pnum_downstream = (int*) calloc(num_tanks,sizeof(int));
+    if (pcascade->pupstream == NULL || pcascade->pfraction == NULL || pnum_downstream == NULL){
+        free(pnum_downstream);
+        CSTR_cascade_destroy(pcascade);
+        return NULL;
+    }
+    pcascade->num_tanks = num_tanks;
+    pcascade->n = 3*num_tanks;
+    pcascade->tank = *pP;
+    for (i=0;i<num_tanks;i++){
+        pcascade->pupstream[i] = (pupstream == NULL) ? i-1 : (pupstream[i] < 0 ? -1 : pupstream[i]);
+    }
+
+    // Equal splits of the feed and of the outflow of every tank
+    int num_fed = 0;
+    for (i=0;i<num_tanks;i++){
+        if (pcascade->pupstream[i] < 0){
+            num_fed++;
+        }
+        else {
+            pnum_downstream[pcascade->pupstream[i]]++;
+        }
+    }
+    int max_distance = 0;
+    for (i=0;i<num_tanks;i++){
+        int up = pcascade->pupstream[i];
+        if (up < 0){
+            pcascade->pfraction[i] = 1.0/num_fed;
+        }
+        else {
+            pcascade->pfraction[i] = pcascade->pfraction[up]/pnum_downstream[up];
+            if (i-up > max_distance){
+                max_distance = i-up;
+            }
+        }
+    }
+    free(pnum_downstream);
+
+    // Tank i depends on the same state of its upstream tank, 3*(i-up) rows above the diagonal
+    pcascade->kl = (3*max_distance > 2) ? 3*max_distance : 2;
+    pcascade->ku = 2;
+    return pcascade;
+}
+
+void CSTR_cascade_destroy(
+    CSTR_cascade_parameters *pP
+){
+    if (pP == NULL){
+        return;
+    }
+    free(pP->pfraction);
+    free(pP->pupstream);
+    free(pP);
+}
+
+void CSTR_cascade_drift(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_cascade_parameters *pcascade = (CSTR_cascade_parameters *) pP;
+    CSTR_parameters *params = &pcascade->tank;
+    int i;
+    for (i=0;i<pcascade->num_tanks;i++){
+        double *px_tank = &px[3*i];
+        int up = pcascade->pupstream[i];
+        double CAin = (up < 0) ? params->CAin : px[3*up];
+        double CBin = (up < 0) ? params->CBin : px[3*up+1];
+        double Tin = (up < 0) ? params->Tin : px[3*up+2];
+
+        //  Arrhenius expression
+        double r = arrhenius_rate(params->parrhenius,params->k0,params->EaR,px_tank[2])*px_tank[0]*px_tank[1];
+        double FV = pcascade->pfraction[i]*pu[0]/params->V;
+
+        pxdot[3*i] = FV*(CAin-px_tank[0]) - r;
+        pxdot[3*i+1] = FV*(CBin-px_tank[1]) - 2*r;
+        pxdot[3*i+2] = FV*(Tin-px_tank[2]) + params->beta*r;
+    }
+}
+
+void CSTR_cascade_diffusion(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_cascade_parameters *pcascade = (CSTR_cascade_parameters *) pP;
+    CSTR_parameters *params = &pcascade->tank;
+    int i;
+    for (i=0;i<pcascade->num_tanks;i++){
+        pxdot[3*i] = 0;
+        pxdot[3*i+1] = 0;
+        pxdot[3*i+2] = (params->sigma*pcascade->pfraction[i]*pu[0])/params->V;
+    }
+}
+
+// Writes the nonzero elements of the Jacobian. Element (row, col) is stored at offset+row-col+col*stride, which is
+// column major storage with stride n+1 and offset 0, and band storage with stride 2kl+ku+1 and offset kl+ku.
+static void fill_jacobian(
+    CSTR_cascade_parameters *pcascade,
+    double *px,
+    double f,
+    double *pJ,
+    int stride,
+    int offset
+){
+    CSTR_parameters *params = &pcascade->tank;
+    int i, c;
+    for (i=0;i<pcascade->num_tanks;i++){
+        int d = 3*i;
+        double CA = px[d];
+        double CB = px[d+1];
+        double temperature = px[d+2];
+        double k_arrhenius = arrhenius_rate(params->parrhenius,params->k0,params->EaR,temperature);
+        double FV = pcascade->pfraction[i]*f/params->V;
+        double kCA = k_arrhenius*CA;
+        double kCB = k_arrhenius*CB;
+        double kT = CA*CB*params->EaR*k_arrhenius/(temperature*temperature);
+
+        // Block of the tank itself, as in CSTR_3D_drift_jacobian()
+        pJ[offset+(d)*stride] = -FV-kCB;
+        pJ[offset+1+(d)*stride] = -(kCB+kCB);
+        pJ[offset+2+(d)*stride] = params->beta*kCB;
+        pJ[offset-1+(d+1)*stride] = -kCA;
+        pJ[offset+(d+1)*stride] = -FV-(kCA+kCA);
+        pJ[offset+1+(d+1)*stride] = params->beta*kCA;
+        pJ[offset-2+(d+2)*stride] = -kT;
+        pJ[offset-1+(d+2)*stride] = -(kT+kT);
+        pJ[offset+(d+2)*stride] = -FV+params->beta*kT;
+
+        // Inflow from the upstream tank
+        int up = pcascade->pupstream[i];
+        if (up >= 0){
+            for (c=0;c<3;c++){
+                pJ[offset+(d-3*up)+(3*up+c)*stride] = FV;
+            }
+        }
+    }
+}
+
+void CSTR_cascade_drift_jacobian(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_cascade_parameters *pcascade = (CSTR_cascade_parameters *) pP;
+    int n = pcascade->n;
+    memset(pxdot,0,n*n*sizeof(double));
+    fill_jacobian(pcascade,px,pu[0],pxdot,n+1,0);
+}
+
+void CSTR_cascade_drift_jacobian_banded(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    CSTR_cascade_parameters *pcascade = (CSTR_cascade_parameters *) pP;
+    int LDAB = 2*pcascade->kl+pcascade->ku+1;
+    memset(pxdot,0,LDAB*pcascade->n*sizeof(double));
+    fill_jacobian(pcascade,px,pu[0],pxdot,LDAB,pcascade->kl+pcascade->ku);
+}
@@ -0,0 +1,126 @@
+/// @file CSTRCascade.h
+
+#ifndef CSTR_CASCADE
+#define CSTR_CASCADE
+
+#include "CSTR.h"
+
+/**
+ * Network of \f$M\f$ adiabatic CSTRs, each described by the model of CSTR_3D_drift(), with \f$3M\f$ states ordered
+ * \f$(C_{A,0},C_{B,0},T_0,\dots,C_{A,M-1},C_{B,M-1},T_{M-1})\f$. The topology is given by the upstream tank of
+ * every tank: tank \f$i\f$ is fed by the outflow of tank pupstream[i] \f$<i\f$, or by the feed if pupstream[i] is
+ * negative. The feed flow rate \f$F\f$ is split equally between the tanks fed by the feed, and the outflow of a tank
+ * is split equally between the tanks it feeds, so tank \f$i\f$ has the flow rate \f$\phi_iF\f$. Every tank has the
+ * volume and the temperature noise of CSTR_3D_diffusion() with its own flow rate.
+ *
+ * Tank \f$i\f$ only depends on itself and its upstream tank, so the Jacobian has \f$k_u=2\f$ superdiagonals and
+ * \f$k_l=\max(2,3\max_i(i-\text{pupstream}[i]))\f$ subdiagonals, i.e. \f$k_l=3\f$ for tanks in series.
+ * CSTR_cascade_drift_jacobian_banded() returns it in the band storage of newton_solver_banded(), such that
+ * the cascade can be simulated with vector_implicit_euler_banded() in time linear in \f$M\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct CSTR_cascade_parameters{
+    int num_tanks;              // Number of tanks M
+    int n;                      // Number of states 3M
+    int kl;                     // Number of subdiagonals of the Jacobian
+    int ku;                     // Number of superdiagonals of the Jacobian
+    int *pupstream;             // Upstream tank of every tank or -1 for the feed, num_tanks
+    double *pfraction;          // Fraction of the feed flow rate through every tank, num_tanks
+    CSTR_parameters tank;       // Parameters of every tank
+} CSTR_cascade_parameters;
+
+/**
+ * Allocates the parameters of a cascade.
+ *
+ * @param[in] pP: Pointer to the parameters of a single tank. The struct is copied.
+ * @param[in] num_tanks: Number of tanks.
+ * @param[in] pupstream: Upstream tank of every tank, smaller than the index of the tank, or negative for the feed.
+ * If NULL, the tanks are in series. Must be of size \f$\text{num\_tanks}\cdot\text{sizeof}(\text{int})\f$.
+ *
+ * @return Pointer to the parameters or NULL if the memory could not be allocated or the topology is invalid.
+ *
+ * @date 19th of October 2026
+ */
+
+CSTR_cascade_parameters *CSTR_cascade_create(
+    CSTR_parameters *pP,
+    int num_tanks,
+    int *pupstream
+);
+
+/**
+ * Frees the parameters of a cascade.
+ *
+ * @param[in] pP: Pointer to the parameters. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_cascade_destroy(
+    CSTR_cascade_parameters *pP
+);
+
+/**
+ * Drift term of the cascade.
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The states of all tanks. Must be 3*num_tanks*sizeof(double).
+ * @param[in] pu: Pointer to the feed flow rate \f$F(t)\f$ in [L / s].
+ * @param[in] pd: Pointer to disturbance. Unused and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_cascade_parameters.
+ * @param[in,out] pxdot: The derivatives of all states. Must be 3*num_tanks*sizeof(double).
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_cascade_drift(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Diffusion term of the cascade. Only the temperatures have noise.
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The states of all tanks. Must be 3*num_tanks*sizeof(double).
+ * @param[in] pu: Pointer to the feed flow rate \f$F(t)\f$ in [L / s].
+ * @param[in] pd: Pointer to disturbance. Unused and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_cascade_parameters.
+ * @param[in,out] pxdot: The diffusion of all states. Must be 3*num_tanks*sizeof(double).
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_cascade_diffusion(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Dense Jacobian of the drift term in column major order for vector_implicit_euler().
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The states of all tanks. Must be 3*num_tanks*sizeof(double).
+ * @param[in] pu: Pointer to the feed flow rate \f$F(t)\f$ in [L / s].
+ * @param[in] pd: Pointer to disturbance. Unused and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_cascade_parameters.
+ * @param[in,out] pxdot: The Jacobian. Must be \f$(3M)^2\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_cascade_drift_jacobian(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+/**
+ * Jacobian of the drift term in the band storage of newton_solver_banded() with the bandwidths kl and ku of the
+ * parameters, for vector_implicit_euler_banded().
+ *
+ * @param[in] pt: The temporal solution. Must be 1*sizeof(double).
+ * @param[in] px: The states of all tanks. Must be 3*num_tanks*sizeof(double).
+ * @param[in] pu: Pointer to the feed flow rate \f$F(t)\f$ in [L / s].
+ * @param[in] pd: Pointer to disturbance. Unused and can be set to NULL.
+ * @param[in] pP: Void pointer to CSTR_cascade_parameters.
+ * @param[in,out] pxdot: The banded Jacobian. Must be \f$(2k_l+k_u+1)\cdot 3M\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_cascade_drift_jacobian_banded(double *pt,double *px, double *pu, double *pd, void *pP,double *pxdot);
+
+#endif
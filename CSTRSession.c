@@ -0,0 +1,260 @@
+/// @file CSTRSession.c
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "CSTRSession.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+
+struct CSTR_session{
+    int n;                          // Number of states
+    int num_samples;                // Number of samples in the experiment
+    int time_steps_per_sample;      // Implicit Euler steps per sample
+    int N;                          // Number of time steps
+    int max_realizations;           // Capacity of pX and pdW
+    int num_realizations;           // Realizations of the last run
+    int num_threads;                // Threads of a run and number of workspaces
+    int max_iterations;             // Newton iterations per step
+    double tolerance;               // Newton tolerance
+    unsigned long seed;             // Base seed
+    unsigned long next_realization; // Number of the next realization
+    unsigned long first_realization;// Number of the first realization of the last run
+    CSTR_parameters params;         // Model parameters
+    double *pt;                     // Time grid, (N+1)
+    double *pu;                     // Flow rate in every sample of the last run [L / s], num_samples
+    double *pX;                     // Trajectories, n*(N+1)*max_realizations
+    double *pdW;                    // Noise, (n*N+1)*max_realizations
+    double *pmean;                  // Mean of the last run, n*(N+1)
+    double *pM2;                    // Sums of squared deviations of the last run, n*(N+1)
+    double *pworkspace_lf;          // Per thread solver workspace, num_threads*n*(5+2n)
+    int *pworkspace_d;              // Per thread pivots, num_threads*n
+    unsigned long *pgenerators;     // Per thread Mersenne Twister generators, num_threads*624
+};
+
+// Simulates the samples first_sample to num_samples-1 of the realizations of the last run from their states at the
+// start of first_sample, with the noise of pdW
+static void session_simulate(
+    CSTR_session *ps,
+    int first_sample
+){
+    int n = ps->n;
+    int N = ps->N;
+    int size_x = n*(N+1);
+    int size_dW = n*N+1;
+    int first_step = first_sample*ps->time_steps_per_sample;
+    int i;
+
+    #pragma omp parallel for num_threads(ps->num_threads) schedule(dynamic,1)
+    for (i=0;i<ps->num_realizations;i++){
+        int thread_index = omp_get_thread_num();
+        implicit_simulation(
+            &ps->pt[first_step],
+            &ps->pX[(size_t) size_x*i+n*first_step],
+            &ps->pdW[(size_t) size_dW*i+n*first_step],
+            &ps->pworkspace_lf[n*(5+2*n)*thread_index],
+            &ps->pworkspace_d[n*thread_index],
+            ps->max_iterations,
+            ps->tolerance,
+            CSTR_3D_drift,
+            CSTR_3D_diffusion,
+            CSTR_3D_drift_jacobian,
+            &ps->pu[first_sample],
+            NULL,
+            &ps->params,
+            1,
+            ps->num_samples-first_sample,
+            ps->time_steps_per_sample,
+            N-first_step,
+            n,
+            0,
+            0,
+            0
+        );
+    }
+}
+
+// Welford updates in the order of the realizations from time step first_step
+static void session_welford(
+    CSTR_session *ps,
+    int first_step
+){
+    int size_x = ps->n*(ps->N+1);
+    int first = ps->n*first_step;
+    int i, k;
+    memset(&ps->pmean[first],0,(size_x-first)*sizeof(double));
+    memset(&ps->pM2[first],0,(size_x-first)*sizeof(double));
+    for (i=0;i<ps->num_realizations;i++){
+        double *px = &ps->pX[(size_t) size_x*i];
+        for (k=first;k<size_x;k++){
+            double delta = px[k]-ps->pmean[k];
+            ps->pmean[k] += delta/(i+1);
+            ps->pM2[k] += delta*(px[k]-ps->pmean[k]);
+        }
+    }
+}
+
+CSTR_session *CSTR_session_create(
+    CSTR_parameters *pP,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    int max_realizations,
+    int num_threads,
+    unsigned long seed
+){
+    if (num_samples < 1 || time_steps_per_sample < 1 || sample_time <= 0 || max_realizations < 1 || num_threads < 0){
+        return NULL;
+    }
+    CSTR_session *ps = (CSTR_session*) calloc(1,sizeof(CSTR_session));
+    if (ps == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int N = num_samples*time_steps_per_sample;
+    ps->n = n;
+    ps->num_samples = num_samples;
+    ps->time_steps_per_sample = time_steps_per_sample;
+    ps->N = N;
+    ps->max_realizations = max_realizations;
+    ps->num_threads = (num_threads > 0) ? num_threads : omp_get_max_threads();
+    ps->max_iterations = 20;
+    ps->tolerance = 10e-6;
+    ps->params = *pP;
+    ps->params.flow_rate = NULL;
+    ps->params.sensitivity_parameters = NULL;
+    ps->params.num_sensitivity_parameters = 0;
+    ps->pt = (double*) malloc((N+1)*sizeof(double));
+    ps->pu = (double*) malloc(num_samples*sizeof(double));
+    ps->pX = (double*) malloc((size_t) n*(N+1)*max_realizations*sizeof(double));
+    ps->pdW = (double*) malloc((size_t) (n*N+1)*max_realizations*sizeof(double));
+    ps->pmean = (double*) calloc(n*(N+1),sizeof(double));
+    ps->pM2 = (double*) calloc(n*(N+1),sizeof(double));
+    ps->pworkspace_lf = (double*) malloc(ps->num_threads*n*(5+2*n)*sizeof(double));
+    ps->pworkspace_d = (int*) malloc(ps->num_threads*n*sizeof(int));
+    ps->pgenerators = (unsigned long*) malloc(ps->num_threads*624*sizeof(unsigned long));
+    if (ps->pt == NULL || ps->pu == NULL || ps->pX == NULL || ps->pdW == NULL || ps->pmean == NULL
+        || ps->pM2 == NULL || ps->pworkspace_lf == NULL || ps->pworkspace_d == NULL || ps->pgenerators == NULL){
+        CSTR_session_destroy(ps);
+        return NULL;
+    }
+    linspace(ps->pt,0,num_samples*sample_time,N);
+    CSTR_session_seed(ps,seed);
+    return ps;
+}
+
+void CSTR_session_seed(
+    CSTR_session *ps,
+    unsigned long seed
+){
+    ps->seed = seed;
+    ps->next_realization = 0;
+}
+
+int CSTR_session_run(
+    CSTR_session *ps,
+    double *pu,
+    double *px0,
+    int num_realizations
+){
+    if (num_realizations < 1 || num_realizations > ps->max_realizations){
+        return -1;
+    }
+    int n = ps->n;
+    int N = ps->N;
+    int size_x = n*(N+1);
+    int size_dW = n*N+1;
+    double sqrtdt = sqrt(ps->pt[1]-ps->pt[0]);
+    int i;
+    for (i=0;i<ps->num_samples;i++){
+        ps->pu[i] = pu[i]/(60*1000);
+    }
+
+    // The noise is kept for CSTR_session_edit()
+    ps->first_realization = ps->next_realization;
+    ps->num_realizations = num_realizations;
+    #pragma omp parallel for num_threads(ps->num_threads) schedule(static)
+    for (i=0;i<num_realizations;i++){
+        int thread_index = omp_get_thread_num();
+        d_rand_normal_seeded(&ps->pdW[(size_t) size_dW*i],&ps->pgenerators[624*thread_index],n*N+((n*N)&1),
+            mersenne_stream_seed(ps->seed,ps->first_realization+i),0,sqrtdt);
+        memcpy(&ps->pX[(size_t) size_x*i],px0,n*sizeof(double));
+    }
+    session_simulate(ps,0);
+    ps->next_realization += num_realizations;
+    session_welford(ps,0);
+    return 0;
+}
+
+int CSTR_session_edit(
+    CSTR_session *ps,
+    double *pu
+){
+    if (ps->num_realizations == 0){
+        return -1;
+    }
+    int first_sample = ps->num_samples;
+    int i;
+    for (i=ps->num_samples-1;i>=0;i--){
+        double u = pu[i]/(60*1000);
+        if (u != ps->pu[i]){
+            ps->pu[i] = u;
+            first_sample = i;
+        }
+    }
+    if (first_sample == ps->num_samples){
+        return first_sample;
+    }
+    session_simulate(ps,first_sample);
+    session_welford(ps,first_sample*ps->time_steps_per_sample);
+    return first_sample;
+}
+
+int CSTR_session_statistics(
+    CSTR_session *ps,
+    double *pmean,
+    double *pstd
+){
+    int size_x = ps->n*(ps->N+1);
+    int k;
+    int m = ps->num_realizations;
+    for (k=0;k<size_x;k++){
+        if (pmean != NULL){
+            pmean[k] = ps->pmean[k];
+        }
+        if (pstd != NULL){
+            pstd[k] = (m > 1) ? sqrt(ps->pM2[k]/(m-1)) : 0;
+        }
+    }
+    return m;
+}
+
+const double *CSTR_session_trajectories(
+    CSTR_session *ps,
+    int *pN
+){
+    if (pN != NULL){
+        *pN = ps->N;
+    }
+    return ps->pX;
+}
+
+void CSTR_session_destroy(
+    CSTR_session *ps
+){
+    if (ps == NULL){
+        return;
+    }
+    free(ps->pgenerators);
+    free(ps->pworkspace_d);
+    free(ps->pworkspace_lf);
+    free(ps->pM2);
+    free(ps->pmean);
+    free(ps->pdW);
+    free(ps->pX);
+    free(ps->pu);
+    free(ps->pt);
+    free(ps);
+}
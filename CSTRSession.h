@@ -0,0 +1,160 @@
+/// @file CSTRSession.h
+
+#ifndef CSTR_SESSION
+#define CSTR_SESSION
+
+#include "CSTR.h"
+
+/**
+ * Session of open loop simulations of the CSTR for embedding the simulator in other software through libcstr, see
+ * the targets libcstr.a and libcstr.so of the Makefile. A session owns its parameters, time grid, trajectories,
+ * noise, solver workspaces and Mersenne Twister generators, which are allocated once by CSTR_session_create(), so
+ * repeated calls to CSTR_session_run() do not allocate. It does not use the global seed of mersenne_twister(): the
+ * realizations of a session are numbered from 0 over all its runs, and realization \f$i\f$ draws its noise from the
+ * seed mersenne_stream_seed(seed, i). Hence the results do not depend on the number of threads or on other
+ * sessions, and different sessions may be used concurrently from different threads. A single session must not be
+ * used by several threads at once.
+ *
+ * Every run uses a parallel region with the number of threads of the session. If sessions are run from threads of
+ * an OpenMP parallel region, the inner regions only get more than one thread if nested parallelism is enabled with
+ * omp_set_max_active_levels().
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct CSTR_session CSTR_session;
+
+/**
+ * Allocates a session.
+ *
+ * @param[in] pP: Pointer to the model parameters. The struct is copied.
+ * @param[in] num_samples: Number of samples of an experiment.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] max_realizations: Largest number of realizations of a run.
+ * @param[in] num_threads: Number of threads of a run, or 0 for omp_get_max_threads().
+ * @param[in] seed: Base seed of the noise.
+ *
+ * @return Pointer to the session or NULL if the memory could not be allocated or an argument is invalid.
+ *
+ * @date 19th of October 2026
+ */
+
+CSTR_session *CSTR_session_create(
+    CSTR_parameters *pP,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    int max_realizations,
+    int num_threads,
+    unsigned long seed
+);
+
+/**
+ * Sets the base seed and restarts the numbering of the realizations, such that the next run repeats the first run
+ * with this seed.
+ *
+ * @param[in,out] ps: Pointer to the session.
+ * @param[in] seed: Base seed of the noise.
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_session_seed(
+    CSTR_session *ps,
+    unsigned long seed
+);
+
+/**
+ * Simulates num_realizations realizations of the experiment in parallel and computes the mean and the standard
+ * deviation of every state at every time step over the realizations.
+ *
+ * @param[in,out] ps: Pointer to the session.
+ * @param[in] pu: Flow rate in every sample in [mL / min]. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] px0: Initial state. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_realizations: Number of realizations, at most max_realizations of CSTR_session_create().
+ *
+ * @return 0 on success and -1 if num_realizations is invalid.
+ *
+ * @date 19th of October 2026
+ */
+
+int CSTR_session_run(
+    CSTR_session *ps,
+    double *pu,
+    double *px0,
+    int num_realizations
+);
+
+/**
+ * Repeats the last run with a new flow rate profile, e.g. after an operator has edited the profile. The realizations
+ * keep their noise and initial states, so the result is the same as that of a run with the new profile after
+ * CSTR_session_seed() with the seed of the last run. Since the trajectories and the noise of the last run are kept
+ * in the session, the states at the start of the first sample whose flow rate has changed are known, and only this
+ * sample and the following ones are simulated again. The statistics are updated from the same sample. An edit of
+ * the last samples hence costs a fraction of a run. The edited run replaces the last run, so edits can follow each
+ * other.
+ *
+ * @param[in,out] ps: Pointer to the session.
+ * @param[in] pu: Flow rate in every sample in [mL / min]. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The first sample which was simulated again, num_samples if the profile is unchanged and -1 if there has
+ * been no run.
+ *
+ * @date 19th of October 2026
+ */
+
+int CSTR_session_edit(
+    CSTR_session *ps,
+    double *pu
+);
+
+/**
+ * Copies the statistics of the last run.
+ *
+ * @param[in] ps: Pointer to the session.
+ * @param[out] pmean: Mean of every state at every time step, stored as the trajectories of implicit_simulation().
+ * Must be of size \f$3(N+1)\cdot\text{sizeof}(\text{double})\f$, where \f$N\f$ is the number of time steps. May be NULL.
+ * @param[out] pstd: Standard deviation of every state at every time step. Same size as pmean. May be NULL.
+ *
+ * @return The number of realizations of the last run, 0 if there has been no run.
+ *
+ * @date 19th of October 2026
+ */
+
+int CSTR_session_statistics(
+    CSTR_session *ps,
+    double *pmean,
+    double *pstd
+);
+
+/**
+ * Returns the trajectories of the last run, which are valid until the next run, the next edit or
+ * CSTR_session_destroy().
+ *
+ * @param[in] ps: Pointer to the session.
+ * @param[out] pN: The number of time steps \f$N\f$, such that realization \f$i\f$ starts at index \f$3(N+1)i\f$. May be NULL.
+ *
+ * @return Pointer to the trajectories.
+ *
+ * @date 19th of October 2026
+ */
+
+const double *CSTR_session_trajectories(
+    CSTR_session *ps,
+    int *pN
+);
+
+/**
+ * Frees all memory held by the session.
+ *
+ * @param[in] ps: Pointer to the session. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void CSTR_session_destroy(
+    CSTR_session *ps
+);
+
+#endif
@@ -0,0 +1,362 @@
+/// @file Cache.c
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <time.h>
+#include "Cache.h"
+
+static const char cache_magic[8] = {'C','S','T','R','C','C','H','1'};
+
+// Header of an entry, followed by the key padded to a multiple of 8 bytes and the values
+typedef struct cache_header{
+    char magic[8];
+    unsigned long key_size;
+    long num_values;
+} cache_header;
+
+static unsigned long long fnv1a(
+    const unsigned char *pbytes,
+    size_t size,
+    unsigned long long hash
+){
+    size_t i;
+    for (i=0;i<size;i++){
+        hash ^= pbytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+static size_t padded(
+    size_t size
+){
+    return (size+7)/8*8;
+}
+
+// Path of a file in the directory, allocated with malloc()
+static char *cache_path(
+    result_cache *pc,
+    const char *pname,
+    const char *psuffix
+){
+    size_t size = strlen(pc->pdirectory)+strlen(pname)+strlen(psuffix)+2;
+    char *ppath = (char*) malloc(size);
+    if (ppath != NULL){
+        snprintf(ppath,size,"%s/%s%s",pc->pdirectory,pname,psuffix);
+    }
+    return ppath;
+}
+
+// Current time in seconds, on the clock of the modification times
+static double cache_now(void){
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME,&now);
+    return now.tv_sec+1e-9*now.tv_nsec;
+}
+
+// Position of a name in the index, or -1 - the position at which it would be inserted
+static int index_find(
+    result_cache *pc,
+    const char *pname
+){
+    int low = 0;
+    int high = pc->num_entries;
+    while (low < high){
+        int middle = (low+high)/2;
+        int order = strcmp(pc->pentries[middle].name,pname);
+        if (order == 0){
+            return middle;
+        }
+        if (order < 0){
+            low = middle+1;
+        }
+        else {
+            high = middle;
+        }
+    }
+    return -1-low;
+}
+
+// Adds an entry to the index or updates its size and time of use. Returns -1 if memory could not be allocated
+static int index_update(
+    result_cache *pc,
+    const char *pname,
+    long size,
+    double used
+){
+    int position = index_find(pc,pname);
+    if (position < 0){
+        position = -1-position;
+        if (pc->num_entries == pc->capacity){
+            int capacity = (pc->capacity > 0) ? 2*pc->capacity : 64;
+            cache_index_entry *pnew = (cache_index_entry*) realloc(pc->pentries,capacity*sizeof(cache_index_entry));
+            if (pnew == NULL){
+                return -1;
+            }
+            pc->pentries = pnew;
+            pc->capacity = capacity;
+        }
+        memmove(&pc->pentries[position+1],&pc->pentries[position],
+            (pc->num_entries-position)*sizeof(cache_index_entry));
+        snprintf(pc->pentries[position].name,sizeof(pc->pentries[position].name),"%s",pname);
+        pc->pentries[position].size = 0;
+        pc->num_entries++;
+    }
+    pc->total_bytes += size-pc->pentries[position].size;
+    pc->pentries[position].size = size;
+    pc->pentries[position].used = used;
+    return 0;
+}
+
+// Removes the least recently used entries until the cache fits its size
+static void cache_evict(
+    result_cache *pc
+){
+    while (pc->total_bytes > pc->max_bytes && pc->num_entries > 0){
+        int i;
+        int oldest = 0;
+        for (i=1;i<pc->num_entries;i++){
+            if (pc->pentries[i].used < pc->pentries[oldest].used){
+                oldest = i;
+            }
+        }
+
+        // An entry which another process has removed already is dropped as well
+        char *ppath = cache_path(pc,pc->pentries[oldest].name,".bin");
+        if (ppath == NULL){
+            return;
+        }
+        unlink(ppath);
+        free(ppath);
+        pc->total_bytes -= pc->pentries[oldest].size;
+        memmove(&pc->pentries[oldest],&pc->pentries[oldest+1],
+            (pc->num_entries-oldest-1)*sizeof(cache_index_entry));
+        pc->num_entries--;
+    }
+}
+
+// Builds the index from the entries in the directory
+static int cache_scan(
+    result_cache *pc
+){
+    DIR *pdir = opendir(pc->pdirectory);
+    if (pdir == NULL){
+        return -1;
+    }
+    struct dirent *pent;
+    int status = 0;
+    while (status == 0 && (pent = readdir(pdir)) != NULL){
+        size_t length = strlen(pent->d_name);
+        struct stat file_status;
+        char name[33];
+        if (length != 36 || strcmp(&pent->d_name[32],".bin") != 0){
+            continue;
+        }
+        if (fstatat(dirfd(pdir),pent->d_name,&file_status,0) != 0){
+            continue;
+        }
+        memcpy(name,pent->d_name,32);
+        name[32] = '\0';
+        status = index_update(pc,name,(long) file_status.st_size,
+            file_status.st_mtim.tv_sec+1e-9*file_status.st_mtim.tv_nsec);
+    }
+    closedir(pdir);
+    return status;
+}
+
+result_cache *cache_open(
+    const char *pdirectory,
+    long max_bytes
+){
+    if (mkdir(pdirectory,0755) != 0 && errno != EEXIST){
+        return NULL;
+    }
+    result_cache *pc = (result_cache*) calloc(1,sizeof(result_cache));
+    if (pc == NULL){
+        return NULL;
+    }
+    pc->pdirectory = strdup(pdirectory);
+    pc->max_bytes = max_bytes;
+    if (pc->pdirectory == NULL || cache_scan(pc) != 0){
+        cache_close(pc);
+        return NULL;
+    }
+    cache_evict(pc);
+    return pc;
+}
+
+void cache_close(
+    result_cache *pc
+){
+    if (pc == NULL){
+        return;
+    }
+    free(pc->pentries);
+    free(pc->pdirectory);
+    free(pc);
+}
+
+int cache_key_begin(
+    cache_key *pkey
+){
+    pkey->pbytes = NULL;
+    pkey->size = 0;
+    pkey->capacity = 0;
+    pkey->name[0] = '\0';
+    return cache_key_add(pkey,CACHE_SOLVER_VERSION,sizeof(CACHE_SOLVER_VERSION));
+}
+
+int cache_key_add(
+    cache_key *pkey,
+    const void *pdata,
+    size_t size
+){
+    if (pkey->size+size > pkey->capacity){
+        size_t capacity = (pkey->capacity > 0) ? pkey->capacity : 256;
+        while (capacity < pkey->size+size){
+            capacity *= 2;
+        }
+        unsigned char *pbytes = (unsigned char*) realloc(pkey->pbytes,capacity);
+        if (pbytes == NULL){
+            return -1;
+        }
+        pkey->pbytes = pbytes;
+        pkey->capacity = capacity;
+    }
+    memcpy(&pkey->pbytes[pkey->size],pdata,size);
+    pkey->size += size;
+    return 0;
+}
+
+int cache_key_add_parameters(
+    cache_key *pkey,
+    CSTR_parameters *pP
+){
+    double pvalues[12] = {pP->final_time, pP->EaR, pP->rho, pP->DeltaH, pP->cP, pP->beta, pP->CAin, pP->CBin,
+        pP->Tin, pP->V, pP->k0, pP->sigma};
+    return cache_key_add(pkey,pvalues,sizeof(pvalues));
+}
+
+void cache_key_finish(
+    cache_key *pkey
+){
+    unsigned long long first = fnv1a(pkey->pbytes,pkey->size,0xcbf29ce484222325ULL);
+    unsigned long long second = fnv1a(pkey->pbytes,pkey->size,0x84222325cbf29ce4ULL^pkey->size);
+    snprintf(pkey->name,sizeof(pkey->name),"%016llx%016llx",first,second);
+}
+
+void cache_key_free(
+    cache_key *pkey
+){
+    free(pkey->pbytes);
+    pkey->pbytes = NULL;
+    pkey->size = 0;
+    pkey->capacity = 0;
+}
+
+int cache_lookup(
+    result_cache *pc,
+    cache_key *pkey,
+    cache_entry *pentry
+){
+    memset(pentry,0,sizeof(cache_entry));
+    char *ppath = cache_path(pc,pkey->name,".bin");
+    if (ppath == NULL){
+        return 0;
+    }
+    int fd = open(ppath,O_RDONLY);
+    free(ppath);
+    if (fd < 0){
+        return 0;
+    }
+    struct stat status;
+    size_t offset = sizeof(cache_header)+padded(pkey->size);
+    if (fstat(fd,&status) != 0 || (size_t) status.st_size < offset){
+        close(fd);
+        return 0;
+    }
+    void *pmap = mmap(NULL,status.st_size,PROT_READ,MAP_SHARED,fd,0);
+    if (pmap == MAP_FAILED){
+        close(fd);
+        return 0;
+    }
+    const cache_header *pheader = (const cache_header*) pmap;
+    const unsigned char *pstored_key = (const unsigned char*) pmap+sizeof(cache_header);
+    if (memcmp(pheader->magic,cache_magic,sizeof(cache_magic)) != 0 || pheader->key_size != pkey->size
+        || memcmp(pstored_key,pkey->pbytes,pkey->size) != 0 || pheader->num_values < 0
+        || offset+pheader->num_values*sizeof(double) != (size_t) status.st_size){
+        munmap(pmap,status.st_size);
+        close(fd);
+        return 0;
+    }
+
+    // The modification time orders the entries for other processes sharing the directory
+    futimens(fd,NULL);
+    close(fd);
+    index_update(pc,pkey->name,(long) status.st_size,cache_now());
+    pentry->pmap = pmap;
+    pentry->map_size = status.st_size;
+    pentry->pvalues = (const double*) ((const char*) pmap+offset);
+    pentry->num_values = pheader->num_values;
+    return 1;
+}
+
+void cache_release(
+    cache_entry *pentry
+){
+    if (pentry->pmap != NULL){
+        munmap(pentry->pmap,pentry->map_size);
+    }
+    memset(pentry,0,sizeof(cache_entry));
+}
+
+int cache_store(
+    result_cache *pc,
+    cache_key *pkey,
+    const double *pvalues,
+    long num_values
+){
+    char suffix[32];
+    snprintf(suffix,sizeof(suffix),".tmp%ld",(long) getpid());
+    char *ptemporary = cache_path(pc,pkey->name,suffix);
+    char *ppath = cache_path(pc,pkey->name,".bin");
+    int status = -1;
+    long size = (long) (sizeof(cache_header)+padded(pkey->size)+num_values*sizeof(double));
+    if (ptemporary != NULL && ppath != NULL){
+        FILE *pfile = fopen(ptemporary,"wb");
+        if (pfile != NULL){
+            cache_header header;
+            unsigned char zeros[8] = {0};
+            memcpy(header.magic,cache_magic,sizeof(cache_magic));
+            header.key_size = pkey->size;
+            header.num_values = num_values;
+            int written = fwrite(&header,sizeof(header),1,pfile) == 1
+                && fwrite(pkey->pbytes,1,pkey->size,pfile) == pkey->size
+                && fwrite(zeros,1,padded(pkey->size)-pkey->size,pfile) == padded(pkey->size)-pkey->size
+                && fwrite(pvalues,sizeof(double),num_values,pfile) == (size_t) num_values;
+            written &= fclose(pfile) == 0;
+            if (written && rename(ptemporary,ppath) == 0){
+                status = 0;
+            }
+            else {
+                unlink(ptemporary);
+            }
+        }
+    }
+    free(ppath);
+    free(ptemporary);
+    if (status == 0){
+        index_update(pc,pkey->name,size,cache_now());
+        cache_evict(pc);
+    }
+    return status;
+}
@@ -0,0 +1,208 @@
+/// @file Cache.h
+
+#ifndef CSTR_CACHE
+#define CSTR_CACHE
+
+#include <stddef.h>
+#include "CSTR.h"
+
+/**
+ * Persistent content-addressed cache of simulation results on a local disk. A result is stored under a key, which
+ * holds every input of the simulation as bytes together with CACHE_SOLVER_VERSION, so results of an older solver
+ * are never returned. The file name of an entry is a 128 bit hash of the key, computed with two 64 bit FNV-1a
+ * hashes, and the key itself is stored in the file and compared on lookup, so a hash collision is a miss.
+ *
+ * Entries are written to a temporary file which is renamed, so several processes may share a directory. A hit is
+ * memory-mapped instead of read and returned without a copy, and its modification time is set to the current time.
+ * The directory is only read by cache_open(), which indexes the size and the modification time of every entry. The
+ * stores and hits update the index, and when the size of all indexed entries exceeds the limit of the cache, the least
+ * recently used ones are removed. An entry which another process stores after cache_open() is indexed once it is hit.
+ *
+ * @date 19th of October 2026
+ */
+
+#define CACHE_SOLVER_VERSION "CSTR implicit Euler 1"
+
+typedef struct cache_key{
+    unsigned char *pbytes;      // The inputs
+    size_t size;                // Number of bytes
+    size_t capacity;            // Allocated bytes
+    char name[33];              // Hexadecimal hash of the bytes, set by cache_key_finish()
+} cache_key;
+
+typedef struct cache_index_entry{
+    char name[33];              // Hexadecimal hash of the key
+    long size;                  // Size of the file in bytes
+    double used;                // Time of the last store or hit in seconds
+} cache_index_entry;
+
+typedef struct result_cache{
+    char *pdirectory;           // Directory of the entries
+    long max_bytes;             // Largest size of all entries
+    long total_bytes;           // Size of all indexed entries
+    int num_entries;            // Number of indexed entries
+    int capacity;               // Capacity of pentries
+    cache_index_entry *pentries; // Index of the entries, sorted by name
+} result_cache;
+
+typedef struct cache_entry{
+    void *pmap;                 // The mapped file
+    size_t map_size;            // Size of the mapping
+    const double *pvalues;      // The stored values, within the mapping
+    long num_values;            // Number of values
+} cache_entry;
+
+/**
+ * Opens a cache directory, which is created if it does not exist, indexes its entries and removes the least recently
+ * used ones if they exceed max_bytes.
+ *
+ * @param[in] pdirectory: Path of the directory.
+ * @param[in] max_bytes: Largest size of all entries in bytes.
+ *
+ * @return Pointer to the cache or NULL if the directory could not be created or read.
+ *
+ * @date 19th of October 2026
+ */
+
+result_cache *cache_open(
+    const char *pdirectory,
+    long max_bytes
+);
+
+/**
+ * Frees a cache. The entries are kept on disk.
+ *
+ * @param[in] pc: Pointer to the cache. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void cache_close(
+    result_cache *pc
+);
+
+/**
+ * Starts a key with CACHE_SOLVER_VERSION.
+ *
+ * @param[out] pkey: The key.
+ *
+ * @return 0 on success and -1 if memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+int cache_key_begin(
+    cache_key *pkey
+);
+
+/**
+ * Appends bytes to a key.
+ *
+ * @param[in,out] pkey: The key.
+ * @param[in] pdata: The bytes.
+ * @param[in] size: Number of bytes.
+ *
+ * @return 0 on success and -1 if memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+int cache_key_add(
+    cache_key *pkey,
+    const void *pdata,
+    size_t size
+);
+
+/**
+ * Appends the values of the model parameters which enter implicit_simulation() to a key, i.e. all members of
+ * CSTR_parameters except the pointers.
+ *
+ * @param[in,out] pkey: The key.
+ * @param[in] pP: The parameters.
+ *
+ * @return 0 on success and -1 if memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+int cache_key_add_parameters(
+    cache_key *pkey,
+    CSTR_parameters *pP
+);
+
+/**
+ * Computes the name of a key after all inputs have been added.
+ *
+ * @param[in,out] pkey: The key.
+ *
+ * @date 19th of October 2026
+ */
+
+void cache_key_finish(
+    cache_key *pkey
+);
+
+/**
+ * Frees the bytes of a key.
+ *
+ * @param[in] pkey: The key.
+ *
+ * @date 19th of October 2026
+ */
+
+void cache_key_free(
+    cache_key *pkey
+);
+
+/**
+ * Looks up a key.
+ *
+ * @param[in] pc: Pointer to the cache.
+ * @param[in] pkey: The finished key.
+ * @param[out] pentry: The mapped entry on a hit. Its values are read from the mapping, which stays valid until
+ * cache_release(), also if the entry is removed from the cache in the meantime.
+ *
+ * @return 1 on a hit and 0 on a miss.
+ *
+ * @date 19th of October 2026
+ */
+
+int cache_lookup(
+    result_cache *pc,
+    cache_key *pkey,
+    cache_entry *pentry
+);
+
+/**
+ * Unmaps an entry of cache_lookup().
+ *
+ * @param[in] pentry: The entry.
+ *
+ * @date 19th of October 2026
+ */
+
+void cache_release(
+    cache_entry *pentry
+);
+
+/**
+ * Stores values under a key and removes the least recently used entries if the cache exceeds its size.
+ *
+ * @param[in] pc: Pointer to the cache.
+ * @param[in] pkey: The finished key.
+ * @param[in] pvalues: The values.
+ * @param[in] num_values: Number of values.
+ *
+ * @return 0 on success and -1 if the entry could not be written.
+ *
+ * @date 19th of October 2026
+ */
+
+int cache_store(
+    result_cache *pc,
+    cache_key *pkey,
+    const double *pvalues,
+    long num_values
+);
+
+#endif
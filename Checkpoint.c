@@ -0,0 +1,190 @@
+/// @file Checkpoint.c
+
+#define _POSIX_C_SOURCE 200809L
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include "Checkpoint.h"
+
+static const char checkpoint_magic[8] = {'C','S','T','R','C','K','P','2'};
+
+campaign_checkpoint *checkpoint_create(
+    int num_realizations,
+    int mode,
+    unsigned long inputs,
+    int num_outputs,
+    int num_statistics,
+    unsigned long seed
+){
+    if (num_realizations < 0 || num_outputs < 0 || num_statistics < 0){
+        return NULL;
+    }
+    campaign_checkpoint *pcheckpoint = (campaign_checkpoint*) calloc(1,sizeof(campaign_checkpoint));
+    if (pcheckpoint == NULL){
+        return NULL;
+    }
+    pcheckpoint->num_realizations = num_realizations;
+    pcheckpoint->mode = mode;
+    pcheckpoint->inputs = inputs;
+    pcheckpoint->num_outputs = num_outputs;
+    pcheckpoint->num_statistics = num_statistics;
+    pcheckpoint->seed = seed;
+    pcheckpoint->poutput_offsets = (long*) calloc(num_outputs+1,sizeof(long));
+    pcheckpoint->psum = (double*) calloc(num_statistics+1,sizeof(double));
+    pcheckpoint->psum_squares = (double*) calloc(num_statistics+1,sizeof(double));
+    if (pcheckpoint->poutput_offsets == NULL || pcheckpoint->psum == NULL || pcheckpoint->psum_squares == NULL){
+        checkpoint_destroy(pcheckpoint);
+        return NULL;
+    }
+    return pcheckpoint;
+}
+
+int checkpoint_write(
+    const char *path,
+    campaign_checkpoint *pcheckpoint
+){
+    size_t length = strlen(path);
+    char *ptemporary = (char*) malloc(length+5);
+    if (ptemporary == NULL){
+        return -1;
+    }
+    memcpy(ptemporary,path,length);
+    memcpy(&ptemporary[length],".tmp",5);
+
+    FILE *pfile = fopen(ptemporary,"wb");
+    if (pfile == NULL){
+        free(ptemporary);
+        return -1;
+    }
+    int ok = 1;
+    ok &= fwrite(checkpoint_magic,1,8,pfile) == 8;
+    ok &= fwrite(&pcheckpoint->num_realizations,sizeof(int),1,pfile) == 1;
+    ok &= fwrite(&pcheckpoint->mode,sizeof(int),1,pfile) == 1;
+    ok &= fwrite(&pcheckpoint->num_outputs,sizeof(int),1,pfile) == 1;
+    ok &= fwrite(&pcheckpoint->num_statistics,sizeof(int),1,pfile) == 1;
+    ok &= fwrite(&pcheckpoint->completed,sizeof(unsigned long),1,pfile) == 1;
+    ok &= fwrite(&pcheckpoint->seed,sizeof(unsigned long),1,pfile) == 1;
+    ok &= fwrite(&pcheckpoint->inputs,sizeof(unsigned long),1,pfile) == 1;
+    ok &= fwrite(pcheckpoint->poutput_offsets,sizeof(long),pcheckpoint->num_outputs,pfile) == (size_t) pcheckpoint->num_outputs;
+    ok &= fwrite(pcheckpoint->psum,sizeof(double),pcheckpoint->num_statistics,pfile) == (size_t) pcheckpoint->num_statistics;
+    ok &= fwrite(pcheckpoint->psum_squares,sizeof(double),pcheckpoint->num_statistics,pfile) == (size_t) pcheckpoint->num_statistics;
+
+    // The data must be on disk before the rename makes it the checkpoint
+    ok &= fflush(pfile) == 0;
+    ok &= fsync(fileno(pfile)) == 0;
+    ok &= fclose(pfile) == 0;
+    if (ok){
+        ok = rename(ptemporary,path) == 0;
+    }
+    if (!ok){
+        remove(ptemporary);
+    }
+
+    // The rename is only durable once the directory is on disk
+    if (ok){
+        const char *pslash = strrchr(path,'/');
+        if (pslash != NULL){
+            size_t directory_length = (pslash == path) ? 1 : (size_t) (pslash-path);
+            memcpy(ptemporary,path,directory_length);
+            ptemporary[directory_length] = '\0';
+        }
+        else {
+            strcpy(ptemporary,".");
+        }
+        int fd = open(ptemporary,O_RDONLY);
+        ok = fd >= 0 && fsync(fd) == 0;
+        if (fd >= 0){
+            close(fd);
+        }
+    }
+    free(ptemporary);
+    return ok ? 0 : -1;
+}
+
+long checkpoint_sync_output(
+    FILE *pfile
+){
+    if (fflush(pfile) != 0 || fsync(fileno(pfile)) != 0){
+        return -1;
+    }
+    return ftell(pfile);
+}
+
+campaign_checkpoint *checkpoint_read(
+    const char *path
+){
+    FILE *pfile = fopen(path,"rb");
+    if (pfile == NULL){
+        return NULL;
+    }
+    char magic[8];
+    int header[4];
+    unsigned long counters[3];
+    campaign_checkpoint *pcheckpoint = NULL;
+    if (fread(magic,1,8,pfile) == 8 && memcmp(magic,checkpoint_magic,8) == 0
+        && fread(header,sizeof(int),4,pfile) == 4 && fread(counters,sizeof(unsigned long),3,pfile) == 3){
+        pcheckpoint = checkpoint_create(header[0],header[1],counters[2],header[2],header[3],counters[1]);
+    }
+    if (pcheckpoint != NULL){
+        pcheckpoint->completed = counters[0];
+        int num_outputs = pcheckpoint->num_outputs;
+        int num_statistics = pcheckpoint->num_statistics;
+        if (fread(pcheckpoint->poutput_offsets,sizeof(long),num_outputs,pfile) != (size_t) num_outputs
+            || fread(pcheckpoint->psum,sizeof(double),num_statistics,pfile) != (size_t) num_statistics
+            || fread(pcheckpoint->psum_squares,sizeof(double),num_statistics,pfile) != (size_t) num_statistics
+            || pcheckpoint->completed > (unsigned long) pcheckpoint->num_realizations){
+            checkpoint_destroy(pcheckpoint);
+            pcheckpoint = NULL;
+        }
+    }
+    fclose(pfile);
+    return pcheckpoint;
+}
+
+int checkpoint_truncate_output(
+    const char *path,
+    long offset
+){
+    struct stat status;
+    if (stat(path,&status) != 0 || status.st_size < offset){
+        return -1;
+    }
+    return truncate(path,offset) == 0 ? 0 : -1;
+}
+
+int checkpoint_hash_file(
+    const char *path,
+    unsigned long *phash
+){
+    FILE *pfile = fopen(path,"rb");
+    if (pfile == NULL){
+        return -1;
+    }
+    unsigned char buffer[4096];
+    size_t count, i;
+    while ((count = fread(buffer,1,sizeof(buffer),pfile)) > 0){
+        for (i=0;i<count;i++){
+            *phash ^= buffer[i];
+            *phash *= 0x100000001b3UL;
+        }
+    }
+    int error = ferror(pfile);
+    fclose(pfile);
+    return error ? -1 : 0;
+}
+
+void checkpoint_destroy(
+    campaign_checkpoint *pcheckpoint
+){
+    if (pcheckpoint == NULL){
+        return;
+    }
+    free(pcheckpoint->psum_squares);
+    free(pcheckpoint->psum);
+    free(pcheckpoint->poutput_offsets);
+    free(pcheckpoint);
+}
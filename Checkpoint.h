@@ -0,0 +1,162 @@
+/// @file Checkpoint.h
+
+#ifndef CSTR_CHECKPOINT
+#define CSTR_CHECKPOINT
+
+#include <stdio.h>
+
+/**
+ * Checkpoint of a Monte Carlo campaign whose realizations are simulated in order, block by block. It holds the
+ * number of completed realizations, the seed of mersenne_twister() after the last completed block, the sizes of the
+ * output files written so far and accumulators of sums and sums of squares of some statistics. A campaign resumed
+ * from the checkpoint restores the seed with set_seed(), truncates the output files to the stored sizes and
+ * continues with the next block, such that it gives the same result as an uninterrupted campaign. A hash of the
+ * inputs which are not given by the sizes, e.g. of an input file from checkpoint_hash_file(), is stored with the
+ * checkpoint, so a campaign is not resumed with other inputs.
+ *
+ * The binary format is, in the byte order of the machine:
+ * - 8 bytes: the characters CSTRCKP2
+ * - 4 bytes int: num_realizations
+ * - 4 bytes int: mode
+ * - 4 bytes int: num_outputs
+ * - 4 bytes int: num_statistics
+ * - 8 bytes unsigned long: completed
+ * - 8 bytes unsigned long: seed
+ * - 8 bytes unsigned long: inputs
+ * - 8 bytes long, num_outputs times: output_offsets
+ * - 8 bytes double, num_statistics times: sums
+ * - 8 bytes double, num_statistics times: sums of squares
+ *
+ * checkpoint_write() writes to a temporary file, flushes it to disk, renames it and flushes the directory, so a
+ * crash leaves either the old or the new checkpoint. The output files must be on disk before the checkpoint which
+ * records their sizes, which checkpoint_sync_output() ensures.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct campaign_checkpoint{
+    int num_realizations;       // Total number of realizations in the campaign
+    int mode;                   // Application defined, e.g. open or closed loop
+    int num_outputs;            // Number of output files
+    int num_statistics;         // Number of accumulated statistics
+    unsigned long completed;    // Realizations completed
+    unsigned long seed;         // Seed of mersenne_twister() after the completed realizations
+    unsigned long inputs;       // Application defined hash of the inputs, which must match when resuming
+    long *poutput_offsets;      // Size in bytes of every output file, num_outputs
+    double *psum;               // Sums of the statistics, num_statistics
+    double *psum_squares;       // Sums of squares of the statistics, num_statistics
+} campaign_checkpoint;
+
+/**
+ * Allocates a checkpoint of a campaign which has not started, with zero accumulators and offsets.
+ *
+ * @param[in] num_realizations: Total number of realizations.
+ * @param[in] mode: Application defined mode which must match when resuming.
+ * @param[in] inputs: Application defined hash of the inputs which must match when resuming.
+ * @param[in] num_outputs: Number of output files.
+ * @param[in] num_statistics: Number of accumulated statistics.
+ * @param[in] seed: Seed of the first realization.
+ *
+ * @return Pointer to the checkpoint or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+campaign_checkpoint *checkpoint_create(
+    int num_realizations,
+    int mode,
+    unsigned long inputs,
+    int num_outputs,
+    int num_statistics,
+    unsigned long seed
+);
+
+/**
+ * Writes a checkpoint atomically.
+ *
+ * @param[in] path: Path of the checkpoint file.
+ * @param[in] pcheckpoint: Pointer to the checkpoint.
+ *
+ * @return 0 on success and -1 if the file could not be written.
+ *
+ * @date 19th of October 2026
+ */
+
+int checkpoint_write(
+    const char *path,
+    campaign_checkpoint *pcheckpoint
+);
+
+/**
+ * Reads a checkpoint.
+ *
+ * @param[in] path: Path of the checkpoint file.
+ *
+ * @return Pointer to the checkpoint or NULL if the file could not be read or is not a checkpoint.
+ *
+ * @date 19th of October 2026
+ */
+
+campaign_checkpoint *checkpoint_read(
+    const char *path
+);
+
+/**
+ * Flushes an output file to disk, such that its size can be stored in a checkpoint.
+ *
+ * @param[in] pfile: The output file.
+ *
+ * @return Size of the file in bytes, or -1 if it could not be flushed.
+ *
+ * @date 19th of October 2026
+ */
+
+long checkpoint_sync_output(
+    FILE *pfile
+);
+
+/**
+ * Truncates an output file to the size stored in a checkpoint, removing output written after the checkpoint.
+ *
+ * @param[in] path: Path of the output file.
+ * @param[in] offset: Size in bytes.
+ *
+ * @return 0 on success and -1 if the file is shorter than offset or could not be truncated.
+ *
+ * @date 19th of October 2026
+ */
+
+int checkpoint_truncate_output(
+    const char *path,
+    long offset
+);
+
+/**
+ * Continues a 64 bit FNV-1a hash with the contents of a file.
+ *
+ * @param[in] path: Path of the file.
+ * @param[in,out] phash: Pointer to the hash, which is updated with every byte of the file.
+ *
+ * @return 0 on success and -1 if the file could not be read.
+ *
+ * @date 19th of October 2026
+ */
+
+int checkpoint_hash_file(
+    const char *path,
+    unsigned long *phash
+);
+
+/**
+ * Frees a checkpoint.
+ *
+ * @param[in] pcheckpoint: Pointer to the checkpoint. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void checkpoint_destroy(
+    campaign_checkpoint *pcheckpoint
+);
+
+#endif
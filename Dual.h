@@ -0,0 +1,176 @@
+/// @file Dual.h
+
+#ifndef CSTR_DUAL
+#define CSTR_DUAL
+
+#include <math.h>
+
+/**
+ * Forward mode automatic differentiation with dual numbers. A dual number holds a value \f$v\f$ and its derivatives
+ * \f$d_0,\dots,d_{w-1}\f$ with respect to \f$w\f$ independent variables, and every operation applies the chain rule
+ * to the derivatives, so a function written with these operations returns its Jacobian along with its value. The
+ * independent variable \f$k\f$ is created with type_variable(), which sets the derivative 1 in position \f$k\f$, and
+ * type_store() writes the derivatives of an output as a row of a column major Jacobian, as functiontype() Jacobians
+ * are stored. The value of every operation is computed with the same floating point operations as the corresponding
+ * double expression, so the value of a function written with dual numbers is bitwise that of the double function
+ * when the operations are applied in the same order.
+ *
+ * DUAL_DEFINE(type, width) defines the struct type and the operations type_add(), type_mul() and so on for a fixed
+ * number of derivatives, which lets the compiler unroll the loops over the derivatives and keep a dual number in
+ * registers. All operations are inline functions on values, so the compiler vectorizes a loop over many points
+ * across the points once the dual numbers are promoted to registers. Marking such a loop omp simd keeps local arrays
+ * of dual numbers in memory as arrays per lane, which prevents this, and model functions called from such a loop
+ * should be declared DUAL_INLINE as well. Derivatives which are known to be zero are still multiplied and added, as
+ * IEEE arithmetic does not allow the compiler to drop \f$0\cdot x\f$, so a Jacobian by dual numbers costs more
+ * operations than a hand written one which exploits the sparsity. Functions without an operation here, such as a
+ * table lookup, are applied with type_apply() given their value and derivative.
+ *
+ * @date 19th of October 2026
+ */
+
+// Forces inlining of the operations and of model functions in dual numbers, which a batched loop needs to vectorize
+#if defined(__GNUC__)
+#define DUAL_INLINE static inline __attribute__((always_inline))
+#else
+#define DUAL_INLINE static inline
+#endif
+
+#define DUAL_DEFINE(type, width) \
+\
+typedef struct type{ \
+    double v; \
+    double d[width]; \
+} type; \
+\
+/* A constant, with zero derivatives */ \
+DUAL_INLINE type type##_constant(double value){ \
+    type r; \
+    int i; \
+    r.v = value; \
+    for (i=0;i<width;i++){ \
+        r.d[i] = 0; \
+    } \
+    return r; \
+} \
+\
+/* Independent variable k with the value value */ \
+DUAL_INLINE type type##_variable(double value, int k){ \
+    type r; \
+    int i; \
+    r.v = value; \
+    for (i=0;i<width;i++){ \
+        r.d[i] = (i == k) ? 1 : 0; \
+    } \
+    return r; \
+} \
+\
+/* Writes the derivatives of output row of count outputs to the count x width matrix pJ, column major */ \
+DUAL_INLINE void type##_store(type a, int row, int count, double *pJ){ \
+    int i; \
+    for (i=0;i<width;i++){ \
+        pJ[row+i*count] = a.d[i]; \
+    } \
+} \
+\
+DUAL_INLINE type type##_add(type a, type b){ \
+    int i; \
+    a.v = a.v+b.v; \
+    for (i=0;i<width;i++){ \
+        a.d[i] = a.d[i]+b.d[i]; \
+    } \
+    return a; \
+} \
+\
+DUAL_INLINE type type##_sub(type a, type b){ \
+    int i; \
+    a.v = a.v-b.v; \
+    for (i=0;i<width;i++){ \
+        a.d[i] = a.d[i]-b.d[i]; \
+    } \
+    return a; \
+} \
+\
+DUAL_INLINE type type##_neg(type a){ \
+    int i; \
+    a.v = -a.v; \
+    for (i=0;i<width;i++){ \
+        a.d[i] = -a.d[i]; \
+    } \
+    return a; \
+} \
+\
+/* a+c for a constant c */ \
+DUAL_INLINE type type##_shift(type a, double c){ \
+    a.v = a.v+c; \
+    return a; \
+} \
+\
+/* c-a for a constant c */ \
+DUAL_INLINE type type##_rsub(double c, type a){ \
+    int i; \
+    a.v = c-a.v; \
+    for (i=0;i<width;i++){ \
+        a.d[i] = -a.d[i]; \
+    } \
+    return a; \
+} \
+\
+/* c*a for a constant c */ \
+DUAL_INLINE type type##_scale(type a, double c){ \
+    int i; \
+    a.v = c*a.v; \
+    for (i=0;i<width;i++){ \
+        a.d[i] = c*a.d[i]; \
+    } \
+    return a; \
+} \
+\
+DUAL_INLINE type type##_mul(type a, type b){ \
+    type r; \
+    int i; \
+    r.v = a.v*b.v; \
+    for (i=0;i<width;i++){ \
+        r.d[i] = a.d[i]*b.v+a.v*b.d[i]; \
+    } \
+    return r; \
+} \
+\
+DUAL_INLINE type type##_div(type a, type b){ \
+    type r; \
+    int i; \
+    double inverse = 1/b.v; \
+    r.v = a.v/b.v; \
+    for (i=0;i<width;i++){ \
+        r.d[i] = (a.d[i]-r.v*b.d[i])*inverse; \
+    } \
+    return r; \
+} \
+\
+/* A function of a with the given value and derivative at a.v */ \
+DUAL_INLINE type type##_apply(type a, double value, double derivative){ \
+    int i; \
+    a.v = value; \
+    for (i=0;i<width;i++){ \
+        a.d[i] = derivative*a.d[i]; \
+    } \
+    return a; \
+} \
+\
+DUAL_INLINE type type##_exp(type a){ \
+    double value = exp(a.v); \
+    return type##_apply(a,value,value); \
+} \
+\
+DUAL_INLINE type type##_log(type a){ \
+    return type##_apply(a,log(a.v),1/a.v); \
+} \
+\
+DUAL_INLINE type type##_sqrt(type a){ \
+    double value = sqrt(a.v); \
+    return type##_apply(a,value,0.5/value); \
+}
+
+// Dual numbers with the derivatives with respect to the three states of the CSTR
+DUAL_DEFINE(dual3, 3)
+
+#endif
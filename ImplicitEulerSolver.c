@@ -1,9 +1,10 @@
 #include "ImplicitEulerSolver.h"
+#include "Instrumentation.h"
 #include <stdbool.h>
 #include <math.h>
 #include <stdio.h>
 
-void vector_implicit_euler(
+int vector_implicit_euler(
     int N,
     int n,
     int NS,
@@ -22,6 +23,7 @@ void vector_implicit_euler(
     void *pP,
     double *px0
 ){
+    int failures = 0;
     unsigned int row, col, sim, i,j,k;
     double h; // temporal step
     double *pF = &workspace_lf[0];
@@ -46,9 +48,12 @@ void vector_implicit_euler(
         j = index_X+n;
         k = index_dW;
         for (col = 0; col < N; col++) {
-            // Invoking drift and diffusion terms
+            // Invoking drift and diffusion terms. Without J_func, the Jacobian written by f_func after the drift
+            // extends over pG and ppsi, which are written afterwards.
             f_func(&pt[col],&px[i],pu,pd,pP,pF);
             g_func(&pt[col],&px[i],pu,pd,pP,pG);
+            INSTRUMENT_ADD(f_evaluations,1);
+            INSTRUMENT_ADD(g_evaluations,1);
 
             // Calculating time step
             h = pt[col+1]-pt[col];
@@ -63,7 +68,7 @@ void vector_implicit_euler(
             }
 
             // Invoking newton solver
-            newton_solver(
+            failures += newton_solver(
                 f_func,
                 J_func,
                 max_iterations,
@@ -78,14 +83,15 @@ void vector_implicit_euler(
                 pu,
                 pd,
                 pP
-            );
+            ) < 0;
         }
         index_X += len2dims_X;
         index_dW += len2dims_dW;
     }
+    return failures;
 }
 
-void newton_solver(
+int newton_solver(
     functiontype f_func,
     functiontype J_func,
     int max_iterations,
@@ -106,8 +112,13 @@ void newton_solver(
     double *pdRdX = &workspace_lf[n*(n+1)];
     double *pR = &workspace_lf[n*(n+n+1)];
 
+    // Without J_func, f_func writes the drift and the Jacobian, which follows the drift in the workspace
     f_func(pt, px,pu,pd,pP,pftemp);
-    J_func(pt, px,pu,pd,pP,pjacobian);
+    INSTRUMENT_ADD(f_evaluations,1);
+    if (J_func != NULL){
+        J_func(pt, px,pu,pd,pP,pjacobian);
+    }
+    INSTRUMENT_ADD(J_evaluations,1);
     
     // Initializing residuals
     int i = 0;
@@ -124,6 +135,9 @@ void newton_solver(
     // Minimizing residuals
     int iterations = 0; // of iterations
 
+    // Number of iterations on convergence, -1 if max_iterations is reached and -2 for a singular system
+    int status = -1;
+
     // Boolean to check if the residuals meet the tolerance
     bool has_converged;
 
@@ -156,6 +170,12 @@ void newton_solver(
             &INFO
         );
 
+        // A singular system leaves the solution at the last iterate
+        if (INFO > 0){
+            status = -2;
+            break;
+        }
+
         // Updating the solution x
         for (i=0;i<n;i++){
             px[i] -= pR[i];
@@ -163,6 +183,7 @@ void newton_solver(
 
         // Updating the residuals and calculating the infinity norm
         f_func(pt, px,pu,pd,pP,pftemp);
+        INSTRUMENT_ADD(f_evaluations,1);
         has_converged = true;
         for (i=0;i<n;i++){
             pR[i] =  px[i]-pftemp[i]*dt-ppsi[i];
@@ -171,18 +192,24 @@ void newton_solver(
 
         // If the infinity norm is less than the tolerance, the method terminates
         if (has_converged){
+            status = iterations+1;
             break;
         }
 
         // Saving one call to the jacobian if convergence is obtained
-        J_func(pt, px,pu,pd,pP,pjacobian);
+        if (J_func != NULL){
+            J_func(pt, px,pu,pd,pP,pjacobian);
+        }
+        INSTRUMENT_ADD(J_evaluations,1);
 
         // Resetting the diagonal index
         diagonal_index = 0;
     }
+    INSTRUMENT_NEWTON(status,iterations < max_iterations ? iterations+1 : max_iterations);
+    return status;
 }
 
-void vector_implicit_euler_final_step(
+int vector_implicit_euler_final_step(
     int N,
     int n,
     int NS,
@@ -201,6 +228,7 @@ void vector_implicit_euler_final_step(
     void *pP,
     double *px0
 ){
+    int failures = 0;
     unsigned int row, col, sim;
     unsigned int k = 0;
     double h; // temporal step
@@ -220,11 +248,15 @@ void vector_implicit_euler_final_step(
             if (col >0 ){
                 f_func(&pt[col],pxtemp_1,pu,pd,pP,pF);
                 g_func(&pt[col],pxtemp_1,pu,pd,pP,pG);
+                INSTRUMENT_ADD(f_evaluations,1);
+                INSTRUMENT_ADD(g_evaluations,1);
             }
             // Imposing initial condition
             else {
                 f_func(&pt[col],px0,pu,pd,pP,pF);
                 g_func(&pt[col],px0,pu,pd,pP,pG);
+                INSTRUMENT_ADD(f_evaluations,1);
+                INSTRUMENT_ADD(g_evaluations,1);
             }
 
             // Calculating time step
@@ -240,7 +272,7 @@ void vector_implicit_euler_final_step(
                 }
 
                 // Invoking newton solver
-                newton_solver(
+                failures += newton_solver(
                     f_func,
                     J_func,
                     max_iterations,
@@ -255,7 +287,7 @@ void vector_implicit_euler_final_step(
                     pu,
                     pd,
                     pP
-                );
+                ) < 0;
 
                 // Updating pointers such that current time step is the previous time step
                 pxtemp = pxtemp_2;
@@ -271,7 +303,7 @@ void vector_implicit_euler_final_step(
                 }
 
                 // Invoking newton solver
-                newton_solver(
+                failures += newton_solver(
                     f_func,
                     J_func,
                     max_iterations,
@@ -286,7 +318,7 @@ void vector_implicit_euler_final_step(
                     pu,
                     pd,
                     pP
-                );
+                ) < 0;
 
                 // Updating pointers such that current time step is the previous time step
                 pxtemp = pxtemp_2;
@@ -303,7 +335,7 @@ void vector_implicit_euler_final_step(
                 }
 
                 // Invoking newton solver
-                newton_solver(
+                failures += newton_solver(
                     f_func,
                     J_func,
                     max_iterations,
@@ -318,8 +350,790 @@ void vector_implicit_euler_final_step(
                     pu,
                     pd,
                     pP
-                );
+                ) < 0;
+            }
+        }
+    }
+    return failures;
+}
+
+int vector_implicit_euler_sensitivity(
+    int N,
+    int n,
+    int ns,
+    double *pt,
+    double *px,
+    double *pS,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    functiontype fp_func,
+    functiontype gp_func,
+    int np,
+    int *pcolumns,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0,
+    double *pS0
+){
+    unsigned int row, col;
+    int i, j, k, c;
+    double h; // temporal step
+    double *pF = &workspace_lf[0];
+    double *pG = &workspace_lf[n];
+    double *ppsi = &workspace_lf[n+n];
+    double *workspace_inner = &workspace_lf[n+n+n];
+    // LU factorization left behind by the Newton solver
+    double *pLU = &workspace_inner[n*(n+1)];
+    double *pfp = &workspace_lf[n*(5+2*n)];
+    double *pgp = &pfp[n*np];
+    double *prhs = &pgp[n*np];
+    int size_S = n*ns;
+    int status;
+    int failures = 0;
+
+    // Parameters for DGETRS
+    char TRANS = 'N';
+    int N_lapack = n;
+    int NRHS = ns;
+    int INFO;
+
+    // Imposing initial condition
+    for (row = 0; row < n; row++) {
+        px[row] = px0[row];
+    }
+    for (c = 0; c < size_S; c++) {
+        pS[c] = pS0[c];
+    }
+
+    i = 0;
+    j = n;
+    k = 0;
+    for (col = 0; col < N; col++) {
+        // Invoking drift and diffusion terms
+        f_func(&pt[col],&px[i],pu,pd,pP,pF);
+        g_func(&pt[col],&px[i],pu,pd,pP,pG);
+        INSTRUMENT_ADD(f_evaluations,1);
+        INSTRUMENT_ADD(g_evaluations,1);
+        gp_func(&pt[col],&px[i],pu,pd,pP,pgp);
+
+        // Calculating time step
+        h = pt[col+1]-pt[col];
+
+        // Initial guess for Newton solver
+        for (row = 0; row < n; row++) {
+            ppsi[row] = px[i+row] + (pG[row]*pdW[k+row]);
+            px[j+row] = ppsi[row]+ (h*pF[row]);
+        }
+
+        // Invoking newton solver
+        status = newton_solver(
+            f_func,
+            J_func,
+            max_iterations,
+            tolerance,
+            n,
+            h,
+            &pt[col],
+            &px[j],
+            ppsi,
+            workspace_inner,
+            workspace_d,
+            pu,
+            pd,
+            pP
+        );
+        failures += status < 0;
+
+        // Without a factorization the sensitivities are undefined from this step on
+        if (status == -2){
+            for (c = 0; c < size_S; c++) {
+                pS[(col+1)*size_S+c] = NAN;
+            }
+            i += n;
+            j += n;
+            k += n;
+            continue;
+        }
+
+        // Right hand side of the sensitivity equation
+        fp_func(&pt[col],&px[j],pu,pd,pP,pfp);
+        for (c = 0; c < size_S; c++) {
+            prhs[c] = pS[col*size_S+c];
+        }
+        for (c = 0; c < np; c++) {
+            if (pcolumns[c] < 0){
+                continue;
+            }
+            for (row = 0; row < n; row++) {
+                prhs[pcolumns[c]*n+row] += pgp[c*n+row]*pdW[k+row] + h*pfp[c*n+row];
+            }
+        }
+
+        // Reusing the factorization of I - J*h
+        dgetrs_(&TRANS,&N_lapack,&NRHS,pLU,&N_lapack,workspace_d,prhs,&N_lapack,&INFO);
+        for (c = 0; c < size_S; c++) {
+            pS[(col+1)*size_S+c] = prhs[c];
+        }
+        i += n;
+        j += n;
+        k += n;
+    }
+    return failures;
+}
+
+int vector_implicit_euler_banded(
+    int N,
+    int n,
+    int kl,
+    int ku,
+    int NS,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+){
+    int failures = 0;
+    unsigned int row, col, sim, i,j,k;
+    double h; // temporal step
+    double *pF = &workspace_lf[0];
+    double *pG = &workspace_lf[n];
+    double *ppsi = &workspace_lf[n+n];
+    double *workspace_inner = &workspace_lf[n+n+n];
+    int len2dims_X = (N+1)*n;
+    int len2dims_dW = len2dims_X-n;
+    int index_X = 0;
+    int index_dW = 0;
+
+    for (sim = 0; sim < NS;sim++){
+        // Imposing initial condition
+        i = index_X;
+        for (row = 0; row < n; row++) {
+            px[i] = px0[row];
+            i++;
+        }
+
+        // Initializing indexes
+        i = index_X;
+        j = index_X+n;
+        k = index_dW;
+        for (col = 0; col < N; col++) {
+            // Invoking drift and diffusion terms
+            f_func(&pt[col],&px[i],pu,pd,pP,pF);
+            g_func(&pt[col],&px[i],pu,pd,pP,pG);
+            INSTRUMENT_ADD(f_evaluations,1);
+            INSTRUMENT_ADD(g_evaluations,1);
+
+            // Calculating time step
+            h = pt[col+1]-pt[col];
+
+            // Initial guess for Newton solver
+            for (row = 0; row < n; row++) {
+                ppsi[row] = px[i] + (pG[row]*pdW[k]);
+                px[j] = ppsi[row]+ (h*pF[row]);
+                i++;
+                j++;
+                k++;
+            }
+
+            // Invoking the banded newton solver
+            failures += newton_solver_banded(
+                f_func,
+                J_func,
+                max_iterations,
+                tolerance,
+                n,
+                kl,
+                ku,
+                h,
+                &pt[col],
+                &px[i],
+                ppsi,
+                workspace_inner,
+                workspace_d,
+                pu,
+                pd,
+                pP
+            ) < 0;
+        }
+        index_X += len2dims_X;
+        index_dW += len2dims_dW;
+    }
+    return failures;
+}
+
+int newton_solver_banded(
+    functiontype f_func,
+    functiontype J_func,
+    int max_iterations,
+    double tolerance,
+    int n,
+    int kl,
+    int ku,
+    double dt,
+    double *pt,
+    double *px,
+    double *ppsi,
+    double *workspace_lf,
+    int *workspace_d,
+    double *pu,
+    double *pd,
+    void *pP
+){
+    int LDAB = 2*kl+ku+1;
+    int band_size = LDAB*n;
+    double *pftemp = &workspace_lf[0];
+    double *pjacobian = &workspace_lf[n];
+    double *pdRdX = &workspace_lf[n+band_size];
+    double *pR = &workspace_lf[n+2*band_size];
+
+    f_func(pt, px,pu,pd,pP,pftemp);
+    INSTRUMENT_ADD(f_evaluations,1);
+    J_func(pt, px,pu,pd,pP,pjacobian);
+    INSTRUMENT_ADD(J_evaluations,1);
+
+    // Initializing residuals
+    int i = 0;
+    for (i=0;i<n;i++){
+        pR[i] =  px[i]-pftemp[i]*dt-ppsi[i];
+    }
+
+    // Parameters for DGBSV
+    int N = n;
+    int KL = kl;
+    int KU = ku;
+    int NRHS = 1;
+    int LDB = N;
+    int INFO;
+    int iterations = 0;
+    bool has_converged;
+
+    // Number of iterations on convergence, -1 if max_iterations is reached and -2 for a singular system
+    int status = -1;
+
+    // The diagonal is row kl+ku of the band storage
+    int diagonal_offset = kl+ku;
+    for (iterations = 0;iterations<max_iterations;iterations++){
+        // Initializing the banded system matrix I - J*dt
+        for (i=0;i<band_size;i++){
+            pdRdX[i] = -pjacobian[i]*dt;
+        }
+        for (i=0;i<n;i++){
+            pdRdX[diagonal_offset+i*LDAB] += 1;
+        }
+
+        // Minimizing residuals
+        dgbsv_(
+            &N,
+            &KL,
+            &KU,
+            &NRHS,
+            pdRdX,
+            &LDAB,
+            workspace_d,
+            pR,
+            &LDB,
+            &INFO
+        );
+
+        // A singular system leaves the solution at the last iterate
+        if (INFO > 0){
+            status = -2;
+            break;
+        }
+
+        // Updating the solution x
+        for (i=0;i<n;i++){
+            px[i] -= pR[i];
+        }
+
+        // Updating the residuals and calculating the infinity norm
+        f_func(pt, px,pu,pd,pP,pftemp);
+        INSTRUMENT_ADD(f_evaluations,1);
+        has_converged = true;
+        for (i=0;i<n;i++){
+            pR[i] =  px[i]-pftemp[i]*dt-ppsi[i];
+            has_converged &= fabs(pR[i]) < tolerance;
+        }
+
+        // If the infinity norm is less than the tolerance, the method terminates
+        if (has_converged){
+            status = iterations+1;
+            break;
+        }
+
+        // Saving one call to the jacobian if convergence is obtained
+        J_func(pt, px,pu,pd,pP,pjacobian);
+        INSTRUMENT_ADD(J_evaluations,1);
+    }
+    INSTRUMENT_NEWTON(status,iterations < max_iterations ? iterations+1 : max_iterations);
+    return status;
+}
+
+int vector_implicit_euler_mixed(
+    int N,
+    int n,
+    int NS,
+    double *pt,
+    void *px,
+    int single_precision_storage,
+    float *pdW,
+    double *workspace_lf,
+    float *workspace_f,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype_float J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+){
+    int failures = 0;
+    unsigned int row, col, sim, i, k;
+    double h; // temporal step
+    double *px_current = &workspace_lf[0];
+    double *px_next = &workspace_lf[n];
+    double *pF = &workspace_lf[2*n];
+    double *pG = &workspace_lf[3*n];
+    double *ppsi = &workspace_lf[4*n];
+    double *workspace_inner = &workspace_lf[5*n];
+    float *px_float = (float*) px;
+    double *px_double = (double*) px;
+    int len2dims_X = (N+1)*n;
+    int len2dims_dW = len2dims_X-n;
+    int index_X = 0;
+    int index_dW = 0;
+
+    for (sim = 0; sim < NS;sim++){
+        // Imposing initial condition
+        i = index_X;
+        for (row = 0; row < n; row++) {
+            px_current[row] = px0[row];
+            if (single_precision_storage){
+                px_float[i] = (float) px0[row];
+            }
+            else {
+                px_double[i] = px0[row];
             }
+            i++;
         }
+
+        k = index_dW;
+        for (col = 0; col < N; col++) {
+            // Invoking drift and diffusion terms
+            f_func(&pt[col],px_current,pu,pd,pP,pF);
+            g_func(&pt[col],px_current,pu,pd,pP,pG);
+            INSTRUMENT_ADD(f_evaluations,1);
+            INSTRUMENT_ADD(g_evaluations,1);
+
+            // Calculating time step
+            h = pt[col+1]-pt[col];
+
+            // Initial guess for Newton solver
+            for (row = 0; row < n; row++) {
+                ppsi[row] = px_current[row] + (pG[row]*pdW[k]);
+                px_next[row] = ppsi[row]+ (h*pF[row]);
+                k++;
+            }
+
+            failures += newton_solver_mixed(
+                f_func,
+                J_func,
+                max_iterations,
+                tolerance,
+                n,
+                h,
+                &pt[col],
+                px_next,
+                ppsi,
+                workspace_inner,
+                workspace_f,
+                workspace_d,
+                pu,
+                pd,
+                pP
+            ) < 0;
+
+            // Storing the step, the state is carried in double precision
+            for (row = 0; row < n; row++) {
+                px_current[row] = px_next[row];
+                if (single_precision_storage){
+                    px_float[i] = (float) px_next[row];
+                }
+                else {
+                    px_double[i] = px_next[row];
+                }
+                i++;
+            }
+        }
+        index_X += len2dims_X;
+        index_dW += len2dims_dW;
+    }
+    return failures;
+}
+
+int newton_solver_mixed(
+    functiontype f_func,
+    functiontype_float J_func,
+    int max_iterations,
+    double tolerance,
+    int n,
+    double dt,
+    double *pt,
+    double *px,
+    double *ppsi,
+    double *workspace_lf,
+    float *workspace_f,
+    int *workspace_d,
+    double *pu,
+    double *pd,
+    void *pP
+){
+    double *pftemp = &workspace_lf[0];
+    double *pR = &workspace_lf[n];
+    float *px_float = &workspace_f[0];
+    float *pjacobian = &workspace_f[n];
+    float *pdRdX = &workspace_f[n*(n+1)];
+    float *pdelta = &workspace_f[n*(n+n+1)];
+    float dt_float = (float) dt;
+
+    // Initializing residuals in double precision and the Jacobian in single precision
+    int i = 0;
+    f_func(pt, px,pu,pd,pP,pftemp);
+    INSTRUMENT_ADD(f_evaluations,1);
+    for (i=0;i<n;i++){
+        pR[i] = px[i]-pftemp[i]*dt-ppsi[i];
+        px_float[i] = (float) px[i];
+    }
+    J_func(pt,px_float,pu,pd,pP,pjacobian);
+    INSTRUMENT_ADD(J_evaluations,1);
+
+    // Parameters for SGESV
+    int N = n;
+    int NRHS = 1;
+    int LDA = N;
+    int LDB = N;
+    int INFO;
+    int iterations = 0;
+
+    // Number of iterations on convergence, -1 if max_iterations is reached and -2 for a singular system
+    int status = -1;
+    bool has_converged;
+    int diagonal_index = 0;
+    int n_square = n*n;
+    for (iterations = 0;iterations<max_iterations;iterations++){
+        // Initializing system matrix to solve
+        for (i=0;i<n_square;i++){
+            if (i == diagonal_index){
+                pdRdX[i] = 1 - pjacobian[i]*dt_float;
+                diagonal_index += n+1;
+            }
+            else {
+                pdRdX[i] = -pjacobian[i]*dt_float;
+            }
+        }
+        for (i=0;i<n;i++){
+            pdelta[i] = (float) pR[i];
+        }
+
+        // Single precision correction
+        sgesv_(
+            &N,
+            &NRHS,
+            pdRdX,
+            &LDA,
+            workspace_d,
+            pdelta,
+            &LDB,
+            &INFO
+        );
+        if (INFO > 0){
+            status = -2;
+            break;
+        }
+
+        // Updating the solution x in double precision
+        for (i=0;i<n;i++){
+            px[i] -= pdelta[i];
+        }
+
+        // The double precision residuals decide the convergence
+        f_func(pt, px,pu,pd,pP,pftemp);
+        INSTRUMENT_ADD(f_evaluations,1);
+        has_converged = true;
+        for (i=0;i<n;i++){
+            pR[i] = px[i]-pftemp[i]*dt-ppsi[i];
+            has_converged &= fabs(pR[i]) < tolerance;
+            px_float[i] = (float) px[i];
+        }
+        if (has_converged){
+            status = iterations+1;
+            break;
+        }
+        J_func(pt,px_float,pu,pd,pP,pjacobian);
+        INSTRUMENT_ADD(J_evaluations,1);
+        diagonal_index = 0;
+    }
+    INSTRUMENT_NEWTON(status,iterations < max_iterations ? iterations+1 : max_iterations);
+    return status;
+}
+
+// Version of newton_solver() with a step per component, which solves \f$x_i-pdt_i f_i(x)-\psi_i=0\f$
+static int newton_solver_scaled(
+    functiontype f_func,
+    functiontype J_func,
+    int max_iterations,
+    double tolerance,
+    int n,
+    double *pdt,
+    double *pt,
+    double *px,
+    double *ppsi,
+    double *workspace_lf,
+    int *workspace_d,
+    double *pu,
+    double *pd,
+    void *pP
+){
+    double *pftemp = &workspace_lf[0];
+    double *pjacobian = &workspace_lf[n];
+    double *pdRdX = &workspace_lf[n*(n+1)];
+    double *pR = &workspace_lf[n*(n+n+1)];
+    int N = n;
+    int NRHS = 1;
+    int INFO;
+    int status = -1;
+    int iterations, i, j;
+    bool has_converged;
+
+    f_func(pt,px,pu,pd,pP,pftemp);
+    INSTRUMENT_ADD(f_evaluations,1);
+    J_func(pt,px,pu,pd,pP,pjacobian);
+    INSTRUMENT_ADD(J_evaluations,1);
+    for (i=0;i<n;i++){
+        pR[i] = px[i]-pdt[i]*pftemp[i]-ppsi[i];
+    }
+    for (iterations=0;iterations<max_iterations;iterations++){
+        // Row i of the Jacobian of the residuals is scaled by the step of component i
+        for (j=0;j<n;j++){
+            for (i=0;i<n;i++){
+                pdRdX[i+n*j] = (i == j)-pdt[i]*pjacobian[i+n*j];
+            }
+        }
+        dgesv_(&N,&NRHS,pdRdX,&N,workspace_d,pR,&N,&INFO);
+        if (INFO > 0){
+            status = -2;
+            break;
+        }
+        for (i=0;i<n;i++){
+            px[i] -= pR[i];
+        }
+        f_func(pt,px,pu,pd,pP,pftemp);
+        INSTRUMENT_ADD(f_evaluations,1);
+        has_converged = true;
+        for (i=0;i<n;i++){
+            pR[i] = px[i]-pdt[i]*pftemp[i]-ppsi[i];
+            has_converged &= fabs(pR[i]) < tolerance;
+        }
+        if (has_converged){
+            status = iterations+1;
+            break;
+        }
+        J_func(pt,px,pu,pd,pP,pjacobian);
+        INSTRUMENT_ADD(J_evaluations,1);
+    }
+    INSTRUMENT_NEWTON(status,iterations < max_iterations ? iterations+1 : max_iterations);
+    return status;
+}
+
+int vector_exponential_euler(
+    int N,
+    int n,
+    int NS,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    int implicit,
+    functiontype L_func,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+){
+    int failures = 0;
+    int row, col, sim, i, j, k;
+    double h; // temporal step
+    double *pL = &workspace_lf[0];
+    double *pF = &workspace_lf[n+n];
+    double *pG = &workspace_lf[n+n+n];
+    double *ppsi = &workspace_lf[n+n+n+n];
+    double *pdt = &workspace_lf[n+n+n+n+n];
+    double *workspace_inner = &workspace_lf[n+n+n+n+n+n];
+    int len2dims_X = (N+1)*n;
+    int len2dims_dW = len2dims_X-n;
+    int index_X = 0;
+    int index_dW = 0;
+
+    for (sim = 0; sim < NS;sim++){
+        // Imposing initial condition
+        for (row = 0; row < n; row++) {
+            px[index_X+row] = px0[row];
+        }
+
+        i = index_X;
+        j = index_X+n;
+        k = index_dW;
+        for (col = 0; col < N; col++) {
+            L_func(&pt[col],&px[i],pu,pd,pP,pL);
+            f_func(&pt[col],&px[i],pu,pd,pP,pF);
+            g_func(&pt[col],&px[i],pu,pd,pP,pG);
+            INSTRUMENT_ADD(f_evaluations,1);
+            INSTRUMENT_ADD(g_evaluations,1);
+            h = pt[col+1]-pt[col];
+
+            // The linear part is propagated exactly, and the noise is scaled to the variance of its convolution
+            // with the exponential of the linear part over the step
+            for (row = 0; row < n; row++) {
+                double z = -pL[row]*h;
+                double noise_scale = (z != 0) ? sqrt(expm1(2*z)/(2*z)) : 1;
+                pdt[row] = (z != 0) ? h*expm1(z)/z : h;
+                ppsi[row] = pL[n+row]+exp(z)*(px[i+row]-pL[n+row])+noise_scale*pG[row]*pdW[k+row];
+                px[j+row] = ppsi[row]+pdt[row]*pF[row];
+            }
+
+            // The explicit step is the initial guess of the implicit one
+            if (implicit){
+                failures += newton_solver_scaled(
+                    f_func,
+                    J_func,
+                    max_iterations,
+                    tolerance,
+                    n,
+                    pdt,
+                    &pt[col+1],
+                    &px[j],
+                    ppsi,
+                    workspace_inner,
+                    workspace_d,
+                    pu,
+                    pd,
+                    pP
+                ) < 0;
+            }
+            i += n;
+            j += n;
+            k += n;
+        }
+        index_X += len2dims_X;
+        index_dW += len2dims_dW;
+    }
+    return failures;
+}
+
+int vector_implicit_trapezoidal(
+    int N,
+    int n,
+    int NS,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+){
+    int failures = 0;
+    int row, col, sim, i, j, k;
+    double h; // temporal step
+    double *pF = &workspace_lf[0];
+    double *pG = &workspace_lf[n];
+    double *ppsi = &workspace_lf[n+n];
+    double *workspace_inner = &workspace_lf[n+n+n];
+    int len2dims_X = (N+1)*n;
+    int len2dims_dW = len2dims_X-n;
+    int index_X = 0;
+    int index_dW = 0;
+
+    for (sim = 0; sim < NS;sim++){
+        // Imposing initial condition
+        for (row = 0; row < n; row++) {
+            px[index_X+row] = px0[row];
+        }
+
+        i = index_X;
+        j = index_X+n;
+        k = index_dW;
+        for (col = 0; col < N; col++) {
+            // Without J_func, the Jacobian written by f_func after the drift extends over pG and ppsi, which are
+            // written afterwards
+            f_func(&pt[col],&px[i],pu,pd,pP,pF);
+            g_func(&pt[col],&px[i],pu,pd,pP,pG);
+            INSTRUMENT_ADD(f_evaluations,1);
+            INSTRUMENT_ADD(g_evaluations,1);
+            h = pt[col+1]-pt[col];
+
+            // The explicit half of the drift and the noise are known, and the explicit Euler step is the initial guess
+            for (row = 0; row < n; row++) {
+                ppsi[row] = px[i+row]+0.5*h*pF[row]+pG[row]*pdW[k+row];
+                px[j+row] = ppsi[row]+0.5*h*pF[row];
+            }
+
+            // The implicit half of the drift
+            failures += newton_solver(
+                f_func,
+                J_func,
+                max_iterations,
+                tolerance,
+                n,
+                0.5*h,
+                &pt[col+1],
+                &px[j],
+                ppsi,
+                workspace_inner,
+                workspace_d,
+                pu,
+                pd,
+                pP
+            ) < 0;
+            i += n;
+            j += n;
+            k += n;
+        }
+        index_X += len2dims_X;
+        index_dW += len2dims_dW;
     }
+    return failures;
 }
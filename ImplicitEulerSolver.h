@@ -13,6 +13,18 @@ extern void dgemv_(char *trans, int *m, int *n,
 extern void dgesv_(int *N, int *NRHS,double *A,
               int *LDA, int *IPIV,double *B,
               int *LDB, int *INFO);
+
+extern void dgetrs_(char *TRANS, int *N, int *NRHS,
+              double *A, int *LDA, int *IPIV,
+              double *B, int *LDB, int *INFO);
+
+extern void dgbsv_(int *N, int *KL, int *KU, int *NRHS,
+              double *AB, int *LDAB, int *IPIV,
+              double *B, int *LDB, int *INFO);
+
+extern void sgesv_(int *N, int *NRHS, float *A,
+              int *LDA, int *IPIV, float *B,
+              int *LDB, int *INFO);
               
 ///@endcond
 
@@ -46,6 +58,23 @@ typedef void (*functiontype)(
     double *pxdot
 );
 
+/**
+ * Version of functiontype() with a single precision state and output, used for the Jacobian of the drift in the
+ * mixed precision solvers vector_implicit_euler_mixed() and newton_solver_mixed(). The time, the control
+ * parameters and the disturbances are passed as they are given to the solver.
+ *
+ * @date 19th of October 2026
+*/
+
+typedef void (*functiontype_float)(
+    double *pt,
+    float *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    float *pxdot
+);
+
 /**
  * Implementation of the implicit-explicit Euler method. This numerical scheme approximates 
  * \f$dx(t) = f\big(x(t)\big)dt+g\big(x(t)\big)d\omega(t)\f$ by 
@@ -66,11 +95,16 @@ typedef void (*functiontype)(
  * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
  * @param[in] f_func: functiontype() pointer to the drift term.
  * @param[in] g_func: functiontype() pointer to diffusion term.
- * @param[in] J_func: functiontype() pointer to the Jacobian of the drift term.
+ * @param[in] J_func: functiontype() pointer to the Jacobian of the drift term, or NULL if f_func writes the drift
+ * followed by its Jacobian in column major order, \f$n(n+1)\f$ values, such as CSTR_3D_drift_fused().
  * @param[in] pu: Pointer to control parameters.
  * @param[in] pd: Pointer to the disturbances.
  * @param[in] pP: Vopid pointer to an arbitrary parameter input.
  * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge, i.e. for which newton_solver() returned a negative
+ * status. The steps after a failed solve continue from its last iterate, so a nonzero count flags the realizations as
+ * unreliable.
  * 
  * @author Anton Rydahl
  * 
@@ -78,7 +112,7 @@ typedef void (*functiontype)(
  * 
  */
 
-void vector_implicit_euler(
+int vector_implicit_euler(
     int N,
     int n,
     int NS,
@@ -104,7 +138,9 @@ void vector_implicit_euler(
  * previous step and the diffusion term in the current step: \f$\psi_n=x_n+g(x_n)d\omega_n\f$.
  * 
  * @param[in] f_func: functiontype() pointer to the drift term.
- * @param[in] J_func: functiontype() pointer to the Jacobian of the drift term.
+ * @param[in] J_func: functiontype() pointer to the Jacobian of the drift term, or NULL if f_func writes the drift
+ * followed by its Jacobian in column major order, \f$n(n+1)\f$ values. The Jacobian is then evaluated along with
+ * every drift, including the last one, which is not needed.
  * @param[in] max_iterations: Maximal number of iterations used if convergence is not obtained.
  * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
  * @param[in] n: The dimension of the system. 
@@ -114,10 +150,15 @@ void vector_implicit_euler(
  * After execution it will contain the final guess for \f$x_{n+1}\f$. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
  * @param[in] ppsi: Should contain \f$\psi_n=x_n+g(x_n)d\omega_n\f$. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
  * @param[in] workspace_lf: Allocated memory of doubles used for storing the residuals. Must be of size \f$n\cdot(2+2\cdot n)\cdot\text{sizeof}(\text{double})\f$.
+ * On return, the \f$n\times n\f$ block starting at index \f$n\cdot(n+1)\f$ holds the LU factorization of \f$I-J\,dt\f$ from the last
+ * iteration, with the row permutation in workspace_d, such that further systems can be solved with DGETRS.
  * @param[in] workspace_d: Allocated memory of integers used  for storing the row permutation indexes in DGESV. Must be of size \f$n\cdot\text{sizeof}(\text{int})\f$.
  * @param[in] pu: Pointer to control parameters.
  * @param[in] pd: Pointer to the disturbances.
  * @param[in] pP: Vopid pointer to an arbitrary parameter input.
+ *
+ * @return The number of iterations if the tolerance was met, -1 if max_iterations was reached and -2 if the system
+ * matrix was singular, in which case px holds the last iterate.
  * 
  * @author Anton Rydahl
  * 
@@ -125,7 +166,7 @@ void vector_implicit_euler(
  * 
  */
 
-void newton_solver(
+int newton_solver(
     functiontype f_func,
     functiontype J_func,
     int max_iterations,
@@ -166,6 +207,8 @@ void newton_solver(
  * @param[in] pd: Pointer to the disturbances.
  * @param[in] pP: Void pointer to an arbitrary parameter input.
  * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge, as for vector_implicit_euler().
  * 
  * @author Anton Rydahl
  * 
@@ -174,7 +217,404 @@ void newton_solver(
  */
 
 
-void vector_implicit_euler_final_step(
+int vector_implicit_euler_final_step(
+    int N,
+    int n,
+    int NS,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+);
+
+/**
+ * Sensitivity augmented version of vector_implicit_euler() for a single realization. Together with the solution it
+ * propagates the sensitivity matrix \f$S_k=\partial x_k/\partial\theta\f$ with \f$n_s\f$ columns. Differentiating the
+ * implicit Euler step gives
+ * \f$(I-J(x_{k+1})\,h)S_{k+1} = S_k + \text{diag}(d\omega_k)\,\partial g/\partial\theta + h\,\partial f/\partial\theta(x_{k+1})\f$,
+ * and the factorization of \f$I-J\,h\f$ which newton_solver() leaves in the workspace is reused, so every step only costs
+ * one extra call to DGETRS with \f$n_s\f$ right hand sides. The factorization belongs to the last Newton iterate, so the
+ * sensitivities carry an error of the order of the Newton tolerance. The diffusion is assumed not to depend on \f$x\f$,
+ * as in CSTR_3D_diffusion().
+ *
+ * The functions fp_func and gp_func return \f$\partial f/\partial\theta\f$ and \f$\partial g/\partial\theta\f$ as \f$n\times n_p\f$
+ * column major matrices. Column \f$i\f$ is added to column pcolumns[i] of the sensitivity matrix, or ignored if pcolumns[i] is negative.
+ * This way the columns with respect to an input can be routed to the sample where the input is active.
+ *
+ * @param[in] N: The number of time steps (excluding the initial condition).
+ * @param[in] n: The dimension of \f$x(t)\f$.
+ * @param[in] ns: The number of columns in the sensitivity matrix.
+ * @param[in] pt: Pointer to the temporal solution.  Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] px: The spatial solution. Must be of size \f$n\cdot (N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] pS: The sensitivities, one column major \f$n\times n_s\f$ matrix per time step. Must be of size \f$n\cdot n_s\cdot(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pdW: White noise. Must be of size \f$n\cdot N\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_lf: Allocated memory. Must be of size \f$n\cdot(5+2n+2n_p+n_s)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_d: Allocated memory for the DGESV routine. Must be \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] f_func: functiontype() pointer to the drift term.
+ * @param[in] g_func: functiontype() pointer to diffusion term.
+ * @param[in] J_func: functiontype() pointer to the Jacobian of the drift term.
+ * @param[in] fp_func: functiontype() pointer to the derivative of the drift with respect to the parameters.
+ * @param[in] gp_func: functiontype() pointer to the derivative of the diffusion with respect to the parameters.
+ * @param[in] np: The number of columns returned by fp_func and gp_func.
+ * @param[in] pcolumns: Column of the sensitivity matrix for every parameter. Must be of size \f$n_p\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pS0: Pointer to the initial sensitivities. Must be of size \f$n\cdot n_s\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge. After a singular system there is no factorization to
+ * reuse, so the sensitivities from that step on are set to NaN instead of being solved for.
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int vector_implicit_euler_sensitivity(
+    int N,
+    int n,
+    int ns,
+    double *pt,
+    double *px,
+    double *pS,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    functiontype fp_func,
+    functiontype gp_func,
+    int np,
+    int *pcolumns,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0,
+    double *pS0
+);
+
+/**
+ * Banded version of vector_implicit_euler() for systems whose Jacobian has kl subdiagonals and ku superdiagonals, e.g.
+ * a cascade of tanks where every tank only depends on its neighbours. The implicit step is solved with
+ * newton_solver_banded(), so a step costs \f$O(n\,k_l(k_l+k_u))\f$ operations instead of \f$O(n^3)\f$. J_func must write
+ * the Jacobian in the LAPACK band storage of DGBSV described in newton_solver_banded().
+ *
+ * @param[in] N: The number of time steps (excluding the initial condition).
+ * @param[in] n: The dimension of \f$x(t)\f$.
+ * @param[in] kl: The number of subdiagonals of the Jacobian.
+ * @param[in] ku: The number of superdiagonals of the Jacobian.
+ * @param[in] NS: The number of simulations.
+ * @param[in] pt: Pointer to the temporal solution.  Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] px: After operation this array will contain the spatial solution. Must be size \f$n\cdot (N+1)\cdot NS\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pdW: White noise. Must be size \f$n\cdot N\cdot NS \cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_lf: Allocated memory. Must be of size \f$n\cdot(5+2(2k_l+k_u+1))\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_d: Allocated memory for the DGBSV routine. Must be \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] f_func: functiontype() pointer to the drift term.
+ * @param[in] g_func: functiontype() pointer to diffusion term.
+ * @param[in] J_func: functiontype() pointer to the banded Jacobian of the drift term.
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge, as for vector_implicit_euler().
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int vector_implicit_euler_banded(
+    int N,
+    int n,
+    int kl,
+    int ku,
+    int NS,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+);
+
+/**
+ * Banded version of newton_solver(). The Jacobian is stored in the band storage of DGBSV with leading dimension
+ * \f$l=2k_l+k_u+1\f$: the element \f$J_{ij}\f$ with \f$-k_u\leq i-j\leq k_l\f$ is stored at index \f$k_l+k_u+i-j+l\,j\f$.
+ * J_func must write all \f$l\cdot n\f$ elements, with zeros outside the band, as the first \f$k_l\f$ rows are used
+ * for the fill-in of the factorization.
+ *
+ * @param[in] f_func: functiontype() pointer to the drift term.
+ * @param[in] J_func: functiontype() pointer to the banded Jacobian of the drift term.
+ * @param[in] max_iterations: Maximal number of iterations used if convergence is not obtained.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] n: The dimension of the system.
+ * @param[in] kl: The number of subdiagonals of the Jacobian.
+ * @param[in] ku: The number of superdiagonals of the Jacobian.
+ * @param[in] dt: The size of the temporal step.
+ * @param[in] pt: Pointer to the temporal solution. Only used as input parameter to f_func and J_func.
+ * @param[in,out] px: On input the initial guess for \f$x_{n+1}\f$ and on output the final guess. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] ppsi: Should contain \f$\psi_n=x_n+g(x_n)d\omega_n\f$. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_lf: Allocated memory. Must be of size \f$n\cdot(2+2(2k_l+k_u+1))\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_d: Allocated memory for the row permutation indexes in DGBSV. Must be of size \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ *
+ * @return The same status as newton_solver().
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int newton_solver_banded(
+    functiontype f_func,
+    functiontype J_func,
+    int max_iterations,
+    double tolerance,
+    int n,
+    int kl,
+    int ku,
+    double dt,
+    double *pt,
+    double *px,
+    double *ppsi,
+    double *workspace_lf,
+    int *workspace_d,
+    double *pu,
+    double *pd,
+    void *pP
+);
+
+/**
+ * Mixed precision version of vector_implicit_euler(). The noise is single precision and the Newton steps are
+ * computed by newton_solver_mixed(), which evaluates the Jacobian and solves the linear systems in single precision
+ * while the state, the drift and the residuals are double precision. Hence the tolerance of the residuals is met
+ * as in vector_implicit_euler(). The trajectories are stored in either precision, and the state is carried in
+ * double precision between steps, so storing them in single precision does not accumulate rounding errors.
+ *
+ * @param[in] N: The number of time steps (excluding the initial condition).
+ * @param[in] n: The dimension of \f$x(t)\f$.
+ * @param[in] NS: The number of simulations.
+ * @param[in] pt: Pointer to the temporal solution.  Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] px: After operation this array will contain the spatial solution. Must be size \f$n\cdot (N+1)\cdot NS\f$
+ * floats if single_precision_storage is 1 and doubles otherwise.
+ * @param[in] single_precision_storage: 1 if px is an array of floats and 0 if it is an array of doubles.
+ * @param[in] pdW: White noise. Must be size \f$n\cdot N\cdot NS \cdot\text{sizeof}(\text{float})\f$.
+ * @param[in,out] workspace_lf: Allocated memory. Must be of size \f$7n\cdot\text{sizeof}(\text{double})\f$. On return,
+ * the first \f$n\f$ elements hold the final state of the last simulation in double precision.
+ * @param[in] workspace_f: Allocated memory. Must be of size \f$n\cdot(2+2n)\cdot\text{sizeof}(\text{float})\f$.
+ * @param[in] workspace_d: Allocated memory for the SGESV routine. Must be \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] f_func: functiontype() pointer to the drift term.
+ * @param[in] g_func: functiontype() pointer to diffusion term.
+ * @param[in] J_func: functiontype_float() pointer to the Jacobian of the drift term.
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge, as for vector_implicit_euler().
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int vector_implicit_euler_mixed(
+    int N,
+    int n,
+    int NS,
+    double *pt,
+    void *px,
+    int single_precision_storage,
+    float *pdW,
+    double *workspace_lf,
+    float *workspace_f,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype_float J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+);
+
+/**
+ * Mixed precision version of newton_solver(). Every iteration solves \f$(I-J\,dt)\delta = R\f$ in single precision
+ * with SGESV, where the Jacobian \f$J\f$ is evaluated in single precision at the rounded state, while the residual
+ * \f$R\f$ and the update of \f$x\f$ are double precision. This is an inexact Newton method: the single precision
+ * correction only affects the rate of convergence, and the method stops when the double precision residual
+ * meets the tolerance, as in newton_solver().
+ *
+ * @param[in] f_func: functiontype() pointer to the drift term.
+ * @param[in] J_func: functiontype_float() pointer to the Jacobian of the drift term.
+ * @param[in] max_iterations: Maximal number of iterations used if convergence is not obtained.
+ * @param[in] tolerance: The desired tolerance for the infinity norm of the residuals.
+ * @param[in] n: The dimension of the system.
+ * @param[in] dt: The size of the temporal step.
+ * @param[in] pt: Pointer to the temporal solution. Only used as input parameter to f_func and J_func.
+ * @param[in,out] px: On input the initial guess for \f$x_{n+1}\f$ and on output the final guess. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] ppsi: Should contain \f$\psi_n=x_n+g(x_n)d\omega_n\f$. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_lf: Allocated memory. Must be of size \f$2n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_f: Allocated memory. Must be of size \f$n\cdot(2+2n)\cdot\text{sizeof}(\text{float})\f$.
+ * @param[in] workspace_d: Allocated memory for the row permutation indexes in SGESV. Must be of size \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ *
+ * @return The same status as newton_solver().
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int newton_solver_mixed(
+    functiontype f_func,
+    functiontype_float J_func,
+    int max_iterations,
+    double tolerance,
+    int n,
+    double dt,
+    double *pt,
+    double *px,
+    double *ppsi,
+    double *workspace_lf,
+    float *workspace_f,
+    int *workspace_d,
+    double *pu,
+    double *pd,
+    void *pP
+);
+
+/**
+ * Exponential Euler method for drifts with a diagonal linear part,
+ * \f$dx_i = \big(\lambda_i(t)(e_i(t)-x_i)+f_i(t,x)\big)dt+g_i(t,x)d\omega_i\f$, e.g. the dilution of a stirred tank,
+ * whose rates \f$\lambda_i\f$ grow with the flow rate and make the system stiff. The linear part is integrated
+ * exactly over every step: with \f$E_i=e^{-\lambda_i h}\f$, \f$h_i=h\,\varphi_1(-\lambda_i h)\f$, where
+ * \f$\varphi_1(z)=(e^z-1)/z\f$, and \f$s_i=\sqrt{\varphi_1(-2\lambda_i h)}\f$, the step is
+ * \f$x_{n+1,i}=e_i+E_i(x_{n,i}-e_i)+s_i g_i(t_n,x_n)d\omega_{n,i}+h_i f_i(t_{n+1},x_{n+1})\f$ if implicit is 1,
+ * where the remaining drift \f$f\f$ is solved for with Newton's method, and the exponential time differencing step
+ * \f$x_{n+1,i}=e_i+E_i(x_{n,i}-e_i)+s_i g_i(t_n,x_n)d\omega_{n,i}+h_i f_i(t_n,x_n)\f$ if implicit is 0, which
+ * needs no Newton iterations or linear solves. The factor \f$s_i\f$ gives the noise the variance of the
+ * stochastic convolution \f$\int e^{-\lambda_i(h-s)}g_i\,d\omega_i(s)\f$, so an Ornstein-Uhlenbeck process is
+ * sampled exactly for any step. The weight \f$h_i\f$ rather than \f$h\f$ of the Lawson method keeps
+ * the steady states of the deterministic system fixed points of the scheme for any step. The Newton iterations only
+ * see the Jacobian of \f$f\f$, so the stiffness of the dilution does not slow down their convergence. For a
+ * vanishing linear part the variants reduce to vector_implicit_euler() and the explicit Euler-Maruyama method.
+ *
+ * @param[in] N: The number of time steps (excluding the initial condition).
+ * @param[in] n: The dimension of \f$x(t)\f$.
+ * @param[in] NS: The number of simulations.
+ * @param[in] pt: Pointer to the temporal solution.  Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] px: After operation this array will contain the spatial solution. Must be size \f$n\cdot (N+1)\cdot NS\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pdW: White noise. Must be size \f$n\cdot N\cdot NS \cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_lf: Allocated memory. Must be of size \f$n\cdot(8+2n)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_d: Allocated memory for the DGESV routine. Must be \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] implicit: 1 to solve for the remaining drift implicitly and 0 to treat it explicitly.
+ * @param[in] L_func: functiontype() pointer to the linear part, which writes the rates \f$\lambda\f$ to the first
+ * \f$n\f$ elements of its output and the states \f$e\f$ to the next \f$n\f$ elements.
+ * @param[in] f_func: functiontype() pointer to the remaining drift \f$f\f$.
+ * @param[in] g_func: functiontype() pointer to the diffusion term.
+ * @param[in] J_func: functiontype() pointer to the Jacobian of \f$f\f$. Only used if implicit is 1.
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge, always 0 if implicit is 0.
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int vector_exponential_euler(
+    int N,
+    int n,
+    int NS,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *workspace_lf,
+    int *workspace_d,
+    int max_iterations,
+    double tolerance,
+    int implicit,
+    functiontype L_func,
+    functiontype f_func,
+    functiontype g_func,
+    functiontype J_func,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *px0
+);
+
+/**
+ * Stochastic trapezoidal rule, \f$x_{n+1}=x_n+\frac{h}{2}\big(f(t_n,x_n)+f(t_{n+1},x_{n+1})\big)+g(t_n,x_n)d\omega_n\f$,
+ * where \f$x_{n+1}\f$ is solved for with Newton's method as in vector_implicit_euler(). For additive noise, i.e. a
+ * diffusion term which does not depend on \f$x\f$ as that of the CSTR, the scheme has weak order two when the
+ * increments \f$d\omega_n\f$ have the moments of \f$N(0,h)\f$ up to the fifth, e.g. the three-point variables of
+ * d_rand_three_point_seeded(), and strong order one with Gaussian increments. Since the drift is averaged over the
+ * step, the bias of expectations decreases with \f$h^2\f$ instead of \f$h\f$ for vector_implicit_euler(), at the cost
+ * of one more evaluation of the drift per step. The scheme is A-stable, but unlike implicit Euler it does not damp
+ * stiff components, which oscillate around the solution for steps far beyond their time scale. For a diffusion term
+ * which depends on \f$x\f$ it has weak order one.
+ *
+ * @param[in] N: The number of time steps (excluding the initial condition).
+ * @param[in] n: The dimension of \f$x(t)\f$.
+ * @param[in] NS: The number of simulations.
+ * @param[in] pt: Pointer to the temporal solution.  Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] px: After operation this array will contain the spatial solution. Must be size \f$n\cdot (N+1)\cdot NS\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pdW: Increments of the noise. Must be size \f$n\cdot N\cdot NS \cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_lf: Allocated memory. Must be of size \f$n\cdot(5+2n)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] workspace_d: Allocated memory for the DGESV routine. Must be \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[in] f_func: functiontype() pointer to the drift term.
+ * @param[in] g_func: functiontype() pointer to the diffusion term.
+ * @param[in] J_func: functiontype() pointer to the Jacobian of the drift term, or NULL as in vector_implicit_euler().
+ * @param[in] pu: Pointer to control parameters.
+ * @param[in] pd: Pointer to the disturbances.
+ * @param[in] pP: Void pointer to an arbitrary parameter input.
+ * @param[in] px0: Pointer to the initial condition. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of Newton solves which did not converge, as for vector_implicit_euler().
+ *
+ * @date 19th of October 2026
+ *
+ */
+
+int vector_implicit_trapezoidal(
     int N,
     int n,
     int NS,
@@ -0,0 +1,120 @@
+/// @file Instrumentation.c
+
+#include <stdlib.h>
+#include <string.h>
+#include "Instrumentation.h"
+
+// Counters of a thread, padded to whole cache lines
+typedef struct thread_counters{
+    solver_counters counters;
+    struct thread_counters *pnext;
+} thread_counters;
+
+static thread_counters *pall_counters = NULL;
+static _Thread_local thread_counters *pcounters = NULL;
+
+solver_counters *instrumentation_thread(void){
+    if (pcounters == NULL){
+        size_t size = (sizeof(thread_counters)+63)/64*64;
+        thread_counters *pnew = (thread_counters*) aligned_alloc(64,size);
+        if (pnew == NULL){
+            return NULL;
+        }
+        memset(pnew,0,size);
+        #pragma omp critical(instrumentation)
+        {
+            pnew->pnext = pall_counters;
+            pall_counters = pnew;
+        }
+        pcounters = pnew;
+    }
+    return &pcounters->counters;
+}
+
+void instrumentation_newton(
+    int status,
+    int iterations
+){
+    solver_counters *pc = instrumentation_thread();
+    if (pc == NULL){
+        return;
+    }
+    pc->newton_solves++;
+    pc->newton_iterations += iterations;
+    pc->non_converged += (status == -1);
+    pc->singular += (status == -2);
+    pc->iteration_histogram[iterations < INSTRUMENTATION_HISTOGRAM_SIZE ? iterations : INSTRUMENTATION_HISTOGRAM_SIZE-1]++;
+}
+
+int instrumentation_merge(
+    solver_counters *ptotal
+){
+    memset(ptotal,0,sizeof(solver_counters));
+    int num_threads = 0;
+    int i;
+    thread_counters *pthread;
+    #pragma omp critical(instrumentation)
+    {
+        for (pthread=pall_counters;pthread!=NULL;pthread=pthread->pnext){
+            solver_counters *pc = &pthread->counters;
+            ptotal->f_evaluations += pc->f_evaluations;
+            ptotal->g_evaluations += pc->g_evaluations;
+            ptotal->J_evaluations += pc->J_evaluations;
+            ptotal->newton_solves += pc->newton_solves;
+            ptotal->newton_iterations += pc->newton_iterations;
+            ptotal->non_converged += pc->non_converged;
+            ptotal->singular += pc->singular;
+            for (i=0;i<INSTRUMENTATION_HISTOGRAM_SIZE;i++){
+                ptotal->iteration_histogram[i] += pc->iteration_histogram[i];
+            }
+            for (i=0;i<INSTRUMENTATION_NUM_PHASES;i++){
+                ptotal->phase_seconds[i] += pc->phase_seconds[i];
+            }
+            num_threads++;
+        }
+    }
+    return num_threads;
+}
+
+void instrumentation_reset(void){
+    thread_counters *pthread;
+    #pragma omp critical(instrumentation)
+    {
+        for (pthread=pall_counters;pthread!=NULL;pthread=pthread->pnext){
+            memset(&pthread->counters,0,sizeof(solver_counters));
+        }
+    }
+}
+
+void instrumentation_write_json(
+    FILE *pfile
+){
+    solver_counters total;
+    int num_threads = instrumentation_merge(&total);
+    int i;
+    #ifdef CSTR_INSTRUMENTATION
+    int enabled = 1;
+    #else
+    int enabled = 0;
+    #endif
+    fprintf(pfile,"{\n");
+    fprintf(pfile,"  \"enabled\": %s,\n",enabled ? "true" : "false");
+    fprintf(pfile,"  \"threads\": %d,\n",num_threads);
+    fprintf(pfile,"  \"f_evaluations\": %ld,\n",total.f_evaluations);
+    fprintf(pfile,"  \"g_evaluations\": %ld,\n",total.g_evaluations);
+    fprintf(pfile,"  \"jacobian_evaluations\": %ld,\n",total.J_evaluations);
+    fprintf(pfile,"  \"newton_solves\": %ld,\n",total.newton_solves);
+    fprintf(pfile,"  \"newton_iterations\": %ld,\n",total.newton_iterations);
+    fprintf(pfile,"  \"non_converged\": %ld,\n",total.non_converged);
+    fprintf(pfile,"  \"singular\": %ld,\n",total.singular);
+    fprintf(pfile,"  \"iteration_histogram\": [");
+    for (i=0;i<INSTRUMENTATION_HISTOGRAM_SIZE;i++){
+        fprintf(pfile,"%s%ld",i ? ", " : "",total.iteration_histogram[i]);
+    }
+    fprintf(pfile,"],\n");
+    fprintf(pfile,"  \"phase_seconds\": {\"noise\": %.6f, \"simulation\": %.6f, \"io\": %.6f}\n",
+        total.phase_seconds[INSTRUMENTATION_PHASE_NOISE],
+        total.phase_seconds[INSTRUMENTATION_PHASE_SIMULATION],
+        total.phase_seconds[INSTRUMENTATION_PHASE_IO]);
+    fprintf(pfile,"}\n");
+}
@@ -0,0 +1,115 @@
+/// @file Instrumentation.h
+
+#ifndef CSTR_INSTRUMENTATION_COUNTERS
+#define CSTR_INSTRUMENTATION_COUNTERS
+
+#include <stdio.h>
+
+/**
+ * Counters of the solvers and timers of the phases of a simulation. The counters are only updated when the library
+ * is compiled with -DCSTR_INSTRUMENTATION, e.g.
+ * \code
+ * make all CFLAGS="-O3 -march=native -DCSTR_INSTRUMENTATION"
+ * \endcode
+ * and otherwise the macros below expand to nothing, so the solvers have no overhead. Every thread updates its own
+ * counters, which are allocated on the first update and aligned to a cache line, so the threads do not synchronize.
+ * instrumentation_merge() sums the counters of all threads and must be called outside of parallel regions.
+ *
+ * @date 19th of October 2026
+ */
+
+#define INSTRUMENTATION_HISTOGRAM_SIZE 32
+
+typedef enum instrumentation_phase{
+    INSTRUMENTATION_PHASE_NOISE,
+    INSTRUMENTATION_PHASE_SIMULATION,
+    INSTRUMENTATION_PHASE_IO,
+    INSTRUMENTATION_NUM_PHASES
+} instrumentation_phase;
+
+typedef struct solver_counters{
+    long f_evaluations;         // Calls to the drift
+    long g_evaluations;         // Calls to the diffusion
+    long J_evaluations;         // Calls to the Jacobian of the drift
+    long newton_solves;         // Calls to the Newton solvers
+    long newton_iterations;     // Linear solves in the Newton solvers
+    long non_converged;         // Newton solves which reached max_iterations
+    long singular;              // Newton solves stopped by a singular system
+    long iteration_histogram[INSTRUMENTATION_HISTOGRAM_SIZE]; // Newton solves by iterations, the last bin holds the rest
+    double phase_seconds[INSTRUMENTATION_NUM_PHASES];         // Wall time of every phase
+} solver_counters;
+
+/**
+ * Returns the counters of the calling thread, which are allocated on the first call.
+ *
+ * @return Pointer to the counters or NULL if they could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+solver_counters *instrumentation_thread(void);
+
+/**
+ * Records a call to a Newton solver.
+ *
+ * @param[in] status: The return value of newton_solver().
+ * @param[in] iterations: The number of linear solves.
+ *
+ * @date 19th of October 2026
+ */
+
+void instrumentation_newton(
+    int status,
+    int iterations
+);
+
+/**
+ * Sums the counters of all threads. The wall time of a phase is summed as well, so it is the time spent by all
+ * threads.
+ *
+ * @param[out] ptotal: The sums.
+ *
+ * @return The number of threads which have counters.
+ *
+ * @date 19th of October 2026
+ */
+
+int instrumentation_merge(
+    solver_counters *ptotal
+);
+
+/**
+ * Sets the counters of all threads to zero.
+ *
+ * @date 19th of October 2026
+ */
+
+void instrumentation_reset(void);
+
+/**
+ * Writes the merged counters as a JSON object. Without -DCSTR_INSTRUMENTATION, the object has "enabled": false and
+ * all counters are zero.
+ *
+ * @param[in] pfile: The output file.
+ *
+ * @date 19th of October 2026
+ */
+
+void instrumentation_write_json(
+    FILE *pfile
+);
+
+#ifdef CSTR_INSTRUMENTATION
+#include <omp.h>
+#define INSTRUMENT_ADD(field,count) do { solver_counters *pc_ = instrumentation_thread(); if (pc_) pc_->field += (count); } while (0)
+#define INSTRUMENT_NEWTON(status,iterations) instrumentation_newton((status),(iterations))
+#define INSTRUMENT_PHASE_BEGIN(timer) double timer = omp_get_wtime()
+#define INSTRUMENT_PHASE_END(timer,phase) do { solver_counters *pc_ = instrumentation_thread(); if (pc_) pc_->phase_seconds[phase] += omp_get_wtime()-(timer); } while (0)
+#else
+#define INSTRUMENT_ADD(field,count) ((void) 0)
+#define INSTRUMENT_NEWTON(status,iterations) ((void) 0)
+#define INSTRUMENT_PHASE_BEGIN(timer) ((void) 0)
+#define INSTRUMENT_PHASE_END(timer,phase) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,378 @@
+/// @file KalmanFilter.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "KalmanFilter.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "CSTR.h"
+
+#define EKF_PI 3.14159265358979323846
+
+// Size of the workspace of one thread
+static int thread_workspace_size(
+    int n,
+    int m
+){
+    return n*(5+2*n) + 2*n*n + n*m + m*m + m*(n+1) + n;
+}
+
+// Time update of filter i over one sample
+static void predict_one(
+    ekf_batch *pekf,
+    int i,
+    double *pu,
+    double *pworkspace_lf,
+    int *pworkspace_d
+){
+    int n = pekf->n;
+    double *px = &pekf->px[i*n];
+    double *pP = &pekf->pP[i*n*n];
+    double *pF = &pworkspace_lf[0];
+    double *pG = &pworkspace_lf[n];
+    double *ppsi = &pworkspace_lf[n+n];
+    double *workspace_inner = &pworkspace_lf[n+n+n];
+    // LU factorization left behind by the Newton solver
+    double *pLU = &workspace_inner[n*(n+1)];
+    double *pM = &pworkspace_lf[n*(5+2*n)];
+    double *pB = &pM[n*n];
+    double *pxnext = &pB[n*n+n*pekf->m+pekf->m*pekf->m+pekf->m*(n+1)];
+
+    // Parameters for DGETRS
+    char TRANS = 'N';
+    int N_lapack = n;
+    int NRHS = n;
+    int INFO;
+    int step, r, c, status;
+    double h;
+    for (step=0;step<pekf->time_steps_per_sample;step++){
+        CSTR_3D_drift(&pekf->pt[step],px,pu,NULL,&pekf->params,pF);
+        CSTR_3D_diffusion(&pekf->pt[step],px,pu,NULL,&pekf->params,pG);
+        h = pekf->pt[step+1]-pekf->pt[step];
+
+        // The mean is propagated without noise
+        for (r=0;r<n;r++){
+            ppsi[r] = px[r];
+            pxnext[r] = px[r]+h*pF[r];
+        }
+        status = newton_solver(
+            CSTR_3D_drift,
+            CSTR_3D_drift_jacobian,
+            pekf->max_iterations,
+            pekf->tolerance,
+            n,
+            h,
+            &pekf->pt[step],
+            pxnext,
+            ppsi,
+            workspace_inner,
+            pworkspace_d,
+            pu,
+            NULL,
+            &pekf->params
+        );
+
+        // Without a factorization of I - A*h the covariance only gains the noise of the step
+        if (status == -2){
+            for (r=0;r<n;r++){
+                pP[r*(n+1)] += pG[r]*pG[r]*h;
+                px[r] = pxnext[r];
+            }
+            continue;
+        }
+
+        // M = Phi*(P + G*G'*h)
+        for (c=0;c<n*n;c++){
+            pM[c] = pP[c];
+        }
+        for (r=0;r<n;r++){
+            pM[r*(n+1)] += pG[r]*pG[r]*h;
+        }
+        dgetrs_(&TRANS,&N_lapack,&NRHS,pLU,&N_lapack,pworkspace_d,pM,&N_lapack,&INFO);
+
+        // P = Phi*M' which equals Phi*(P + G*G'*h)*Phi'
+        for (r=0;r<n;r++){
+            for (c=0;c<n;c++){
+                pB[r+n*c] = pM[c+n*r];
+            }
+        }
+        dgetrs_(&TRANS,&N_lapack,&NRHS,pLU,&N_lapack,pworkspace_d,pB,&N_lapack,&INFO);
+        for (r=0;r<n;r++){
+            for (c=0;c<n;c++){
+                pP[r+n*c] = 0.5*(pB[r+n*c]+pB[c+n*r]);
+            }
+            px[r] = pxnext[r];
+        }
+    }
+}
+
+// Measurement update of filter i
+static void update_one(
+    ekf_batch *pekf,
+    int i,
+    double *py,
+    double *pworkspace_lf,
+    int *pworkspace_d
+){
+    int n = pekf->n;
+    int m = pekf->m;
+    double *px = &pekf->px[i*n];
+    double *pP = &pekf->pP[i*n*n];
+    double *pH = pekf->pH;
+    double *pR = pekf->pR;
+    double *pe = &pekf->pinnovation[i*m];
+    double *pL = &pworkspace_lf[n*(5+2*n)];
+    double *pT1 = &pL[n*n];
+    double *pPHt = &pT1[n*n];
+    double *pS = &pPHt[n*m];
+    double *pKt = &pS[m*m];
+    double *pSe = &pKt[m*n];
+
+    // Parameters for DGESV
+    int N_lapack = m;
+    int NRHS = n+1;
+    int INFO;
+    int r, c, a, b, k;
+    double sum;
+
+    // P*H'
+    for (r=0;r<n;r++){
+        for (a=0;a<m;a++){
+            sum = 0;
+            for (k=0;k<n;k++){
+                sum += pP[r+n*k]*pH[a+m*k];
+            }
+            pPHt[r+n*a] = sum;
+        }
+    }
+
+    // S = H*P*H' + R and the innovation e = y - H*x
+    for (a=0;a<m;a++){
+        for (b=0;b<m;b++){
+            sum = pR[a+m*b];
+            for (k=0;k<n;k++){
+                sum += pH[a+m*k]*pPHt[k+n*b];
+            }
+            pS[a+m*b] = sum;
+        }
+        sum = py[a];
+        for (k=0;k<n;k++){
+            sum -= pH[a+m*k]*px[k];
+        }
+        pe[a] = sum;
+    }
+
+    // Solving S*[K', z] = [H*P, e]
+    for (a=0;a<m;a++){
+        for (r=0;r<n;r++){
+            pKt[a+m*r] = pPHt[r+n*a];
+        }
+        pSe[a] = pe[a];
+    }
+    dgesv_(&N_lapack,&NRHS,pS,&N_lapack,pworkspace_d,pKt,&N_lapack,&INFO);
+    if (INFO != 0){
+        return;
+    }
+
+    // Log likelihood of the innovation
+    double log_determinant = 0;
+    double quadratic = 0;
+    for (a=0;a<m;a++){
+        log_determinant += log(fabs(pS[a*(m+1)]));
+        quadratic += pe[a]*pSe[a];
+    }
+    pekf->plog_likelihood[i] -= 0.5*(log_determinant+quadratic+m*log(2*EKF_PI));
+
+    // x = x + K*e
+    for (r=0;r<n;r++){
+        sum = 0;
+        for (a=0;a<m;a++){
+            sum += pKt[a+m*r]*pe[a];
+        }
+        px[r] += sum;
+    }
+
+    // The concentrations are kept between zero and the inlet concentrations,
+    // since the implicit Euler step has non-physical roots outside this region
+    px[0] = fmin(fmax(px[0],0),pekf->params.CAin);
+    px[1] = fmin(fmax(px[1],0),pekf->params.CBin);
+
+    // L = I - K*H
+    for (r=0;r<n;r++){
+        for (c=0;c<n;c++){
+            sum = (r == c) ? 1 : 0;
+            for (a=0;a<m;a++){
+                sum -= pKt[a+m*r]*pH[a+m*c];
+            }
+            pL[r+n*c] = sum;
+        }
+    }
+
+    // T1 = L*P
+    for (r=0;r<n;r++){
+        for (c=0;c<n;c++){
+            sum = 0;
+            for (k=0;k<n;k++){
+                sum += pL[r+n*k]*pP[k+n*c];
+            }
+            pT1[r+n*c] = sum;
+        }
+    }
+
+    // P = T1*L' + K*R*K'
+    for (r=0;r<n;r++){
+        for (c=0;c<=r;c++){
+            sum = 0;
+            for (k=0;k<n;k++){
+                sum += pT1[r+n*k]*pL[c+n*k];
+            }
+            for (a=0;a<m;a++){
+                for (b=0;b<m;b++){
+                    sum += pKt[a+m*r]*pR[a+m*b]*pKt[b+m*c];
+                }
+            }
+            pP[r+n*c] = sum;
+            pP[c+n*r] = sum;
+        }
+    }
+}
+
+ekf_batch *ekf_create(
+    int num_filters,
+    int m,
+    int time_steps_per_sample,
+    double sample_time,
+    double *pH,
+    double *pR,
+    double *px0,
+    double *pP0,
+    CSTR_parameters *pparams
+){
+    if (num_filters < 1 || m < 1 || time_steps_per_sample < 1){
+        return NULL;
+    }
+    ekf_batch *pekf = (ekf_batch*) calloc(1,sizeof(ekf_batch));
+    if (pekf == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int i, j;
+    pekf->num_filters = num_filters;
+    pekf->n = n;
+    pekf->m = m;
+    pekf->time_steps_per_sample = time_steps_per_sample;
+    pekf->num_threads = omp_get_max_threads();
+    pekf->max_iterations = 20;
+    pekf->tolerance = 10e-6;
+    pekf->params = *pparams;
+    pekf->pt = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    pekf->px = (double*) malloc(n*num_filters*sizeof(double));
+    pekf->pP = (double*) malloc(n*n*num_filters*sizeof(double));
+    pekf->pH = (double*) malloc(m*n*sizeof(double));
+    pekf->pR = (double*) malloc(m*m*sizeof(double));
+    pekf->pinnovation = (double*) calloc(m*num_filters,sizeof(double));
+    pekf->plog_likelihood = (double*) calloc(num_filters,sizeof(double));
+    pekf->pworkspace_lf = (double*) malloc(pekf->num_threads*thread_workspace_size(n,m)*sizeof(double));
+    pekf->pworkspace_d = (int*) malloc(pekf->num_threads*(n+m)*sizeof(int));
+    if (pekf->pt == NULL || pekf->px == NULL || pekf->pP == NULL || pekf->pH == NULL
+        || pekf->pR == NULL || pekf->pinnovation == NULL || pekf->plog_likelihood == NULL
+        || pekf->pworkspace_lf == NULL || pekf->pworkspace_d == NULL){
+        ekf_destroy(pekf);
+        return NULL;
+    }
+    linspace(pekf->pt,0,sample_time,time_steps_per_sample);
+    memcpy(pekf->pH,pH,m*n*sizeof(double));
+    memcpy(pekf->pR,pR,m*m*sizeof(double));
+    for (i=0;i<num_filters;i++){
+        for (j=0;j<n;j++){
+            pekf->px[i*n+j] = px0[j];
+        }
+        for (j=0;j<n*n;j++){
+            pekf->pP[i*n*n+j] = pP0[j];
+        }
+    }
+    return pekf;
+}
+
+void ekf_predict(
+    ekf_batch *pekf,
+    double *pu,
+    int u_increment
+){
+    int size_thread = thread_workspace_size(pekf->n,pekf->m);
+    int i;
+    #pragma omp parallel for num_threads(pekf->num_threads) schedule(static)
+    for (i=0;i<pekf->num_filters;i++){
+        int thread_index = omp_get_thread_num();
+        predict_one(
+            pekf,
+            i,
+            &pu[i*u_increment],
+            &pekf->pworkspace_lf[size_thread*thread_index],
+            &pekf->pworkspace_d[(pekf->n+pekf->m)*thread_index]
+        );
+    }
+}
+
+void ekf_update(
+    ekf_batch *pekf,
+    double *py
+){
+    int size_thread = thread_workspace_size(pekf->n,pekf->m);
+    int i;
+    #pragma omp parallel for num_threads(pekf->num_threads) schedule(static)
+    for (i=0;i<pekf->num_filters;i++){
+        int thread_index = omp_get_thread_num();
+        update_one(
+            pekf,
+            i,
+            &py[i*pekf->m],
+            &pekf->pworkspace_lf[size_thread*thread_index],
+            &pekf->pworkspace_d[(pekf->n+pekf->m)*thread_index]
+        );
+    }
+}
+
+void ekf_step(
+    ekf_batch *pekf,
+    double *pu,
+    int u_increment,
+    double *py
+){
+    double timer = omp_get_wtime();
+    int size_thread = thread_workspace_size(pekf->n,pekf->m);
+    int i;
+    #pragma omp parallel for num_threads(pekf->num_threads) schedule(static)
+    for (i=0;i<pekf->num_filters;i++){
+        int thread_index = omp_get_thread_num();
+        double *pworkspace_lf = &pekf->pworkspace_lf[size_thread*thread_index];
+        int *pworkspace_d = &pekf->pworkspace_d[(pekf->n+pekf->m)*thread_index];
+        predict_one(pekf,i,&pu[i*u_increment],pworkspace_lf,pworkspace_d);
+        update_one(pekf,i,&py[i*pekf->m],pworkspace_lf,pworkspace_d);
+    }
+    pekf->last_step_time = omp_get_wtime()-timer;
+    if (pekf->last_step_time > pekf->max_step_time){
+        pekf->max_step_time = pekf->last_step_time;
+    }
+}
+
+void ekf_destroy(
+    ekf_batch *pekf
+){
+    if (pekf == NULL){
+        return;
+    }
+    free(pekf->pworkspace_d);
+    free(pekf->pworkspace_lf);
+    free(pekf->plog_likelihood);
+    free(pekf->pinnovation);
+    free(pekf->pR);
+    free(pekf->pH);
+    free(pekf->pP);
+    free(pekf->px);
+    free(pekf->pt);
+    free(pekf);
+}
@@ -0,0 +1,140 @@
+/// @file KalmanFilter.h
+
+#ifndef CSTR_KALMAN_FILTER
+#define CSTR_KALMAN_FILTER
+
+#include "CSTR.h"
+
+/**
+ * A batch of independent continuous-discrete extended Kalman filters for the CSTR, for instance one per reactor.
+ * Between two samples the mean is propagated with the implicit Euler scheme without noise and the covariance with the
+ * implicit Euler discretization of the Lyapunov equation \f$\dot{P}=AP+PA^T+GG^T\f$,
+ * \f[
+ *     P_{k+1} = \Phi_k\big(P_k+G_kG_k^Th\big)\Phi_k^T,\qquad \Phi_k=\big(I-A(x_{k+1})h\big)^{-1},
+ * \f]
+ * where \f$A\f$ is CSTR_3D_drift_jacobian() and \f$G\f$ the diagonal matrix with CSTR_3D_diffusion() on the diagonal. The
+ * factorization of \f$I-Ah\f$ left by newton_solver() is reused. In a step where \f$I-Ah\f$ is singular, only
+ * \f$G_kG_k^Th\f$ is added to the covariance. At every sample the linear measurement \f$y=Hx+v\f$, \f$v\sim N(0,R)\f$, is
+ * incorporated with the Joseph form of the update.
+ *
+ * The filters are processed in parallel with one workspace per thread and no memory is allocated after ekf_create().
+ * The states, the covariances and the noise matrices may be changed directly between the calls.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct ekf_batch{
+    int num_filters;            // Number of independent filters
+    int n;                      // Number of states
+    int m;                      // Number of measurements
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int num_threads;            // Number of workspaces
+    int max_iterations;         // Newton iterations per step
+    double tolerance;           // Newton tolerance
+    double last_step_time;      // Wall clock time of the last ekf_step() in seconds
+    double max_step_time;       // Largest wall clock time of ekf_step() in seconds
+    CSTR_parameters params;     // Model parameters
+    double *pt;                 // Time grid of one sample, (steps+1)
+    double *px;                 // States, n*num_filters
+    double *pP;                 // Covariances, column major, n*n*num_filters
+    double *pH;                 // Measurement matrix, column major, m*n
+    double *pR;                 // Measurement noise covariance, m*m
+    double *pinnovation;        // Innovations of the last update, m*num_filters
+    double *plog_likelihood;    // Accumulated log likelihood of the innovations, num_filters
+    double *pworkspace_lf;      // Per thread workspace
+    int *pworkspace_d;          // Per thread pivots
+} ekf_batch;
+
+/**
+ * Allocates a batch of filters which all start from the mean px0 and the covariance pP0.
+ *
+ * @param[in] num_filters: Number of filters.
+ * @param[in] m: Number of measurements.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps between two samples.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] pH: Measurement matrix, column major. Must be of size \f$m\cdot n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pR: Measurement noise covariance. Must be of size \f$m\cdot m\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] px0: Initial mean. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pP0: Initial covariance. Must be of size \f$n\cdot n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pparams: Pointer to the model parameters. The struct is copied.
+ *
+ * @return Pointer to the batch or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+ekf_batch *ekf_create(
+    int num_filters,
+    int m,
+    int time_steps_per_sample,
+    double sample_time,
+    double *pH,
+    double *pR,
+    double *px0,
+    double *pP0,
+    CSTR_parameters *pparams
+);
+
+/**
+ * Time update of all filters over one sample.
+ *
+ * @param[in,out] pekf: Pointer to the batch.
+ * @param[in] pu: Flow rates in [L / s].
+ * @param[in] u_increment: Offset between the flow rates of two filters. If 0, all filters use pu[0].
+ *
+ * @date 19th of October 2026
+ */
+
+void ekf_predict(
+    ekf_batch *pekf,
+    double *pu,
+    int u_increment
+);
+
+/**
+ * Measurement update of all filters. The innovations are stored in pinnovation and their log likelihood is added
+ * to plog_likelihood.
+ *
+ * @param[in,out] pekf: Pointer to the batch.
+ * @param[in] py: Measurements, m per filter. Must be of size \f$m\cdot\text{num\_filters}\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+void ekf_update(
+    ekf_batch *pekf,
+    double *py
+);
+
+/**
+ * One sample of all filters: ekf_predict() followed by ekf_update() in the same parallel region.
+ * The wall clock time is stored in last_step_time and max_step_time.
+ *
+ * @param[in,out] pekf: Pointer to the batch.
+ * @param[in] pu: Flow rates in [L / s].
+ * @param[in] u_increment: Offset between the flow rates of two filters. If 0, all filters use pu[0].
+ * @param[in] py: Measurements, m per filter.
+ *
+ * @date 19th of October 2026
+ */
+
+void ekf_step(
+    ekf_batch *pekf,
+    double *pu,
+    int u_increment,
+    double *py
+);
+
+/**
+ * Frees all memory held by the batch.
+ *
+ * @param[in] pekf: Pointer to the batch. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void ekf_destroy(
+    ekf_batch *pekf
+);
+
+#endif
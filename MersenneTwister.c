@@ -13,25 +13,73 @@ void set_seed(
   mersenne_seed = x;
 };
 
+unsigned long get_seed(void){
+  return mersenne_seed;
+}
+
 /*******************************************************************************
 Helper functions for Mersenne Twister
 *******************************************************************************/
 
-// Initializing the generator
-void seed_mt(
-    unsigned long *parr
+// Initializing the generator from an explicit seed
+static void seed_mt_from(
+    unsigned long *parr,
+    unsigned long seed
 ) {
     // Length of generator
     int n = 624;
     // 0xffffffff is equivalent to 4294967295 in decimal
     // 0xffffffffUL & is the modulo operaion in the field with 2^32 elements
-    parr[0] = 0xffffffffUL & mersenne_seed;
+    parr[0] = 0xffffffffUL & seed;
     int i = 0;
     for (i=1;i<n;i++) {
         parr[i] = 0xffffffffUL & (69069 * parr[i-1]);
     }
 }
 
+// Initializing the generator from a 64 bit seed with init_by_array() of the 2002 edition, whose key is the two
+// 32 bit halves of the seed, such that distinct seeds give distinct generators
+static void seed_mt_by_array(
+    unsigned long *parr,
+    unsigned long seed
+) {
+    int n = 624;
+    unsigned long key[2] = {0xffffffffUL & seed, 0xffffffffUL & (seed >> 32)};
+    int i, j, k;
+    parr[0] = 19650218UL;
+    for (i=1;i<n;i++) {
+        parr[i] = 0xffffffffUL & (1812433253UL * (parr[i-1] ^ (parr[i-1] >> 30)) + i);
+    }
+    i = 1;
+    j = 0;
+    for (k=n;k>0;k--) {
+        parr[i] = 0xffffffffUL & ((parr[i] ^ ((parr[i-1] ^ (parr[i-1] >> 30)) * 1664525UL)) + key[j] + j);
+        i++;
+        j = (j+1) % 2;
+        if (i >= n) {
+            parr[0] = parr[n-1];
+            i = 1;
+        }
+    }
+    for (k=n-1;k>0;k--) {
+        parr[i] = 0xffffffffUL & ((parr[i] ^ ((parr[i-1] ^ (parr[i-1] >> 30)) * 1566083941UL)) - i);
+        i++;
+        if (i >= n) {
+            parr[0] = parr[n-1];
+            i = 1;
+        }
+    }
+    // The most significant bit makes the state non-zero
+    parr[0] = 0x80000000UL;
+}
+
+// Initializing the generator from the global seed
+void seed_mt(
+    unsigned long *parr
+) {
+    seed_mt_from(parr,mersenne_seed);
+}
+
 // Twisting the generator
 void twist(
   unsigned long *parr
@@ -70,7 +118,19 @@ void twist(
 Implementation of Mersenne Twister
 *******************************************************************************/
 
-void mersenne_twister(
+// Tempering operation
+static unsigned long temper(
+    unsigned long y
+){
+    y = y ^ (y >> 11);
+    y = y ^ ((y << 7) & 0x9d2c5680);
+    y = y ^ ((y << 15) & 0xefc60000);
+    y = y ^ (y >> 18);
+    return y;
+}
+
+// Drawing N uniform variables from a generator which has already been seeded
+static void fill_uniform(
     double *parr, 
     unsigned long *pgenerator, 
     int N
@@ -78,8 +138,6 @@ void mersenne_twister(
     int i;
     // Length of generator
     int n = 624;
-    // Offset between indexes in generator
-    seed_mt(pgenerator);
     twist(pgenerator);
     int index = 0;
     for(i=0;i<N;i++){
@@ -89,18 +147,70 @@ void mersenne_twister(
             index = 0;
         }
         // Tempering operation
-        unsigned long y = pgenerator[index];
-        y = y ^ (y >> 11);
-        y = y ^ ((y << 7) & 0x9d2c5680);
-        y = y ^ ((y << 15) & 0xefc60000);
-        y = y ^ (y >> 18);
+        unsigned long y = temper(pgenerator[index]);
         index += 1;
         // Transforming unsigned integer back to the open unit interval (0,1)
         parr[i] = (0.5+(long double) y )/(0xffffffffUL+1);
     }
+}
+
+// Single precision version of fill_uniform(), the values are rounded from the same double values
+static void fill_uniform_float(
+    float *parr,
+    unsigned long *pgenerator,
+    int N
+){
+    int i;
+    int n = 624;
+    twist(pgenerator);
+    int index = 0;
+    for(i=0;i<N;i++){
+        if (index >= n) {
+            twist(pgenerator);
+            index = 0;
+        }
+        unsigned long y = temper(pgenerator[index]);
+        index += 1;
+        parr[i] = (float) ((0.5+(double) y)/(0xffffffffUL+1));
+    }
+}
+
+void mersenne_twister(
+    double *parr, 
+    unsigned long *pgenerator, 
+    int N
+){
+    // Length of generator
+    int n = 624;
+    seed_mt(pgenerator);
+    fill_uniform(parr,pgenerator,N);
     mersenne_seed = pgenerator[n-1];
 }
 
+void mersenne_twister_seeded(
+    double *parr, 
+    unsigned long *pgenerator, 
+    int N,
+    unsigned long seed
+){
+    seed_mt_by_array(pgenerator,seed);
+    fill_uniform(parr,pgenerator,N);
+}
+
+unsigned long mersenne_stream_seed(
+    unsigned long seed,
+    unsigned long stream
+){
+    // SplitMix64 finalizer such that neighbouring streams get unrelated seeds. It is a bijection of the 64 bit
+    // input, so the streams below 2^32 of a base seed get distinct seeds
+    unsigned long long z = ((unsigned long long) seed << 32) ^ (unsigned long long) stream;
+    z += 0x9e3779b97f4a7c15ULL;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    z = z ^ (z >> 31);
+    return (unsigned long) z;
+}
+
 /*******************************************************************************
 Box Muller Transformation of Uniform Distribution
 *******************************************************************************/
@@ -132,6 +242,31 @@ void box_muller(
     }
 }
 
+void box_muller_float(
+    float *parr,
+    int N,
+    float mu,
+    float sigma
+){
+    int i;
+    float U0,U1,R,Omega,firstVal;
+    float PI = 3.14159265f;
+    // If the length is uneven, the first value is
+    // also used as the last
+    firstVal = parr[0];
+    for(i=0;i<N;i++){
+        U0 = parr[i];
+        U1 = (i < N-1) ? parr[i+1] : firstVal;
+        R = sqrtf(-2*logf(U0));
+        Omega = 2*PI*U1;
+        parr[i] = mu+sigma*R*cosf(Omega);
+        if (i<N-1){
+            parr[i+1] = mu+sigma*R*sinf(Omega);
+            i++;
+        }
+    }
+}
+
 void d_rand_standard_normal(
     double *parr, 
     unsigned long *pworkspace, 
@@ -151,3 +286,87 @@ void d_rand_normal(
   mersenne_twister(parr,pworkspace,N);
   box_muller(parr,N,mu,sigma);
 }
+
+void d_rand_normal_seeded(
+    double *parr, 
+    unsigned long *pworkspace, 
+    int N,
+    unsigned long seed,
+    long double mu, 
+    long double sigma
+){
+  mersenne_twister_seeded(parr,pworkspace,N,seed);
+  box_muller(parr,N,mu,sigma);
+}
+
+void s_rand_normal_seeded(
+    float *parr,
+    unsigned long *pworkspace,
+    int N,
+    unsigned long seed,
+    float mu,
+    float sigma
+){
+  seed_mt_by_array(pworkspace,seed);
+  fill_uniform_float(parr,pworkspace,N);
+  box_muller_float(parr,N,mu,sigma);
+}
+
+/*******************************************************************************
+Discrete increments for weak approximations
+*******************************************************************************/
+
+void d_rand_two_point_seeded(
+    double *parr,
+    unsigned long *pworkspace,
+    int N,
+    unsigned long seed,
+    double sigma
+){
+    int i, bit, count;
+    // Length of generator
+    int n = 624;
+    int index = 0;
+    seed_mt_by_array(pworkspace,seed);
+    twist(pworkspace);
+    // Every tempered word gives the signs of 32 values
+    for (i=0;i<N;i+=32){
+        if (index >= n) {
+            twist(pworkspace);
+            index = 0;
+        }
+        unsigned long y = temper(pworkspace[index]);
+        index += 1;
+        count = (N-i < 32) ? N-i : 32;
+        for (bit=0;bit<count;bit++){
+            parr[i+bit] = ((y >> bit) & 1) ? sigma : -sigma;
+        }
+    }
+}
+
+void d_rand_three_point_seeded(
+    double *parr,
+    unsigned long *pworkspace,
+    int N,
+    unsigned long seed,
+    double sigma
+){
+    int i;
+    // Length of generator
+    int n = 624;
+    int index = 0;
+    // ceil(2^32/6), the same number of words gives the positive and the negative value
+    unsigned long sixth = 715827883UL;
+    double value = sqrt(3.0)*sigma;
+    seed_mt_by_array(pworkspace,seed);
+    twist(pworkspace);
+    for (i=0;i<N;i++){
+        if (index >= n) {
+            twist(pworkspace);
+            index = 0;
+        }
+        unsigned long y = temper(pworkspace[index]);
+        index += 1;
+        parr[i] = (y < sixth) ? value : ((y < 2*sixth) ? -value : 0);
+    }
+}
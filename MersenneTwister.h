@@ -19,6 +19,17 @@ void set_seed(
     unsigned int x
 );
 
+/**
+ * Returns the current seed of mersenne_twister(). Since mersenne_twister() continues from this seed, passing the
+ * returned value to set_seed() later resumes the same sequence of random numbers, e.g. after a restart.
+ *
+ * @return The current seed.
+ *
+ * @date 19th of October 2026
+*/
+
+unsigned long get_seed(void);
+
 /**
  * This is double precision implementation of the Linear Congruential Generator which can be used for both singe, double and extended precision.
  * This pseudo random number generator generates a sample taken from the uniform distribution on the unit interval \f$(0,1)\f$. 
@@ -62,6 +73,46 @@ void mersenne_twister(
     int N
 );
 
+/**
+ * Reentrant version of mersenne_twister(). The generator is seeded from "seed" instead of the global seed set with set_seed(),
+ * and the global seed is neither read nor updated. Hence the routine can be called concurrently from several threads as long
+ * as every thread uses its own "pgenerator". Calling it twice with the same seed reproduces the same sample. The generator
+ * is initialized with init_by_array() of the 2002 edition of Mersenne Twister from the two 32 bit halves of the seed, so
+ * distinct seeds give distinct generators.
+ * 
+ * @param[out] parr: Pointer to memory of length \f$N\cdot \text{sizeof}(double)\f$.
+ * @param[in] pgenerator: Pointer to memory of length \f$624\cdot\text{sizeof}(\text{unsigned long})\f$. This is used for storing the generator.
+ * @param[in] N: Number of random variables to be generated.
+ * @param[in] seed: Seed of the generator. All 64 bits are used.
+ * 
+ * @date 19th of October 2026
+*/
+
+void mersenne_twister_seeded(
+    double *parr, 
+    unsigned long *pgenerator, 
+    int N,
+    unsigned long seed
+);
+
+/**
+ * Derives the seed of an independent random number stream from a base seed and a stream index, for instance
+ * the index of a thread or of a block of realizations. The two inputs are mixed with the SplitMix64 finalizer
+ * such that neighbouring stream indexes give unrelated generators. All 64 bits of the result are used by the seeded
+ * generators, and the stream indexes below \f$2^{32}\f$ of a base seed give distinct seeds, so two streams never
+ * share their random numbers.
+ * 
+ * @param[in] seed: Base seed of the experiment.
+ * @param[in] stream: Index of the stream.
+ * 
+ * @date 19th of October 2026
+*/
+
+unsigned long mersenne_stream_seed(
+    unsigned long seed,
+    unsigned long stream
+);
+
 /**
  * This is the implementation of the Box-Muller transformation which transforms uniformly distributed random variables into normally
  * distributed random variables in sets of two. Note that if an uneven number of variables is inputted (if 2 divides N-1), the function 
@@ -86,6 +137,25 @@ void box_muller(
     long double sigma
 );
 
+/**
+ * Single precision version of box_muller(). The transformation is computed in single precision, which allows twice
+ * as many values per SIMD register.
+ *
+ * @param[in,out] parr: Pointer to memory of length \f$N\cdot \text{sizeof}(float)\f$.
+ * @param[in] N: Number of random variables held by parr.
+ * @param[in] mu: The desired scalar mean of the distribution.
+ * @param[in] sigma: The desired scalar standard deviation of the distribution.
+ *
+ * @date 19th of October 2026
+*/
+
+void box_muller_float(
+    float *parr,
+    int N,
+    float mu,
+    float sigma
+);
+
 /**
  * A double precision implementation of the rejection based ratio of unitforms normal transformation. 
  * Since this is a rejection based method, it does not always need exactly the same amount of uniform random numbers. 
@@ -199,4 +269,99 @@ void d_rand_normal(
     long double sigma
 );
 
+/**
+ * Reentrant version of d_rand_normal(). The uniform sample is drawn with mersenne_twister_seeded() so
+ * the global seed is left untouched.
+ * 
+ * @param[out] parr: Pointer to memory of length \f$N\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pworkspace: Pointer to memory of length \f$624\cdot\text{sizeof}(\text{unsigned long})\f$.
+ * @param[in] N: Number of random variables to be generated.
+ * @param[in] seed: Seed of the generator.
+ * @param[in] mu: Mean of distribution.
+ * @param[in] sigma: Standard deviation of distribution.
+ * 
+ * @date 19th of October 2026
+*/
+
+void d_rand_normal_seeded(
+    double *parr, 
+    unsigned long *pworkspace, 
+    int N,
+    unsigned long seed,
+    long double mu, 
+    long double sigma
+);
+
+/**
+ * Single precision version of d_rand_normal_seeded(). The uniform variables are those of mersenne_twister_seeded()
+ * rounded to single precision, so the sample approximates the double precision sample of the same seed.
+ *
+ * @param[out] parr: Pointer to memory of length \f$N\cdot\text{sizeof}(\text{float})\f$.
+ * @param[in] pworkspace: Pointer to memory of length \f$624\cdot\text{sizeof}(\text{unsigned long})\f$.
+ * @param[in] N: Number of random variables to be generated.
+ * @param[in] seed: Seed of the generator.
+ * @param[in] mu: Mean of distribution.
+ * @param[in] sigma: Standard deviation of distribution.
+ *
+ * @date 19th of October 2026
+*/
+
+void s_rand_normal_seeded(
+    float *parr,
+    unsigned long *pworkspace,
+    int N,
+    unsigned long seed,
+    float mu,
+    float sigma
+);
+
+/**
+ * Draws N independent two-point random variables, \f$\pm\sigma\f$ with probability 1/2 each, for weak
+ * approximations of stochastic differential equations. Their moments up to the third equal those of
+ * \f$N(0,\sigma^2)\f$, which is enough for a scheme of weak order one, and with \f$\sigma=\sqrt{h}\f$ they replace the
+ * Wiener increments of a time step of length \f$h\f$. Every tempered word of the Mersenne Twister gives the signs of
+ * 32 values, so no logarithm, square root or trigonometric function is evaluated. The generator is seeded as in
+ * mersenne_twister_seeded().
+ *
+ * @param[out] parr: Pointer to memory of length \f$N\cdot \text{sizeof}(double)\f$.
+ * @param[in] pworkspace: Pointer to memory of length \f$624\cdot\text{sizeof}(\text{unsigned long})\f$. This is used for storing the generator.
+ * @param[in] N: Number of random variables to be generated.
+ * @param[in] seed: Seed of the generator. All 64 bits are used.
+ * @param[in] sigma: The standard deviation of the distribution.
+ *
+ * @date 19th of October 2026
+*/
+
+void d_rand_two_point_seeded(
+    double *parr,
+    unsigned long *pworkspace,
+    int N,
+    unsigned long seed,
+    double sigma
+);
+
+/**
+ * Draws N independent three-point random variables, \f$\pm\sqrt{3}\sigma\f$ with probability 1/6 each and 0 with
+ * probability 2/3. Their moments up to the fifth equal those of \f$N(0,\sigma^2)\f$, which is enough for a scheme of
+ * weak order two. Every value is chosen by comparing one tempered word of the Mersenne Twister with two thresholds,
+ * which are the same distance apart such that the distribution is symmetric, and the probabilities differ from 1/6
+ * and 2/3 by less than \f$2^{-32}\f$. The generator is seeded as in mersenne_twister_seeded().
+ *
+ * @param[out] parr: Pointer to memory of length \f$N\cdot \text{sizeof}(double)\f$.
+ * @param[in] pworkspace: Pointer to memory of length \f$624\cdot\text{sizeof}(\text{unsigned long})\f$. This is used for storing the generator.
+ * @param[in] N: Number of random variables to be generated.
+ * @param[in] seed: Seed of the generator. All 64 bits are used.
+ * @param[in] sigma: The standard deviation of the distribution.
+ *
+ * @date 19th of October 2026
+*/
+
+void d_rand_three_point_seeded(
+    double *parr,
+    unsigned long *pworkspace,
+    int N,
+    unsigned long seed,
+    double sigma
+);
+
 #endif
@@ -0,0 +1,424 @@
+/// @file NMPC.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "NMPC.h"
+#include "CSTR.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+
+// Size of the workspace of one thread
+static int thread_workspace_size(
+    nmpc_controller *pc
+){
+    int n = pc->n;
+    return n*(pc->time_steps_per_sample+1) + (5+2*n)*n + n*(pc->horizon+1) + pc->horizon;
+}
+
+// Simulating the samples start,...,horizon-1 without noise from the state stored in pstates[start]
+static void predict(
+    nmpc_controller *pc,
+    double *pF,
+    int start,
+    double *pstates,
+    double *pworkspace_lf,
+    int *pworkspace_d
+){
+    int n = pc->n;
+    int steps = pc->time_steps_per_sample;
+    double *ptrajectory = &pworkspace_lf[0];
+    double *pworkspace_solver = &pworkspace_lf[n*(steps+1)];
+    int i, k;
+    double u;
+    for (k=start;k<pc->horizon;k++){
+        // Converting to [L / s]
+        u = pF[k]/(60*1000);
+        vector_implicit_euler(
+            steps,
+            n,
+            1,
+            pc->pt,
+            ptrajectory,
+            pc->pzero_noise,
+            pworkspace_solver,
+            pworkspace_d,
+            pc->max_iterations,
+            pc->tolerance,
+            CSTR_3D_drift,
+            CSTR_3D_diffusion,
+            CSTR_3D_drift_jacobian,
+            &u,
+            NULL,
+            &pc->params,
+            &pstates[k*n]
+        );
+        for (i=0;i<n;i++){
+            pstates[(k+1)*n+i] = ptrajectory[steps*n+i];
+        }
+    }
+}
+
+// Computing the residuals and returning the cost
+static double residuals(
+    nmpc_controller *pc,
+    double *pF,
+    double *pstates,
+    double *pref,
+    double F_previous,
+    double *presidual
+){
+    int n = pc->n;
+    int horizon = pc->horizon;
+    double sqrt_q = sqrt(pc->q);
+    double sqrt_r = sqrt(pc->r);
+    double cost = 0;
+    int k;
+    for (k=0;k<horizon;k++){
+        presidual[k] = sqrt_q*(pstates[(k+1)*n+2]-pref[k]);
+        presidual[horizon+k] = sqrt_r*(pF[k]-((k > 0) ? pF[k-1] : F_previous));
+        cost += presidual[k]*presidual[k]+presidual[horizon+k]*presidual[horizon+k];
+    }
+    // A diverged prediction is never accepted
+    if (!isfinite(cost)){
+        return HUGE_VAL;
+    }
+    return cost;
+}
+
+// Projecting onto the input bounds
+static void clamp(
+    nmpc_controller *pc,
+    double *pF
+){
+    int k;
+    for (k=0;k<pc->horizon;k++){
+        if (pF[k] < pc->F_min){
+            pF[k] = pc->F_min;
+        }
+        if (pF[k] > pc->F_max){
+            pF[k] = pc->F_max;
+        }
+    }
+}
+
+// Forward differences of the residuals, one column per iteration
+static void jacobian(
+    nmpc_controller *pc
+){
+    int n = pc->n;
+    int horizon = pc->horizon;
+    int rows = 2*horizon;
+    int size_thread = thread_workspace_size(pc);
+    double sqrt_q = sqrt(pc->q);
+    double sqrt_r = sqrt(pc->r);
+    int j;
+    #pragma omp parallel for num_threads(pc->num_threads) schedule(dynamic)
+    for (j=0;j<horizon;j++){
+        int thread_index = omp_get_thread_num();
+        int i, k;
+        double *pw = &pc->pworkspace_lf[size_thread*thread_index];
+        double *pstates = &pw[n*(pc->time_steps_per_sample+1) + (5+2*n)*n];
+        double *pF = &pstates[n*(horizon+1)];
+        double *pcolumn = &pc->pjacobian[rows*j];
+
+        // Perturbing into the feasible region
+        double h = (pc->pF[j] + pc->fd_step <= pc->F_max) ? pc->fd_step : -pc->fd_step;
+        for (k=0;k<horizon;k++){
+            pF[k] = pc->pF[k];
+        }
+        pF[j] += h;
+        for (i=0;i<n;i++){
+            pstates[j*n+i] = pc->pstates[j*n+i];
+        }
+        predict(pc,pF,j,pstates,pw,&pc->pworkspace_d[n*thread_index]);
+
+        // The states before sample j do not depend on F_j
+        for (k=0;k<horizon;k++){
+            pcolumn[k] = (k < j) ? 0 : sqrt_q*(pstates[(k+1)*n+2]-pc->pstates[(k+1)*n+2])/h;
+            if (!isfinite(pcolumn[k])){
+                pcolumn[k] = 0;
+            }
+            pcolumn[horizon+k] = 0;
+        }
+        pcolumn[horizon+j] = sqrt_r;
+        if (j+1 < horizon){
+            pcolumn[horizon+j+1] = -sqrt_r;
+        }
+    }
+}
+
+nmpc_controller *nmpc_create(
+    int horizon,
+    int time_steps_per_sample,
+    double sample_time,
+    CSTR_parameters *pP,
+    double F_min,
+    double F_max
+){
+    if (horizon < 1 || time_steps_per_sample < 1 || F_max < F_min){
+        return NULL;
+    }
+    nmpc_controller *pc = (nmpc_controller*) calloc(1,sizeof(nmpc_controller));
+    if (pc == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int k;
+    pc->n = n;
+    pc->horizon = horizon;
+    pc->time_steps_per_sample = time_steps_per_sample;
+    pc->max_iterations = 20;
+    pc->max_lm_iterations = 20;
+    // Inside a parallel region the finite differences would run in a nested region on one thread
+    pc->num_threads = omp_in_parallel() ? 1 : omp_get_max_threads();
+    pc->tolerance = 1e-9;
+    pc->q = 1;
+    pc->r = 1e-4;
+    pc->F_min = F_min;
+    pc->F_max = F_max;
+    pc->fd_step = 0.5;
+    pc->params = *pP;
+
+    int rows = 2*horizon;
+    pc->pt = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    pc->pzero_noise = (double*) calloc(n*time_steps_per_sample,sizeof(double));
+    pc->pF = (double*) malloc(horizon*sizeof(double));
+    pc->pF_initial = (double*) malloc(horizon*sizeof(double));
+    pc->pF_trial = (double*) malloc(horizon*sizeof(double));
+    pc->pstates = (double*) malloc(n*(horizon+1)*sizeof(double));
+    pc->pstates_trial = (double*) malloc(n*(horizon+1)*sizeof(double));
+    pc->presidual = (double*) malloc(rows*sizeof(double));
+    pc->presidual_trial = (double*) malloc(rows*sizeof(double));
+    pc->pjacobian = (double*) malloc(rows*horizon*sizeof(double));
+    pc->phessian = (double*) malloc(horizon*horizon*sizeof(double));
+    pc->psystem = (double*) malloc(horizon*horizon*sizeof(double));
+    pc->pstep = (double*) malloc(horizon*sizeof(double));
+    pc->ppivots = (int*) malloc(horizon*sizeof(int));
+    pc->pworkspace_lf = (double*) malloc(pc->num_threads*thread_workspace_size(pc)*sizeof(double));
+    pc->pworkspace_d = (int*) malloc(pc->num_threads*n*sizeof(int));
+    if (pc->pt == NULL || pc->pzero_noise == NULL || pc->pF == NULL || pc->pF_initial == NULL
+        || pc->pF_trial == NULL || pc->pstates == NULL || pc->pstates_trial == NULL
+        || pc->presidual == NULL || pc->presidual_trial == NULL || pc->pjacobian == NULL
+        || pc->phessian == NULL || pc->psystem == NULL || pc->pstep == NULL
+        || pc->ppivots == NULL || pc->pworkspace_lf == NULL || pc->pworkspace_d == NULL){
+        nmpc_destroy(pc);
+        return NULL;
+    }
+    linspace(pc->pt,0,sample_time,time_steps_per_sample);
+    for (k=0;k<horizon;k++){
+        pc->pF_initial[k] = (F_min+F_max)/2;
+        pc->pF[k] = pc->pF_initial[k];
+    }
+    return pc;
+}
+
+double nmpc_solve(
+    nmpc_controller *pc,
+    double *px0,
+    double *pref,
+    double F_previous
+){
+    int n = pc->n;
+    int horizon = pc->horizon;
+    int rows = 2*horizon;
+    int i, j, k, tries;
+    double *pswap;
+
+    // Nominal prediction from the warm start
+    clamp(pc,pc->pF);
+    for (i=0;i<n;i++){
+        pc->pstates[i] = px0[i];
+        pc->pstates_trial[i] = px0[i];
+    }
+    predict(pc,pc->pF,0,pc->pstates,pc->pworkspace_lf,pc->pworkspace_d);
+    double cost = residuals(pc,pc->pF,pc->pstates,pref,F_previous,pc->presidual);
+    double mu = 1e-3;
+
+    // Parameters for DGESV
+    int NRHS = 1;
+    int INFO;
+    for (pc->iterations=0;pc->iterations<pc->max_lm_iterations;pc->iterations++){
+        jacobian(pc);
+
+        // Gauss-Newton Hessian and gradient
+        for (j=0;j<horizon;j++){
+            double gradient = 0;
+            for (k=0;k<rows;k++){
+                gradient += pc->pjacobian[rows*j+k]*pc->presidual[k];
+            }
+            pc->pstep[j] = gradient;
+            for (i=0;i<=j;i++){
+                double sum = 0;
+                for (k=0;k<rows;k++){
+                    sum += pc->pjacobian[rows*i+k]*pc->pjacobian[rows*j+k];
+                }
+                pc->phessian[horizon*j+i] = sum;
+                pc->phessian[horizon*i+j] = sum;
+            }
+        }
+
+        // Increasing the damping until the cost decreases
+        double cost_trial = cost;
+        for (tries=0;tries<10;tries++){
+            for (i=0;i<horizon*horizon;i++){
+                pc->psystem[i] = pc->phessian[i];
+            }
+            for (i=0;i<horizon;i++){
+                pc->psystem[i*(horizon+1)] += mu*(pc->phessian[i*(horizon+1)]+1e-12);
+                pc->pF_trial[i] = -pc->pstep[i];
+            }
+            dgesv_(&horizon,&NRHS,pc->psystem,&horizon,pc->ppivots,pc->pF_trial,&horizon,&INFO);
+            if (INFO != 0){
+                mu *= 4;
+                continue;
+            }
+            for (i=0;i<horizon;i++){
+                pc->pF_trial[i] += pc->pF[i];
+            }
+            clamp(pc,pc->pF_trial);
+            predict(pc,pc->pF_trial,0,pc->pstates_trial,pc->pworkspace_lf,pc->pworkspace_d);
+            cost_trial = residuals(pc,pc->pF_trial,pc->pstates_trial,pref,F_previous,pc->presidual_trial);
+            if (cost_trial < cost){
+                break;
+            }
+            mu *= 4;
+        }
+        if (cost_trial >= cost){
+            break;
+        }
+
+        // Accepting the step
+        pswap = pc->pF; pc->pF = pc->pF_trial; pc->pF_trial = pswap;
+        pswap = pc->pstates; pc->pstates = pc->pstates_trial; pc->pstates_trial = pswap;
+        pswap = pc->presidual; pc->presidual = pc->presidual_trial; pc->presidual_trial = pswap;
+        double decrease = cost-cost_trial;
+        cost = cost_trial;
+        mu /= 3;
+        if (decrease < 1e-8*(cost+decrease)){
+            pc->iterations++;
+            break;
+        }
+    }
+    pc->cost = cost;
+
+    // Shifting the solution for the next call
+    double F_applied = pc->pF[0];
+    for (k=0;k<horizon-1;k++){
+        pc->pF[k] = pc->pF[k+1];
+    }
+    return F_applied;
+}
+
+void nmpc_destroy(
+    nmpc_controller *pc
+){
+    if (pc == NULL){
+        return;
+    }
+    free(pc->pworkspace_d);
+    free(pc->pworkspace_lf);
+    free(pc->ppivots);
+    free(pc->pstep);
+    free(pc->psystem);
+    free(pc->phessian);
+    free(pc->pjacobian);
+    free(pc->presidual_trial);
+    free(pc->presidual);
+    free(pc->pstates_trial);
+    free(pc->pstates);
+    free(pc->pF_trial);
+    free(pc->pF_initial);
+    free(pc->pF);
+    free(pc->pzero_noise);
+    free(pc->pt);
+    free(pc);
+}
+
+void temperature_reference(double *parray){
+    int i;
+    for (i=0;i<35;i++){
+        if (i < 12){
+            parray[i] = 300;
+        }
+        else if (i < 24){
+            parray[i] = 320;
+        }
+        else {
+            parray[i] = 340;
+        }
+    }
+}
+
+void closed_loop_simulation(
+    nmpc_controller *pc,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    int max_iterations,
+    double tolerance,
+    double *pu,
+    double *pref,
+    CSTR_parameters *pP,
+    int num_realizations,
+    int num_samples,
+    int time_steps_per_sample,
+    int N,
+    int n,
+    int dw_increment,
+    int p_increment
+){
+    int i, j, k;
+    int x_index = 0;
+    int dw_index = 0;
+    int t_index = 0;
+    int p_index = 0;
+    int x_increment = n*(N+1);
+    int sample_size = n*time_steps_per_sample;
+    double F_previous;
+    double ref[pc->horizon];
+    for (i=0;i<num_realizations;i++){
+        x_index = i*x_increment;
+        dw_index = i*dw_increment;
+        t_index = 0;
+        for (k=0;k<pc->horizon;k++){
+            pc->pF[k] = pc->pF_initial[k];
+        }
+        F_previous = pc->pF_initial[0];
+        for (j=0;j<num_samples;j++){
+            // The reference is held constant beyond the final sample
+            for (k=0;k<pc->horizon;k++){
+                ref[k] = pref[(j+k+1 < num_samples) ? j+k+1 : num_samples-1];
+            }
+            F_previous = nmpc_solve(pc,&px[x_index],ref,F_previous);
+            pu[i*num_samples+j] = F_previous/(60*1000);
+            vector_implicit_euler(
+                time_steps_per_sample,
+                n,
+                1,
+                &pt[t_index],
+                &px[x_index],
+                &pdW[dw_index],
+                pworkspace_lf,
+                pworkspace_d,
+                max_iterations,
+                tolerance,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                &pu[i*num_samples+j],
+                NULL,
+                &pP[p_index],
+                &px[x_index]
+            );
+            x_index += sample_size;
+            dw_index += sample_size;
+            t_index += time_steps_per_sample;
+        }
+        p_index += p_increment;
+    }
+}
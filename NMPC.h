@@ -0,0 +1,180 @@
+/// @file NMPC.h
+
+#ifndef CSTR_NONLINEAR_MPC
+#define CSTR_NONLINEAR_MPC
+
+#include "CSTR.h"
+
+/**
+ * Single shooting nonlinear model predictive controller for the temperature of the CSTR. At every sample the
+ * flow rates \f$F_0,\ldots,F_{N_p-1}\f$ of the horizon are computed by minimizing
+ * \f[
+ *     \phi = \sum_{k=1}^{N_p} q\,(T_k-\bar{T}_k)^2 + \sum_{k=0}^{N_p-1} r\,(F_k-F_{k-1})^2
+ * \f]
+ * subject to \f$F_{min}\leq F_k\leq F_{max}\f$, where \f$T_k\f$ is predicted with vector_implicit_euler() without noise.
+ * The problem is solved with a projected Levenberg-Marquardt method. The Jacobian of the residuals is computed with
+ * forward finite differences in parallel, one column per thread, and since a perturbation of \f$F_j\f$ does not change
+ * the states before sample \f$j\f$ every column is simulated from the nominal state at sample \f$j\f$.
+ * The solution is shifted one sample and used as initial guess in the next call.
+ * The Levenberg-Marquardt iterations stop when the relative decrease of the cost is below 1e-8.
+ *
+ * The flow rates are given in [mL / min] and the fields may be changed between calls to nmpc_solve().
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct nmpc_controller{
+    int n;                      // Number of states
+    int horizon;                // Prediction horizon in samples
+    int time_steps_per_sample;  // Implicit Euler steps per sample in the predictions
+    int max_iterations;         // Newton iterations per implicit Euler step
+    int max_lm_iterations;      // Levenberg-Marquardt iterations per call
+    int num_threads;            // Number of workspaces for the finite differences
+    int iterations;             // Levenberg-Marquardt iterations used in the last call
+    double tolerance;           // Newton tolerance
+    double q;                   // Weight on the temperature error
+    double r;                   // Weight on the input rate of change
+    double F_min;               // Lower bound on the flow rate [mL / min]
+    double F_max;               // Upper bound on the flow rate [mL / min]
+    double fd_step;             // Finite difference step [mL / min]
+    double cost;                // Optimal cost of the last call
+    CSTR_parameters params;     // Model parameters used in the predictions
+    double *pt;                 // Time grid of one sample, (steps+1)
+    double *pzero_noise;        // Zero noise, n*steps
+    double *pF;                 // Solution and warm start, horizon
+    double *pF_initial;         // Initial guess of every closed loop realization, horizon
+    double *pF_trial;           // Trial solution, horizon
+    double *pstates;            // Nominal states at the sample boundaries, n*(horizon+1)
+    double *pstates_trial;      // States of the trial solution, n*(horizon+1)
+    double *presidual;          // Residuals, 2*horizon
+    double *presidual_trial;    // Residuals of the trial solution, 2*horizon
+    double *pjacobian;          // Jacobian of the residuals, 2*horizon x horizon, column major
+    double *phessian;           // Gauss-Newton Hessian, horizon x horizon
+    double *psystem;            // Damped Hessian passed to DGESV, horizon x horizon
+    double *pstep;              // Step, horizon
+    int *ppivots;               // Pivots for DGESV, horizon
+    double *pworkspace_lf;      // Per thread: trajectory, solver workspace and states
+    int *pworkspace_d;          // Per thread: pivots for the Newton solver
+} nmpc_controller;
+
+/**
+ * Allocates a controller. The initial guess is \f$(F_{min}+F_{max})/2\f$ in every sample. A controller created
+ * inside a parallel region, e.g. one per thread, has a single workspace and computes the finite differences on the
+ * calling thread, and otherwise it has one workspace per thread of omp_get_max_threads().
+ *
+ * @param[in] horizon: Prediction horizon in samples.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample in the predictions.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] pP: Pointer to the model parameters used in the predictions. The struct is copied.
+ * @param[in] F_min: Lower bound on the flow rate in [mL / min].
+ * @param[in] F_max: Upper bound on the flow rate in [mL / min].
+ *
+ * @return Pointer to the controller or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+nmpc_controller *nmpc_create(
+    int horizon,
+    int time_steps_per_sample,
+    double sample_time,
+    CSTR_parameters *pP,
+    double F_min,
+    double F_max
+);
+
+/**
+ * Solves the optimal control problem from the state px0 and returns the first flow rate of the optimal sequence.
+ * Afterwards the optimal sequence is shifted one sample to warm start the next call. When invoked from inside a
+ * parallel region, the finite differences are computed by the calling thread only.
+ *
+ * @param[in,out] pc: Pointer to the controller.
+ * @param[in] px0: The current state. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pref: Temperature reference in the samples \f$1,\ldots,N_p\f$. Must be of size \f$N_p\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] F_previous: The flow rate applied in the previous sample in [mL / min].
+ *
+ * @return The flow rate to apply in [mL / min].
+ *
+ * @date 19th of October 2026
+ */
+
+double nmpc_solve(
+    nmpc_controller *pc,
+    double *px0,
+    double *pref,
+    double F_previous
+);
+
+/**
+ * Frees all memory held by the controller.
+ *
+ * @param[in] pc: Pointer to the controller. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void nmpc_destroy(
+    nmpc_controller *pc
+);
+
+/**
+ * The following function returns the temperature reference in [K] for a 35 minutes closed loop simulation.
+ * It steers the reactor to the unstable middle steady state and afterwards to the upper steady state.
+ *
+ * @param[in] parray: Pointer to array of doubles of length 35.
+ *
+ * @date 19th of October 2026
+ */
+
+void temperature_reference(double *parray);
+
+/**
+ * Closed loop counterpart of implicit_simulation(). Before every sample the controller computes the flow rate from
+ * the current state of the realization, the flow rate is recorded in pu and the plant is advanced one sample with
+ * vector_implicit_euler(). Every realization starts from the same initial guess, pF_initial, such that the result of a
+ * realization does not depend on which thread simulated it.
+ *
+ * @param[in,out] pc: Pointer to the controller.
+ * @param[in] pt: Pointer to the temporal solution. Must be of size \f$(N+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in,out] px: Spatial solution. The initial condition of every realization must be imposed on input.
+ * @param[in] pdW: White noise.
+ * @param[in] pworkspace_lf: Workspace for vector_implicit_euler(). Must be of size \f$n\cdot(5+2n)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pworkspace_d: Workspace for DGESV. Must be of size \f$n\cdot\text{sizeof}(\text{int})\f$.
+ * @param[in] max_iterations: Maximal number of iterations for each call to the Newton solver.
+ * @param[in] tolerance: The desired tolerance for the infinity norm used in the Newton solver.
+ * @param[out] pu: The applied flow rates in [L / s]. Must be of size \f$\text{num\_realizations}\cdot\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pref: Temperature reference in every sample. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$. The last value is repeated beyond the end.
+ * @param[in] pP: Plant parameters.
+ * @param[in] num_realizations: Number of realizations.
+ * @param[in] num_samples: Number of samples.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample in the plant.
+ * @param[in] N: Total number of time steps.
+ * @param[in] n: Number of states.
+ * @param[in] dw_increment: Offset between the noise of two realizations.
+ * @param[in] p_increment: Offset between the parameters of two realizations.
+ *
+ * @date 19th of October 2026
+ */
+
+void closed_loop_simulation(
+    nmpc_controller *pc,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    int max_iterations,
+    double tolerance,
+    double *pu,
+    double *pref,
+    CSTR_parameters *pP,
+    int num_realizations,
+    int num_samples,
+    int time_steps_per_sample,
+    int N,
+    int n,
+    int dw_increment,
+    int p_increment
+);
+
+#endif
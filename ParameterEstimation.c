@@ -0,0 +1,532 @@
+/// @file ParameterEstimation.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ParameterEstimation.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "CSTR.h"
+
+static const char estimation_magic[8] = {'C','S','T','R','E','S','T','1'};
+
+estimation_data *estimation_data_create(
+    int num_samples,
+    int m
+){
+    if (num_samples < 1 || m < 1){
+        return NULL;
+    }
+    estimation_data *pdata = (estimation_data*) calloc(1,sizeof(estimation_data));
+    if (pdata == NULL){
+        return NULL;
+    }
+    pdata->num_samples = num_samples;
+    pdata->m = m;
+    pdata->poutputs = (int*) calloc(m,sizeof(int));
+    pdata->pnoise_std = (double*) calloc(m,sizeof(double));
+    pdata->pu = (double*) calloc(num_samples,sizeof(double));
+    pdata->py = (double*) calloc((size_t) m*num_samples,sizeof(double));
+    if (pdata->poutputs == NULL || pdata->pnoise_std == NULL || pdata->pu == NULL || pdata->py == NULL){
+        estimation_data_destroy(pdata);
+        return NULL;
+    }
+    return pdata;
+}
+
+estimation_data *estimation_data_read(
+    const char *filename
+){
+    FILE *pfile = fopen(filename,"rb");
+    if (pfile == NULL){
+        return NULL;
+    }
+    char magic[8];
+    int num_samples, m, a;
+    if (fread(magic,1,8,pfile) != 8 || memcmp(magic,estimation_magic,8) != 0
+        || fread(&num_samples,sizeof(int),1,pfile) != 1 || fread(&m,sizeof(int),1,pfile) != 1){
+        fclose(pfile);
+        return NULL;
+    }
+    estimation_data *pdata = estimation_data_create(num_samples,m);
+    if (pdata == NULL){
+        fclose(pfile);
+        return NULL;
+    }
+    size_t size_y = (size_t) m*num_samples;
+    int complete = fread(&pdata->sample_time,sizeof(double),1,pfile) == 1
+        && fread(pdata->px0,sizeof(double),3,pfile) == 3
+        && fread(pdata->poutputs,sizeof(int),m,pfile) == (size_t) m
+        && fread(pdata->pnoise_std,sizeof(double),m,pfile) == (size_t) m
+        && fread(pdata->pu,sizeof(double),num_samples,pfile) == (size_t) num_samples
+        && fread(pdata->py,sizeof(double),size_y,pfile) == size_y;
+    fclose(pfile);
+    if (complete && !(pdata->sample_time > 0)){
+        complete = 0;
+    }
+    for (a=0;complete && a<m;a++){
+        if (pdata->poutputs[a] < 0 || pdata->poutputs[a] > 2 || !(pdata->pnoise_std[a] > 0)){
+            complete = 0;
+        }
+    }
+    if (!complete){
+        estimation_data_destroy(pdata);
+        return NULL;
+    }
+    return pdata;
+}
+
+int estimation_data_write(
+    const char *filename,
+    estimation_data *pdata
+){
+    FILE *pfile = fopen(filename,"wb");
+    if (pfile == NULL){
+        return -1;
+    }
+    int m = pdata->m;
+    int num_samples = pdata->num_samples;
+    size_t size_y = (size_t) m*num_samples;
+    int complete = fwrite(estimation_magic,1,8,pfile) == 8
+        && fwrite(&num_samples,sizeof(int),1,pfile) == 1
+        && fwrite(&m,sizeof(int),1,pfile) == 1
+        && fwrite(&pdata->sample_time,sizeof(double),1,pfile) == 1
+        && fwrite(pdata->px0,sizeof(double),3,pfile) == 3
+        && fwrite(pdata->poutputs,sizeof(int),m,pfile) == (size_t) m
+        && fwrite(pdata->pnoise_std,sizeof(double),m,pfile) == (size_t) m
+        && fwrite(pdata->pu,sizeof(double),num_samples,pfile) == (size_t) num_samples
+        && fwrite(pdata->py,sizeof(double),size_y,pfile) == size_y;
+    if (fclose(pfile) != 0 || !complete){
+        return -1;
+    }
+    return 0;
+}
+
+void estimation_data_destroy(
+    estimation_data *pdata
+){
+    if (pdata == NULL){
+        return;
+    }
+    free(pdata->py);
+    free(pdata->pu);
+    free(pdata->pnoise_std);
+    free(pdata->poutputs);
+    free(pdata);
+}
+
+// Pointer to the parameter identified by a CSTR_sensitivity value
+static double *parameter_pointer(
+    CSTR_parameters *pP,
+    int parameter
+){
+    switch (parameter){
+        case CSTR_SENSITIVITY_K0: return &pP->k0;
+        case CSTR_SENSITIVITY_EAR: return &pP->EaR;
+        case CSTR_SENSITIVITY_BETA: return &pP->beta;
+        case CSTR_SENSITIVITY_SIGMA: return &pP->sigma;
+        case CSTR_SENSITIVITY_CAIN: return &pP->CAin;
+        case CSTR_SENSITIVITY_CBIN: return &pP->CBin;
+        case CSTR_SENSITIVITY_TIN: return &pP->Tin;
+        default: return NULL;
+    }
+}
+
+// Parameters corresponding to the scaled parameters theta
+static void unscale(
+    parameter_estimator *pe,
+    double *ptheta,
+    CSTR_parameters *pP
+){
+    int i;
+    *pP = pe->initial;
+    for (i=0;i<pe->num_parameters;i++){
+        *parameter_pointer(pP,pe->pselected[i]) = *parameter_pointer(&pe->initial,pe->pselected[i])*exp(ptheta[i]);
+    }
+}
+
+// Cost of the trajectory px
+static double trajectory_cost(
+    parameter_estimator *pe,
+    double *px
+){
+    estimation_data *pdata = pe->pdata;
+    int n = pe->n;
+    int m = pdata->m;
+    int steps = pe->time_steps_per_sample;
+    int k, a;
+    double r;
+    double cost = 0;
+    for (k=0;k<pdata->num_samples;k++){
+        for (a=0;a<m;a++){
+            r = (pdata->py[k*m+a]-px[n*steps*(k+1)+pdata->poutputs[a]])/pdata->pnoise_std[a];
+            cost += r*r;
+        }
+    }
+    return isfinite(cost) ? 0.5*cost : HUGE_VAL;
+}
+
+parameter_estimator *estimator_create(
+    estimation_data *pdata,
+    CSTR_parameters *pinitial,
+    int *pselected,
+    int num_parameters,
+    int time_steps_per_sample
+){
+    if (pdata == NULL || num_parameters < 1 || time_steps_per_sample < 1){
+        return NULL;
+    }
+    int i;
+    for (i=0;i<num_parameters;i++){
+        if (parameter_pointer(pinitial,pselected[i]) == NULL || *parameter_pointer(pinitial,pselected[i]) <= 0){
+            return NULL;
+        }
+    }
+    parameter_estimator *pe = (parameter_estimator*) calloc(1,sizeof(parameter_estimator));
+    if (pe == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int p = num_parameters;
+    int N = pdata->num_samples*time_steps_per_sample;
+    pe->n = n;
+    pe->num_parameters = p;
+    pe->num_residuals = pdata->m*pdata->num_samples;
+    pe->time_steps_per_sample = time_steps_per_sample;
+    pe->N = N;
+    pe->num_candidates = ESTIMATOR_NUM_CANDIDATES;
+    pe->num_threads = omp_get_max_threads();
+    pe->num_threads = (pe->num_threads < pe->num_candidates) ? pe->num_threads : pe->num_candidates;
+    pe->max_iterations = 20;
+    pe->max_lm_iterations = 100;
+    pe->tolerance = 10e-6;
+    pe->lambda = 1e-3;
+    pe->pdata = pdata;
+    pe->initial = *pinitial;
+    pe->initial.sensitivity_parameters = NULL;
+    pe->initial.num_sensitivity_parameters = 0;
+    pe->params = pe->initial;
+
+    int rows = pe->num_residuals;
+    int C = pe->num_candidates;
+    pe->pselected = (int*) malloc(p*sizeof(int));
+    pe->ptheta = (double*) calloc(p,sizeof(double));
+    pe->pstandard_error = (double*) calloc(p,sizeof(double));
+    pe->pt = (double*) malloc((N+1)*sizeof(double));
+    pe->pu = (double*) malloc(pdata->num_samples*sizeof(double));
+    pe->pzero_noise = (double*) calloc((size_t) n*N,sizeof(double));
+    pe->presidual = (double*) malloc(rows*sizeof(double));
+    pe->pjacobian = (double*) malloc((size_t) rows*p*sizeof(double));
+    pe->phessian = (double*) malloc(p*p*sizeof(double));
+    pe->psystem = (double*) malloc(p*p*sizeof(double));
+    pe->pgradient = (double*) malloc(p*sizeof(double));
+    pe->pcovariance = (double*) malloc(p*p*sizeof(double));
+    pe->ptheta_candidates = (double*) malloc(p*C*sizeof(double));
+    pe->pcost_candidates = (double*) malloc(C*sizeof(double));
+    pe->plambda_candidates = (double*) malloc(C*sizeof(double));
+    pe->pcandidates = (CSTR_parameters*) malloc(C*sizeof(CSTR_parameters));
+    pe->px_candidates = (double*) malloc((size_t) n*(N+1)*C*sizeof(double));
+    pe->px_sample = (double*) malloc(n*(time_steps_per_sample+1)*sizeof(double));
+    pe->pS_sample = (double*) malloc(n*p*(time_steps_per_sample+1)*sizeof(double));
+    pe->pcolumns = (int*) malloc((1+p)*sizeof(int));
+    pe->ppivots = (int*) malloc(p*sizeof(int));
+    pe->pworkspace_lf = (double*) malloc(pe->num_threads*n*(5+2*n+2*(1+p)+p)*sizeof(double));
+    pe->pworkspace_d = (int*) malloc(pe->num_threads*n*sizeof(int));
+    if (pe->pselected == NULL || pe->ptheta == NULL || pe->pstandard_error == NULL || pe->pt == NULL
+        || pe->pu == NULL || pe->pzero_noise == NULL || pe->presidual == NULL || pe->pjacobian == NULL
+        || pe->phessian == NULL || pe->psystem == NULL || pe->pgradient == NULL || pe->pcovariance == NULL
+        || pe->ptheta_candidates == NULL
+        || pe->pcost_candidates == NULL || pe->plambda_candidates == NULL || pe->pcandidates == NULL
+        || pe->px_candidates == NULL || pe->px_sample == NULL || pe->pS_sample == NULL
+        || pe->pcolumns == NULL || pe->ppivots == NULL || pe->pworkspace_lf == NULL || pe->pworkspace_d == NULL){
+        estimator_destroy(pe);
+        return NULL;
+    }
+    memcpy(pe->pselected,pselected,p*sizeof(int));
+    linspace(pe->pt,0,pdata->num_samples*pdata->sample_time,N);
+    for (i=0;i<pdata->num_samples;i++){
+        pe->pu[i] = pdata->pu[i]/(60*1000);
+    }
+
+    // The derivative with respect to the flow rate is not needed
+    pe->pcolumns[0] = -1;
+    for (i=0;i<p;i++){
+        pe->pcolumns[1+i] = i;
+    }
+    return pe;
+}
+
+void estimator_cost(
+    parameter_estimator *pe,
+    double *ptheta,
+    int num_candidates,
+    double *pcost
+){
+    int n = pe->n;
+    int N = pe->N;
+    int x_increment = n*(N+1);
+    int i;
+    for (i=0;i<num_candidates;i++){
+        unscale(pe,&ptheta[i*pe->num_parameters],&pe->pcandidates[i]);
+    }
+    pe->num_cost_evaluations += num_candidates;
+
+    #pragma omp parallel num_threads(pe->num_threads) proc_bind(close)
+    {
+        int thread_index = omp_get_thread_num();
+        int number_of_threads = omp_get_num_threads();
+        // The candidates are divided evenly, also when there are fewer candidates than threads
+        int thread_start = thread_index*num_candidates/number_of_threads;
+        int thread_points = (thread_index+1)*num_candidates/number_of_threads-thread_start;
+        int j, k;
+        if (thread_points > 0){
+            double *px = &pe->px_candidates[(size_t) thread_start*x_increment];
+            for (j=0;j<thread_points;j++){
+                for (k=0;k<n;k++){
+                    px[j*x_increment+k] = pe->pdata->px0[k];
+                }
+            }
+
+            // One candidate parameter vector per realization, all without noise. A candidate for which the Newton
+            // solver fails is rejected.
+            for (j=0;j<thread_points;j++){
+                int failed = implicit_simulation(
+                    pe->pt,
+                    &px[j*x_increment],
+                    pe->pzero_noise,
+                    &pe->pworkspace_lf[n*(5+2*n+2*(1+pe->num_parameters)+pe->num_parameters)*thread_index],
+                    &pe->pworkspace_d[n*thread_index],
+                    pe->max_iterations,
+                    pe->tolerance,
+                    CSTR_3D_drift,
+                    CSTR_3D_diffusion,
+                    CSTR_3D_drift_jacobian,
+                    pe->pu,
+                    NULL,
+                    &pe->pcandidates[thread_start+j],
+                    1,
+                    pe->pdata->num_samples,
+                    pe->time_steps_per_sample,
+                    N,
+                    n,
+                    0,
+                    1,
+                    0
+                );
+                pcost[thread_start+j] = failed ? HUGE_VAL : trajectory_cost(pe,&px[j*x_increment]);
+            }
+        }
+    }
+}
+
+// Residuals and their Jacobian with respect to the scaled parameters at the current estimate
+static double linearize(
+    parameter_estimator *pe
+){
+    estimation_data *pdata = pe->pdata;
+    int n = pe->n;
+    int m = pdata->m;
+    int p = pe->num_parameters;
+    int rows = pe->num_residuals;
+    int steps = pe->time_steps_per_sample;
+    int k, a, c;
+    double *px = pe->px_sample;
+    double *pS = pe->pS_sample;
+    double *px_end = &px[n*steps];
+    double *pS_end = &pS[n*p*steps];
+    double cost = 0;
+    int failures = 0;
+
+    CSTR_parameters params = pe->params;
+    params.sensitivity_parameters = pe->pselected;
+    params.num_sensitivity_parameters = p;
+    for (k=0;k<n;k++){
+        px_end[k] = pdata->px0[k];
+    }
+    for (k=0;k<n*p;k++){
+        pS_end[k] = 0;
+    }
+    for (k=0;k<pdata->num_samples;k++){
+        failures += vector_implicit_euler_sensitivity(
+            steps,
+            n,
+            p,
+            &pe->pt[k*steps],
+            px,
+            pS,
+            pe->pzero_noise,
+            pe->pworkspace_lf,
+            pe->pworkspace_d,
+            pe->max_iterations,
+            pe->tolerance,
+            CSTR_3D_drift,
+            CSTR_3D_diffusion,
+            CSTR_3D_drift_jacobian,
+            CSTR_3D_drift_parameter_jacobian,
+            CSTR_3D_diffusion_parameter_jacobian,
+            1+p,
+            pe->pcolumns,
+            &pe->pu[k],
+            NULL,
+            &params,
+            px_end,
+            pS_end
+        );
+        for (a=0;a<m;a++){
+            int output = pdata->poutputs[a];
+            double weight = 1/pdata->pnoise_std[a];
+            double r = (pdata->py[k*m+a]-px_end[output])*weight;
+            pe->presidual[k*m+a] = r;
+            cost += r*r;
+
+            // dp/dtheta = p for the logarithmic scaling
+            for (c=0;c<p;c++){
+                pe->pjacobian[rows*c+k*m+a] = -pS_end[output+n*c]*(*parameter_pointer(&params,pe->pselected[c]))*weight;
+            }
+        }
+    }
+    return (failures == 0 && isfinite(cost)) ? 0.5*cost : HUGE_VAL;
+}
+
+// Gauss-Newton Hessian and gradient from the residuals and the Jacobian
+static void normal_equations(
+    parameter_estimator *pe
+){
+    int p = pe->num_parameters;
+    int rows = pe->num_residuals;
+    int i, j, k;
+    double sum;
+    for (j=0;j<p;j++){
+        sum = 0;
+        for (k=0;k<rows;k++){
+            sum += pe->pjacobian[rows*j+k]*pe->presidual[k];
+        }
+        pe->pgradient[j] = sum;
+        for (i=0;i<=j;i++){
+            sum = 0;
+            for (k=0;k<rows;k++){
+                sum += pe->pjacobian[rows*i+k]*pe->pjacobian[rows*j+k];
+            }
+            pe->phessian[p*j+i] = sum;
+            pe->phessian[p*i+j] = sum;
+        }
+    }
+}
+
+double estimator_solve(
+    parameter_estimator *pe
+){
+    int p = pe->num_parameters;
+    int C = pe->num_candidates;
+    int i, c, best;
+
+    // Parameters for DGESV
+    int N_lapack = p;
+    int NRHS = 1;
+    int INFO;
+
+    double cost = linearize(pe);
+    for (pe->iterations=0;pe->iterations<pe->max_lm_iterations;pe->iterations++){
+        normal_equations(pe);
+
+        // Steps for damping parameters spaced by 10^0.5 and centred on the current one
+        for (c=0;c<C;c++){
+            double *ptheta = &pe->ptheta_candidates[c*p];
+            pe->plambda_candidates[c] = pe->lambda*pow(10,0.5*(c-0.5*(C-1)));
+            for (i=0;i<p*p;i++){
+                pe->psystem[i] = pe->phessian[i];
+            }
+            for (i=0;i<p;i++){
+                pe->psystem[i*(p+1)] += pe->plambda_candidates[c]*(pe->phessian[i*(p+1)]+1e-12);
+                ptheta[i] = -pe->pgradient[i];
+            }
+            dgesv_(&N_lapack,&NRHS,pe->psystem,&N_lapack,pe->ppivots,ptheta,&N_lapack,&INFO);
+            for (i=0;i<p;i++){
+                ptheta[i] = (INFO == 0) ? pe->ptheta[i]+ptheta[i] : pe->ptheta[i];
+            }
+        }
+        estimator_cost(pe,pe->ptheta_candidates,C,pe->pcost_candidates);
+        best = 0;
+        for (c=1;c<C;c++){
+            if (pe->pcost_candidates[c] < pe->pcost_candidates[best]){
+                best = c;
+            }
+        }
+
+        // No candidate decreased the cost, the damping is increased beyond all candidates
+        if (!(pe->pcost_candidates[best] < cost)){
+            pe->lambda = pe->plambda_candidates[C-1]*10;
+            if (pe->lambda > 1e12){
+                break;
+            }
+            continue;
+        }
+
+        // Accepting the best candidate
+        double decrease = cost-pe->pcost_candidates[best];
+        for (i=0;i<p;i++){
+            pe->ptheta[i] = pe->ptheta_candidates[best*p+i];
+        }
+        unscale(pe,pe->ptheta,&pe->params);
+        pe->lambda = pe->plambda_candidates[best];
+        cost = linearize(pe);
+        if (decrease < 1e-10*(cost+decrease)){
+            pe->iterations++;
+            break;
+        }
+    }
+    pe->cost = cost;
+
+    // Standard errors from the inverse of the Gauss-Newton Hessian scaled by the residual variance
+    normal_equations(pe);
+    double *pcovariance = pe->pcovariance;
+    for (i=0;i<p*p;i++){
+        pe->psystem[i] = pe->phessian[i];
+        pcovariance[i] = 0;
+    }
+    for (i=0;i<p;i++){
+        pcovariance[i*(p+1)] = 1;
+    }
+    NRHS = p;
+    double variance = pe->num_residuals > p ? 2*cost/(pe->num_residuals-p) : 1;
+    dgesv_(&N_lapack,&NRHS,pe->psystem,&N_lapack,pe->ppivots,pcovariance,&N_lapack,&INFO);
+    for (i=0;i<p;i++){
+        double value = *parameter_pointer(&pe->params,pe->pselected[i]);
+        pe->pstandard_error[i] = (INFO == 0) ? value*sqrt(fabs(variance*pcovariance[i*(p+1)])) : HUGE_VAL;
+    }
+    return cost;
+}
+
+void estimator_destroy(
+    parameter_estimator *pe
+){
+    if (pe == NULL){
+        return;
+    }
+    free(pe->pworkspace_d);
+    free(pe->pworkspace_lf);
+    free(pe->ppivots);
+    free(pe->pcolumns);
+    free(pe->pS_sample);
+    free(pe->px_sample);
+    free(pe->px_candidates);
+    free(pe->pcandidates);
+    free(pe->plambda_candidates);
+    free(pe->pcost_candidates);
+    free(pe->ptheta_candidates);
+    free(pe->pcovariance);
+    free(pe->pgradient);
+    free(pe->psystem);
+    free(pe->phessian);
+    free(pe->pjacobian);
+    free(pe->presidual);
+    free(pe->pzero_noise);
+    free(pe->pu);
+    free(pe->pt);
+    free(pe->pstandard_error);
+    free(pe->ptheta);
+    free(pe->pselected);
+    free(pe);
+}
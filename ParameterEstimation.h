@@ -0,0 +1,229 @@
+/// @file ParameterEstimation.h
+
+#ifndef CSTR_PARAMETER_ESTIMATION
+#define CSTR_PARAMETER_ESTIMATION
+
+#include "CSTR.h"
+
+/**
+ * Measured data of one experiment on the CSTR. The flow rate is held constant in every sample and the outputs are
+ * measured at the end of every sample, i.e. py[k*m+a] is output \f$a\f$ at time \f$(k+1)\cdot\text{sample\_time}\f$.
+ * Output \f$a\f$ is state poutputs[a], 0 for \f$C_A\f$, 1 for \f$C_B\f$ and 2 for \f$T\f$, measured with the standard
+ * deviation pnoise_std[a].
+ *
+ * The binary file format, written with the native byte order, is
+ * \code
+ *     char   magic[8]         "CSTREST1"
+ *     int    num_samples
+ *     int    m
+ *     double sample_time      [s]
+ *     double x0[3]            [mol / L], [mol / L], [K]
+ *     int    outputs[m]
+ *     double noise_std[m]
+ *     double u[num_samples]   [mL / min]
+ *     double y[num_samples*m]
+ * \endcode
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct estimation_data{
+    int num_samples;            // Number of samples
+    int m;                      // Number of outputs
+    double sample_time;         // Sample time in seconds
+    double px0[3];              // Initial state
+    int *poutputs;              // Measured state of every output, m
+    double *pnoise_std;         // Standard deviation of every output, m
+    double *pu;                 // Flow rate in every sample in [mL / min], num_samples
+    double *py;                 // Measurements, m*num_samples
+} estimation_data;
+
+/**
+ * Allocates an empty data set.
+ *
+ * @param[in] num_samples: Number of samples.
+ * @param[in] m: Number of outputs.
+ *
+ * @return Pointer to the data set or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+estimation_data *estimation_data_create(
+    int num_samples,
+    int m
+);
+
+/**
+ * Reads a data set from a binary file.
+ *
+ * @param[in] filename: Name of the file.
+ *
+ * @return Pointer to the data set or NULL if the file could not be read or is malformed.
+ *
+ * @date 19th of October 2026
+ */
+
+estimation_data *estimation_data_read(
+    const char *filename
+);
+
+/**
+ * Writes a data set to a binary file.
+ *
+ * @param[in] filename: Name of the file.
+ * @param[in] pdata: Pointer to the data set.
+ *
+ * @return 0 on success and -1 if the file could not be written.
+ *
+ * @date 19th of October 2026
+ */
+
+int estimation_data_write(
+    const char *filename,
+    estimation_data *pdata
+);
+
+/**
+ * Frees a data set.
+ *
+ * @param[in] pdata: Pointer to the data set. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void estimation_data_destroy(
+    estimation_data *pdata
+);
+
+/**
+ * Prediction error estimator of selected parameters of the CSTR. The model is simulated without noise with the
+ * measured flow rates and the cost is
+ * \f[
+ *     V(\theta) = \frac{1}{2}\sum_{k=1}^{N_s}\sum_{a=1}^{m}\left(\frac{y_{k,a}-x_{k,o_a}(\theta)}{\sigma_a}\right)^2,
+ * \f]
+ * which is the negative log likelihood up to a constant when the measurement noise dominates. The parameters are
+ * scaled logarithmically, \f$p_i=p_{i,0}\exp(\theta_i)\f$, which keeps them positive and makes e.g. \f$k_0\f$ and
+ * \f$\beta\f$ comparable. The cost is minimized with Levenberg-Marquardt, the Jacobian of the residuals is computed
+ * with vector_implicit_euler_sensitivity() and the steps of num_candidates damping parameters are evaluated in
+ * parallel with implicit_simulation(), one candidate parameter vector per realization. The damping parameters are
+ * the ESTIMATOR_NUM_CANDIDATES fixed multiples \f$10^{(c-(C-1)/2)/2}\f$, \f$c=0,\dots,C-1\f$, of the current one, which
+ * are centred on it, so the iterations do not depend on the number of threads, and the threads share the candidates.
+ *
+ * @date 19th of October 2026
+ */
+
+#define ESTIMATOR_NUM_CANDIDATES 8
+
+typedef struct parameter_estimator{
+    int n;                      // Number of states
+    int num_parameters;         // Number of estimated parameters
+    int num_residuals;          // Number of residuals, m*num_samples
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int N;                      // Total number of time steps
+    int num_threads;            // Number of workspaces, at most num_candidates
+    int num_candidates;         // Number of damping parameters tried in every iteration
+    int max_iterations;         // Newton iterations per step
+    int max_lm_iterations;      // Maximal number of Levenberg-Marquardt iterations
+    int iterations;             // Levenberg-Marquardt iterations used by the last call to estimator_solve()
+    int num_cost_evaluations;   // Number of simulated candidate parameter vectors
+    double tolerance;           // Newton tolerance
+    double lambda;              // Current damping parameter
+    double cost;                // Cost of the current estimate
+    int *pselected;             // Estimated parameters as CSTR_sensitivity values, num_parameters
+    CSTR_parameters params;     // Current estimate, all other parameters are kept fixed
+    CSTR_parameters initial;    // Initial guess, defines the scaling
+    estimation_data *pdata;     // The data, not owned by the estimator
+    double *ptheta;             // Current scaled parameters, num_parameters
+    double *pstandard_error;    // Standard errors of the estimated parameters, num_parameters
+    double *pt;                 // Time grid of the experiment, (N+1)
+    double *pu;                 // Flow rates in [L / s], num_samples
+    double *pzero_noise;        // Zero noise, n*N
+    double *presidual;          // Residuals, num_residuals
+    double *pjacobian;          // Jacobian of the residuals, column major, num_residuals x num_parameters
+    double *phessian;           // Gauss-Newton Hessian, num_parameters x num_parameters
+    double *psystem;            // Damped Hessian passed to DGESV, num_parameters x num_parameters
+    double *pgradient;          // Gradient, num_parameters
+    double *pcovariance;        // Covariance of the scaled parameters, num_parameters x num_parameters
+    double *ptheta_candidates;  // Scaled candidate parameters, num_parameters*num_candidates
+    double *pcost_candidates;   // Cost of the candidates, num_candidates
+    double *plambda_candidates; // Damping of the candidates, num_candidates
+    CSTR_parameters *pcandidates; // Candidate parameter structs, num_candidates
+    double *px_candidates;      // Trajectories of the candidates, n*(N+1)*num_candidates
+    double *px_sample;          // Trajectory of one sample, n*(steps+1)
+    double *pS_sample;          // Sensitivities of one sample, n*num_parameters*(steps+1)
+    int *pcolumns;              // Column of every parameter in the sensitivity matrix, 1+num_parameters
+    int *ppivots;               // Pivots for DGESV, num_parameters
+    double *pworkspace_lf;      // Per thread solver workspace
+    int *pworkspace_d;          // Per thread pivots
+} parameter_estimator;
+
+/**
+ * Allocates an estimator.
+ *
+ * @param[in] pdata: Pointer to the data. It must stay allocated while the estimator is in use.
+ * @param[in] pinitial: Initial guess of the parameters. The struct is copied and the sensitivity fields are ignored.
+ * @param[in] pselected: The estimated parameters as CSTR_sensitivity values.
+ * @param[in] num_parameters: Number of estimated parameters.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ *
+ * @return Pointer to the estimator or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+parameter_estimator *estimator_create(
+    estimation_data *pdata,
+    CSTR_parameters *pinitial,
+    int *pselected,
+    int num_parameters,
+    int time_steps_per_sample
+);
+
+/**
+ * Evaluates the cost of several scaled parameter vectors in parallel. Every candidate is simulated as one
+ * realization of implicit_simulation() with p_increment equal to 1.
+ *
+ * @param[in,out] pe: Pointer to the estimator.
+ * @param[in] ptheta: Scaled parameters, num_parameters per candidate.
+ * @param[in] num_candidates: Number of candidates. At most pe->num_candidates.
+ * @param[out] pcost: The cost of every candidate. HUGE_VAL if the simulation failed.
+ *
+ * @date 19th of October 2026
+ */
+
+void estimator_cost(
+    parameter_estimator *pe,
+    double *ptheta,
+    int num_candidates,
+    double *pcost
+);
+
+/**
+ * Minimizes the cost from the current estimate. Afterwards params holds the estimate and pstandard_error
+ * the standard errors computed from the Gauss-Newton approximation of the Hessian.
+ *
+ * @param[in,out] pe: Pointer to the estimator.
+ *
+ * @return The cost of the estimate.
+ *
+ * @date 19th of October 2026
+ */
+
+double estimator_solve(
+    parameter_estimator *pe
+);
+
+/**
+ * Frees all memory held by the estimator.
+ *
+ * @param[in] pe: Pointer to the estimator. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void estimator_destroy(
+    parameter_estimator *pe
+);
+
+#endif
@@ -0,0 +1,610 @@
+/// @file ParticleFilter.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ParticleFilter.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+#include "CSTR.h"
+
+#define PF_PI 3.14159265358979323846
+
+// Random number streams of a sample
+enum{PF_STREAM_NOISE, PF_STREAM_MEASUREMENT, PF_STREAM_RESAMPLING};
+
+// Size of the noise of one chunk, including one extra value for draw_normal()
+static int noise_size(
+    int n,
+    int time_steps_per_sample
+){
+    return PF_CHUNK_SIZE*n*time_steps_per_sample + 1;
+}
+
+// Size of the workspace of one thread
+static int thread_workspace_size(
+    int n,
+    int m,
+    int time_steps_per_sample
+){
+    return noise_size(n,time_steps_per_sample) + n*(7+2*n) + n + n + m + m;
+}
+
+// Offset between the partial results of two chunks
+static int chunk_stride(
+    int n,
+    int m
+){
+    return n*m + m*m + n + m + 2;
+}
+
+// Seed of chunk "chunk" for the given purpose in the current sample
+static unsigned long chunk_seed(
+    particle_filter *ppf,
+    int purpose,
+    int chunk
+){
+    unsigned long stream = (ppf->sample_count*3+purpose)*ppf->num_chunks+chunk;
+    return mersenne_stream_seed(ppf->seed,stream);
+}
+
+// First particle and number of particles in chunk "chunk"
+static void chunk_range(
+    particle_filter *ppf,
+    int chunk,
+    int *pstart,
+    int *ppoints
+){
+    int start = chunk*PF_CHUNK_SIZE;
+    int points = ppf->num_particles-start;
+    *pstart = start;
+    *ppoints = points < PF_CHUNK_SIZE ? points : PF_CHUNK_SIZE;
+}
+
+// Draws an even number of normal random variables such that none are reused by the Box-Muller transformation
+static void draw_normal(
+    double *parr,
+    unsigned long *pgenerator,
+    int N,
+    unsigned long seed,
+    double sigma
+){
+    d_rand_normal_seeded(parr,pgenerator,N+(N&1),seed,0,sigma);
+}
+
+// Solves L*z = e in place, where L is lower triangular and column major
+static void forward_substitution(
+    double *pL,
+    double *pe,
+    int m
+){
+    int a, b;
+    for (a=0;a<m;a++){
+        for (b=0;b<a;b++){
+            pe[a] -= pL[a+m*b]*pe[b];
+        }
+        pe[a] /= pL[a+m*a];
+    }
+}
+
+particle_filter *pf_create(
+    int num_particles,
+    int m,
+    int time_steps_per_sample,
+    double sample_time,
+    double *pH,
+    double *pR,
+    double *px0,
+    double *pP0,
+    CSTR_parameters *pparams,
+    unsigned long seed
+){
+    if (num_particles < 2 || m < 1 || time_steps_per_sample < 2){
+        return NULL;
+    }
+    particle_filter *ppf = (particle_filter*) calloc(1,sizeof(particle_filter));
+    if (ppf == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int a, b;
+    size_t size_states = (size_t) n*num_particles;
+    ppf->num_particles = num_particles;
+    ppf->num_chunks = (num_particles+PF_CHUNK_SIZE-1)/PF_CHUNK_SIZE;
+    ppf->n = n;
+    ppf->m = m;
+    ppf->time_steps_per_sample = time_steps_per_sample;
+    ppf->num_threads = omp_get_max_threads();
+    ppf->max_iterations = 20;
+    ppf->tolerance = 10e-6;
+    ppf->resample_threshold = 0.5;
+    ppf->effective_sample_size = num_particles;
+    ppf->seed = seed;
+    ppf->params = *pparams;
+    ppf->pt = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    ppf->pstates = (double*) malloc(size_states*sizeof(double));
+    ppf->pstates_next = (double*) malloc(size_states*sizeof(double));
+    ppf->pweights = (double*) malloc(num_particles*sizeof(double));
+    ppf->pcumulative = (double*) malloc(num_particles*sizeof(double));
+    ppf->pchunk_sums = (double*) malloc(ppf->num_chunks*chunk_stride(n,m)*sizeof(double));
+    ppf->pH = (double*) malloc(m*n*sizeof(double));
+    ppf->pR = (double*) malloc(m*m*sizeof(double));
+    ppf->pR_cholesky = (double*) malloc(m*m*sizeof(double));
+    ppf->pgain = (double*) malloc(m*(n+1)*sizeof(double));
+    ppf->psystem = (double*) malloc(m*m*sizeof(double));
+    ppf->ppivots = (int*) malloc(m*sizeof(int));
+    ppf->pworkspace_lf = (double*) malloc((size_t) ppf->num_threads*thread_workspace_size(n,m,time_steps_per_sample)*sizeof(double));
+    ppf->pworkspace_d = (int*) malloc(ppf->num_threads*n*sizeof(int));
+    ppf->pgenerators = (unsigned long*) malloc(ppf->num_threads*624*sizeof(unsigned long));
+    if (ppf->pt == NULL || ppf->pstates == NULL || ppf->pstates_next == NULL || ppf->pweights == NULL
+        || ppf->pcumulative == NULL || ppf->pchunk_sums == NULL || ppf->pH == NULL || ppf->pR == NULL
+        || ppf->pR_cholesky == NULL || ppf->pgain == NULL || ppf->psystem == NULL || ppf->ppivots == NULL
+        || ppf->pworkspace_lf == NULL || ppf->pworkspace_d == NULL || ppf->pgenerators == NULL){
+        pf_destroy(ppf);
+        return NULL;
+    }
+    linspace(ppf->pt,0,sample_time,time_steps_per_sample);
+    memcpy(ppf->pH,pH,m*n*sizeof(double));
+    memcpy(ppf->pR,pR,m*m*sizeof(double));
+
+    // Cholesky factorization of R used for the likelihood and the perturbed measurements
+    char UPLO = 'L';
+    int N_lapack = m;
+    int INFO;
+    memcpy(ppf->pR_cholesky,pR,m*m*sizeof(double));
+    dpotrf_(&UPLO,&N_lapack,ppf->pR_cholesky,&N_lapack,&INFO);
+    if (INFO != 0){
+        pf_destroy(ppf);
+        return NULL;
+    }
+    ppf->log_determinant_R = 0;
+    for (a=0;a<m;a++){
+        for (b=a+1;b<m;b++){
+            ppf->pR_cholesky[a+m*b] = 0;
+        }
+        ppf->log_determinant_R += 2*log(ppf->pR_cholesky[a*(m+1)]);
+    }
+
+    // Drawing the initial particles. The particles are touched first by
+    // the threads which process them in pf_propagate().
+    int size_thread = thread_workspace_size(n,m,time_steps_per_sample);
+    int chunk;
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<ppf->num_chunks;chunk++){
+        int thread_index = omp_get_thread_num();
+        double *pnoise = &ppf->pworkspace_lf[(size_t) size_thread*thread_index];
+        int start, points, i, j;
+        chunk_range(ppf,chunk,&start,&points);
+        draw_normal(pnoise,&ppf->pgenerators[624*thread_index],n*points,chunk_seed(ppf,PF_STREAM_RESAMPLING,chunk),1);
+        for (j=0;j<n;j++){
+            for (i=0;i<points;i++){
+                ppf->pstates[(size_t) j*num_particles+start+i] = px0[j]+sqrt(pP0[j])*pnoise[j*points+i];
+                ppf->pstates_next[(size_t) j*num_particles+start+i] = 0;
+            }
+        }
+        for (i=0;i<points;i++){
+            ppf->pweights[start+i] = 1.0/num_particles;
+            ppf->pcumulative[start+i] = 0;
+        }
+    }
+    return ppf;
+}
+
+void pf_propagate(
+    particle_filter *ppf,
+    double *pu
+){
+    int n = ppf->n;
+    int NP = ppf->num_particles;
+    int steps = ppf->time_steps_per_sample;
+    int size_thread = thread_workspace_size(n,ppf->m,steps);
+    double sqrtdt = sqrt(ppf->pt[1]-ppf->pt[0]);
+    int chunk;
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<ppf->num_chunks;chunk++){
+        int thread_index = omp_get_thread_num();
+        double *pnoise = &ppf->pworkspace_lf[(size_t) size_thread*thread_index];
+        double *pworkspace_solver = &pnoise[noise_size(n,steps)];
+        double *px0 = &pworkspace_solver[n*(7+2*n)];
+        double *px = &px0[n];
+        int *pworkspace_d = &ppf->pworkspace_d[n*thread_index];
+        int start, points, i, j;
+        chunk_range(ppf,chunk,&start,&points);
+        draw_normal(pnoise,&ppf->pgenerators[624*thread_index],n*steps*points,chunk_seed(ppf,PF_STREAM_NOISE,chunk),sqrtdt);
+        for (i=start;i<start+points;i++){
+            for (j=0;j<n;j++){
+                px0[j] = ppf->pstates[(size_t) j*NP+i];
+            }
+            vector_implicit_euler_final_step(
+                steps,
+                n,
+                1,
+                ppf->pt,
+                px,
+                &pnoise[(i-start)*n*steps],
+                pworkspace_solver,
+                pworkspace_d,
+                ppf->max_iterations,
+                ppf->tolerance,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                pu,
+                NULL,
+                &ppf->params,
+                px0
+            );
+            for (j=0;j<n;j++){
+                ppf->pstates[(size_t) j*NP+i] = px[j];
+            }
+        }
+    }
+    ppf->sample_count++;
+}
+
+void pf_update(
+    particle_filter *ppf,
+    double *py
+){
+    int n = ppf->n;
+    int m = ppf->m;
+    int NP = ppf->num_particles;
+    int num_chunks = ppf->num_chunks;
+    int stride = chunk_stride(n,m);
+    int size_thread = thread_workspace_size(n,m,ppf->time_steps_per_sample);
+    double *psums = ppf->pchunk_sums;
+    int chunk;
+
+    // Log weights and the largest log weight of every chunk
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        int thread_index = omp_get_thread_num();
+        double *pe = &ppf->pworkspace_lf[(size_t) size_thread*thread_index+noise_size(n,ppf->time_steps_per_sample)+n*(9+2*n)];
+        int start, points, i, a, k;
+        double quadratic, log_weight;
+        double largest = -HUGE_VAL;
+        chunk_range(ppf,chunk,&start,&points);
+        for (i=start;i<start+points;i++){
+            for (a=0;a<m;a++){
+                pe[a] = py[a];
+                for (k=0;k<n;k++){
+                    pe[a] -= ppf->pH[a+m*k]*ppf->pstates[(size_t) k*NP+i];
+                }
+            }
+            forward_substitution(ppf->pR_cholesky,pe,m);
+            quadratic = 0;
+            for (a=0;a<m;a++){
+                quadratic += pe[a]*pe[a];
+            }
+            log_weight = log(ppf->pweights[i])-0.5*quadratic;
+            if (!isfinite(log_weight)){
+                log_weight = -HUGE_VAL;
+            }
+            ppf->pweights[i] = log_weight;
+            if (log_weight > largest){
+                largest = log_weight;
+            }
+        }
+        psums[chunk*stride] = largest;
+    }
+    double largest = -HUGE_VAL;
+    for (chunk=0;chunk<num_chunks;chunk++){
+        if (psums[chunk*stride] > largest){
+            largest = psums[chunk*stride];
+        }
+    }
+
+    // No particle explains the measurement. The particles are kept with uniform weights.
+    if (largest == -HUGE_VAL){
+        int i;
+        #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+        for (i=0;i<NP;i++){
+            ppf->pweights[i] = 1.0/NP;
+        }
+        ppf->effective_sample_size = NP;
+        ppf->log_likelihood = -HUGE_VAL;
+        return;
+    }
+
+    // Unnormalized weights and their sum and sum of squares in every chunk
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        int start, points, i;
+        double sum = 0;
+        double sum_squares = 0;
+        chunk_range(ppf,chunk,&start,&points);
+        for (i=start;i<start+points;i++){
+            ppf->pweights[i] = exp(ppf->pweights[i]-largest);
+            sum += ppf->pweights[i];
+            sum_squares += ppf->pweights[i]*ppf->pweights[i];
+        }
+        psums[chunk*stride] = sum;
+        psums[chunk*stride+1] = sum_squares;
+    }
+
+    // Exclusive scan over the chunks. It is kept in the second slot of every chunk.
+    double total = 0;
+    double total_squares = 0;
+    for (chunk=0;chunk<num_chunks;chunk++){
+        total_squares += psums[chunk*stride+1];
+        psums[chunk*stride+1] = total;
+        total += psums[chunk*stride];
+    }
+
+    // The previous weights are normalized, so the sum is the likelihood of the measurement
+    ppf->log_likelihood += log(total)+largest-0.5*(m*log(2*PF_PI)+ppf->log_determinant_R);
+    ppf->effective_sample_size = total*total/total_squares;
+    if (ppf->effective_sample_size >= ppf->resample_threshold*NP){
+        int i;
+        #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+        for (i=0;i<NP;i++){
+            ppf->pweights[i] /= total;
+        }
+        return;
+    }
+
+    // Cumulative sum of the weights, every chunk starts from its offset
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        int start, points, i;
+        double sum = psums[chunk*stride+1];
+        chunk_range(ppf,chunk,&start,&points);
+        for (i=start;i<start+points;i++){
+            sum += ppf->pweights[i];
+            ppf->pcumulative[i] = sum;
+        }
+    }
+
+    // Systematic resampling. Offspring k of the points (u+k)/NP*total falls in particle i if
+    // C[i-1] <= (u+k)/NP*total < C[i]. Since neighbouring particles share the boundary C[i-1],
+    // the ranges of the particles tile 0,...,NP-1 and every particle writes its own offspring.
+    double u;
+    mersenne_twister_seeded(&u,ppf->pgenerators,1,chunk_seed(ppf,PF_STREAM_RESAMPLING,0));
+    double scale = NP/total;
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        int start, points, i, j, k, first, last;
+        chunk_range(ppf,chunk,&start,&points);
+        for (i=start;i<start+points;i++){
+            first = (i == 0) ? 0 : (int) ceil(ppf->pcumulative[i-1]*scale-u);
+            last = (i == NP-1) ? NP : (int) ceil(ppf->pcumulative[i]*scale-u);
+            first = first < 0 ? 0 : first;
+            last = last > NP ? NP : last;
+            for (j=0;j<n;j++){
+                double value = ppf->pstates[(size_t) j*NP+i];
+                for (k=first;k<last;k++){
+                    ppf->pstates_next[(size_t) j*NP+k] = value;
+                }
+            }
+        }
+        for (i=start;i<start+points;i++){
+            ppf->pweights[i] = 1.0/NP;
+        }
+    }
+    double *pswap = ppf->pstates;
+    ppf->pstates = ppf->pstates_next;
+    ppf->pstates_next = pswap;
+    ppf->num_resamples++;
+}
+
+void enkf_update(
+    particle_filter *ppf,
+    double *py
+){
+    int n = ppf->n;
+    int m = ppf->m;
+    int NP = ppf->num_particles;
+    int num_chunks = ppf->num_chunks;
+    int stride = chunk_stride(n,m);
+    int size_thread = thread_workspace_size(n,m,ppf->time_steps_per_sample);
+    double *psums = ppf->pchunk_sums;
+    double *pH = ppf->pH;
+    int chunk, a, b, r;
+
+    // Sums of the states and the predicted measurements in every chunk
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        double *pchunk = &psums[chunk*stride];
+        int start, points, i, j, a, k;
+        chunk_range(ppf,chunk,&start,&points);
+        for (j=0;j<n+m;j++){
+            pchunk[j] = 0;
+        }
+        for (i=start;i<start+points;i++){
+            for (k=0;k<n;k++){
+                double value = ppf->pstates[(size_t) k*NP+i];
+                pchunk[k] += value;
+                for (a=0;a<m;a++){
+                    pchunk[n+a] += pH[a+m*k]*value;
+                }
+            }
+        }
+    }
+    double *pmean = &ppf->pworkspace_lf[noise_size(n,ppf->time_steps_per_sample)+n*(7+2*n)];
+    for (r=0;r<n+m;r++){
+        pmean[r] = 0;
+    }
+    for (chunk=0;chunk<num_chunks;chunk++){
+        for (r=0;r<n+m;r++){
+            pmean[r] += psums[chunk*stride+r];
+        }
+    }
+    for (r=0;r<n+m;r++){
+        pmean[r] /= NP;
+    }
+
+    // Cross covariance of states and measurements and covariance of the measurements in every chunk
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        int thread_index = omp_get_thread_num();
+        double *pchunk = &psums[chunk*stride];
+        double *pdx = &ppf->pworkspace_lf[(size_t) size_thread*thread_index+noise_size(n,ppf->time_steps_per_sample)];
+        double *pdy = &pdx[n];
+        int start, points, i, j, a, b, k;
+        chunk_range(ppf,chunk,&start,&points);
+        for (j=0;j<n*m+m*m;j++){
+            pchunk[j] = 0;
+        }
+        for (i=start;i<start+points;i++){
+            for (k=0;k<n;k++){
+                pdx[k] = ppf->pstates[(size_t) k*NP+i]-pmean[k];
+            }
+            for (a=0;a<m;a++){
+                pdy[a] = -pmean[n+a];
+                for (k=0;k<n;k++){
+                    pdy[a] += pH[a+m*k]*ppf->pstates[(size_t) k*NP+i];
+                }
+            }
+            for (a=0;a<m;a++){
+                for (k=0;k<n;k++){
+                    pchunk[a+m*k] += pdy[a]*pdx[k];
+                }
+                for (b=0;b<m;b++){
+                    pchunk[n*m+a+m*b] += pdy[a]*pdy[b];
+                }
+            }
+        }
+    }
+
+    // Solving (Pyy + R)*[K', z] = [Pxy', y - mean(Hx)]
+    double *pKt = ppf->pgain;
+    double *pS = ppf->psystem;
+    double *pz = &pKt[m*n];
+    for (r=0;r<n*m;r++){
+        pKt[r] = 0;
+    }
+    for (r=0;r<m*m;r++){
+        pS[r] = 0;
+    }
+    for (chunk=0;chunk<num_chunks;chunk++){
+        for (r=0;r<n*m;r++){
+            pKt[r] += psums[chunk*stride+r];
+        }
+        for (r=0;r<m*m;r++){
+            pS[r] += psums[chunk*stride+n*m+r];
+        }
+    }
+    for (r=0;r<n*m;r++){
+        pKt[r] /= NP-1;
+    }
+    for (a=0;a<m;a++){
+        for (b=0;b<m;b++){
+            pS[a+m*b] = pS[a+m*b]/(NP-1)+ppf->pR[a+m*b];
+        }
+        pz[a] = py[a]-pmean[n+a];
+    }
+    double *pinnovation = &pmean[n+m];
+    for (a=0;a<m;a++){
+        pinnovation[a] = pz[a];
+    }
+    int N_lapack = m;
+    int NRHS = n+1;
+    int INFO;
+    dgesv_(&N_lapack,&NRHS,pS,&N_lapack,ppf->ppivots,pKt,&N_lapack,&INFO);
+    if (INFO != 0){
+        return;
+    }
+    double log_determinant = 0;
+    double quadratic = 0;
+    for (a=0;a<m;a++){
+        log_determinant += log(fabs(pS[a*(m+1)]));
+        quadratic += pinnovation[a]*pz[a];
+    }
+    ppf->log_likelihood -= 0.5*(log_determinant+quadratic+m*log(2*PF_PI));
+
+    // Moving every particle towards its own perturbed measurement
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<num_chunks;chunk++){
+        int thread_index = omp_get_thread_num();
+        double *pnoise = &ppf->pworkspace_lf[(size_t) size_thread*thread_index];
+        double *pe = &pnoise[noise_size(n,ppf->time_steps_per_sample)+n*(9+2*n)];
+        int start, points, i, a, b, k;
+        double sum;
+        chunk_range(ppf,chunk,&start,&points);
+        draw_normal(pnoise,&ppf->pgenerators[624*thread_index],m*points,chunk_seed(ppf,PF_STREAM_MEASUREMENT,chunk),1);
+        for (i=start;i<start+points;i++){
+            for (a=0;a<m;a++){
+                sum = py[a];
+                for (b=0;b<=a;b++){
+                    sum += ppf->pR_cholesky[a+m*b]*pnoise[(i-start)*m+b];
+                }
+                for (k=0;k<n;k++){
+                    sum -= pH[a+m*k]*ppf->pstates[(size_t) k*NP+i];
+                }
+                pe[a] = sum;
+            }
+            for (k=0;k<n;k++){
+                sum = 0;
+                for (a=0;a<m;a++){
+                    sum += pKt[a+m*k]*pe[a];
+                }
+                ppf->pstates[(size_t) k*NP+i] += sum;
+            }
+
+            // The concentrations are kept between zero and the inlet concentrations,
+            // since the implicit Euler step has non-physical roots outside this region
+            ppf->pstates[i] = fmin(fmax(ppf->pstates[i],0),ppf->params.CAin);
+            ppf->pstates[(size_t) NP+i] = fmin(fmax(ppf->pstates[(size_t) NP+i],0),ppf->params.CBin);
+            ppf->pweights[i] = 1.0/NP;
+        }
+    }
+    ppf->effective_sample_size = NP;
+}
+
+void pf_mean(
+    particle_filter *ppf,
+    double *pmean
+){
+    int n = ppf->n;
+    int NP = ppf->num_particles;
+    int stride = chunk_stride(n,ppf->m);
+    double *psums = ppf->pchunk_sums;
+    int chunk, j;
+    #pragma omp parallel for num_threads(ppf->num_threads) schedule(static)
+    for (chunk=0;chunk<ppf->num_chunks;chunk++){
+        int start, points, i, k;
+        chunk_range(ppf,chunk,&start,&points);
+        for (k=0;k<n;k++){
+            double sum = 0;
+            for (i=start;i<start+points;i++){
+                sum += ppf->pweights[i]*ppf->pstates[(size_t) k*NP+i];
+            }
+            psums[chunk*stride+k] = sum;
+        }
+    }
+    for (j=0;j<n;j++){
+        pmean[j] = 0;
+    }
+    for (chunk=0;chunk<ppf->num_chunks;chunk++){
+        for (j=0;j<n;j++){
+            pmean[j] += psums[chunk*stride+j];
+        }
+    }
+}
+
+void pf_destroy(
+    particle_filter *ppf
+){
+    if (ppf == NULL){
+        return;
+    }
+    free(ppf->pgenerators);
+    free(ppf->pworkspace_d);
+    free(ppf->pworkspace_lf);
+    free(ppf->ppivots);
+    free(ppf->psystem);
+    free(ppf->pgain);
+    free(ppf->pR_cholesky);
+    free(ppf->pR);
+    free(ppf->pH);
+    free(ppf->pchunk_sums);
+    free(ppf->pcumulative);
+    free(ppf->pweights);
+    free(ppf->pstates_next);
+    free(ppf->pstates);
+    free(ppf->pt);
+    free(ppf);
+}
@@ -0,0 +1,162 @@
+/// @file ParticleFilter.h
+
+#ifndef CSTR_PARTICLE_FILTER
+#define CSTR_PARTICLE_FILTER
+
+#include "CSTR.h"
+
+/**
+ * Particle ensemble for the CSTR which is used both as a bootstrap particle filter and as an ensemble Kalman filter.
+ * Every sample, each particle is advanced one sample interval with vector_implicit_euler_final_step() and new noise.
+ * Afterwards the measurement \f$y=Hx+v\f$, \f$v\sim N(0,R)\f$, is incorporated with either pf_update() or enkf_update().
+ *
+ * The particles are stored as structure of arrays, state \f$j\f$ of particle \f$i\f$ is pstates[j*num_particles+i], and
+ * all buffers are allocated once and reused. The particles are processed in chunks of PF_CHUNK_SIZE particles. The noise
+ * of a chunk is seeded from the seed, the sample and the index of the chunk, and all reductions are combined chunk by
+ * chunk in a fixed order, so the result does not depend on the number of threads.
+ *
+ * @date 19th of October 2026
+ */
+
+#define PF_CHUNK_SIZE 256
+
+typedef struct particle_filter{
+    int num_particles;          // Number of particles
+    int num_chunks;             // Number of chunks of PF_CHUNK_SIZE particles
+    int n;                      // Number of states
+    int m;                      // Number of measurements
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int num_threads;            // Number of workspaces
+    int max_iterations;         // Newton iterations per step
+    int num_resamples;          // Number of times the particles have been resampled
+    double tolerance;           // Newton tolerance
+    double resample_threshold;  // Resample when the effective sample size is below this fraction of the particles
+    double effective_sample_size; // Effective sample size after the last update
+    double log_likelihood;      // Accumulated log likelihood of the measurements
+    unsigned long seed;         // Base seed
+    unsigned long sample_count; // Number of samples propagated so far
+    CSTR_parameters params;     // Model parameters
+    double *pt;                 // Time grid of one sample, (steps+1)
+    double *pstates;            // Particles, structure of arrays, n*num_particles
+    double *pstates_next;       // Second buffer used when resampling, n*num_particles
+    double *pweights;           // Normalized weights, num_particles
+    double *pcumulative;        // Cumulative sum of the weights, num_particles
+    double *pchunk_sums;        // Partial results per chunk
+    double *pH;                 // Measurement matrix, column major, m*n
+    double *pR;                 // Measurement noise covariance, m*m
+    double *pR_cholesky;        // Lower Cholesky factor of R, m*m
+    double *pgain;              // Transposed Kalman gain of the ensemble Kalman filter, m*n
+    double *psystem;            // Innovation covariance passed to DGESV, m*m
+    int *ppivots;               // Pivots for DGESV, m
+    double log_determinant_R;   // Logarithm of the determinant of R
+    double *pworkspace_lf;      // Per thread: noise of a chunk and solver workspace
+    int *pworkspace_d;          // Per thread: pivots
+    unsigned long *pgenerators; // Per thread: Mersenne Twister generator
+} particle_filter;
+
+/**
+ * Allocates the particles and draws them from a normal distribution with mean px0 and the diagonal covariance pP0.
+ *
+ * @param[in] num_particles: Number of particles.
+ * @param[in] m: Number of measurements.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps between two samples. Must be at least 2.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] pH: Measurement matrix, column major. Must be of size \f$m\cdot n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pR: Measurement noise covariance. Must be symmetric positive definite and of size \f$m\cdot m\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] px0: Initial mean. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pP0: Initial variances. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pparams: Pointer to the model parameters. The struct is copied.
+ * @param[in] seed: Base seed of all random numbers.
+ *
+ * @return Pointer to the filter or NULL if the memory could not be allocated or R is not positive definite.
+ *
+ * @date 19th of October 2026
+ */
+
+particle_filter *pf_create(
+    int num_particles,
+    int m,
+    int time_steps_per_sample,
+    double sample_time,
+    double *pH,
+    double *pR,
+    double *px0,
+    double *pP0,
+    CSTR_parameters *pparams,
+    unsigned long seed
+);
+
+/**
+ * Advances all particles one sample interval with new noise. The noise of a chunk is drawn in one go and the
+ * states of a particle are gathered from the structure of arrays, advanced and scattered back.
+ *
+ * @param[in,out] ppf: Pointer to the filter.
+ * @param[in] pu: Pointer to the flow rate in [L / s].
+ *
+ * @date 19th of October 2026
+ */
+
+void pf_propagate(
+    particle_filter *ppf,
+    double *pu
+);
+
+/**
+ * Bootstrap particle filter update. The particles are weighted with the likelihood of the measurement and, if
+ * the effective sample size falls below resample_threshold times the number of particles, resampled with
+ * systematic resampling. The cumulative sum of the weights is computed with a parallel prefix sum over the chunks
+ * and every particle writes its own copies, so the resampling is parallel as well.
+ *
+ * @param[in,out] ppf: Pointer to the filter.
+ * @param[in] py: The measurement. Must be of size \f$m\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+void pf_update(
+    particle_filter *ppf,
+    double *py
+);
+
+/**
+ * Ensemble Kalman filter update with perturbed measurements. The gain is computed from the ensemble covariances
+ * and every particle is moved towards its own perturbed measurement. The weights are left uniform.
+ *
+ * @param[in,out] ppf: Pointer to the filter.
+ * @param[in] py: The measurement. Must be of size \f$m\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+void enkf_update(
+    particle_filter *ppf,
+    double *py
+);
+
+/**
+ * Computes the weighted mean of the particles.
+ *
+ * @param[in] ppf: Pointer to the filter.
+ * @param[out] pmean: The mean. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @date 19th of October 2026
+ */
+
+void pf_mean(
+    particle_filter *ppf,
+    double *pmean
+);
+
+/**
+ * Frees all memory held by the filter.
+ *
+ * @param[in] ppf: Pointer to the filter. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void pf_destroy(
+    particle_filter *ppf
+);
+
+#endif
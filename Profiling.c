@@ -0,0 +1,236 @@
+/// @file Profiling.c
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "Profiling.h"
+
+#if defined(__linux__)
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+
+static const unsigned long long profile_configs[PROFILE_NUM_EVENTS] = {
+    PERF_COUNT_HW_CPU_CYCLES,
+    PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_REFERENCES,
+    PERF_COUNT_HW_CACHE_MISSES
+};
+
+// Opens a counter of the calling thread on any CPU, excluding the kernel
+static int open_counter(
+    unsigned long long config
+){
+    struct perf_event_attr attr;
+    memset(&attr,0,sizeof(attr));
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.size = sizeof(attr);
+    attr.config = config;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int) syscall(__NR_perf_event_open,&attr,0,-1,-1,0);
+}
+
+// Count scaled by the fraction of the time the counter was scheduled, in case the counters are multiplexed
+static double read_counter(
+    int fd
+){
+    unsigned long long values[3];
+    if (read(fd,values,sizeof(values)) != (ssize_t) sizeof(values) || values[2] == 0){
+        return 0;
+    }
+    return (double) values[0]*((double) values[1]/(double) values[2]);
+}
+#endif
+
+int profile_open(
+    profile_counters *pc
+){
+    int e;
+    pc->available = 0;
+    for (e=0;e<PROFILE_NUM_EVENTS;e++){
+        pc->pfd[e] = -1;
+    }
+    #if defined(__linux__)
+    pc->available = 1;
+    for (e=0;e<PROFILE_NUM_EVENTS;e++){
+        pc->pfd[e] = open_counter(profile_configs[e]);
+        if (pc->pfd[e] < 0){
+            pc->available = 0;
+        }
+    }
+    if (!pc->available){
+        profile_close(pc);
+    }
+    #endif
+    return pc->available;
+}
+
+void profile_begin(
+    profile_counters *pc
+){
+    int e;
+    for (e=0;e<PROFILE_NUM_EVENTS;e++){
+        pc->pstart[e] = 0;
+    }
+    #if defined(__linux__)
+    if (pc->available){
+        for (e=0;e<PROFILE_NUM_EVENTS;e++){
+            pc->pstart[e] = read_counter(pc->pfd[e]);
+        }
+    }
+    #endif
+    pc->start_time = omp_get_wtime();
+}
+
+void profile_end(
+    profile_counters *pc,
+    instrumentation_phase phase
+){
+    pc->pseconds[phase] += omp_get_wtime()-pc->start_time;
+    #if defined(__linux__)
+    int e;
+    if (pc->available){
+        for (e=0;e<PROFILE_NUM_EVENTS;e++){
+            pc->pvalues[phase][e] += read_counter(pc->pfd[e])-pc->pstart[e];
+        }
+    }
+    #endif
+}
+
+void profile_close(
+    profile_counters *pc
+){
+    #if defined(__linux__)
+    int e;
+    for (e=0;e<PROFILE_NUM_EVENTS;e++){
+        if (pc->pfd[e] >= 0){
+            close(pc->pfd[e]);
+        }
+        pc->pfd[e] = -1;
+    }
+    #endif
+}
+
+void profile_add(
+    profile_counters *ptotal,
+    profile_counters *pc
+){
+    int p, e;
+    ptotal->available |= pc->available;
+    for (p=0;p<INSTRUMENTATION_NUM_PHASES;p++){
+        for (e=0;e<PROFILE_NUM_EVENTS;e++){
+            ptotal->pvalues[p][e] += pc->pvalues[p][e];
+        }
+        // The threads run the phase concurrently, so its wall time is that of the slowest thread
+        ptotal->pseconds[p] = fmax(ptotal->pseconds[p],pc->pseconds[p]);
+        ptotal->pflops[p] += pc->pflops[p];
+    }
+}
+
+void profile_roofline(
+    roofline *proof,
+    int num_threads
+){
+    // Multiply-add chains which are independent, such that they can be pipelined and vectorized
+    int chains = 64;
+    long iterations = 1L<<22;
+    double flops_timer = omp_get_wtime();
+    double sink = 0;
+    #pragma omp parallel num_threads(num_threads) reduction(+:sink)
+    {
+        double pa[64];
+        double b = 0.999999;
+        double c = 1e-7;
+        long i;
+        int j;
+        for (j=0;j<chains;j++){
+            pa[j] = j;
+        }
+        for (i=0;i<iterations;i++){
+            for (j=0;j<chains;j++){
+                pa[j] = pa[j]*b+c;
+            }
+        }
+        for (j=0;j<chains;j++){
+            sink += pa[j];
+        }
+    }
+    flops_timer = omp_get_wtime()-flops_timer;
+    proof->peak_flops = 2.0*chains*iterations*num_threads/flops_timer;
+
+    // STREAM triad on arrays much larger than the last level cache
+    long length = 1L<<23;
+    double *pa = (double*) malloc(length*sizeof(double));
+    double *pb = (double*) malloc(length*sizeof(double));
+    double *pc = (double*) malloc(length*sizeof(double));
+    proof->peak_bandwidth = 0;
+    if (pa != NULL && pb != NULL && pc != NULL){
+        long i;
+        int repetition;
+        #pragma omp parallel for num_threads(num_threads) schedule(static)
+        for (i=0;i<length;i++){
+            pa[i] = 0;
+            pb[i] = 1;
+            pc[i] = 2;
+        }
+        for (repetition=0;repetition<3;repetition++){
+            double timer = omp_get_wtime();
+            #pragma omp parallel for num_threads(num_threads) schedule(static)
+            for (i=0;i<length;i++){
+                pa[i] = pb[i]+3*pc[i];
+            }
+            timer = omp_get_wtime()-timer;
+            proof->peak_bandwidth = fmax(proof->peak_bandwidth,3.0*length*sizeof(double)/timer);
+        }
+        sink += pa[length/2];
+    }
+    free(pc);
+    free(pb);
+    free(pa);
+    proof->num_threads = num_threads;
+    if (sink == 1.2345){
+        proof->num_threads = 0;
+    }
+}
+
+void profile_report(
+    FILE *pfile,
+    profile_counters *ptotal,
+    roofline *proof
+){
+    const char *pnames[INSTRUMENTATION_NUM_PHASES] = {"noise", "simulation", "io"};
+    int p;
+    fprintf(pfile,"Roofline of the host with %d threads: peak %.3e FLOP/s, bandwidth %.3e B/s, ridge point %.3f FLOP/B\n",
+        proof->num_threads,proof->peak_flops,proof->peak_bandwidth,proof->peak_flops/proof->peak_bandwidth);
+    if (!ptotal->available){
+        fprintf(pfile,"Hardware counters are unavailable, check /proc/sys/kernel/perf_event_paranoid. Only times are reported.\n");
+    }
+    fprintf(pfile,"%-12s %12s %8s %12s %12s %12s %12s %12s %12s\n","phase","time [s]","IPC","miss rate",
+        "B/s","FLOP/s","FLOP/B","attainable","of roofline");
+    for (p=0;p<INSTRUMENTATION_NUM_PHASES;p++){
+        double seconds = ptotal->pseconds[p];
+        double flops = ptotal->pflops[p];
+        double flop_rate = seconds > 0 ? flops/seconds : 0;
+        if (ptotal->available){
+            double *pv = ptotal->pvalues[p];
+            double ipc = pv[PROFILE_CYCLES] > 0 ? pv[PROFILE_INSTRUCTIONS]/pv[PROFILE_CYCLES] : 0;
+            double miss_rate = pv[PROFILE_CACHE_REFERENCES] > 0 ? pv[PROFILE_CACHE_MISSES]/pv[PROFILE_CACHE_REFERENCES] : 0;
+            double bytes = 64*pv[PROFILE_CACHE_MISSES];
+            double bandwidth = seconds > 0 ? bytes/seconds : 0;
+            double intensity = bytes > 0 ? flops/bytes : HUGE_VAL;
+            double attainable = fmin(proof->peak_flops,intensity*proof->peak_bandwidth);
+            fprintf(pfile,"%-12s %12.4f %8.3f %12.4f %12.3e %12.3e %12.3e %12.3e %11.2f%%\n",pnames[p],seconds,ipc,
+                miss_rate,bandwidth,flop_rate,intensity,attainable,attainable > 0 ? 100*flop_rate/attainable : 0);
+        }
+        else {
+            fprintf(pfile,"%-12s %12.4f %8s %12s %12s %12.3e %12s %12s %12s\n",pnames[p],seconds,"-","-","-",flop_rate,
+                "-","-","-");
+        }
+    }
+}
@@ -0,0 +1,150 @@
+/// @file Profiling.h
+
+#ifndef CSTR_PROFILING
+#define CSTR_PROFILING
+
+#include <stdio.h>
+#include "Instrumentation.h"
+
+/**
+ * Hardware counters of the phases of a simulation, read with the Linux perf_event_open system call. Every thread
+ * opens counters of cycles, instructions, last level cache references and last level cache misses for itself with
+ * profile_open(), and profile_begin() and profile_end() add the counts and the wall time between them to a phase.
+ * The phases are those of Instrumentation.h. If the counters cannot be opened, for instance because of
+ * /proc/sys/kernel/perf_event_paranoid, on another operating system or in a container, only the wall time is
+ * recorded and available is 0.
+ *
+ * The memory traffic of a phase is estimated as 64 bytes per cache miss. Together with the floating point
+ * operations of the phase, which the caller estimates since there is no portable counter for them, this gives the
+ * arithmetic intensity, which profile_report() compares to a roofline of the host measured by profile_roofline().
+ *
+ * @date 19th of October 2026
+ */
+
+#define PROFILE_NUM_EVENTS 4
+
+typedef enum profile_event{
+    PROFILE_CYCLES,
+    PROFILE_INSTRUCTIONS,
+    PROFILE_CACHE_REFERENCES,
+    PROFILE_CACHE_MISSES
+} profile_event;
+
+typedef struct profile_counters{
+    int available;                                                  // 1 if the hardware counters are open
+    int pfd[PROFILE_NUM_EVENTS];                                    // File descriptors of the counters
+    double pstart[PROFILE_NUM_EVENTS];                              // Counts at profile_begin()
+    double start_time;                                              // Time at profile_begin()
+    double pvalues[INSTRUMENTATION_NUM_PHASES][PROFILE_NUM_EVENTS]; // Counts of every phase
+    double pseconds[INSTRUMENTATION_NUM_PHASES];                    // Wall time of every phase
+    double pflops[INSTRUMENTATION_NUM_PHASES];                      // Floating point operations of every phase, set by the caller
+} profile_counters;
+
+typedef struct roofline{
+    double peak_flops;          // Floating point operations per second of all threads
+    double peak_bandwidth;      // Bytes per second from memory of all threads
+    int num_threads;            // Threads used for the measurement
+} roofline;
+
+/**
+ * Opens the counters of the calling thread. The counts of the phases are kept, so the counters may be opened and
+ * closed several times, e.g. once per parallel region.
+ *
+ * @param[in,out] pc: Pointer to the counters. Must be zero initialized before the first call.
+ *
+ * @return 1 if the hardware counters could be opened and 0 otherwise.
+ *
+ * @date 19th of October 2026
+ */
+
+int profile_open(
+    profile_counters *pc
+);
+
+/**
+ * Starts a phase on the calling thread.
+ *
+ * @param[in,out] pc: Pointer to the counters.
+ *
+ * @date 19th of October 2026
+ */
+
+void profile_begin(
+    profile_counters *pc
+);
+
+/**
+ * Ends a phase on the calling thread and adds its counts and wall time to the phase.
+ *
+ * @param[in,out] pc: Pointer to the counters.
+ * @param[in] phase: The phase.
+ *
+ * @date 19th of October 2026
+ */
+
+void profile_end(
+    profile_counters *pc,
+    instrumentation_phase phase
+);
+
+/**
+ * Closes the counters of the calling thread.
+ *
+ * @param[in,out] pc: Pointer to the counters.
+ *
+ * @date 19th of October 2026
+ */
+
+void profile_close(
+    profile_counters *pc
+);
+
+/**
+ * Adds the counts and the operations of one thread to a total. The time of the total is the largest time of the
+ * threads, i.e. the wall time of a phase which all threads run concurrently, such that the rates of the total are
+ * those of all threads and compare to a roofline measured with all threads.
+ *
+ * @param[in,out] ptotal: Pointer to the total.
+ * @param[in] pc: Pointer to the counters of a thread.
+ *
+ * @date 19th of October 2026
+ */
+
+void profile_add(
+    profile_counters *ptotal,
+    profile_counters *pc
+);
+
+/**
+ * Measures the peak floating point rate with independent multiply-add chains and the memory bandwidth with a
+ * STREAM triad on num_threads threads.
+ *
+ * @param[out] proof: The roofline.
+ * @param[in] num_threads: Number of threads.
+ *
+ * @date 19th of October 2026
+ */
+
+void profile_roofline(
+    roofline *proof,
+    int num_threads
+);
+
+/**
+ * Writes a table with the time, IPC, cache miss rate, bandwidth, arithmetic intensity and the attainable
+ * performance of the roofline for every phase.
+ *
+ * @param[in] pfile: The output file.
+ * @param[in] ptotal: Pointer to the counters of all threads added with profile_add().
+ * @param[in] proof: Pointer to the roofline.
+ *
+ * @date 19th of October 2026
+ */
+
+void profile_report(
+    FILE *pfile,
+    profile_counters *ptotal,
+    roofline *proof
+);
+
+#endif
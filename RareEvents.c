@@ -0,0 +1,432 @@
+/// @file RareEvents.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "RareEvents.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+#include "CSTR.h"
+
+// Size of the workspace of one thread
+static int thread_workspace_size(
+    int n,
+    int time_steps_per_sample
+){
+    return n*(time_steps_per_sample+1) + n*time_steps_per_sample + 1 + n*(5+2*n);
+}
+
+// Simulates from the state px_start at time step step_start until the temperature reaches the level or
+// the experiment ends. Returns 1 and the state and time step of the crossing if the level was reached.
+// The largest temperature of the simulated part is stored in pmax_T.
+static int run_until_level(
+    splitting_estimator *pe,
+    double *px_start,
+    int step_start,
+    double level,
+    unsigned long seed,
+    double *px_hit,
+    int *pstep_hit,
+    double *pmax_T,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    unsigned long *pgenerator,
+    long *psimulated_steps
+){
+    int n = pe->n;
+    int steps = pe->time_steps_per_sample;
+    int total_steps = steps*pe->num_samples;
+    double *pX = pworkspace_lf;
+    double *pdW = &pX[n*(steps+1)];
+    double *pworkspace_solver = &pdW[n*steps+1];
+    double sqrtdt = sqrt(pe->pt[1]-pe->pt[0]);
+    double x[3];
+    int step = step_start;
+    int sample, offset, count, k, j;
+    for (j=0;j<n;j++){
+        x[j] = px_start[j];
+    }
+    *pmax_T = x[2];
+
+    // A state which overshot the previous level may already be above this one
+    if (x[2] >= level){
+        for (j=0;j<n;j++){
+            px_hit[j] = x[j];
+        }
+        *pstep_hit = step;
+        return 1;
+    }
+    while (step < total_steps){
+        sample = step/steps;
+        offset = step-sample*steps;
+        count = steps-offset;
+
+        // Fresh noise for the rest of the sample, an even number for the Box-Muller transformation
+        d_rand_normal_seeded(pdW,pgenerator,n*count+((n*count)&1),mersenne_stream_seed(seed,sample),0,sqrtdt);
+        vector_implicit_euler(
+            count,
+            n,
+            1,
+            &pe->pt[offset],
+            pX,
+            pdW,
+            pworkspace_solver,
+            pworkspace_d,
+            pe->max_iterations,
+            pe->tolerance,
+            CSTR_3D_drift,
+            CSTR_3D_diffusion,
+            CSTR_3D_drift_jacobian,
+            &pe->pu[sample],
+            NULL,
+            &pe->params,
+            x
+        );
+        for (k=1;k<=count;k++){
+            *pmax_T = fmax(*pmax_T,pX[k*n+2]);
+            if (pX[k*n+2] >= level){
+                for (j=0;j<n;j++){
+                    px_hit[j] = pX[k*n+j];
+                }
+                *pstep_hit = step+k;
+                *psimulated_steps += step+k-step_start;
+                return 1;
+            }
+        }
+        for (j=0;j<n;j++){
+            x[j] = pX[count*n+j];
+        }
+        step += count;
+    }
+    *psimulated_steps += total_steps-step_start;
+    return 0;
+}
+
+splitting_estimator *splitting_create(
+    CSTR_parameters *pP,
+    double *pu,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    double *px0,
+    double *plevels,
+    int num_levels,
+    int num_trajectories,
+    unsigned long seed
+){
+    if (num_samples < 1 || time_steps_per_sample < 1 || num_levels < 1 || num_trajectories < 1){
+        return NULL;
+    }
+    int i;
+    for (i=1;i<num_levels;i++){
+        if (!(plevels[i] > plevels[i-1])){
+            return NULL;
+        }
+    }
+    splitting_estimator *pe = (splitting_estimator*) calloc(1,sizeof(splitting_estimator));
+    if (pe == NULL){
+        return NULL;
+    }
+    int n = 3;
+    pe->n = n;
+    pe->num_levels = num_levels;
+    pe->num_trajectories = num_trajectories;
+    pe->num_samples = num_samples;
+    pe->time_steps_per_sample = time_steps_per_sample;
+    pe->num_threads = omp_get_max_threads();
+    pe->max_iterations = 20;
+    pe->tolerance = 10e-6;
+    pe->seed = seed;
+    pe->params = *pP;
+    pe->plevels = (double*) malloc(num_levels*sizeof(double));
+    pe->pstage_probability = (double*) calloc(num_levels,sizeof(double));
+    pe->pt = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    pe->pu = (double*) malloc(num_samples*sizeof(double));
+    pe->pentrance = (double*) malloc(n*num_trajectories*sizeof(double));
+    pe->pentrance_step = (int*) malloc(num_trajectories*sizeof(int));
+    pe->phit = (double*) malloc(n*num_trajectories*sizeof(double));
+    pe->phit_step = (int*) malloc(num_trajectories*sizeof(int));
+    pe->psuccess = (int*) malloc(num_trajectories*sizeof(int));
+    pe->pworkspace_lf = (double*) malloc(pe->num_threads*thread_workspace_size(n,time_steps_per_sample)*sizeof(double));
+    pe->pworkspace_d = (int*) malloc(pe->num_threads*n*sizeof(int));
+    pe->pgenerators = (unsigned long*) malloc(pe->num_threads*624*sizeof(unsigned long));
+    if (pe->plevels == NULL || pe->pstage_probability == NULL || pe->pt == NULL || pe->pu == NULL
+        || pe->pentrance == NULL || pe->pentrance_step == NULL || pe->phit == NULL || pe->phit_step == NULL
+        || pe->psuccess == NULL || pe->pworkspace_lf == NULL || pe->pworkspace_d == NULL || pe->pgenerators == NULL){
+        splitting_destroy(pe);
+        return NULL;
+    }
+    memcpy(pe->plevels,plevels,num_levels*sizeof(double));
+    memcpy(pe->px0,px0,n*sizeof(double));
+    linspace(pe->pt,0,sample_time,time_steps_per_sample);
+    for (i=0;i<num_samples;i++){
+        pe->pu[i] = pu[i]/(60*1000);
+    }
+    return pe;
+}
+
+// Runs one stage: num_trajectories trajectories started from the num_entrances entrances until they reach the
+// level. Trajectory i uses the seed of stream (stream+i). The successful trajectories are stored in phit in the order
+// of the trajectories and their number is returned. If pmax_T is not NULL, the largest temperature of every
+// trajectory is stored in it.
+static int run_stage(
+    splitting_estimator *pe,
+    unsigned long base_seed,
+    unsigned long stream,
+    double level,
+    int num_entrances,
+    double *pmax_T,
+    long *psimulated_steps
+){
+    int n = pe->n;
+    int N = pe->num_trajectories;
+    int size_thread = thread_workspace_size(n,pe->time_steps_per_sample);
+    long simulated_steps = 0;
+    int i, j, successes;
+    #pragma omp parallel for num_threads(pe->num_threads) schedule(dynamic,16) reduction(+:simulated_steps)
+    for (i=0;i<N;i++){
+        int thread_index = omp_get_thread_num();
+        unsigned long seed = mersenne_stream_seed(base_seed,stream+i);
+        double max_T;
+
+        // Starting state drawn uniformly with replacement from its own stream
+        int start = (int) (mersenne_stream_seed(seed,pe->num_samples) % (unsigned long) num_entrances);
+        pe->psuccess[i] = run_until_level(
+            pe,
+            &pe->pentrance[n*start],
+            pe->pentrance_step[start],
+            level,
+            seed,
+            &pe->phit[n*i],
+            &pe->phit_step[i],
+            &max_T,
+            &pe->pworkspace_lf[size_thread*thread_index],
+            &pe->pworkspace_d[n*thread_index],
+            &pe->pgenerators[624*thread_index],
+            &simulated_steps
+        );
+        if (pmax_T != NULL){
+            pmax_T[i] = max_T;
+        }
+    }
+    *psimulated_steps += simulated_steps;
+
+    // The successful trajectories become the entrances of the next stage, in the order of the trajectories
+    successes = 0;
+    for (i=0;i<N;i++){
+        if (pe->psuccess[i]){
+            for (j=0;j<n;j++){
+                pe->phit[n*successes+j] = pe->phit[n*i+j];
+            }
+            pe->phit_step[successes] = pe->phit_step[i];
+            successes++;
+        }
+    }
+    return successes;
+}
+
+// Makes the hits of the last stage the entrances of the next stage
+static void swap_entrances(
+    splitting_estimator *pe
+){
+    double *pswap = pe->pentrance;
+    int *pswap_step = pe->pentrance_step;
+    pe->pentrance = pe->phit;
+    pe->phit = pswap;
+    pe->pentrance_step = pe->phit_step;
+    pe->phit_step = pswap_step;
+}
+
+// Starts the first stage from the initial state
+static void reset_entrances(
+    splitting_estimator *pe
+){
+    int j;
+    for (j=0;j<pe->n;j++){
+        pe->pentrance[j] = pe->px0[j];
+    }
+    pe->pentrance_step[0] = 0;
+}
+
+// One replicate of the splitting. Returns the product of the conditional probabilities.
+static double replicate(
+    splitting_estimator *pe,
+    int r,
+    double *pstage
+){
+    int N = pe->num_trajectories;
+    int K = pe->num_levels;
+    int num_entrances = 1;
+    double probability = 1;
+    long simulated_steps = 0;
+    int k, successes;
+
+    reset_entrances(pe);
+    for (k=0;k<K;k++){
+        successes = run_stage(pe,pe->seed,((unsigned long) r*K+k)*N,pe->plevels[k],num_entrances,NULL,&simulated_steps);
+        pstage[k] = (double) successes/N;
+        probability *= pstage[k];
+        if (successes == 0){
+            for (k=k+1;k<K;k++){
+                pstage[k] = 0;
+            }
+            break;
+        }
+        swap_entrances(pe);
+        num_entrances = successes;
+    }
+    pe->simulated_steps += simulated_steps;
+    return probability;
+}
+
+static int compare_doubles(
+    const void *pa,
+    const void *pb
+){
+    double a = *(const double*) pa;
+    double b = *(const double*) pb;
+    return (a > b) - (a < b);
+}
+
+int splitting_choose_levels(
+    splitting_estimator *pe,
+    double threshold,
+    double target_probability,
+    int max_levels
+){
+    int N = pe->num_trajectories;
+    if (!(target_probability > 0 && target_probability < 1) || max_levels < 1){
+        return -1;
+    }
+    double *plevels = (double*) malloc(max_levels*sizeof(double));
+    double *pmax_T = (double*) malloc(N*sizeof(double));
+    double *psorted = (double*) malloc(N*sizeof(double));
+    if (plevels == NULL || pmax_T == NULL || psorted == NULL){
+        free(psorted);
+        free(pmax_T);
+        free(plevels);
+        return -1;
+    }
+
+    // The pilot uses its own seeds, so the levels are independent of the replicates of the estimate
+    unsigned long pilot_seed = mersenne_stream_seed(pe->seed,~0UL);
+    int quantile = (int) floor((1-target_probability)*N);
+    int num_entrances = 1;
+    int K = 0;
+    long simulated_steps = 0;
+    double level = -HUGE_VAL;
+    double next;
+    int i;
+    if (quantile > N-1){
+        quantile = N-1;
+    }
+    reset_entrances(pe);
+    while (K < max_levels-1){
+        // Largest temperature of every pilot trajectory without a level
+        run_stage(pe,pilot_seed,(unsigned long) K*N,HUGE_VAL,num_entrances,pmax_T,&simulated_steps);
+        for (i=0;i<N;i++){
+            psorted[i] = pmax_T[i];
+        }
+        qsort(psorted,N,sizeof(double),compare_doubles);
+
+        // The next level is reached by a fraction target_probability of the trajectories
+        next = psorted[quantile];
+        if (next >= threshold || !(next > level)){
+            break;
+        }
+
+        // The same trajectories again, stopped at the level, give the entrances of the next stage
+        num_entrances = run_stage(pe,pilot_seed,(unsigned long) K*N,next,num_entrances,NULL,&simulated_steps);
+        if (num_entrances == 0){
+            break;
+        }
+        swap_entrances(pe);
+        level = next;
+        plevels[K++] = level;
+    }
+    plevels[K++] = threshold;
+    free(psorted);
+    free(pmax_T);
+
+    double *pstage_probability = (double*) realloc(pe->pstage_probability,K*sizeof(double));
+    if (pstage_probability == NULL){
+        free(plevels);
+        return -1;
+    }
+    pe->pstage_probability = pstage_probability;
+    for (i=0;i<K;i++){
+        pe->pstage_probability[i] = 0;
+    }
+    free(pe->plevels);
+    pe->plevels = plevels;
+    pe->num_levels = K;
+    pe->simulated_steps = simulated_steps;
+    return K;
+}
+
+double splitting_estimate(
+    splitting_estimator *pe,
+    int num_replicates
+){
+    int K = pe->num_levels;
+    double *pstage = (double*) malloc(K*sizeof(double));
+    if (pstage == NULL || num_replicates < 1){
+        free(pstage);
+        return NAN;
+    }
+    double sum = 0;
+    double sum_squares = 0;
+    double estimate;
+    int r, k;
+    pe->simulated_steps = 0;
+    for (k=0;k<K;k++){
+        pe->pstage_probability[k] = 0;
+    }
+    for (r=0;r<num_replicates;r++){
+        estimate = replicate(pe,r,pstage);
+        sum += estimate;
+        sum_squares += estimate*estimate;
+        for (k=0;k<K;k++){
+            pe->pstage_probability[k] += pstage[k]/num_replicates;
+        }
+    }
+    free(pstage);
+
+    // Mean of the independent replicates with a normal approximation of its distribution
+    pe->num_replicates = num_replicates;
+    pe->probability = sum/num_replicates;
+    if (num_replicates > 1){
+        double variance = (sum_squares-num_replicates*pe->probability*pe->probability)/(num_replicates-1);
+        pe->standard_error = variance > 0 ? sqrt(variance/num_replicates) : 0;
+    }
+    else {
+        pe->standard_error = HUGE_VAL;
+    }
+    pe->ci_low = fmax(pe->probability-1.96*pe->standard_error,0);
+    pe->ci_high = fmin(pe->probability+1.96*pe->standard_error,1);
+    return pe->probability;
+}
+
+void splitting_destroy(
+    splitting_estimator *pe
+){
+    if (pe == NULL){
+        return;
+    }
+    free(pe->pgenerators);
+    free(pe->pworkspace_d);
+    free(pe->pworkspace_lf);
+    free(pe->psuccess);
+    free(pe->phit_step);
+    free(pe->phit);
+    free(pe->pentrance_step);
+    free(pe->pentrance);
+    free(pe->pu);
+    free(pe->pt);
+    free(pe->pstage_probability);
+    free(pe->plevels);
+    free(pe);
+}
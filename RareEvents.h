@@ -0,0 +1,146 @@
+/// @file RareEvents.h
+
+#ifndef CSTR_RARE_EVENTS
+#define CSTR_RARE_EVENTS
+
+#include "CSTR.h"
+
+/**
+ * Fixed effort multilevel splitting for the probability that the temperature of the CSTR exceeds a threshold
+ * during an experiment with a given flow rate profile. With the levels \f$L_1<\cdots<L_K\f$, where \f$L_K\f$ is the
+ * threshold, the probability is written as
+ * \f[
+ *     p = \prod_{k=1}^K P(\tau_k\leq t_f\mid\tau_{k-1}\leq t_f),
+ * \f]
+ * where \f$\tau_k\f$ is the first time the temperature reaches \f$L_k\f$. In stage \f$k\f$, num_trajectories
+ * trajectories are started from states drawn uniformly with replacement among the states where the trajectories of
+ * the previous stage first reached \f$L_{k-1}\f$. They are simulated with vector_implicit_euler() and fresh noise until
+ * they reach \f$L_k\f$ or the experiment ends, and the fraction which reached \f$L_k\f$ estimates the conditional
+ * probability. The product of the fractions is an unbiased estimate of \f$p\f$.
+ *
+ * The estimate is repeated for independent replicates and the mean of the replicates is reported together with its
+ * standard error and a 95% confidence interval. Every trajectory draws its noise and its starting state from a
+ * seed derived from the replicate, the stage and the trajectory, so the result does not depend on the number of
+ * threads. With one level, the estimate is the plain Monte Carlo estimate.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct splitting_estimator{
+    int n;                      // Number of states
+    int num_levels;             // Number of levels, the last is the threshold
+    int num_trajectories;       // Trajectories per stage
+    int num_samples;            // Number of samples in the experiment
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int num_threads;            // Number of workspaces
+    int max_iterations;         // Newton iterations per step
+    int num_replicates;         // Replicates used by the last estimate
+    double tolerance;           // Newton tolerance
+    double probability;         // Mean of the replicates
+    double standard_error;      // Standard error of the mean
+    double ci_low;              // Lower end of the 95% confidence interval
+    double ci_high;             // Upper end of the 95% confidence interval
+    double simulated_steps;     // Implicit Euler steps used by the last estimate
+    unsigned long seed;         // Base seed
+    CSTR_parameters params;     // Model parameters
+    double px0[3];              // Initial state
+    double *plevels;            // Temperature levels [K], num_levels
+    double *pstage_probability; // Mean conditional probability of every stage, num_levels
+    double *pt;                 // Time grid of one sample, (steps+1)
+    double *pu;                 // Flow rate in every sample [L / s], num_samples
+    double *pentrance;          // States where the previous stage reached its level, n*num_trajectories
+    int *pentrance_step;        // Time steps where the previous stage reached its level, num_trajectories
+    double *phit;               // States where the current stage reached its level, n*num_trajectories
+    int *phit_step;             // Time steps where the current stage reached its level, num_trajectories
+    int *psuccess;              // 1 if the trajectory reached the level, num_trajectories
+    double *pworkspace_lf;      // Per thread: trajectory of a sample, noise and solver workspace
+    int *pworkspace_d;          // Per thread: pivots
+    unsigned long *pgenerators; // Per thread: Mersenne Twister generator
+} splitting_estimator;
+
+/**
+ * Allocates an estimator.
+ *
+ * @param[in] pP: Pointer to the model parameters. The struct is copied.
+ * @param[in] pu: Flow rate in every sample in [mL / min]. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_samples: Number of samples.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] px0: Initial state. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] plevels: Increasing temperature levels in [K]. The last level is the threshold.
+ * @param[in] num_levels: Number of levels.
+ * @param[in] num_trajectories: Number of trajectories per stage.
+ * @param[in] seed: Base seed of all random numbers.
+ *
+ * @return Pointer to the estimator or NULL if the memory could not be allocated or the levels are not increasing.
+ *
+ * @date 19th of October 2026
+ */
+
+splitting_estimator *splitting_create(
+    CSTR_parameters *pP,
+    double *pu,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    double *px0,
+    double *plevels,
+    int num_levels,
+    int num_trajectories,
+    unsigned long seed
+);
+
+/**
+ * Estimates the probability with num_replicates independent replicates of the splitting. The result is stored
+ * in probability, standard_error, ci_low and ci_high.
+ *
+ * @param[in,out] pe: Pointer to the estimator.
+ * @param[in] num_replicates: Number of replicates. At least 2 for a standard error.
+ *
+ * @return The estimated probability.
+ *
+ * @date 19th of October 2026
+ */
+
+double splitting_estimate(
+    splitting_estimator *pe,
+    int num_replicates
+);
+
+/**
+ * Replaces the levels by levels chosen with a pilot run such that every stage has a conditional probability of about
+ * target_probability. Starting from the initial state, num_trajectories pilot trajectories are simulated without a
+ * level and the next level is the temperature exceeded by the largest temperature of a fraction target_probability of
+ * them. The same trajectories stopped at that level give the starting states of the next stage. The levels stop at
+ * the threshold. The pilot uses seeds which are not used by splitting_estimate(), so the estimate remains unbiased.
+ *
+ * @param[in,out] pe: Pointer to the estimator.
+ * @param[in] threshold: Temperature threshold in [K], the last level.
+ * @param[in] target_probability: Conditional probability of a stage, between 0 and 1.
+ * @param[in] max_levels: Largest number of levels, including the threshold.
+ *
+ * @return The number of levels or -1 if the arguments are invalid or the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+int splitting_choose_levels(
+    splitting_estimator *pe,
+    double threshold,
+    double target_probability,
+    int max_levels
+);
+
+/**
+ * Frees all memory held by the estimator.
+ *
+ * @param[in] pe: Pointer to the estimator. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void splitting_destroy(
+    splitting_estimator *pe
+);
+
+#endif
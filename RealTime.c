@@ -0,0 +1,304 @@
+/// @file RealTime.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "RealTime.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+#include "CSTR.h"
+
+// Number of latencies kept for the percentiles
+#define REALTIME_LATENCY_CAPACITY 4096
+
+// Splitting NS realizations into contiguous blocks, one per thread
+static void thread_block(
+    int NS,
+    int thread_index,
+    int number_of_threads,
+    int *pstart,
+    int *ppoints
+){
+    int points = NS / number_of_threads;
+    int start = thread_index*points;
+    if (thread_index == number_of_threads-1){
+        points = NS - start;
+    }
+    *pstart = start;
+    *ppoints = points;
+}
+
+realtime_context *realtime_create(
+    int NS,
+    int max_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    CSTR_parameters *pP,
+    unsigned long seed,
+    int num_threads
+){
+    if (NS < 1 || max_samples < 1 || time_steps_per_sample < 1){
+        return NULL;
+    }
+    realtime_context *pctx = (realtime_context*) calloc(1,sizeof(realtime_context));
+    if (pctx == NULL){
+        return NULL;
+    }
+    int n = 3;
+    if (num_threads < 1){
+        num_threads = omp_get_max_threads();
+    }
+    pctx->NS = NS;
+    pctx->n = n;
+    pctx->max_samples = max_samples;
+    pctx->time_steps_per_sample = time_steps_per_sample;
+    pctx->N = max_samples*time_steps_per_sample;
+    pctx->num_threads = num_threads;
+    pctx->max_iterations = 20;
+    pctx->tolerance = 10e-6;
+    pctx->sample_time = sample_time;
+    pctx->seed = seed;
+    pctx->call_count = 0;
+    pctx->params = *pP;
+    pctx->latency_capacity = REALTIME_LATENCY_CAPACITY;
+
+    int N = pctx->N;
+    size_t size_x = (size_t) n*(N+1)*NS;
+    size_t size_dW = (size_t) n*N*NS;
+    size_t size_sums = (size_t) 2*n*(max_samples+1);
+    pctx->pT = (double*) malloc((N+1)*sizeof(double));
+    pctx->pX = (double*) malloc(size_x*sizeof(double));
+    pctx->pdW = (double*) malloc(size_dW*sizeof(double));
+    pctx->pworkspace_lf = (double*) malloc(num_threads*(5+2*n)*n*sizeof(double));
+    pctx->pworkspace_d = (int*) malloc(num_threads*n*sizeof(int));
+    pctx->pgenerators = (unsigned long*) malloc(num_threads*624*sizeof(unsigned long));
+    pctx->psums = (double*) malloc(num_threads*size_sums*sizeof(double));
+    pctx->platency = (double*) malloc(pctx->latency_capacity*sizeof(double));
+    pctx->platency_sorted = (double*) malloc(pctx->latency_capacity*sizeof(double));
+    if (pctx->pT == NULL || pctx->pX == NULL || pctx->pdW == NULL || pctx->pworkspace_lf == NULL
+        || pctx->pworkspace_d == NULL || pctx->pgenerators == NULL || pctx->psums == NULL
+        || pctx->platency == NULL || pctx->platency_sorted == NULL){
+        realtime_destroy(pctx);
+        return NULL;
+    }
+
+    // Time grid relative to the start of the horizon
+    linspace(pctx->pT,0,max_samples*sample_time,N);
+
+    // First touch by the thread which owns the block
+    int x_increment = n*(N+1);
+    int dw_increment = n*N;
+    #pragma omp parallel num_threads(num_threads) proc_bind(close)
+    {
+        int thread_index = omp_get_thread_num();
+        int number_of_threads = omp_get_num_threads();
+        int thread_start, thread_points;
+        thread_block(NS,thread_index,number_of_threads,&thread_start,&thread_points);
+        memset(&pctx->pX[(size_t) thread_start*x_increment],0,(size_t) thread_points*x_increment*sizeof(double));
+        memset(&pctx->pdW[(size_t) thread_start*dw_increment],0,(size_t) thread_points*dw_increment*sizeof(double));
+        memset(&pctx->pworkspace_lf[(5+2*n)*n*thread_index],0,(5+2*n)*n*sizeof(double));
+        memset(&pctx->pgenerators[624*thread_index],0,624*sizeof(unsigned long));
+        memset(&pctx->psums[size_sums*thread_index],0,size_sums*sizeof(double));
+    }
+    return pctx;
+}
+
+int realtime_predict(
+    realtime_context *pctx,
+    double *px0,
+    double *pu,
+    int num_samples,
+    double *pmean,
+    double *pstd
+){
+    if (num_samples < 1){
+        return -1;
+    }
+    double timer = omp_get_wtime();
+    int n = pctx->n;
+    int N = pctx->N;
+    int NS = pctx->NS;
+    int steps = pctx->time_steps_per_sample;
+    if (num_samples > pctx->max_samples){
+        num_samples = pctx->max_samples;
+    }
+    int N_horizon = num_samples*steps;
+    // The trajectories and the noise keep the layout of the longest horizon, which realtime_create() placed
+    // with the threads, while only the noise needed for this horizon is generated
+    int x_increment = n*(N+1);
+    int dw_increment = n*N;
+    int dw_horizon = n*N_horizon;
+    int size_sums = 2*n*(pctx->max_samples+1);
+    int size_stats = n*(num_samples+1);
+    int sample_size = n*steps;
+    double sqrtdt = sqrt(pctx->pT[1]-pctx->pT[0]);
+    unsigned long stream_offset = pctx->call_count*pctx->num_threads;
+    int team_size = 1;
+    int i, j, k;
+
+    #pragma omp parallel num_threads(pctx->num_threads) proc_bind(close) private(i,j,k)
+    {
+        int thread_index = omp_get_thread_num();
+        int number_of_threads = omp_get_num_threads();
+        int thread_start, thread_points;
+        thread_block(NS,thread_index,number_of_threads,&thread_start,&thread_points);
+        if (thread_index == 0){
+            team_size = number_of_threads;
+        }
+        double *psums = &pctx->psums[size_sums*thread_index];
+        for (i=0;i<2*size_stats;i++){
+            psums[i] = 0;
+        }
+        if (thread_points > 0){
+            double *pX = &pctx->pX[(size_t) thread_start*x_increment];
+            double *pdW = &pctx->pdW[(size_t) thread_start*dw_increment];
+
+            // New noise for every call and every thread, drawn at the start of the block and moved to the
+            // realizations from the last one, which does not overwrite noise that has not been moved
+            d_rand_normal_seeded(
+                pdW,
+                &pctx->pgenerators[624*thread_index],
+                thread_points*dw_horizon,
+                mersenne_stream_seed(pctx->seed,stream_offset+thread_index),
+                0,
+                sqrtdt
+            );
+            if (dw_horizon < dw_increment){
+                for (i=thread_points-1;i>0;i--){
+                    memmove(&pdW[(size_t) i*dw_increment],&pdW[(size_t) i*dw_horizon],dw_horizon*sizeof(double));
+                }
+            }
+
+            // Imposing initial condition
+            for (i=0;i<thread_points;i++){
+                for (j=0;j<n;j++){
+                    pX[i*x_increment+j] = px0[j];
+                }
+            }
+
+            implicit_simulation(
+                pctx->pT,
+                pX,
+                pdW,
+                &pctx->pworkspace_lf[(5+2*n)*n*thread_index],
+                &pctx->pworkspace_d[n*thread_index],
+                pctx->max_iterations,
+                pctx->tolerance,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                pu,
+                NULL,
+                &pctx->params,
+                thread_points,
+                num_samples,
+                steps,
+                N,
+                n,
+                dw_increment,
+                0,
+                0
+            );
+
+            // Sums of deviations from the initial state at the sample boundaries
+            for (i=0;i<thread_points;i++){
+                for (k=0;k<=num_samples;k++){
+                    double *px = &pX[i*x_increment+k*sample_size];
+                    for (j=0;j<n;j++){
+                        double deviation = px[j]-px0[j];
+                        psums[k*n+j] += deviation;
+                        psums[size_stats+k*n+j] += deviation*deviation;
+                    }
+                }
+            }
+        }
+    }
+
+    // Combining the partial sums in a fixed order
+    for (i=0;i<size_stats;i++){
+        double sum = 0;
+        double sum_squares = 0;
+        for (k=0;k<team_size;k++){
+            sum += pctx->psums[size_sums*k+i];
+            sum_squares += pctx->psums[size_sums*k+size_stats+i];
+        }
+        double mean = sum/NS;
+        double variance = 0;
+        if (NS > 1){
+            variance = (sum_squares-NS*mean*mean)/(NS-1);
+        }
+        pmean[i] = px0[i%n]+mean;
+        pstd[i] = variance > 0 ? sqrt(variance) : 0;
+    }
+    pctx->call_count++;
+
+    // Recording the latency
+    timer = omp_get_wtime()-timer;
+    pctx->platency[pctx->latency_next] = timer;
+    pctx->latency_next = (pctx->latency_next+1) % pctx->latency_capacity;
+    if (pctx->latency_count < pctx->latency_capacity){
+        pctx->latency_count++;
+    }
+    return 0;
+}
+
+static int compare_doubles(
+    const void *pa,
+    const void *pb
+){
+    double a = *(const double*) pa;
+    double b = *(const double*) pb;
+    return (a > b) - (a < b);
+}
+
+double realtime_latency_percentile(
+    realtime_context *pctx,
+    double percentile
+){
+    int count = pctx->latency_count;
+    if (count == 0){
+        return 0;
+    }
+    memcpy(pctx->platency_sorted,pctx->platency,count*sizeof(double));
+    qsort(pctx->platency_sorted,count,sizeof(double),compare_doubles);
+    int rank = (int) ceil(percentile/100*count)-1;
+    if (rank < 0){
+        rank = 0;
+    }
+    if (rank > count-1){
+        rank = count-1;
+    }
+    return pctx->platency_sorted[rank];
+}
+
+void realtime_latency_report(
+    realtime_context *pctx,
+    FILE *pfile
+){
+    fprintf(pfile,"Latency over the last %d predictions [ms]:\n",pctx->latency_count);
+    fprintf(pfile,"  p50   %lf\n",1000*realtime_latency_percentile(pctx,50));
+    fprintf(pfile,"  p90   %lf\n",1000*realtime_latency_percentile(pctx,90));
+    fprintf(pfile,"  p99   %lf\n",1000*realtime_latency_percentile(pctx,99));
+    fprintf(pfile,"  p99.9 %lf\n",1000*realtime_latency_percentile(pctx,99.9));
+    fprintf(pfile,"  max   %lf\n",1000*realtime_latency_percentile(pctx,100));
+}
+
+void realtime_destroy(
+    realtime_context *pctx
+){
+    if (pctx == NULL){
+        return;
+    }
+    free(pctx->platency_sorted);
+    free(pctx->platency);
+    free(pctx->psums);
+    free(pctx->pgenerators);
+    free(pctx->pworkspace_d);
+    free(pctx->pworkspace_lf);
+    free(pctx->pdW);
+    free(pctx->pX);
+    free(pctx->pT);
+    free(pctx);
+}
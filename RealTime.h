@@ -0,0 +1,143 @@
+/// @file RealTime.h
+
+#ifndef CSTR_REAL_TIME
+#define CSTR_REAL_TIME
+
+#include <stdio.h>
+#include "CSTR.h"
+
+/**
+ * Persistent state of the real-time predictor. All buffers are allocated once by realtime_create() for the largest
+ * horizon that will be requested, such that realtime_predict() does not allocate memory on the heap and does not
+ * touch the file system. The fields max_iterations and tolerance may be changed between calls.
+ *
+ * The realizations are split into one contiguous block per thread. The threads are bound with proc_bind(close), so
+ * in order to pin them to cores the environment variable OMP_PLACES should be set, for instance OMP_PLACES=cores.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct realtime_context{
+    int NS;                     // Number of realizations in every prediction
+    int n;                      // Number of states
+    int max_samples;            // Longest horizon in samples
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int N;                      // Number of time steps in the longest horizon
+    int num_threads;            // Size of the OpenMP team
+    int max_iterations;         // Newton iterations per step
+    double tolerance;           // Newton tolerance
+    double sample_time;         // Sample time in seconds
+    unsigned long seed;         // Base seed of the noise
+    unsigned long call_count;   // Number of predictions made so far
+    CSTR_parameters params;     // Model parameters
+    double *pT;                 // Time grid, (N+1)
+    double *pX;                 // Trajectories, n*(N+1)*NS
+    double *pdW;                // Noise, n*N*NS
+    double *pworkspace_lf;      // Solver workspace, num_threads*(5+2n)*n
+    int *pworkspace_d;          // Pivots for DGESV, num_threads*n
+    unsigned long *pgenerators; // Mersenne Twister generators, num_threads*624
+    double *psums;              // Partial sums per thread, num_threads*2*n*(max_samples+1)
+    int latency_capacity;       // Number of latencies kept in the ring buffer
+    int latency_count;          // Number of latencies recorded, at most latency_capacity
+    int latency_next;           // Next slot in the ring buffer
+    double *platency;           // Ring buffer of latencies in seconds
+    double *platency_sorted;    // Scratch space for computing percentiles
+} realtime_context;
+
+/**
+ * Allocates and initializes a real-time predictor for the CSTR model. The memory is touched for the first time by the
+ * thread which will later use it.
+ *
+ * @param[in] NS: Number of realizations of noise in every prediction.
+ * @param[in] max_samples: The longest horizon in samples which will be passed to realtime_predict().
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ * @param[in] sample_time: The sample time in seconds.
+ * @param[in] pP: Pointer to the model parameters. The struct is copied.
+ * @param[in] seed: Base seed for the noise. Every prediction uses new noise derived from this seed.
+ * @param[in] num_threads: Number of OpenMP threads. If less than 1, omp_get_max_threads() is used.
+ *
+ * @return Pointer to the predictor or NULL if NS, max_samples or time_steps_per_sample is less than 1 or the memory
+ * could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+realtime_context *realtime_create(
+    int NS,
+    int max_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    CSTR_parameters *pP,
+    unsigned long seed,
+    int num_threads
+);
+
+/**
+ * Advances all realizations from the state px0 over num_samples samples with the inputs in pu and returns the
+ * mean and the standard deviation of the ensemble at every sample boundary. The wall clock time of the call is
+ * recorded for realtime_latency_percentile(). The routine neither allocates memory nor performs file I/O.
+ *
+ * @param[in,out] pctx: Pointer to the predictor.
+ * @param[in] px0: Initial state. Must be of size \f$n\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pu: Flow rate in every sample of the horizon in [L / s]. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_samples: Horizon in samples. Must be between 1 and max_samples.
+ * @param[out] pmean: Ensemble mean, column major. Must be of size \f$n\cdot(\text{num\_samples}+1)\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] pstd: Ensemble standard deviation, column major. Must be of size \f$n\cdot(\text{num\_samples}+1)\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return 0 on success and -1 if num_samples is less than 1, in which case nothing is computed.
+ *
+ * @date 19th of October 2026
+ */
+
+int realtime_predict(
+    realtime_context *pctx,
+    double *px0,
+    double *pu,
+    int num_samples,
+    double *pmean,
+    double *pstd
+);
+
+/**
+ * Returns a percentile of the latencies of the most recent calls to realtime_predict(). Nearest rank is used.
+ *
+ * @param[in] pctx: Pointer to the predictor.
+ * @param[in] percentile: The percentile in the interval \f$[0,100]\f$.
+ *
+ * @return Latency in seconds or 0 if no predictions have been made.
+ *
+ * @date 19th of October 2026
+ */
+
+double realtime_latency_percentile(
+    realtime_context *pctx,
+    double percentile
+);
+
+/**
+ * Writes the median, the 90th, 99th and 99.9th percentiles and the maximum latency to pfile.
+ *
+ * @param[in] pctx: Pointer to the predictor.
+ * @param[in] pfile: Output stream, for instance stdout.
+ *
+ * @date 19th of October 2026
+ */
+
+void realtime_latency_report(
+    realtime_context *pctx,
+    FILE *pfile
+);
+
+/**
+ * Frees all memory held by the predictor.
+ *
+ * @param[in] pctx: Pointer to the predictor. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void realtime_destroy(
+    realtime_context *pctx
+);
+
+#endif
@@ -0,0 +1,305 @@
+/// @file Scenario.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+#include "Scenario.h"
+
+// Parameters which beta is computed from, and beta itself
+#define SCENARIO_THERMAL 1
+#define SCENARIO_BETA 2
+
+// Parameters of CSTR_parameters which can be set in a scenario
+static const struct {
+    const char *name;
+    size_t offset;
+    int flag;
+} scenario_parameters[] = {
+    {"EaR", offsetof(CSTR_parameters,EaR), 0},
+    {"rho", offsetof(CSTR_parameters,rho), SCENARIO_THERMAL},
+    {"DeltaH", offsetof(CSTR_parameters,DeltaH), SCENARIO_THERMAL},
+    {"cP", offsetof(CSTR_parameters,cP), SCENARIO_THERMAL},
+    {"beta", offsetof(CSTR_parameters,beta), SCENARIO_BETA},
+    {"CAin", offsetof(CSTR_parameters,CAin), 0},
+    {"CBin", offsetof(CSTR_parameters,CBin), 0},
+    {"Tin", offsetof(CSTR_parameters,Tin), 0},
+    {"V", offsetof(CSTR_parameters,V), 0},
+    {"k0", offsetof(CSTR_parameters,k0), 0},
+    {"sigma", offsetof(CSTR_parameters,sigma), 0}
+};
+
+// Reads the next whitespace separated token, skipping comments. Returns 0 at the end of the file
+static int next_token(
+    FILE *pfile,
+    char *ptoken,
+    int size,
+    int *pline
+){
+    int c = fgetc(pfile);
+    while (c != EOF){
+        if (c == '#'){
+            while (c != EOF && c != '\n'){
+                c = fgetc(pfile);
+            }
+        }
+        else if (c == ' ' || c == '\t' || c == '\r' || c == '\n'){
+            *pline += (c == '\n');
+            c = fgetc(pfile);
+        }
+        else {
+            break;
+        }
+    }
+    int length = 0;
+    while (c != EOF && c != ' ' && c != '\t' && c != '\r' && c != '\n' && c != '#'){
+        if (length < size-1){
+            ptoken[length++] = (char) c;
+        }
+        c = fgetc(pfile);
+    }
+    if (c != EOF){
+        ungetc(c,pfile);
+    }
+    ptoken[length] = '\0';
+    return length > 0;
+}
+
+// Reads a number, returns 0 on error
+static int next_number(
+    FILE *pfile,
+    int *pline,
+    double *pvalue
+){
+    char token[64];
+    char *pend;
+    if (!next_token(pfile,token,sizeof(token),pline)){
+        return 0;
+    }
+    *pvalue = strtod(token,&pend);
+    return *pend == '\0';
+}
+
+// Reads a positive integer, returns 0 on error
+static int next_count(
+    FILE *pfile,
+    int *pline,
+    int *pvalue
+){
+    double value;
+    if (!next_number(pfile,pline,&value) || value < 1 || value > 1e9 || value != (int) value){
+        return 0;
+    }
+    *pvalue = (int) value;
+    return 1;
+}
+
+scenario_batch *scenario_read(
+    const char *path,
+    int *perror_line
+){
+    int line = 1;
+    int error_line = 0;
+    int capacity = 0;
+    int *pflags = NULL;
+    int i;
+    char token[64];
+    if (perror_line != NULL){
+        *perror_line = 0;
+    }
+    FILE *pfile = fopen(path,"r");
+    if (pfile == NULL){
+        return NULL;
+    }
+    scenario_batch *pb = (scenario_batch*) calloc(1,sizeof(scenario_batch));
+    if (pb == NULL){
+        fclose(pfile);
+        return NULL;
+    }
+    pb->num_samples = 35;
+    pb->time_steps_per_sample = 60;
+    pb->sample_time = 60;
+    scenario_group *pgroup = NULL;
+    while (error_line == 0 && next_token(pfile,token,sizeof(token),&line)){
+        int keyword_line = line;
+        double value;
+        if (strcmp(token,"samples") == 0 || strcmp(token,"steps_per_sample") == 0){
+            int count;
+            if (pgroup != NULL || !next_count(pfile,&line,&count)){
+                error_line = keyword_line;
+            }
+            else if (strcmp(token,"samples") == 0){
+                pb->num_samples = count;
+            }
+            else {
+                pb->time_steps_per_sample = count;
+            }
+        }
+        else if (strcmp(token,"sample_time") == 0){
+            if (pgroup != NULL || !next_number(pfile,&line,&value) || value <= 0){
+                error_line = keyword_line;
+            }
+            else {
+                pb->sample_time = value;
+            }
+        }
+        else if (strcmp(token,"scenario") == 0){
+            if (pb->num_groups == capacity){
+                capacity = (capacity > 0) ? 2*capacity : 16;
+                scenario_group *pgroups = (scenario_group*) realloc(pb->pgroups,capacity*sizeof(scenario_group));
+                if (pgroups != NULL){
+                    pb->pgroups = pgroups;
+                }
+                int *pnew_flags = (int*) realloc(pflags,capacity*sizeof(int));
+                if (pnew_flags != NULL){
+                    pflags = pnew_flags;
+                }
+                if (pgroups == NULL || pnew_flags == NULL){
+                    error_line = -1;
+                    break;
+                }
+            }
+            pflags[pb->num_groups] = 0;
+            pgroup = &pb->pgroups[pb->num_groups];
+            pb->num_groups++;
+            pgroup->pu = NULL;
+            pgroup->num_realizations = 0;
+            pgroup->params = default_parameters();
+            pgroup->px0[0] = 0.05;
+            pgroup->px0[1] = 0.25;
+            pgroup->px0[2] = pgroup->params.Tin;
+            if (!next_count(pfile,&line,&pgroup->num_realizations)){
+                error_line = keyword_line;
+            }
+            pb->num_realizations += pgroup->num_realizations;
+        }
+        else if (pgroup == NULL){
+            error_line = keyword_line;
+        }
+        else if (strcmp(token,"x0") == 0){
+            for (i=0;i<3;i++){
+                if (!next_number(pfile,&line,&pgroup->px0[i])){
+                    error_line = keyword_line;
+                }
+            }
+        }
+        else if (strcmp(token,"flow") == 0){
+            if (pgroup->pu == NULL){
+                pgroup->pu = (double*) malloc(pb->num_samples*sizeof(double));
+            }
+            if (pgroup->pu == NULL){
+                error_line = -1;
+                break;
+            }
+            for (i=0;i<pb->num_samples;i++){
+                if (!next_number(pfile,&line,&pgroup->pu[i]) || pgroup->pu[i] < 0){
+                    error_line = keyword_line;
+                    break;
+                }
+            }
+        }
+        else {
+            int num_parameters = sizeof(scenario_parameters)/sizeof(scenario_parameters[0]);
+            for (i=0;i<num_parameters;i++){
+                if (strcmp(token,scenario_parameters[i].name) == 0){
+                    break;
+                }
+            }
+            if (i == num_parameters || !next_number(pfile,&line,&value)){
+                error_line = keyword_line;
+            }
+            else {
+                *(double*) ((char*) &pgroup->params+scenario_parameters[i].offset) = value;
+                pflags[pb->num_groups-1] |= scenario_parameters[i].flag;
+            }
+        }
+    }
+    fclose(pfile);
+
+    // The profile of flow_rate() is the default of scenarios without a flow rate
+    if (error_line == 0 && pb->num_groups == 0){
+        error_line = line;
+    }
+    for (i=0;i<pb->num_groups && error_line == 0;i++){
+        // The drift only uses beta, which follows from rho, DeltaH and cP unless it is given
+        CSTR_parameters *pparams = &pb->pgroups[i].params;
+        if (pflags[i] == SCENARIO_THERMAL){
+            if (!(pparams->rho*pparams->cP > 0)){
+                error_line = line;
+                break;
+            }
+            pparams->beta = -pparams->DeltaH/(pparams->rho*pparams->cP);
+        }
+        if (pb->pgroups[i].pu == NULL){
+            if (pb->num_samples != 35){
+                error_line = line;
+                break;
+            }
+            pb->pgroups[i].pu = (double*) malloc(35*sizeof(double));
+            if (pb->pgroups[i].pu == NULL){
+                error_line = -1;
+                break;
+            }
+            flow_rate(pb->pgroups[i].pu);
+        }
+    }
+    free(pflags);
+    if (error_line != 0){
+        if (perror_line != NULL){
+            *perror_line = (error_line > 0) ? error_line : 0;
+        }
+        scenario_destroy(pb);
+        return NULL;
+    }
+    return pb;
+}
+
+int scenario_expand(
+    scenario_batch *pb,
+    int first,
+    int count,
+    double *pu,
+    double *px,
+    int x_increment,
+    CSTR_parameters *pparams
+){
+    if (first < 0 || count < 0 || first+count > pb->num_realizations){
+        return -1;
+    }
+    int group = 0;
+    int group_end = pb->pgroups[0].num_realizations;
+    int i, j;
+    for (i=0;i<count;i++){
+        while (first+i >= group_end){
+            group++;
+            group_end += pb->pgroups[group].num_realizations;
+        }
+        scenario_group *pgroup = &pb->pgroups[group];
+        for (j=0;j<pb->num_samples;j++){
+            pu[i*pb->num_samples+j] = pgroup->pu[j]/(60*1000);
+        }
+        if (px != NULL){
+            for (j=0;j<3;j++){
+                px[i*x_increment+j] = pgroup->px0[j];
+            }
+        }
+        if (pparams != NULL){
+            pparams[i] = pgroup->params;
+        }
+    }
+    return 0;
+}
+
+void scenario_destroy(
+    scenario_batch *pb
+){
+    if (pb == NULL){
+        return;
+    }
+    int i;
+    for (i=0;i<pb->num_groups;i++){
+        free(pb->pgroups[i].pu);
+    }
+    free(pb->pgroups);
+    free(pb);
+}
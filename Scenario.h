@@ -0,0 +1,112 @@
+/// @file Scenario.h
+
+#ifndef CSTR_SCENARIO
+#define CSTR_SCENARIO
+
+#include "CSTR.h"
+
+/**
+ * Batch of what-if scenarios of the open loop experiment, read from a text file by scenario_read(). The file holds
+ * whitespace separated keywords and values, and everything from # to the end of a line is a comment. It starts with
+ * the horizon, which is shared by all scenarios,
+ * \code
+ * samples 35
+ * steps_per_sample 60
+ * sample_time 60
+ * \endcode
+ * where the values shown are the defaults. Every scenario starts with the keyword scenario and the number of
+ * realizations of noise simulated with it, followed by any of the keywords
+ * \code
+ * scenario 100
+ * x0 0.05 0.25 273.65
+ * flow 700 700 ... 700
+ * k0 4.8266e10
+ * \endcode
+ * x0 is the initial state and flow is the flow rate in every sample in [mL / min]. A parameter of CSTR_parameters
+ * is set by its name, i.e. EaR, rho, DeltaH, cP, beta, CAin, CBin, Tin, V, k0 or sigma, in the units of
+ * default_parameters(). The drift depends on rho, DeltaH and cP through beta only, so if a scenario sets any of them
+ * but not beta, beta is computed as \f$-\Delta H/(\rho c_P)\f$. Values which are not given are those of
+ * default_parameters(), the initial state \f$(0.05, 0.25, 273.65)\f$ and the profile of flow_rate(), which
+ * requires 35 samples.
+ *
+ * The realizations are numbered in the order of the scenarios, so a scenario with one realization is a
+ * per-realization scenario and a scenario with many realizations is a group. scenario_expand() writes the flow
+ * rates, initial states and parameters of consecutive realizations to arrays, which can be passed to
+ * implicit_simulation() with u_increment num_samples and p_increment 1.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct scenario_group{
+    int num_realizations;       // Realizations simulated with the scenario
+    double px0[3];              // Initial state
+    double *pu;                 // Flow rate in every sample [mL / min], num_samples
+    CSTR_parameters params;     // Model parameters
+} scenario_group;
+
+typedef struct scenario_batch{
+    int num_samples;            // Number of samples
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    double sample_time;         // Sample time in seconds
+    int num_groups;             // Number of scenarios
+    int num_realizations;       // Realizations of all scenarios
+    scenario_group *pgroups;    // The scenarios, num_groups
+} scenario_batch;
+
+/**
+ * Reads a scenario file.
+ *
+ * @param[in] path: Path of the file.
+ * @param[out] perror_line: The line of the first error, or 0 if the file could not be opened or memory could not be
+ * allocated. May be NULL.
+ *
+ * @return Pointer to the batch or NULL on error.
+ *
+ * @date 19th of October 2026
+ */
+
+scenario_batch *scenario_read(
+    const char *path,
+    int *perror_line
+);
+
+/**
+ * Writes the inputs of the realizations first to first+count-1 to arrays, with realization \f$i\f$ at index
+ * \f$i-\text{first}\f$.
+ *
+ * @param[in] pb: Pointer to the batch.
+ * @param[in] first: The first realization.
+ * @param[in] count: Number of realizations.
+ * @param[out] pu: Flow rates in [L / s]. Must be of size \f$\text{count}\cdot\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[out] px: Initial states, written to the first 3 elements of every trajectory. May be NULL.
+ * @param[in] x_increment: Offset between the trajectories in px.
+ * @param[out] pparams: Parameters. Must be of size \f$\text{count}\cdot\text{sizeof}(\text{CSTR\_parameters})\f$. May be NULL.
+ *
+ * @return 0 on success and -1 if the realizations are not in the batch.
+ *
+ * @date 19th of October 2026
+ */
+
+int scenario_expand(
+    scenario_batch *pb,
+    int first,
+    int count,
+    double *pu,
+    double *px,
+    int x_increment,
+    CSTR_parameters *pparams
+);
+
+/**
+ * Frees all memory held by the batch.
+ *
+ * @param[in] pb: Pointer to the batch. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void scenario_destroy(
+    scenario_batch *pb
+);
+
+#endif
@@ -0,0 +1,168 @@
+/// @file ScenarioTree.c
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ScenarioTree.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+
+scenario_tree *scenario_tree_create(
+    int num_stages,
+    int *pbranching,
+    int time_steps_per_sample,
+    double sample_time,
+    int num_threads
+){
+    int l;
+    if (num_stages < 1 || time_steps_per_sample < 1 || !(sample_time > 0) || num_threads < 0){
+        return NULL;
+    }
+    for (l=0;l<num_stages;l++){
+        if (pbranching[l] < 1){
+            return NULL;
+        }
+    }
+    scenario_tree *ptree = (scenario_tree*) calloc(1,sizeof(scenario_tree));
+    if (ptree == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int N = num_stages*time_steps_per_sample;
+    ptree->n = n;
+    ptree->num_stages = num_stages;
+    ptree->time_steps_per_sample = time_steps_per_sample;
+    ptree->num_threads = (num_threads > 0) ? num_threads : omp_get_max_threads();
+    ptree->max_iterations = 20;
+    ptree->tolerance = 10e-6;
+    ptree->pbranching = (int*) malloc(num_stages*sizeof(int));
+    ptree->plevel_start = (long*) malloc((num_stages+2)*sizeof(long));
+    if (ptree->pbranching == NULL || ptree->plevel_start == NULL){
+        scenario_tree_destroy(ptree);
+        return NULL;
+    }
+    memcpy(ptree->pbranching,pbranching,num_stages*sizeof(int));
+
+    // Number of nodes of every level
+    long width = 1;
+    ptree->plevel_start[0] = 0;
+    ptree->plevel_start[1] = 1;
+    for (l=0;l<num_stages;l++){
+        width *= pbranching[l];
+        ptree->plevel_start[l+2] = ptree->plevel_start[l+1]+width;
+        if (ptree->plevel_start[l+2] > (1L<<31)){
+            scenario_tree_destroy(ptree);
+            return NULL;
+        }
+    }
+    ptree->num_nodes = ptree->plevel_start[num_stages+1];
+
+    int size_trajectory = n*(time_steps_per_sample+1);
+    int size_dW = n*time_steps_per_sample+1;
+    ptree->pt = (double*) malloc((N+1)*sizeof(double));
+    ptree->px = (double*) malloc((size_t) n*ptree->num_nodes*sizeof(double));
+    ptree->ptrajectories = (double*) malloc(ptree->num_threads*size_trajectory*sizeof(double));
+    ptree->pdW = (double*) malloc(ptree->num_threads*size_dW*sizeof(double));
+    ptree->pworkspace_lf = (double*) malloc(ptree->num_threads*n*(5+2*n)*sizeof(double));
+    ptree->pworkspace_d = (int*) malloc(ptree->num_threads*n*sizeof(int));
+    ptree->pgenerators = (unsigned long*) malloc(ptree->num_threads*624*sizeof(unsigned long));
+    if (ptree->pt == NULL || ptree->px == NULL || ptree->ptrajectories == NULL || ptree->pdW == NULL
+        || ptree->pworkspace_lf == NULL || ptree->pworkspace_d == NULL || ptree->pgenerators == NULL){
+        scenario_tree_destroy(ptree);
+        return NULL;
+    }
+    linspace(ptree->pt,0,num_stages*sample_time,N);
+    return ptree;
+}
+
+void scenario_tree_simulate(
+    scenario_tree *ptree,
+    double *px0,
+    double *pu,
+    CSTR_parameters *pP,
+    int p_increment,
+    unsigned long seed
+){
+    int n = ptree->n;
+    int steps = ptree->time_steps_per_sample;
+    int size_trajectory = n*(steps+1);
+    int size_dW = n*steps+1;
+    double sqrtdt = sqrt(ptree->pt[1]-ptree->pt[0]);
+    int l;
+    memcpy(ptree->px,px0,n*sizeof(double));
+
+    // The levels breadth first, every level in parallel from the states of the previous one
+    for (l=0;l<ptree->num_stages;l++){
+        long first = ptree->plevel_start[l+1];
+        long count = ptree->plevel_start[l+2]-first;
+        int branching = ptree->pbranching[l];
+        long k;
+        #pragma omp parallel for num_threads(ptree->num_threads) schedule(static)
+        for (k=0;k<count;k++){
+            int thread_index = omp_get_thread_num();
+            long parent = ptree->plevel_start[l]+k/branching;
+            int branch = (int) (k%branching);
+            double *ptrajectory = &ptree->ptrajectories[size_trajectory*thread_index];
+            double *pdW = &ptree->pdW[size_dW*thread_index];
+            double u = pu[parent]/(60*1000);
+            d_rand_normal_seeded(pdW,&ptree->pgenerators[624*thread_index],n*steps+((n*steps)&1),
+                mersenne_stream_seed(seed,(unsigned long) (first+k)),0,sqrtdt);
+            vector_implicit_euler(
+                steps,
+                n,
+                1,
+                &ptree->pt[l*steps],
+                ptrajectory,
+                pdW,
+                &ptree->pworkspace_lf[n*(5+2*n)*thread_index],
+                &ptree->pworkspace_d[n*thread_index],
+                ptree->max_iterations,
+                ptree->tolerance,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                &u,
+                NULL,
+                &pP[branch*p_increment],
+                &ptree->px[n*parent]
+            );
+            memcpy(&ptree->px[n*(first+k)],&ptrajectory[n*steps],n*sizeof(double));
+        }
+    }
+}
+
+long scenario_tree_parent(
+    scenario_tree *ptree,
+    long node,
+    int *pbranch
+){
+    int l = 1;
+    while (ptree->plevel_start[l+1] <= node){
+        l++;
+    }
+    long k = node-ptree->plevel_start[l];
+    if (pbranch != NULL){
+        *pbranch = (int) (k%ptree->pbranching[l-1]);
+    }
+    return ptree->plevel_start[l-1]+k/ptree->pbranching[l-1];
+}
+
+void scenario_tree_destroy(
+    scenario_tree *ptree
+){
+    if (ptree == NULL){
+        return;
+    }
+    free(ptree->pgenerators);
+    free(ptree->pworkspace_d);
+    free(ptree->pworkspace_lf);
+    free(ptree->pdW);
+    free(ptree->ptrajectories);
+    free(ptree->px);
+    free(ptree->pt);
+    free(ptree->plevel_start);
+    free(ptree->pbranching);
+    free(ptree);
+}
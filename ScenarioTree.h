@@ -0,0 +1,121 @@
+/// @file ScenarioTree.h
+
+#ifndef CSTR_SCENARIO_TREE
+#define CSTR_SCENARIO_TREE
+
+#include "CSTR.h"
+
+/**
+ * Scenario tree of the CSTR for robust and multistage MPC. The root is the initial state, and every node at level
+ * \f$l\f$ branches into branching[l] children at level \f$l+1\f$, i.e. one level per sample. A child is simulated
+ * over one sample from the end state of its parent with vector_implicit_euler(), so the shared prefix of the leaves
+ * is simulated once instead of once per leaf. The levels are processed one after the other, breadth first, and the
+ * nodes of a level in parallel.
+ *
+ * The nodes are numbered breadth first from the root, node 0, such that the nodes of level \f$l\f$ are
+ * level_start[l] to level_start[l+1]-1. Child \f$c\f$ of the \f$j\f$-th node of level \f$l\f$ is the node
+ * level_start[l+1]+j*branching[l]+c. Only the state of every node at the end of its sample is stored, n values per
+ * node. Node \f$k\f$ draws its noise from mersenne_stream_seed(seed, k), so the tree does not depend on the number of
+ * threads. Within a node the flow rate of the parent applies, as the input is decided before the branches separate,
+ * and branch \f$c\f$ uses the parameters pP[c*p_increment], so parameter uncertainty is modelled with p_increment 1
+ * and an array of parameter realizations, and noise only with p_increment 0.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct scenario_tree{
+    int n;                      // Number of states
+    int num_stages;             // Number of levels below the root, one per sample
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int num_threads;            // Threads of a simulation and number of workspaces
+    int max_iterations;         // Newton iterations per step
+    double tolerance;           // Newton tolerance
+    int *pbranching;            // Children of every node of a level, num_stages
+    long *plevel_start;         // First node of every level, num_stages+2
+    long num_nodes;             // Number of nodes
+    double *pt;                 // Time grid, num_stages*time_steps_per_sample+1
+    double *px;                 // State of every node at the end of its sample, n*num_nodes
+    double *ptrajectories;      // Per thread trajectory of one sample, num_threads*n*(time_steps_per_sample+1)
+    double *pdW;                // Per thread noise of one sample, num_threads*(n*time_steps_per_sample+1)
+    double *pworkspace_lf;      // Per thread solver workspace, num_threads*n*(5+2n)
+    int *pworkspace_d;          // Per thread pivots, num_threads*n
+    unsigned long *pgenerators; // Per thread Mersenne Twister generators, num_threads*624
+} scenario_tree;
+
+/**
+ * Allocates a scenario tree.
+ *
+ * @param[in] num_stages: Number of samples of the tree.
+ * @param[in] pbranching: Number of children of the nodes at every level, num_stages values of at least 1.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] num_threads: Number of threads, or 0 for omp_get_max_threads().
+ *
+ * @return Pointer to the tree or NULL if an argument is invalid, the tree has more than \f$2^{31}\f$ nodes or memory
+ * could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+scenario_tree *scenario_tree_create(
+    int num_stages,
+    int *pbranching,
+    int time_steps_per_sample,
+    double sample_time,
+    int num_threads
+);
+
+/**
+ * Simulates all nodes of the tree.
+ *
+ * @param[in,out] ptree: Pointer to the tree.
+ * @param[in] px0: State of the root. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pu: Flow rate in [mL / min] applied from every node which is not a leaf, indexed by the node. Must be of
+ * size \f$\text{level\_start}[\text{num\_stages}]\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] pP: Parameters of the branches.
+ * @param[in] p_increment: Offset between the parameters of consecutive branches, 0 for the same parameters in all.
+ * @param[in] seed: Base seed of the noise.
+ *
+ * @date 19th of October 2026
+ */
+
+void scenario_tree_simulate(
+    scenario_tree *ptree,
+    double *px0,
+    double *pu,
+    CSTR_parameters *pP,
+    int p_increment,
+    unsigned long seed
+);
+
+/**
+ * Finds the parent of a node.
+ *
+ * @param[in] ptree: Pointer to the tree.
+ * @param[in] node: A node other than the root.
+ * @param[out] pbranch: The number of the node among the children of its parent. May be NULL.
+ *
+ * @return The parent.
+ *
+ * @date 19th of October 2026
+ */
+
+long scenario_tree_parent(
+    scenario_tree *ptree,
+    long node,
+    int *pbranch
+);
+
+/**
+ * Frees all memory held by the tree.
+ *
+ * @param[in] ptree: Pointer to the tree. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void scenario_tree_destroy(
+    scenario_tree *ptree
+);
+
+#endif
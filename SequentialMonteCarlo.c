@@ -0,0 +1,174 @@
+/// @file SequentialMonteCarlo.c
+
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "SequentialMonteCarlo.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+
+sequential_mc *sequential_mc_create(
+    CSTR_parameters *pP,
+    double *pu,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    double *px0,
+    int num_quantities,
+    quantity_function quantity,
+    void *pquantity_data,
+    int batch_size,
+    unsigned long seed
+){
+    if (num_samples < 1 || time_steps_per_sample < 1 || num_quantities < 1 || quantity == NULL || batch_size < 1){
+        return NULL;
+    }
+    sequential_mc *pmc = (sequential_mc*) calloc(1,sizeof(sequential_mc));
+    if (pmc == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int N = num_samples*time_steps_per_sample;
+    pmc->n = n;
+    pmc->num_samples = num_samples;
+    pmc->time_steps_per_sample = time_steps_per_sample;
+    pmc->N = N;
+    pmc->batch_size = batch_size;
+    pmc->num_threads = omp_get_max_threads();
+    pmc->num_quantities = num_quantities;
+    pmc->max_iterations = 20;
+    pmc->min_realizations = 100;
+    pmc->tolerance = 10e-6;
+    pmc->z = 1.96;
+    pmc->seed = seed;
+    pmc->params = *pP;
+    pmc->quantity = quantity;
+    pmc->pquantity_data = pquantity_data;
+    pmc->pmean = (double*) calloc(num_quantities,sizeof(double));
+    pmc->pvariance = (double*) calloc(num_quantities,sizeof(double));
+    pmc->phalf_width = (double*) calloc(num_quantities,sizeof(double));
+    pmc->pM2 = (double*) calloc(num_quantities,sizeof(double));
+    pmc->pt = (double*) malloc((N+1)*sizeof(double));
+    pmc->pu = (double*) malloc(num_samples*sizeof(double));
+    pmc->pX = (double*) malloc(n*(N+1)*batch_size*sizeof(double));
+    pmc->pdW = (double*) malloc((n*N+1)*batch_size*sizeof(double));
+    pmc->pvalues = (double*) malloc(num_quantities*batch_size*sizeof(double));
+    pmc->pworkspace_lf = (double*) malloc(pmc->num_threads*n*(5+2*n)*sizeof(double));
+    pmc->pworkspace_d = (int*) malloc(pmc->num_threads*n*sizeof(int));
+    pmc->pgenerators = (unsigned long*) malloc(pmc->num_threads*624*sizeof(unsigned long));
+    if (pmc->pmean == NULL || pmc->pvariance == NULL || pmc->phalf_width == NULL || pmc->pM2 == NULL
+        || pmc->pt == NULL || pmc->pu == NULL || pmc->pX == NULL || pmc->pdW == NULL || pmc->pvalues == NULL
+        || pmc->pworkspace_lf == NULL || pmc->pworkspace_d == NULL || pmc->pgenerators == NULL){
+        sequential_mc_destroy(pmc);
+        return NULL;
+    }
+    memcpy(pmc->px0,px0,n*sizeof(double));
+    linspace(pmc->pt,0,num_samples*sample_time,N);
+    int i;
+    for (i=0;i<num_samples;i++){
+        pmc->pu[i] = pu[i]/(60*1000);
+    }
+    return pmc;
+}
+
+int sequential_mc_run(
+    sequential_mc *pmc,
+    int max_realizations,
+    double *ptarget_half_width
+){
+    int n = pmc->n;
+    int N = pmc->N;
+    int q = pmc->num_quantities;
+    int size_x = n*(N+1);
+    int size_dW = n*N+1;
+    double sqrtdt = sqrt(pmc->pt[1]-pmc->pt[0]);
+    int m = 0;
+    int batch, i, j;
+    for (j=0;j<q;j++){
+        pmc->pmean[j] = 0;
+        pmc->pM2[j] = 0;
+        pmc->pvariance[j] = 0;
+        pmc->phalf_width[j] = HUGE_VAL;
+    }
+    pmc->converged = 0;
+    while (m < max_realizations && !pmc->converged){
+        batch = (max_realizations-m < pmc->batch_size) ? max_realizations-m : pmc->batch_size;
+
+        // Every realization has its own stream of noise, so the batch can be split between threads in any way
+        #pragma omp parallel for num_threads(pmc->num_threads) schedule(dynamic,1)
+        for (i=0;i<batch;i++){
+            int thread_index = omp_get_thread_num();
+            double *px = &pmc->pX[size_x*i];
+            double *pdW = &pmc->pdW[size_dW*i];
+            d_rand_normal_seeded(pdW,&pmc->pgenerators[624*thread_index],n*N+((n*N)&1),
+                mersenne_stream_seed(pmc->seed,(unsigned long) (m+i)),0,sqrtdt);
+            memcpy(px,pmc->px0,n*sizeof(double));
+            implicit_simulation(
+                pmc->pt,
+                px,
+                pdW,
+                &pmc->pworkspace_lf[n*(5+2*n)*thread_index],
+                &pmc->pworkspace_d[n*thread_index],
+                pmc->max_iterations,
+                pmc->tolerance,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                pmc->pu,
+                NULL,
+                &pmc->params,
+                1,
+                pmc->num_samples,
+                pmc->time_steps_per_sample,
+                N,
+                n,
+                0,
+                0,
+                0
+            );
+            pmc->quantity(px,N,n,pmc->pquantity_data,&pmc->pvalues[q*i]);
+        }
+
+        // Welford updates in the order of the realizations. The stopping rule is checked after every realization,
+        // and the rest of the batch is discarded once it holds, so the run stops at the first m which meets it.
+        for (i=0;i<batch && !pmc->converged;i++){
+            m++;
+            int all_below = 1;
+            for (j=0;j<q;j++){
+                double value = pmc->pvalues[q*i+j];
+                double delta = value-pmc->pmean[j];
+                pmc->pmean[j] += delta/m;
+                pmc->pM2[j] += delta*(value-pmc->pmean[j]);
+                pmc->pvariance[j] = (m > 1) ? pmc->pM2[j]/(m-1) : 0;
+                pmc->phalf_width[j] = (m > 1) ? pmc->z*sqrt(pmc->pvariance[j]/m) : HUGE_VAL;
+                all_below &= pmc->phalf_width[j] <= ptarget_half_width[j];
+            }
+            pmc->converged = all_below && m >= pmc->min_realizations;
+        }
+    }
+    pmc->num_realizations = m;
+    return m;
+}
+
+void sequential_mc_destroy(
+    sequential_mc *pmc
+){
+    if (pmc == NULL){
+        return;
+    }
+    free(pmc->pgenerators);
+    free(pmc->pworkspace_d);
+    free(pmc->pworkspace_lf);
+    free(pmc->pvalues);
+    free(pmc->pdW);
+    free(pmc->pX);
+    free(pmc->pu);
+    free(pmc->pt);
+    free(pmc->pM2);
+    free(pmc->phalf_width);
+    free(pmc->pvariance);
+    free(pmc->pmean);
+    free(pmc);
+}
@@ -0,0 +1,143 @@
+/// @file SequentialMonteCarlo.h
+
+#ifndef CSTR_SEQUENTIAL_MONTE_CARLO
+#define CSTR_SEQUENTIAL_MONTE_CARLO
+
+#include "CSTR.h"
+
+/**
+ * Function type for the quantities estimated by sequential_mc_run(). It is called once per realization with the
+ * whole trajectory and must write num_quantities values to pvalue, e.g. the final concentration of B or the
+ * indicator of the temperature exceeding a threshold, whose mean is a probability.
+ *
+ * @param[in] px: The trajectory of the realization. Contains \f$n\cdot(N+1)\f$ values.
+ * @param[in] N: The number of time steps.
+ * @param[in] n: The number of states.
+ * @param[in] pdata: Pointer to user data given to sequential_mc_create().
+ * @param[out] pvalue: The quantities of the realization.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef void (*quantity_function)(
+    double *px,
+    int N,
+    int n,
+    void *pdata,
+    double *pvalue
+);
+
+/**
+ * Sequential Monte Carlo estimation of the expected values of some quantities of the open loop experiment. The
+ * realizations are simulated in batches of batch_size in parallel. After every batch the mean and variance of every
+ * quantity are updated with Welford's method, realization by realization in the order of the realizations, and the
+ * run stops at the first \f$m\f$ for which the half-width \f$z\,s/\sqrt{m}\f$ of the confidence interval of every
+ * quantity is below its target, where \f$m\f$ is the number of realizations. The realizations of the batch after it
+ * are discarded. Realization \f$i\f$ draws its noise from the seed mersenne_stream_seed(seed, i), so the estimates and
+ * the number of realizations depend neither on the number of threads nor on the batch size.
+ *
+ * The stopping rule is only checked after min_realizations realizations, since the sample variance of a rare
+ * indicator is zero until the first event occurs.
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct sequential_mc{
+    int n;                          // Number of states
+    int num_samples;                // Number of samples in the experiment
+    int time_steps_per_sample;      // Implicit Euler steps per sample
+    int N;                          // Number of time steps
+    int batch_size;                 // Realizations per batch
+    int num_threads;                // Number of workspaces
+    int num_quantities;             // Number of estimated quantities
+    int max_iterations;             // Newton iterations per step
+    int min_realizations;           // Realizations before the stopping rule is checked, default 100
+    int num_realizations;           // Realizations used by the last run
+    int converged;                  // 1 if the last run reached the targets
+    double tolerance;               // Newton tolerance
+    double z;                       // Quantile of the confidence interval, default 1.96
+    unsigned long seed;             // Base seed
+    CSTR_parameters params;         // Model parameters
+    double px0[3];                  // Initial state
+    quantity_function quantity;     // Quantities of a realization
+    void *pquantity_data;           // User data of quantity
+    double *pmean;                  // Mean of every quantity, num_quantities
+    double *pvariance;              // Sample variance of every quantity, num_quantities
+    double *phalf_width;            // Half-width of the confidence interval of every quantity, num_quantities
+    double *pM2;                    // Sums of squared deviations, num_quantities
+    double *pt;                     // Time grid, (N+1)
+    double *pu;                     // Flow rate in every sample [L / s], num_samples
+    double *pX;                     // Trajectories of a batch, n*(N+1)*batch_size
+    double *pdW;                    // Noise of a batch, (n*N+1)*batch_size
+    double *pvalues;                // Quantities of a batch, num_quantities*batch_size
+    double *pworkspace_lf;          // Per thread solver workspace, num_threads*n*(5+2n)
+    int *pworkspace_d;              // Per thread pivots, num_threads*n
+    unsigned long *pgenerators;     // Per thread Mersenne Twister generators, num_threads*624
+} sequential_mc;
+
+/**
+ * Allocates a sequential estimator.
+ *
+ * @param[in] pP: Pointer to the model parameters. The struct is copied.
+ * @param[in] pu: Flow rate in every sample in [mL / min]. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_samples: Number of samples.
+ * @param[in] time_steps_per_sample: Number of implicit Euler steps per sample.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] px0: Initial state. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_quantities: Number of quantities.
+ * @param[in] quantity: Function returning the quantities of a realization.
+ * @param[in] pquantity_data: User data passed to quantity. May be NULL.
+ * @param[in] batch_size: Number of realizations per batch.
+ * @param[in] seed: Base seed of the noise.
+ *
+ * @return Pointer to the estimator or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+sequential_mc *sequential_mc_create(
+    CSTR_parameters *pP,
+    double *pu,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    double *px0,
+    int num_quantities,
+    quantity_function quantity,
+    void *pquantity_data,
+    int batch_size,
+    unsigned long seed
+);
+
+/**
+ * Simulates batches until the half-width of the confidence interval of every quantity is below its target or
+ * max_realizations realizations have been used. The estimates are stored in pmean, pvariance and phalf_width.
+ *
+ * @param[in,out] pmc: Pointer to the estimator.
+ * @param[in] max_realizations: Largest number of realizations.
+ * @param[in] ptarget_half_width: Target half-width of every quantity. Must be of size \f$\text{num\_quantities}\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return The number of realizations used.
+ *
+ * @date 19th of October 2026
+ */
+
+int sequential_mc_run(
+    sequential_mc *pmc,
+    int max_realizations,
+    double *ptarget_half_width
+);
+
+/**
+ * Frees all memory held by the estimator.
+ *
+ * @param[in] pmc: Pointer to the estimator. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void sequential_mc_destroy(
+    sequential_mc *pmc
+);
+
+#endif
@@ -0,0 +1,877 @@
+/// @file Service.c
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <errno.h>
+#include <signal.h>
+#include <omp.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include "Service.h"
+#include "CSTR.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+#include "Cache.h"
+
+#define SERVICE_MAX_CLIENTS 256
+#define SERVICE_MAX_REALIZATIONS 1000000
+#define SERVICE_MAX_SAMPLES 100000
+#define SERVICE_MAX_VALUES (1L<<28)
+#define SERVICE_MAX_PENDING_BYTES (1L<<32)
+#define SERVICE_MAX_ITERATIONS 20
+#define SERVICE_TOLERANCE 10e-6
+#define SERVICE_DRAIN_SECONDS 5
+
+// A request waiting for its batch
+typedef struct service_job{
+    int fd;                             // Connection of the client
+    service_request_header header;      // The request
+    int N;                              // Number of time steps
+    double arrival;                     // Time of arrival
+    double *pt;                         // Time grid, (N+1)
+    double *pu;                         // Flow rate in every sample [L / s], num_samples
+    double *pX;                         // Trajectories, 3*(N+1)*num_realizations
+    cache_key key;                      // Inputs of the simulation, if the server has a cache
+    service_response_header response;   // Response set by run_batch(), whose values are in pX
+} service_job;
+
+// A response which has not been written completely
+typedef struct service_output{
+    service_response_header header;     // Header of the response
+    double *pvalues;                    // Values following the header, owned by the output, or NULL
+    cache_entry entry;                  // Mapped cache entry holding the values instead, or with pmap NULL
+    long num_values;                    // Number of values
+} service_output;
+
+// A client connection. The requests are read and the responses written as far as the socket allows, such that a
+// slow client does not hold up the others
+typedef struct service_connection{
+    int fd;                             // Non-blocking socket
+    service_request_header header;      // Request being read
+    size_t header_bytes;                // Bytes of the header read so far
+    double *pu;                         // Flow rates of the request being read, allocated when the header is complete
+    size_t pu_bytes;                    // Bytes of the flow rates read so far
+    service_output *poutput;            // Responses to write, in order
+    int num_output;                     // Number of responses to write
+    int output_capacity;                // Capacity of poutput
+    size_t output_bytes;                // Bytes of the first response written so far
+} service_connection;
+
+// Latencies of all requests
+typedef struct service_latencies{
+    int count;
+    int capacity;
+    double *pqueue;
+    double *pservice;
+} service_latencies;
+
+static volatile sig_atomic_t service_stop = 0;
+
+static void service_signal(
+    int signal_number
+){
+    (void) signal_number;
+    service_stop = 1;
+}
+
+static int read_full(
+    int fd,
+    void *pbuffer,
+    size_t size
+){
+    char *p = (char*) pbuffer;
+    while (size > 0){
+        ssize_t count = read(fd,p,size);
+        if (count < 0 && errno == EINTR){
+            continue;
+        }
+        if (count <= 0){
+            return -1;
+        }
+        p += count;
+        size -= count;
+    }
+    return 0;
+}
+
+static int write_full(
+    int fd,
+    const void *pbuffer,
+    size_t size
+){
+    const char *p = (const char*) pbuffer;
+    while (size > 0){
+        ssize_t count = write(fd,p,size);
+        if (count < 0 && errno == EINTR){
+            continue;
+        }
+        if (count <= 0){
+            return -1;
+        }
+        p += count;
+        size -= count;
+    }
+    return 0;
+}
+
+// Number of values of the response to a valid request
+static long response_values(
+    service_request_header *prequest,
+    int N
+){
+    long size_x = 3L*(N+1);
+    return (prequest->mode == SERVICE_STATISTICS) ? 2*size_x : size_x*prequest->num_realizations;
+}
+
+// Reads what the socket holds of the next request. Returns 1 when the request is complete, 0 if more data is needed
+// and -1 if the connection must be closed
+static int read_partial(
+    service_connection *pc
+){
+    size_t header_size = sizeof(service_request_header);
+    while (pc->header_bytes < header_size || pc->pu_bytes < pc->header.num_samples*sizeof(double)){
+        char *p;
+        size_t remaining;
+        if (pc->header_bytes < header_size){
+            p = (char*) &pc->header+pc->header_bytes;
+            remaining = header_size-pc->header_bytes;
+        }
+        else {
+            p = (char*) pc->pu+pc->pu_bytes;
+            remaining = pc->header.num_samples*sizeof(double)-pc->pu_bytes;
+        }
+        ssize_t count = read(pc->fd,p,remaining);
+        if (count < 0 && errno == EINTR){
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            return 0;
+        }
+        if (count <= 0){
+            return -1;
+        }
+        if (pc->header_bytes < header_size){
+            pc->header_bytes += count;
+            if (pc->header_bytes < header_size){
+                continue;
+            }
+
+            // The header is complete, and its size of the flow rates is checked before they are allocated
+            if (pc->header.magic != SERVICE_REQUEST_MAGIC || pc->header.num_samples < 1
+                || pc->header.num_samples > SERVICE_MAX_SAMPLES){
+                return -1;
+            }
+            pc->pu = (double*) malloc(pc->header.num_samples*sizeof(double));
+            pc->pu_bytes = 0;
+            if (pc->pu == NULL){
+                return -1;
+            }
+        }
+        else {
+            pc->pu_bytes += count;
+        }
+    }
+    return 1;
+}
+
+// Moves the complete request of a connection to a job, without allocating its buffers. Returns 1 for a valid
+// request and 0 for an invalid one
+static int take_request(
+    service_connection *pc,
+    service_job *pjob
+){
+    service_request_header *prequest = &pjob->header;
+    int i;
+    *prequest = pc->header;
+    pjob->fd = pc->fd;
+    pjob->pu = pc->pu;
+    pjob->pt = NULL;
+    pjob->pX = NULL;
+    memset(&pjob->key,0,sizeof(cache_key));
+    pc->pu = NULL;
+    pc->pu_bytes = 0;
+    pc->header_bytes = 0;
+    for (i=0;i<prequest->num_samples;i++){
+        pjob->pu[i] /= (60*1000);
+    }
+    long N = (long) prequest->num_samples*prequest->time_steps_per_sample;
+    if ((prequest->mode != SERVICE_STATISTICS && prequest->mode != SERVICE_TRAJECTORIES)
+        || prequest->num_realizations < 1 || prequest->num_realizations > SERVICE_MAX_REALIZATIONS
+        || prequest->time_steps_per_sample < 1 || !(prequest->sample_time > 0) || N > SERVICE_MAX_VALUES/3
+        || 3*(N+1)*prequest->num_realizations > SERVICE_MAX_VALUES){
+        return 0;
+    }
+    pjob->N = (int) N;
+    return 1;
+}
+
+// Bytes held by a job from its allocation until its response has been written
+static long job_bytes(
+    service_job *pjob
+){
+    long N = pjob->N;
+    return (long) sizeof(double)*((N+1)+3*(N+1)*pjob->header.num_realizations+pjob->header.num_samples);
+}
+
+// Allocates the time grid and the trajectories of a valid request. Returns -1 if the memory could not be allocated
+static int allocate_job(
+    service_job *pjob
+){
+    service_request_header *prequest = &pjob->header;
+    pjob->pt = (double*) malloc((pjob->N+1)*sizeof(double));
+    pjob->pX = (double*) malloc(3L*(pjob->N+1)*prequest->num_realizations*sizeof(double));
+    if (pjob->pt == NULL || pjob->pX == NULL){
+        return -1;
+    }
+    linspace(pjob->pt,0,prequest->num_samples*prequest->sample_time,pjob->N);
+    return 0;
+}
+
+// Bytes held by the jobs waiting for their batch and by the responses which have not been written, except those
+// which are mapped from the cache
+static long pending_bytes(
+    service_job *pjobs,
+    int num_jobs,
+    service_connection *pconnections,
+    int num_fds
+){
+    long total = 0;
+    int i, k;
+    for (k=0;k<num_jobs;k++){
+        total += job_bytes(&pjobs[k]);
+    }
+    for (i=1;i<num_fds;i++){
+        for (k=0;k<pconnections[i].num_output;k++){
+            if (pconnections[i].poutput[k].pvalues != NULL){
+                total += (long) sizeof(double)*pconnections[i].poutput[k].num_values;
+            }
+        }
+    }
+    return total;
+}
+
+// Frees the values of a response, or unmaps the cache entry which holds them
+static void release_output(
+    service_output *po
+){
+    free(po->pvalues);
+    cache_release(&po->entry);
+}
+
+// Appends a response to the responses of a connection, which takes over pvalues, or the mapped entry pentry if it is
+// not NULL. Returns -1 if the response could not be stored, in which case the connection must be closed
+static int queue_response(
+    service_connection *pc,
+    service_response_header *presponse,
+    double *pvalues,
+    cache_entry *pentry,
+    long num_values
+){
+    service_output output;
+    output.header = *presponse;
+    output.pvalues = pvalues;
+    memset(&output.entry,0,sizeof(cache_entry));
+    if (pentry != NULL){
+        output.entry = *pentry;
+        memset(pentry,0,sizeof(cache_entry));
+    }
+    output.num_values = (pvalues != NULL || output.entry.pmap != NULL) ? num_values : 0;
+    if (pc->num_output == pc->output_capacity){
+        int capacity = (pc->output_capacity > 0) ? 2*pc->output_capacity : 4;
+        service_output *poutput = (service_output*) realloc(pc->poutput,capacity*sizeof(service_output));
+        if (poutput == NULL){
+            release_output(&output);
+            return -1;
+        }
+        pc->poutput = poutput;
+        pc->output_capacity = capacity;
+    }
+    pc->poutput[pc->num_output] = output;
+    pc->num_output++;
+    return 0;
+}
+
+// Writes as much of the responses of a connection as the socket accepts. Returns -1 if the connection must be closed
+static int write_partial(
+    service_connection *pc
+){
+    size_t header_size = sizeof(service_response_header);
+    while (pc->num_output > 0){
+        service_output *po = &pc->poutput[0];
+        const double *pvalues = (po->entry.pmap != NULL) ? po->entry.pvalues : po->pvalues;
+        size_t total = header_size+po->num_values*sizeof(double);
+        const char *p;
+        if (pc->output_bytes < header_size){
+            p = (const char*) &po->header+pc->output_bytes;
+        }
+        else {
+            p = (const char*) pvalues+(pc->output_bytes-header_size);
+        }
+        size_t remaining = (pc->output_bytes < header_size) ? header_size-pc->output_bytes : total-pc->output_bytes;
+        ssize_t count = write(pc->fd,p,remaining);
+        if (count < 0 && errno == EINTR){
+            continue;
+        }
+        if (count < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)){
+            return 0;
+        }
+        if (count <= 0){
+            return -1;
+        }
+        pc->output_bytes += count;
+        if (pc->output_bytes == total){
+            release_output(po);
+            memmove(&pc->poutput[0],&pc->poutput[1],(pc->num_output-1)*sizeof(service_output));
+            pc->num_output--;
+            pc->output_bytes = 0;
+        }
+    }
+    return 0;
+}
+
+// Frees the partial request and the unwritten responses of a connection and closes it
+static void close_connection(
+    service_connection *pc
+){
+    int k;
+    for (k=0;k<pc->num_output;k++){
+        release_output(&pc->poutput[k]);
+    }
+    free(pc->poutput);
+    free(pc->pu);
+    close(pc->fd);
+    memset(pc,0,sizeof(service_connection));
+    pc->fd = -1;
+}
+
+static void free_job(
+    service_job *pjob
+){
+    free(pjob->pX);
+    free(pjob->pt);
+    free(pjob->pu);
+    cache_key_free(&pjob->key);
+}
+
+// Key of all inputs of the simulation of a request
+static int job_key(
+    service_job *pjob,
+    CSTR_parameters *pP
+){
+    service_request_header *prequest = &pjob->header;
+    int max_iterations = SERVICE_MAX_ITERATIONS;
+    double tolerance = SERVICE_TOLERANCE;
+    if (cache_key_begin(&pjob->key) != 0
+        || cache_key_add(&pjob->key,&prequest->mode,sizeof(prequest->mode)) != 0
+        || cache_key_add(&pjob->key,&prequest->num_realizations,sizeof(prequest->num_realizations)) != 0
+        || cache_key_add(&pjob->key,&prequest->num_samples,sizeof(prequest->num_samples)) != 0
+        || cache_key_add(&pjob->key,&prequest->time_steps_per_sample,sizeof(prequest->time_steps_per_sample)) != 0
+        || cache_key_add(&pjob->key,&prequest->sample_time,sizeof(prequest->sample_time)) != 0
+        || cache_key_add(&pjob->key,prequest->px0,sizeof(prequest->px0)) != 0
+        || cache_key_add(&pjob->key,&prequest->seed,sizeof(prequest->seed)) != 0
+        || cache_key_add(&pjob->key,&max_iterations,sizeof(max_iterations)) != 0
+        || cache_key_add(&pjob->key,&tolerance,sizeof(tolerance)) != 0
+        || cache_key_add_parameters(&pjob->key,pP) != 0
+        || cache_key_add(&pjob->key,pjob->pu,prequest->num_samples*sizeof(double)) != 0){
+        return -1;
+    }
+    cache_key_finish(&pjob->key);
+    return 0;
+}
+
+static void record_latency(
+    service_latencies *pl,
+    double queue_seconds,
+    double service_seconds
+){
+    if (pl->count == pl->capacity){
+        int capacity = (pl->capacity > 0) ? 2*pl->capacity : 1024;
+        double *pqueue = (double*) realloc(pl->pqueue,capacity*sizeof(double));
+        if (pqueue != NULL){
+            pl->pqueue = pqueue;
+        }
+        double *pservice = (double*) realloc(pl->pservice,capacity*sizeof(double));
+        if (pservice != NULL){
+            pl->pservice = pservice;
+        }
+        if (pqueue == NULL || pservice == NULL){
+            return;
+        }
+        pl->capacity = capacity;
+    }
+    pl->pqueue[pl->count] = queue_seconds;
+    pl->pservice[pl->count] = service_seconds;
+    pl->count++;
+}
+
+static int compare_doubles(
+    const void *pa,
+    const void *pb
+){
+    double a = *(const double*) pa;
+    double b = *(const double*) pb;
+    return (a > b)-(a < b);
+}
+
+static void print_percentiles(
+    const char *pname,
+    double *pvalues,
+    int count
+){
+    qsort(pvalues,count,sizeof(double),compare_doubles);
+    printf("%-8s p50 %10.3f ms, p90 %10.3f ms, p99 %10.3f ms, max %10.3f ms\n",pname,1e3*pvalues[count/2],
+        1e3*pvalues[(int) (0.9*(count-1))],1e3*pvalues[(int) (0.99*(count-1))],1e3*pvalues[count-1]);
+}
+
+// Sets an error response
+static void reject(
+    service_response_header *presponse
+){
+    memset(presponse,0,sizeof(service_response_header));
+    presponse->magic = SERVICE_RESPONSE_MAGIC;
+    presponse->status = -1;
+}
+
+// Simulates all realizations of a batch together and sets the responses of the jobs
+static void run_batch(
+    service_job *pjobs,
+    int num_jobs,
+    int num_threads,
+    double **ppdW,
+    long *pdW_capacity,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    unsigned long *pgenerators,
+    CSTR_parameters *pP,
+    result_cache *pcache,
+    service_latencies *platencies
+){
+    int n = 3;
+    int j, t;
+    long total = 0;
+    long *pfirst = (long*) malloc((num_jobs+1)*sizeof(long));
+    for (j=0;j<num_jobs;j++){
+        reject(&pjobs[j].response);
+    }
+    if (pfirst == NULL){
+        return;
+    }
+
+    // Noise buffers of the threads for the longest horizon of the batch
+    long size_dW = 0;
+    for (j=0;j<num_jobs;j++){
+        pfirst[j] = total;
+        total += pjobs[j].header.num_realizations;
+        size_dW = (size_dW > (long) n*pjobs[j].N+1) ? size_dW : (long) n*pjobs[j].N+1;
+    }
+    pfirst[num_jobs] = total;
+    for (t=0;t<num_threads;t++){
+        if (pdW_capacity[t] < size_dW){
+            double *pdW = (double*) realloc(ppdW[t],size_dW*sizeof(double));
+            if (pdW == NULL){
+                free(pfirst);
+                return;
+            }
+            ppdW[t] = pdW;
+            pdW_capacity[t] = size_dW;
+        }
+    }
+
+    double start = omp_get_wtime();
+    long k;
+    #pragma omp parallel for num_threads(num_threads) schedule(dynamic,1)
+    for (k=0;k<total;k++){
+        int thread_index = omp_get_thread_num();
+        int job = 0;
+        while (pfirst[job+1] <= k){
+            job++;
+        }
+        service_job *pjob = &pjobs[job];
+        service_request_header *prequest = &pjob->header;
+        long i = k-pfirst[job];
+        int N = pjob->N;
+        double *px = &pjob->pX[3L*(N+1)*i];
+        double sqrtdt = sqrt(pjob->pt[1]-pjob->pt[0]);
+        d_rand_normal_seeded(ppdW[thread_index],&pgenerators[624*thread_index],n*N+((n*N)&1),
+            mersenne_stream_seed(prequest->seed,(unsigned long) i),0,sqrtdt);
+        memcpy(px,prequest->px0,n*sizeof(double));
+        implicit_simulation(pjob->pt,px,ppdW[thread_index],&pworkspace_lf[n*(5+2*n)*thread_index],
+            &pworkspace_d[n*thread_index],SERVICE_MAX_ITERATIONS,SERVICE_TOLERANCE,CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,
+            pjob->pu,NULL,pP,1,prequest->num_samples,prequest->time_steps_per_sample,N,n,0,0,0);
+    }
+
+    // Responses in the order of arrival
+    for (j=0;j<num_jobs;j++){
+        service_job *pjob = &pjobs[j];
+        service_request_header *prequest = &pjob->header;
+        long size_x = 3L*(pjob->N+1);
+        long num_values = response_values(prequest,pjob->N);
+        if (prequest->mode == SERVICE_STATISTICS){
+            // Welford updates in the order of the realizations, the statistics overwrite the first trajectories
+            double *pmean = (double*) calloc(2*size_x,sizeof(double));
+            double *pM2 = (pmean != NULL) ? &pmean[size_x] : NULL;
+            long i, l;
+            if (pmean == NULL){
+                continue;
+            }
+            for (i=0;i<prequest->num_realizations;i++){
+                double *px = &pjob->pX[size_x*i];
+                for (l=0;l<size_x;l++){
+                    double delta = px[l]-pmean[l];
+                    pmean[l] += delta/(i+1);
+                    pM2[l] += delta*(px[l]-pmean[l]);
+                }
+            }
+            for (l=0;l<size_x;l++){
+                pM2[l] = (prequest->num_realizations > 1) ? sqrt(pM2[l]/(prequest->num_realizations-1)) : 0;
+            }
+            free(pjob->pX);
+            pjob->pX = pmean;
+        }
+        service_response_header *presponse = &pjob->response;
+        presponse->status = 0;
+        presponse->num_values = (int) num_values;
+        presponse->N = pjob->N;
+        presponse->batch_requests = num_jobs;
+        presponse->batch_realizations = (int) total;
+        presponse->queue_seconds = start-pjob->arrival;
+        presponse->service_seconds = omp_get_wtime()-start;
+        record_latency(platencies,presponse->queue_seconds,presponse->service_seconds);
+        if (pcache != NULL && pjob->key.size > 0){
+            cache_store(pcache,&pjob->key,pjob->pX,num_values);
+        }
+    }
+    free(pfirst);
+}
+
+int service_run(
+    const char *path,
+    double window_seconds,
+    int max_batch_realizations,
+    int num_threads,
+    const char *cache_directory,
+    long cache_bytes
+){
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)){
+        return -1;
+    }
+    int listen_fd = socket(AF_UNIX,SOCK_STREAM,0);
+    if (listen_fd < 0){
+        return -1;
+    }
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path,path);
+    unlink(path);
+    if (bind(listen_fd,(struct sockaddr*) &address,sizeof(address)) != 0 || listen(listen_fd,SERVICE_MAX_CLIENTS) != 0){
+        close(listen_fd);
+        return -1;
+    }
+
+    // poll() is interrupted by the signals, such that the server stops after the batch in progress
+    struct sigaction action;
+    memset(&action,0,sizeof(action));
+    action.sa_handler = service_signal;
+    sigaction(SIGINT,&action,NULL);
+    sigaction(SIGTERM,&action,NULL);
+    signal(SIGPIPE,SIG_IGN);
+    service_stop = 0;
+
+    // Buffers which are kept between batches
+    int n = 3;
+    num_threads = (num_threads > 0) ? num_threads : omp_get_max_threads();
+    double **ppdW = (double**) calloc(num_threads,sizeof(double*));
+    long *pdW_capacity = (long*) calloc(num_threads,sizeof(long));
+    double *pworkspace_lf = (double*) malloc(num_threads*n*(5+2*n)*sizeof(double));
+    int *pworkspace_d = (int*) malloc(num_threads*n*sizeof(int));
+    unsigned long *pgenerators = (unsigned long*) malloc(num_threads*624*sizeof(unsigned long));
+    struct pollfd *pfds = (struct pollfd*) malloc((SERVICE_MAX_CLIENTS+1)*sizeof(struct pollfd));
+    service_connection *pconnections = (service_connection*) calloc(SERVICE_MAX_CLIENTS+1,sizeof(service_connection));
+    int job_capacity = 64;
+    service_job *pjobs = (service_job*) malloc(job_capacity*sizeof(service_job));
+    service_latencies latencies = {0, 0, NULL, NULL};
+    CSTR_parameters params = default_parameters();
+    result_cache *pcache = (cache_directory != NULL) ? cache_open(cache_directory,cache_bytes) : NULL;
+    if ((cache_directory != NULL && pcache == NULL) || ppdW == NULL || pdW_capacity == NULL || pworkspace_lf == NULL || pworkspace_d == NULL || pgenerators == NULL
+        || pfds == NULL || pconnections == NULL || pjobs == NULL){
+        cache_close(pcache);
+        free(pjobs);
+        free(pconnections);
+        free(pfds);
+        free(pgenerators);
+        free(pworkspace_d);
+        free(pworkspace_lf);
+        free(pdW_capacity);
+        free(ppdW);
+        close(listen_fd);
+        unlink(path);
+        return -1;
+    }
+    pfds[0].fd = listen_fd;
+    int num_fds = 1;
+    int num_jobs = 0;
+    long pending_realizations = 0;
+    int num_batches = 0;
+    int num_hits = 0;
+    double drain_end = 0;
+    int i, j;
+
+    printf("Listening on %s with %d threads\n",path,num_threads);
+    fflush(stdout);
+    while (1){
+        // After a stop, the responses which are still pending are written for a limited time
+        int num_pending = 0;
+        for (i=1;i<num_fds;i++){
+            num_pending += (pconnections[i].num_output > 0);
+        }
+        double now = omp_get_wtime();
+        if (service_stop && num_jobs == 0){
+            drain_end = (drain_end > 0) ? drain_end : now+SERVICE_DRAIN_SECONDS;
+            if (num_pending == 0 || now >= drain_end){
+                break;
+            }
+        }
+
+        // The listener is not polled at capacity, a connection with pending responses is only polled for writing
+        pfds[0].events = (!service_stop && num_fds <= SERVICE_MAX_CLIENTS) ? POLLIN : 0;
+        for (i=1;i<num_fds;i++){
+            pfds[i].events = (pconnections[i].num_output > 0) ? POLLOUT : (service_stop ? 0 : POLLIN);
+            pfds[i].revents = 0;
+        }
+        int timeout = -1;
+        if (num_jobs > 0){
+            double remaining = pjobs[0].arrival+window_seconds-now;
+            timeout = (remaining > 0) ? (int) ceil(1e3*remaining) : 0;
+        }
+        if (service_stop){
+            timeout = (num_jobs > 0) ? 0 : (int) ceil(1e3*(drain_end-now));
+        }
+        int ready = poll(pfds,num_fds,timeout);
+        if (ready < 0 && errno != EINTR){
+            break;
+        }
+        if (ready > 0){
+            // New connections
+            if (pfds[0].revents & POLLIN){
+                int fd = accept4(listen_fd,NULL,NULL,SOCK_NONBLOCK);
+                if (fd >= 0){
+                    memset(&pconnections[num_fds],0,sizeof(service_connection));
+                    pconnections[num_fds].fd = fd;
+                    pfds[num_fds].fd = fd;
+                    pfds[num_fds].events = 0;
+                    pfds[num_fds].revents = 0;
+                    num_fds++;
+                }
+            }
+
+            // Requests and responses, a closed connection is removed and its pending requests are not answered
+            for (i=1;i<num_fds;i++){
+                service_connection *pc = &pconnections[i];
+                int status = 0;
+                if (pfds[i].revents & POLLOUT){
+                    status = write_partial(pc);
+                }
+                else if ((pfds[i].revents & (POLLHUP | POLLERR)) && !(pfds[i].revents & POLLIN)){
+                    status = -1;
+                }
+                while (status == 0 && (pfds[i].revents & POLLIN) && pc->num_output == 0){
+                    status = read_partial(pc);
+                    if (status != 1){
+                        break;
+                    }
+                    if (num_jobs == job_capacity){
+                        service_job *pnew = (service_job*) realloc(pjobs,2*job_capacity*sizeof(service_job));
+                        if (pnew == NULL){
+                            status = -1;
+                            break;
+                        }
+                        pjobs = pnew;
+                        job_capacity *= 2;
+                    }
+                    service_job *pjob = &pjobs[num_jobs];
+                    service_response_header response;
+                    status = 0;
+                    if (!take_request(pc,pjob)){
+                        free_job(pjob);
+                        reject(&response);
+                        status = queue_response(pc,&response,NULL,NULL,0);
+                        continue;
+                    }
+                    if (pcache != NULL && job_key(pjob,&params) == 0){
+                        // A hit is answered at once from the mapped entry, which is unmapped once it is written
+                        cache_entry entry;
+                        double arrival = omp_get_wtime();
+                        if (cache_lookup(pcache,&pjob->key,&entry)
+                            && entry.num_values == response_values(&pjob->header,pjob->N)){
+                            reject(&response);
+                            response.status = 0;
+                            response.num_values = (int) entry.num_values;
+                            response.N = pjob->N;
+                            response.cached = 1;
+                            response.service_seconds = omp_get_wtime()-arrival;
+                            record_latency(&latencies,0,response.service_seconds);
+                            num_hits++;
+                            free_job(pjob);
+                            status = queue_response(pc,&response,NULL,&entry,response.num_values);
+                            continue;
+                        }
+                        cache_release(&entry);
+                    }
+
+                    // A request which does not fit the memory budget is answered at once with status -2
+                    long bytes = pending_bytes(pjobs,num_jobs,pconnections,num_fds)+job_bytes(pjob);
+                    if (bytes > SERVICE_MAX_PENDING_BYTES || allocate_job(pjob) != 0){
+                        free_job(pjob);
+                        reject(&response);
+                        response.status = -2;
+                        status = queue_response(pc,&response,NULL,NULL,0);
+                        continue;
+                    }
+                    pjob->arrival = omp_get_wtime();
+                    pending_realizations += pjob->header.num_realizations;
+                    num_jobs++;
+                }
+                if (status >= 0){
+                    continue;
+                }
+                // The jobs of the closed connection are dropped instead of simulated
+                int kept = 0;
+                for (j=0;j<num_jobs;j++){
+                    if (pjobs[j].fd == pc->fd){
+                        pending_realizations -= pjobs[j].header.num_realizations;
+                        free_job(&pjobs[j]);
+                    }
+                    else {
+                        pjobs[kept++] = pjobs[j];
+                    }
+                }
+                num_jobs = kept;
+                close_connection(pc);
+                pfds[i] = pfds[num_fds-1];
+                pconnections[i] = pconnections[num_fds-1];
+                num_fds--;
+                i--;
+            }
+        }
+
+        // A batch is started when the window of its first request has passed or it is large enough
+        now = omp_get_wtime();
+        if (num_jobs > 0 && (service_stop || now >= pjobs[0].arrival+window_seconds
+            || pending_realizations >= max_batch_realizations)){
+            run_batch(pjobs,num_jobs,num_threads,ppdW,pdW_capacity,pworkspace_lf,pworkspace_d,pgenerators,&params,
+                pcache,&latencies);
+            num_batches++;
+            printf("Batch %d: %d requests with %ld realizations\n",num_batches,num_jobs,pending_realizations);
+            fflush(stdout);
+
+            // The responses are handed to their connections, which write what the sockets accept at once
+            for (j=0;j<num_jobs;j++){
+                service_job *pjob = &pjobs[j];
+                for (i=1;i<num_fds && pconnections[i].fd != pjob->fd;i++);
+                if (pjob->fd >= 0 && i < num_fds){
+                    double *pvalues = (pjob->response.status == 0) ? pjob->pX : NULL;
+                    if (pvalues != NULL){
+                        pjob->pX = NULL;
+                    }
+                    if (queue_response(&pconnections[i],&pjob->response,pvalues,NULL,pjob->response.num_values) != 0
+                        || write_partial(&pconnections[i]) != 0){
+                        shutdown(pconnections[i].fd,SHUT_RDWR);
+                    }
+                }
+                free_job(pjob);
+            }
+            num_jobs = 0;
+            pending_realizations = 0;
+        }
+    }
+
+    // Latencies of all requests
+    printf("Served %d requests in %d batches",latencies.count,num_batches);
+    if (pcache != NULL){
+        printf(" and %d from the cache",num_hits);
+    }
+    printf("\n");
+    if (latencies.count > 0){
+        print_percentiles("queue",latencies.pqueue,latencies.count);
+        print_percentiles("service",latencies.pservice,latencies.count);
+    }
+
+    for (i=1;i<num_fds;i++){
+        close_connection(&pconnections[i]);
+    }
+    free(pconnections);
+    close(listen_fd);
+    unlink(path);
+    cache_close(pcache);
+    for (i=0;i<num_threads;i++){
+        free(ppdW[i]);
+    }
+    free(latencies.pservice);
+    free(latencies.pqueue);
+    free(pjobs);
+    free(pfds);
+    free(pgenerators);
+    free(pworkspace_d);
+    free(pworkspace_lf);
+    free(pdW_capacity);
+    free(ppdW);
+    return 0;
+}
+
+int service_connect(
+    const char *path
+){
+    struct sockaddr_un address;
+    if (strlen(path) >= sizeof(address.sun_path)){
+        return -1;
+    }
+    int fd = socket(AF_UNIX,SOCK_STREAM,0);
+    if (fd < 0){
+        return -1;
+    }
+    memset(&address,0,sizeof(address));
+    address.sun_family = AF_UNIX;
+    strcpy(address.sun_path,path);
+    if (connect(fd,(struct sockaddr*) &address,sizeof(address)) != 0){
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int service_request(
+    int fd,
+    service_request_header *prequest,
+    double *pu,
+    service_response_header *presponse,
+    double **ppvalues
+){
+    *ppvalues = NULL;
+    prequest->magic = SERVICE_REQUEST_MAGIC;
+    prequest->reserved = 0;
+    if (write_full(fd,prequest,sizeof(service_request_header)) != 0
+        || write_full(fd,pu,prequest->num_samples*sizeof(double)) != 0
+        || read_full(fd,presponse,sizeof(service_response_header)) != 0
+        || presponse->magic != SERVICE_RESPONSE_MAGIC){
+        return -1;
+    }
+    if (presponse->status != 0 || presponse->num_values <= 0){
+        return 0;
+    }
+    *ppvalues = (double*) malloc(presponse->num_values*sizeof(double));
+    if (*ppvalues == NULL || read_full(fd,*ppvalues,presponse->num_values*sizeof(double)) != 0){
+        free(*ppvalues);
+        *ppvalues = NULL;
+        return -1;
+    }
+    return 0;
+}
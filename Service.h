@@ -0,0 +1,134 @@
+/// @file Service.h
+
+#ifndef CSTR_SERVICE
+#define CSTR_SERVICE
+
+/**
+ * Local simulation service on a Unix domain socket, such that several tools can share one long-running process
+ * instead of starting project for every simulation. A client connects, writes a service_request_header followed by
+ * the flow rate in every sample in [mL / min], and reads a service_response_header followed by the result. A
+ * connection may carry any number of requests, one after the other. All values are in the native byte order, since
+ * the socket is local.
+ *
+ * The server coalesces the requests which arrive within a batching window into one parallel ensemble: the
+ * realizations of all requests are distributed over the threads together, so many small requests use all threads.
+ * Realization \f$i\f$ of a request draws its noise from mersenne_stream_seed(seed, i) with the seed of the request,
+ * so the result of a request does not depend on the other requests of its batch or on the number of threads.
+ *
+ * The response reports the time the request waited for its batch to start and the time from the start of the batch
+ * until the response was ready. The server also keeps these latencies of all requests and prints their
+ * percentiles when it stops.
+ *
+ * With a cache directory, the result of every request is stored in a result_cache under all inputs of its
+ * simulation, and a request which has been answered before is answered from the cache at once, without waiting for
+ * a batch.
+ *
+ * The server runs on one thread outside of the batches, so the client sockets are non-blocking: every connection
+ * keeps its partial request and the responses which its socket has not taken yet, and a client which sends or reads
+ * slowly does not hold up the others. A connection with pending responses is not read until they are written. At
+ * 256 connections, no more connections are accepted until one is closed. The requests waiting for their batch and
+ * the responses which have not been written may hold at most 4 GiB together; a request beyond that is answered with
+ * status -2 at once and may be sent again later. The requests of a connection which is closed before their batch
+ * starts are dropped.
+ *
+ * @date 19th of October 2026
+ */
+
+#define SERVICE_REQUEST_MAGIC 0x51525343u   // "CSRQ"
+#define SERVICE_RESPONSE_MAGIC 0x50525343u  // "CSRP"
+
+typedef enum service_mode{
+    SERVICE_STATISTICS,         // The mean and the standard deviation of every state at every time step
+    SERVICE_TRAJECTORIES        // The trajectories of all realizations
+} service_mode;
+
+typedef struct service_request_header{
+    unsigned int magic;         // SERVICE_REQUEST_MAGIC
+    int mode;                   // service_mode
+    int num_realizations;       // Number of realizations
+    int num_samples;            // Number of samples, the number of flow rates following the header
+    int time_steps_per_sample;  // Implicit Euler steps per sample
+    int reserved;               // Must be 0
+    double sample_time;         // Sample time in seconds
+    double px0[3];              // Initial state
+    unsigned long seed;         // Base seed of the noise
+} service_request_header;
+
+typedef struct service_response_header{
+    unsigned int magic;         // SERVICE_RESPONSE_MAGIC
+    int status;                 // 0 on success, -1 for an invalid request and -2 if the server is out of memory for it,
+                                // in which case no data follows
+    int num_values;             // Number of doubles following the header
+    int N;                      // Number of time steps
+    int batch_requests;         // Number of requests in the batch
+    int batch_realizations;     // Number of realizations in the batch
+    int cached;                 // 1 if the result was read from the cache of the server, without a batch
+    int reserved;               // 0
+    double queue_seconds;       // Time from the arrival of the request to the start of its batch
+    double service_seconds;     // Time from the start of the batch to the response
+} service_response_header;
+
+/**
+ * Runs the server until SIGINT or SIGTERM. The batch in progress is finished and the pending responses are written
+ * for at most 5 seconds. The socket file is created at path and removed on return.
+ *
+ * @param[in] path: Path of the socket.
+ * @param[in] window_seconds: Time to wait for more requests after the first request of a batch.
+ * @param[in] max_batch_realizations: A batch is started as soon as it has this many realizations.
+ * @param[in] num_threads: Number of threads, or 0 for omp_get_max_threads().
+ * @param[in] cache_directory: Directory of the result cache, or NULL for no cache.
+ * @param[in] cache_bytes: Largest size of the cache in bytes.
+ *
+ * @return 0 after a clean shutdown and -1 if the socket or the cache could not be opened.
+ *
+ * @date 19th of October 2026
+ */
+
+int service_run(
+    const char *path,
+    double window_seconds,
+    int max_batch_realizations,
+    int num_threads,
+    const char *cache_directory,
+    long cache_bytes
+);
+
+/**
+ * Connects to a server.
+ *
+ * @param[in] path: Path of the socket.
+ *
+ * @return The file descriptor of the connection or -1.
+ *
+ * @date 19th of October 2026
+ */
+
+int service_connect(
+    const char *path
+);
+
+/**
+ * Sends a request on a connection and waits for the response.
+ *
+ * @param[in] fd: The connection of service_connect().
+ * @param[in] prequest: The request. The magic number is set by the function.
+ * @param[in] pu: Flow rate in every sample in [mL / min].
+ * @param[out] presponse: The header of the response.
+ * @param[out] ppvalues: Set to an array with the num_values values of the response, allocated with malloc(), or NULL.
+ * For SERVICE_STATISTICS it holds the means followed by the standard deviations, each stored as a trajectory of
+ * \f$3(N+1)\f$ values. For SERVICE_TRAJECTORIES it holds the trajectories one after the other.
+ *
+ * @return 0 if a response was received and -1 if the connection failed.
+ *
+ * @date 19th of October 2026
+ */
+
+int service_request(
+    int fd,
+    service_request_header *prequest,
+    double *pu,
+    service_response_header *presponse,
+    double **ppvalues
+);
+
+#endif
@@ -0,0 +1,489 @@
+/// @file SteadyState.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "SteadyState.h"
+#include "ImplicitEulerSolver.h"
+#include "CSTR.h"
+
+// Scaling of the temperature and the flow rate in the continuation
+#define SS_T_SCALE 100.0
+#define SS_F_SCALE 100.0
+
+// Conversion from [mL / min] to [L / s]
+#define SS_F_UNIT (60.0*1000.0)
+
+// Points of the closed form curve which are scanned for the temperature range
+#define SS_SCAN_POINTS 10000
+
+// Points traced by one segment
+typedef struct segment{
+    int num_points;
+    int capacity;
+    int num_newton_iterations;
+    double *py;                 // Scaled points, 4 per point
+    double *ptangent_F;         // F component of the tangent, 1 per point
+} segment;
+
+static int segment_append(
+    segment *pseg,
+    double *py,
+    double tangent_F
+){
+    if (pseg->num_points == pseg->capacity){
+        int capacity = pseg->capacity == 0 ? 64 : 2*pseg->capacity;
+        double *py_new = (double*) realloc(pseg->py,4*capacity*sizeof(double));
+        if (py_new == NULL){
+            return -1;
+        }
+        pseg->py = py_new;
+        double *pt_new = (double*) realloc(pseg->ptangent_F,capacity*sizeof(double));
+        if (pt_new == NULL){
+            return -1;
+        }
+        pseg->ptangent_F = pt_new;
+        pseg->capacity = capacity;
+    }
+    memcpy(&pseg->py[4*pseg->num_points],py,4*sizeof(double));
+    pseg->ptangent_F[pseg->num_points] = tangent_F;
+    pseg->num_points++;
+    return 0;
+}
+
+// Drift and its Jacobian with respect to the scaled variables. The Jacobian fills the first
+// three rows of the column major 4 x 4 matrix pA and the derivative with respect to F is
+// the first column of CSTR_3D_drift_parameter_jacobian().
+static void scaled_drift(
+    CSTR_parameters *pP,
+    double *py,
+    double *pf,
+    double *pA
+){
+    double t = 0;
+    double x[3] = {py[0], py[1], py[2]*SS_T_SCALE};
+    double u = py[3]*SS_F_SCALE/SS_F_UNIT;
+    double J[9], pF[3];
+    CSTR_parameters params = *pP;
+    params.num_sensitivity_parameters = 0;
+    CSTR_3D_drift(&t,x,&u,NULL,&params,pf);
+    if (pA == NULL){
+        return;
+    }
+    CSTR_3D_drift_jacobian(&t,x,&u,NULL,&params,J);
+    CSTR_3D_drift_parameter_jacobian(&t,x,&u,NULL,&params,pF);
+    int r;
+    for (r=0;r<3;r++){
+        pA[r] = J[r];
+        pA[r+4] = J[r+3];
+        pA[r+8] = J[r+6]*SS_T_SCALE;
+        pA[r+12] = pF[r]*SS_F_SCALE/SS_F_UNIT;
+    }
+}
+
+// Normalized tangent at py oriented along the previous tangent pt_previous
+static int tangent(
+    CSTR_parameters *pP,
+    double *py,
+    double *pt_previous,
+    double *pt
+){
+    double f[3], A[16];
+    int pivots[4];
+    int N_lapack = 4;
+    int NRHS = 1;
+    int INFO;
+    int c;
+    scaled_drift(pP,py,f,A);
+    for (c=0;c<4;c++){
+        A[3+4*c] = pt_previous[c];
+        pt[c] = 0;
+    }
+    pt[3] = 1;
+    dgesv_(&N_lapack,&NRHS,A,&N_lapack,pivots,pt,&N_lapack,&INFO);
+    if (INFO != 0){
+        return -1;
+    }
+    double norm = sqrt(pt[0]*pt[0]+pt[1]*pt[1]+pt[2]*pt[2]+pt[3]*pt[3]);
+    for (c=0;c<4;c++){
+        pt[c] /= norm;
+    }
+    return 0;
+}
+
+// Pseudo-arclength corrector. Solves f(y) = 0 and t'(y - y_previous) = ds from the predictor in py.
+static int corrector(
+    CSTR_parameters *pP,
+    double *py,
+    double *py_previous,
+    double *pt,
+    double ds,
+    int max_iterations,
+    double tolerance
+){
+    double A[16], rhs[4];
+    int pivots[4];
+    int N_lapack = 4;
+    int NRHS = 1;
+    int INFO;
+    int iteration, c;
+    double step;
+    for (iteration=1;iteration<=max_iterations;iteration++){
+        scaled_drift(pP,py,rhs,A);
+        rhs[3] = ds;
+        for (c=0;c<4;c++){
+            A[3+4*c] = pt[c];
+            rhs[3] -= pt[c]*(py[c]-py_previous[c]);
+        }
+        for (c=0;c<3;c++){
+            rhs[c] = -rhs[c];
+        }
+        dgesv_(&N_lapack,&NRHS,A,&N_lapack,pivots,rhs,&N_lapack,&INFO);
+        if (INFO != 0){
+            return -1;
+        }
+        step = 0;
+        for (c=0;c<4;c++){
+            py[c] += rhs[c];
+            step = fmax(step,fabs(rhs[c]));
+        }
+        if (!isfinite(step)){
+            return -1;
+        }
+        if (step < tolerance){
+            return iteration;
+        }
+    }
+    return -1;
+}
+
+// Exact steady state at the temperature T. Since the reactor is adiabatic,
+// the concentrations follow from the temperature rise and F from the balance of A.
+static double closed_form(
+    CSTR_parameters *pP,
+    double T,
+    double *py
+){
+    double conversion = (T-pP->Tin)/pP->beta;
+    double CA = pP->CAin-conversion;
+    double CB = pP->CBin-2*conversion;
+    double r = pP->k0*exp(-pP->EaR/T)*CA*CB;
+    double F = pP->V*r/conversion*SS_F_UNIT;
+    py[0] = CA;
+    py[1] = CB;
+    py[2] = T/SS_T_SCALE;
+    py[3] = F/SS_F_SCALE;
+    return F;
+}
+
+int steady_state_solve(
+    CSTR_parameters *pP,
+    double F,
+    double *px,
+    int max_iterations,
+    double tolerance
+){
+    double t = 0;
+    double u = F/SS_F_UNIT;
+    double f[3], J[9];
+    int pivots[3];
+    int N_lapack = 3;
+    int NRHS = 1;
+    int INFO;
+    int iteration, r;
+    double step;
+    CSTR_parameters params = *pP;
+    params.num_sensitivity_parameters = 0;
+    for (iteration=1;iteration<=max_iterations;iteration++){
+        CSTR_3D_drift(&t,px,&u,NULL,&params,f);
+        CSTR_3D_drift_jacobian(&t,px,&u,NULL,&params,J);
+        for (r=0;r<3;r++){
+            f[r] = -f[r];
+        }
+        dgesv_(&N_lapack,&NRHS,J,&N_lapack,pivots,f,&N_lapack,&INFO);
+        if (INFO != 0){
+            return -1;
+        }
+        step = fmax(fmax(fabs(f[0]),fabs(f[1])),fabs(f[2])/SS_T_SCALE);
+        for (r=0;r<3;r++){
+            px[r] += f[r];
+        }
+        if (!isfinite(step)){
+            return -1;
+        }
+        if (step < tolerance){
+            return iteration;
+        }
+    }
+    return -1;
+}
+
+int steady_state_stable(
+    CSTR_parameters *pP,
+    double F,
+    double *px
+){
+    double t = 0;
+    double u = F/SS_F_UNIT;
+    double J[9];
+    CSTR_parameters params = *pP;
+    params.num_sensitivity_parameters = 0;
+    CSTR_3D_drift_jacobian(&t,px,&u,NULL,&params,J);
+
+    // Characteristic polynomial s^3 + a2*s^2 + a1*s + a0, column major J
+    double a2 = -(J[0]+J[4]+J[8]);
+    double a1 = (J[0]*J[4]-J[3]*J[1])+(J[0]*J[8]-J[6]*J[2])+(J[4]*J[8]-J[7]*J[5]);
+    double determinant = J[0]*(J[4]*J[8]-J[7]*J[5])-J[3]*(J[1]*J[8]-J[7]*J[2])+J[6]*(J[1]*J[5]-J[4]*J[2]);
+    double a0 = -determinant;
+    return (a2 > 0 && a0 > 0 && a2*a1 > a0) ? 1 : 0;
+}
+
+// Locates the fold between the points pa and pb, where the F component of the tangent changes
+// sign, by bisection on the arclength from pa. Falls back to linear interpolation of the tangent.
+static void refine_fold(
+    CSTR_parameters *pP,
+    double *pa,
+    double *pb,
+    double tF_a,
+    double tF_b,
+    double *pfold,
+    int *pnum_newton_iterations
+){
+    double e_T[4] = {0, 0, 1, 0};
+    double t_a[4], t[4], y[4];
+    double s_low = 0;
+    double s_high = 0;
+    double s;
+    int i, c, iterations;
+    double theta = tF_a/(tF_a-tF_b);
+    for (c=0;c<4;c++){
+        pfold[c] = pa[c]+theta*(pb[c]-pa[c]);
+    }
+    if (tangent(pP,pa,e_T,t_a) != 0){
+        return;
+    }
+    for (c=0;c<4;c++){
+        s_high += t_a[c]*(pb[c]-pa[c]);
+    }
+    for (i=0;i<40;i++){
+        s = 0.5*(s_low+s_high);
+        for (c=0;c<4;c++){
+            y[c] = pa[c]+s*t_a[c];
+        }
+        iterations = corrector(pP,y,pa,t_a,s,20,1e-12);
+        if (iterations < 0 || tangent(pP,y,t_a,t) != 0){
+            return;
+        }
+        *pnum_newton_iterations += iterations;
+        if ((t[3] > 0) == (tF_a > 0)){
+            s_low = s;
+        }
+        else {
+            s_high = s;
+        }
+    }
+    for (c=0;c<4;c++){
+        pfold[c] = y[c];
+    }
+}
+
+// Traces the curve from the temperature T_start to T_end
+static void trace_segment(
+    CSTR_parameters *pP,
+    double T_start,
+    double T_end,
+    int include_end,
+    double max_step,
+    segment *pseg
+){
+    int max_iterations = 20;
+    double tolerance = 1e-10;
+    double y[4], y_new[4], t[4], t_new[4];
+    double e_T[4] = {0, 0, 1, 0};
+    double ds = 0.25*max_step;
+    int c, iterations;
+
+    // Exact starting point with the tangent oriented towards increasing temperature
+    closed_form(pP,T_start,y);
+    if (tangent(pP,y,e_T,t) != 0 || segment_append(pseg,y,t[3]) != 0){
+        return;
+    }
+    while (1){
+        for (c=0;c<4;c++){
+            y_new[c] = y[c]+ds*t[c];
+        }
+        iterations = corrector(pP,y_new,y,t,ds,max_iterations,tolerance);
+        pseg->num_newton_iterations += iterations > 0 ? iterations : max_iterations;
+        if (iterations < 0 || y_new[2] <= y[2]){
+            ds *= 0.5;
+            if (ds < 1e-8*max_step){
+                return;
+            }
+            continue;
+        }
+        if (y_new[2]*SS_T_SCALE >= T_end){
+            break;
+        }
+        if (tangent(pP,y_new,t,t_new) != 0 || segment_append(pseg,y_new,t_new[3]) != 0){
+            return;
+        }
+        for (c=0;c<4;c++){
+            y[c] = y_new[c];
+            t[c] = t_new[c];
+        }
+        if (iterations <= 3){
+            ds = fmin(1.5*ds,max_step);
+        }
+        else if (iterations > 6){
+            ds *= 0.5;
+        }
+    }
+
+    // The last segment ends at the exact end point
+    if (include_end){
+        closed_form(pP,T_end,y_new);
+        if (tangent(pP,y_new,t,t_new) == 0){
+            segment_append(pseg,y_new,t_new[3]);
+        }
+    }
+}
+
+steady_state_curve *steady_state_continuation(
+    CSTR_parameters *pP,
+    double F_min,
+    double F_max,
+    double max_step,
+    int num_segments
+){
+    if (num_segments < 1 || !(F_min > 0) || !(F_max > F_min) || !(max_step > 0)){
+        return NULL;
+    }
+
+    // Temperature range between complete conversion of the limiting reactant
+    // and no conversion, narrowed to the steady states with flow rates in the range
+    double T_adiabatic = pP->Tin+pP->beta*fmin(pP->CAin,0.5*pP->CBin);
+    double margin = 1e-6*(T_adiabatic-pP->Tin);
+    double T_low = HUGE_VAL;
+    double T_high = -HUGE_VAL;
+    double y[4], T, F;
+    int i, k;
+    for (i=0;i<=SS_SCAN_POINTS;i++){
+        T = pP->Tin+margin+(T_adiabatic-pP->Tin-2*margin)*i/SS_SCAN_POINTS;
+        F = closed_form(pP,T,y);
+        if (F >= F_min && F <= F_max){
+            T_low = fmin(T_low,T);
+            T_high = fmax(T_high,T);
+        }
+    }
+
+    steady_state_curve *pcurve = (steady_state_curve*) calloc(1,sizeof(steady_state_curve));
+    if (pcurve == NULL){
+        return NULL;
+    }
+    if (T_low >= T_high){
+        return pcurve;
+    }
+
+    // Tracing the segments in parallel
+    segment *psegments = (segment*) calloc(num_segments,sizeof(segment));
+    if (psegments == NULL){
+        free(pcurve);
+        return NULL;
+    }
+    int s;
+    #pragma omp parallel for schedule(dynamic,1)
+    for (s=0;s<num_segments;s++){
+        double T_start = T_low+(T_high-T_low)*s/num_segments;
+        double T_end = T_low+(T_high-T_low)*(s+1)/num_segments;
+        trace_segment(pP,T_start,T_end,s == num_segments-1,max_step,&psegments[s]);
+    }
+
+    // Merging the segments in order of temperature
+    int total = 0;
+    for (s=0;s<num_segments;s++){
+        total += psegments[s].num_points;
+        pcurve->num_newton_iterations += psegments[s].num_newton_iterations;
+    }
+    double *py_all = (double*) malloc((4*total+1)*sizeof(double));
+    double *pt_all = (double*) malloc((total+1)*sizeof(double));
+    pcurve->px = (double*) malloc((3*total+1)*sizeof(double));
+    pcurve->pF = (double*) malloc((total+1)*sizeof(double));
+    pcurve->ptangent_F = (double*) malloc((total+1)*sizeof(double));
+    pcurve->pstable = (int*) malloc((total+1)*sizeof(int));
+    pcurve->pfold_x = (double*) malloc((3*total+1)*sizeof(double));
+    pcurve->pfold_F = (double*) malloc((total+1)*sizeof(double));
+    if (py_all == NULL || pt_all == NULL || pcurve->px == NULL || pcurve->pF == NULL || pcurve->ptangent_F == NULL
+        || pcurve->pstable == NULL || pcurve->pfold_x == NULL || pcurve->pfold_F == NULL){
+        free(py_all);
+        free(pt_all);
+        steady_state_curve_destroy(pcurve);
+        pcurve = NULL;
+    }
+    else {
+        total = 0;
+        for (s=0;s<num_segments;s++){
+            memcpy(&py_all[4*total],psegments[s].py,4*psegments[s].num_points*sizeof(double));
+            memcpy(&pt_all[total],psegments[s].ptangent_F,psegments[s].num_points*sizeof(double));
+            total += psegments[s].num_points;
+        }
+
+        // Folds are detected on consecutive points before the points outside the range are removed
+        for (i=0;i+1<total;i++){
+            double tF_a = pt_all[i];
+            double tF_b = pt_all[i+1];
+            if ((tF_a > 0 && tF_b < 0) || (tF_a < 0 && tF_b > 0)){
+                double y_fold[4];
+                refine_fold(pP,&py_all[4*i],&py_all[4*(i+1)],tF_a,tF_b,y_fold,&pcurve->num_newton_iterations);
+                F = y_fold[3]*SS_F_SCALE;
+                if (F >= F_min && F <= F_max){
+                    double *pfold = &pcurve->pfold_x[3*pcurve->num_folds];
+                    pfold[0] = y_fold[0];
+                    pfold[1] = y_fold[1];
+                    pfold[2] = y_fold[2]*SS_T_SCALE;
+                    pcurve->pfold_F[pcurve->num_folds] = F;
+                    pcurve->num_folds++;
+                }
+            }
+        }
+        for (i=0;i<total;i++){
+            double *pyi = &py_all[4*i];
+            F = pyi[3]*SS_F_SCALE;
+            if (F < F_min || F > F_max){
+                continue;
+            }
+            k = pcurve->num_points;
+            pcurve->px[3*k] = pyi[0];
+            pcurve->px[3*k+1] = pyi[1];
+            pcurve->px[3*k+2] = pyi[2]*SS_T_SCALE;
+            pcurve->pF[k] = F;
+            pcurve->ptangent_F[k] = pt_all[i];
+            pcurve->pstable[k] = steady_state_stable(pP,F,&pcurve->px[3*k]);
+            pcurve->num_points++;
+        }
+        free(py_all);
+        free(pt_all);
+    }
+    for (s=0;s<num_segments;s++){
+        free(psegments[s].py);
+        free(psegments[s].ptangent_F);
+    }
+    free(psegments);
+    return pcurve;
+}
+
+void steady_state_curve_destroy(
+    steady_state_curve *pcurve
+){
+    if (pcurve == NULL){
+        return;
+    }
+    free(pcurve->pfold_F);
+    free(pcurve->pfold_x);
+    free(pcurve->pstable);
+    free(pcurve->ptangent_F);
+    free(pcurve->pF);
+    free(pcurve->px);
+    free(pcurve);
+}
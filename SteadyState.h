@@ -0,0 +1,113 @@
+/// @file SteadyState.h
+
+#ifndef CSTR_STEADY_STATE
+#define CSTR_STEADY_STATE
+
+#include "CSTR.h"
+
+/**
+ * Steady states of the adiabatic CSTR as a function of the flow rate. A steady state satisfies
+ * \f$f(x,F)=0\f$ where \f$f\f$ is CSTR_3D_drift(). Single steady states are computed with Newton's method and the
+ * whole S-curve is traced with pseudo-arclength continuation in the scaled variables
+ * \f$y=(C_A,\,C_B,\,T/100\,\text{K},\,F/100\,\text{mL/min})\f$, which passes the ignition and extinction folds where
+ * the curve turns back in \f$F\f$. A fold is detected when the \f$F\f$ component of the tangent changes sign and it
+ * is located by bisection on the arclength between the two neighbouring points.
+ *
+ * Since the reactor is adiabatic, every steady state satisfies \f$C_A=C_{A,in}-(T-T_{in})/\beta\f$ and
+ * \f$C_B=C_{B,in}-2(T-T_{in})/\beta\f$, so the curve is single valued in \f$T\f$ while it is multivalued in \f$F\f$.
+ * The curve is therefore split into segments of equal temperature range which are traced in parallel, each from an
+ * exact starting point. The flow rates are given in [mL / min].
+ *
+ * @date 19th of October 2026
+ */
+
+typedef struct steady_state_curve{
+    int num_points;             // Number of points on the curve
+    int num_folds;              // Number of detected folds
+    int num_newton_iterations;  // Total number of Newton iterations used to trace the curve
+    double *px;                 // Steady states, 3 per point, ordered by temperature
+    double *pF;                 // Flow rates [mL / min], num_points
+    double *ptangent_F;         // F component of the normalized tangent, num_points
+    int *pstable;               // 1 if the steady state is asymptotically stable, num_points
+    double *pfold_x;            // Steady states at the folds, 3 per fold
+    double *pfold_F;            // Flow rates at the folds [mL / min], num_folds
+} steady_state_curve;
+
+/**
+ * Computes a steady state with Newton's method from the initial guess px.
+ *
+ * @param[in] pP: Pointer to the model parameters.
+ * @param[in] F: Flow rate in [mL / min].
+ * @param[in,out] px: Initial guess on input and the steady state on output. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] max_iterations: Maximal number of Newton iterations.
+ * @param[in] tolerance: Tolerance on the infinity norm of the scaled Newton step.
+ *
+ * @return The number of iterations or -1 if the iterations did not converge.
+ *
+ * @date 19th of October 2026
+ */
+
+int steady_state_solve(
+    CSTR_parameters *pP,
+    double F,
+    double *px,
+    int max_iterations,
+    double tolerance
+);
+
+/**
+ * Determines whether a steady state is asymptotically stable with the Routh-Hurwitz criterion applied to the
+ * characteristic polynomial of CSTR_3D_drift_jacobian().
+ *
+ * @param[in] pP: Pointer to the model parameters.
+ * @param[in] F: Flow rate in [mL / min].
+ * @param[in] px: The steady state. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ *
+ * @return 1 if all eigenvalues of the Jacobian have negative real part and 0 otherwise.
+ *
+ * @date 19th of October 2026
+ */
+
+int steady_state_stable(
+    CSTR_parameters *pP,
+    double F,
+    double *px
+);
+
+/**
+ * Traces the steady states with flow rates between F_min and F_max with pseudo-arclength continuation. The
+ * temperature range of the curve is split into num_segments segments which are traced in parallel. The step
+ * length is adapted to the number of Newton iterations and is at most max_step in the scaled variables.
+ *
+ * @param[in] pP: Pointer to the model parameters.
+ * @param[in] F_min: Smallest flow rate in [mL / min].
+ * @param[in] F_max: Largest flow rate in [mL / min].
+ * @param[in] max_step: Largest arclength step.
+ * @param[in] num_segments: Number of segments.
+ *
+ * @return Pointer to the curve or NULL if the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+steady_state_curve *steady_state_continuation(
+    CSTR_parameters *pP,
+    double F_min,
+    double F_max,
+    double max_step,
+    int num_segments
+);
+
+/**
+ * Frees a curve.
+ *
+ * @param[in] pcurve: Pointer to the curve. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void steady_state_curve_destroy(
+    steady_state_curve *pcurve
+);
+
+#endif
@@ -0,0 +1,277 @@
+/// @file WeakExpectation.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "WeakExpectation.h"
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+#include "CSTR.h"
+
+typedef int (*weak_scheme)(int, int, int, double *, double *, double *, double *, int *, int, double, functiontype,
+    functiontype, functiontype, double *, double *, void *, double *);
+
+// Number of steps per sample of the simulation with the smallest step
+static int fine_steps(
+    int time_steps_per_sample,
+    int extrapolate
+){
+    return extrapolate ? 2*time_steps_per_sample : time_steps_per_sample;
+}
+
+// Size of the workspace of one thread: the increments of the fine and the coarse simulation of a whole path, one
+// more for box_muller(), the states of both at the sample times, the trajectory of a sample and the solver workspace
+static long thread_workspace_size(
+    int n,
+    int num_samples,
+    int time_steps_per_sample,
+    int extrapolate
+){
+    long steps = fine_steps(time_steps_per_sample,extrapolate);
+    long coarse = extrapolate ? (long) n*num_samples*time_steps_per_sample : 0;
+    return n*num_samples*steps + 1 + coarse + 2*n*(num_samples+1) + n*(steps+1) + n*(5+2*n);
+}
+
+weak_estimator *weak_create(
+    CSTR_parameters *pP,
+    double *pu,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    double *px0,
+    int num_paths,
+    int order,
+    weak_increments increments,
+    int extrapolate,
+    unsigned long seed
+){
+    if (num_samples < 1 || time_steps_per_sample < 1 || num_paths < 1 || (order != 1 && order != 2)
+        || !(sample_time > 0)){
+        return NULL;
+    }
+    weak_estimator *pe = (weak_estimator*) calloc(1,sizeof(weak_estimator));
+    if (pe == NULL){
+        return NULL;
+    }
+    int n = 3;
+    int i;
+    long size_sample = n*(num_samples+1);
+    pe->n = n;
+    pe->num_samples = num_samples;
+    pe->time_steps_per_sample = time_steps_per_sample;
+    pe->num_paths = num_paths;
+    pe->num_blocks = (num_paths+WEAK_BLOCK_SIZE-1)/WEAK_BLOCK_SIZE;
+    pe->order = order;
+    pe->extrapolate = extrapolate ? 1 : 0;
+    pe->increments = increments;
+    pe->num_threads = omp_get_max_threads();
+    pe->max_iterations = 20;
+    pe->tolerance = 10e-6;
+    pe->seed = seed;
+    pe->params = *pP;
+    pe->pt_coarse = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    pe->pt_fine = (double*) malloc((2*time_steps_per_sample+1)*sizeof(double));
+    pe->pu = (double*) malloc(num_samples*sizeof(double));
+    pe->pmean = (double*) malloc(size_sample*sizeof(double));
+    pe->pvariance = (double*) malloc(size_sample*sizeof(double));
+    pe->pstandard_error = (double*) malloc(size_sample*sizeof(double));
+    pe->pblock_sums = (double*) malloc(3*size_sample*pe->num_blocks*sizeof(double));
+    pe->pblock_failed = (int*) malloc(pe->num_blocks*sizeof(int));
+    pe->pworkspace_lf = (double*) malloc(pe->num_threads*thread_workspace_size(n,num_samples,time_steps_per_sample,
+        pe->extrapolate)*sizeof(double));
+    pe->pworkspace_d = (int*) malloc(pe->num_threads*n*sizeof(int));
+    pe->pgenerators = (unsigned long*) malloc(pe->num_threads*624*sizeof(unsigned long));
+    if (pe->pt_coarse == NULL || pe->pt_fine == NULL || pe->pu == NULL || pe->pmean == NULL || pe->pvariance == NULL
+        || pe->pstandard_error == NULL || pe->pblock_sums == NULL || pe->pblock_failed == NULL
+        || pe->pworkspace_lf == NULL || pe->pworkspace_d == NULL || pe->pgenerators == NULL){
+        weak_destroy(pe);
+        return NULL;
+    }
+    memcpy(pe->px0,px0,n*sizeof(double));
+    linspace(pe->pt_coarse,0,sample_time,time_steps_per_sample);
+    linspace(pe->pt_fine,0,sample_time,2*time_steps_per_sample);
+    for (i=0;i<num_samples;i++){
+        pe->pu[i] = pu[i]/(60*1000);
+    }
+    return pe;
+}
+
+// Draws count increments of standard deviation sigma for a path
+static void draw_increments(
+    weak_increments increments,
+    double *pdW,
+    unsigned long *pgenerator,
+    int count,
+    unsigned long seed,
+    double sigma
+){
+    switch (increments){
+        case WEAK_TWO_POINT:
+            d_rand_two_point_seeded(pdW,pgenerator,count,seed,sigma);
+            break;
+        case WEAK_THREE_POINT:
+            d_rand_three_point_seeded(pdW,pgenerator,count,seed,sigma);
+            break;
+        default:
+            d_rand_normal_seeded(pdW,pgenerator,count+(count&1),seed,0,sigma);
+            break;
+    }
+}
+
+// Simulates a path through all samples with the given steps per sample and increments, stores the state at every
+// sample time in px_samples and returns 1 if a Newton solve failed or a state is not finite
+static int simulate_path(
+    weak_estimator *pe,
+    weak_scheme scheme,
+    int steps,
+    double *pt,
+    double *pdW,
+    double *ptrajectory,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    double *px_samples
+){
+    int n = pe->n;
+    int s, k;
+    int failures = 0;
+    memcpy(px_samples,pe->px0,n*sizeof(double));
+    for (s=0;s<pe->num_samples;s++){
+        failures += scheme(steps,n,1,pt,ptrajectory,&pdW[(long) n*steps*s],pworkspace_lf,pworkspace_d,
+            pe->max_iterations,pe->tolerance,CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,&pe->pu[s],NULL,
+            &pe->params,&px_samples[n*s]);
+        memcpy(&px_samples[n*(s+1)],&ptrajectory[n*steps],n*sizeof(double));
+    }
+    for (k=0;k<n*(pe->num_samples+1);k++){
+        failures += !isfinite(px_samples[k]);
+    }
+    return failures > 0;
+}
+
+void weak_estimate(
+    weak_estimator *pe
+){
+    int n = pe->n;
+    int S = pe->num_samples;
+    int steps = pe->time_steps_per_sample;
+    int steps_fine = fine_steps(steps,pe->extrapolate);
+    long size_sample = n*(S+1);
+    long size_thread = thread_workspace_size(n,S,steps,pe->extrapolate);
+    long count_fine = (long) n*S*steps_fine;
+    long count_coarse = (long) n*S*steps;
+    weak_scheme scheme = (pe->order == 2) ? vector_implicit_trapezoidal : vector_implicit_euler;
+    double *pt_fine = pe->extrapolate ? pe->pt_fine : pe->pt_coarse;
+    double sigma = sqrt(pt_fine[1]-pt_fine[0]);
+
+    // Weights of the fine and the coarse simulation, which cancel the bias of order h^p
+    double power = (pe->order == 2) ? 4 : 2;
+    double weight_fine = pe->extrapolate ? power/(power-1) : 1;
+    double weight_coarse = pe->extrapolate ? -1/(power-1) : 0;
+    long simulated_steps = 0;
+    int b;
+
+    #pragma omp parallel for num_threads(pe->num_threads) schedule(dynamic,1) reduction(+:simulated_steps)
+    for (b=0;b<pe->num_blocks;b++){
+        int thread_index = omp_get_thread_num();
+        double *pworkspace = &pe->pworkspace_lf[size_thread*thread_index];
+        double *pdW_fine = pworkspace;
+        double *pdW_coarse = &pdW_fine[count_fine+1];
+        double *px_fine = &pdW_coarse[pe->extrapolate ? count_coarse : 0];
+        double *px_coarse = &px_fine[size_sample];
+        double *ptrajectory = &px_coarse[size_sample];
+        double *pworkspace_solver = &ptrajectory[n*(steps_fine+1)];
+        int *pworkspace_d = &pe->pworkspace_d[n*thread_index];
+        unsigned long *pgenerator = &pe->pgenerators[624*thread_index];
+        double *psum = &pe->pblock_sums[3*size_sample*b];
+        double *psum_square = &psum[size_sample];
+        double *psum_second = &psum[2*size_sample];
+        int *pfailed = &pe->pblock_failed[b];
+        int first = b*WEAK_BLOCK_SIZE;
+        int last = (first+WEAK_BLOCK_SIZE < pe->num_paths) ? first+WEAK_BLOCK_SIZE : pe->num_paths;
+        int path;
+        long l, k;
+        int failed;
+        memset(psum,0,3*size_sample*sizeof(double));
+        *pfailed = 0;
+        for (path=first;path<last;path++){
+            draw_increments(pe->increments,pdW_fine,pgenerator,count_fine,
+                mersenne_stream_seed(pe->seed,(unsigned long) path),sigma);
+            failed = simulate_path(pe,scheme,steps_fine,pt_fine,pdW_fine,ptrajectory,pworkspace_solver,pworkspace_d,
+                px_fine);
+            simulated_steps += (long) steps_fine*S;
+
+            // A coarse step takes the sum of the increments of the two fine steps
+            if (pe->extrapolate){
+                for (l=0;l<(long) S*steps;l++){
+                    for (k=0;k<n;k++){
+                        pdW_coarse[n*l+k] = pdW_fine[2*n*l+k]+pdW_fine[2*n*l+n+k];
+                    }
+                }
+                failed |= simulate_path(pe,scheme,steps,pe->pt_coarse,pdW_coarse,ptrajectory,pworkspace_solver,
+                    pworkspace_d,px_coarse);
+                simulated_steps += (long) steps*S;
+            }
+            else {
+                memcpy(px_coarse,px_fine,size_sample*sizeof(double));
+            }
+
+            // A failed path is left out of the moments
+            if (failed){
+                (*pfailed)++;
+                continue;
+            }
+            for (l=0;l<size_sample;l++){
+                double estimate = weight_fine*px_fine[l]+weight_coarse*px_coarse[l];
+                psum[l] += estimate;
+                psum_square[l] += estimate*estimate;
+                psum_second[l] += weight_fine*px_fine[l]*px_fine[l]+weight_coarse*px_coarse[l]*px_coarse[l];
+            }
+        }
+    }
+    pe->simulated_steps = simulated_steps;
+    pe->failed_paths = 0;
+    for (b=0;b<pe->num_blocks;b++){
+        pe->failed_paths += pe->pblock_failed[b];
+    }
+
+    // The blocks are added in order
+    long l;
+    double M = pe->num_paths-pe->failed_paths;
+    for (l=0;l<size_sample;l++){
+        double sum = 0;
+        double sum_square = 0;
+        double sum_second = 0;
+        for (b=0;b<pe->num_blocks;b++){
+            sum += pe->pblock_sums[3*size_sample*b+l];
+            sum_square += pe->pblock_sums[3*size_sample*b+size_sample+l];
+            sum_second += pe->pblock_sums[3*size_sample*b+2*size_sample+l];
+        }
+        double mean = sum/M;
+        double spread = (M > 1) ? (sum_square-M*mean*mean)/(M-1) : 0;
+        pe->pmean[l] = mean;
+        pe->pvariance[l] = sum_second/M-mean*mean;
+        pe->pstandard_error[l] = (spread < 0) ? 0 : sqrt(spread/M);
+    }
+}
+
+void weak_destroy(
+    weak_estimator *pe
+){
+    if (pe == NULL){
+        return;
+    }
+    free(pe->pgenerators);
+    free(pe->pworkspace_d);
+    free(pe->pworkspace_lf);
+    free(pe->pblock_failed);
+    free(pe->pblock_sums);
+    free(pe->pstandard_error);
+    free(pe->pvariance);
+    free(pe->pmean);
+    free(pe->pu);
+    free(pe->pt_fine);
+    free(pe->pt_coarse);
+    free(pe);
+}
@@ -0,0 +1,127 @@
+/// @file WeakExpectation.h
+
+#ifndef CSTR_WEAK_EXPECTATION
+#define CSTR_WEAK_EXPECTATION
+
+#include "CSTR.h"
+
+/**
+ * Monte Carlo estimate of the mean and the variance of the states of the CSTR at the sample times of an experiment
+ * with a given flow rate profile, for runs which only need expectations and not accurate paths. A weak scheme only
+ * has to reproduce the law of the solution, so the Wiener increments can be replaced by discrete random variables with
+ * the same low order moments, which are drawn from the raw bits of the Mersenne Twister instead of with box_muller().
+ * Order 1 uses vector_implicit_euler() and order 2 vector_implicit_trapezoidal(), whose bias decreases with \f$h\f$ and
+ * \f$h^2\f$ with two-point and three-point increments respectively.
+ *
+ * With Richardson extrapolation, every path is simulated with the step \f$h/2\f$ and with the step \f$h\f$, and the
+ * estimate is the mean of \f$(2^pX_{h/2}-X_h)/(2^p-1)\f$ over the paths, where \f$p\f$ is the order, which cancels the
+ * leading term of the bias. The increments of a coarse step are the sums of the increments of the two fine steps, so
+ * both simulations share the random numbers of the path and the extrapolation adds little variance. The sum of two
+ * increments whose moments match those of a normal variable up to the third or fifth again matches them, so the
+ * coarse simulation keeps its order. The variance is estimated from the extrapolated first and second moments.
+ *
+ * Path \f$i\f$ draws its increments from mersenne_stream_seed(seed, i), and the sums over the paths are formed in blocks
+ * of WEAK_BLOCK_SIZE paths which are added in order, so the result does not depend on the number of threads.
+ *
+ * @date 19th of October 2026
+ */
+
+#define WEAK_BLOCK_SIZE 64
+
+typedef enum weak_increments{
+    WEAK_GAUSSIAN,              // Normal increments by box_muller()
+    WEAK_TWO_POINT,             // d_rand_two_point_seeded(), enough for order 1
+    WEAK_THREE_POINT            // d_rand_three_point_seeded(), enough for order 2
+} weak_increments;
+
+typedef struct weak_estimator{
+    int n;                      // Number of states
+    int num_samples;            // Number of samples in the experiment
+    int time_steps_per_sample;  // Steps per sample with the step h
+    int num_paths;              // Number of paths
+    int num_blocks;             // Number of blocks of paths
+    int order;                  // 1 for implicit Euler and 2 for the trapezoidal rule
+    int extrapolate;            // 1 for Richardson extrapolation with the step h/2
+    weak_increments increments; // Distribution of the increments
+    int num_threads;            // Number of workspaces
+    int max_iterations;         // Newton iterations per step
+    double tolerance;           // Newton tolerance
+    double simulated_steps;     // Time steps used by the last estimate
+    int failed_paths;           // Paths left out of the last estimate
+    unsigned long seed;         // Base seed
+    CSTR_parameters params;     // Model parameters
+    double px0[3];              // Initial state
+    double *pt_coarse;          // Time grid of one sample with the step h, (steps+1)
+    double *pt_fine;            // Time grid of one sample with the step h/2, (2*steps+1)
+    double *pu;                 // Flow rate in every sample [L / s], num_samples
+    double *pmean;              // Estimated mean at every sample time, n*(num_samples+1)
+    double *pvariance;          // Estimated variance at every sample time, n*(num_samples+1)
+    double *pstandard_error;    // Standard error of the mean, n*(num_samples+1)
+    double *pblock_sums;        // Sums of the estimate, its square and the second moment per block, 3*n*(num_samples+1)*num_blocks
+    int *pblock_failed;         // Failed paths per block, num_blocks
+    double *pworkspace_lf;      // Per thread: increments, trajectory of a sample and solver workspace
+    int *pworkspace_d;          // Per thread: pivots
+    unsigned long *pgenerators; // Per thread: Mersenne Twister generator
+} weak_estimator;
+
+/**
+ * Allocates an estimator.
+ *
+ * @param[in] pP: Pointer to the model parameters. The struct is copied.
+ * @param[in] pu: Flow rate in every sample in [mL / min]. Must be of size \f$\text{num\_samples}\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_samples: Number of samples.
+ * @param[in] time_steps_per_sample: Number of time steps per sample with the step h.
+ * @param[in] sample_time: Sample time in seconds.
+ * @param[in] px0: Initial state. Must be of size \f$3\cdot\text{sizeof}(\text{double})\f$.
+ * @param[in] num_paths: Number of paths. At least 2 for a standard error.
+ * @param[in] order: 1 for vector_implicit_euler() and 2 for vector_implicit_trapezoidal().
+ * @param[in] increments: Distribution of the increments.
+ * @param[in] extrapolate: 1 for Richardson extrapolation and 0 for the step h only.
+ * @param[in] seed: Base seed of all random numbers.
+ *
+ * @return Pointer to the estimator or NULL if an argument is invalid or the memory could not be allocated.
+ *
+ * @date 19th of October 2026
+ */
+
+weak_estimator *weak_create(
+    CSTR_parameters *pP,
+    double *pu,
+    int num_samples,
+    int time_steps_per_sample,
+    double sample_time,
+    double *px0,
+    int num_paths,
+    int order,
+    weak_increments increments,
+    int extrapolate,
+    unsigned long seed
+);
+
+/**
+ * Simulates all paths and stores the estimates in pmean, pvariance and pstandard_error. A path in which a Newton solve
+ * does not converge or a state is not finite, in the fine or the coarse simulation, is left out of the estimates and
+ * counted in failed_paths. If all paths fail, the estimates are NaN.
+ *
+ * @param[in,out] pe: Pointer to the estimator.
+ *
+ * @date 19th of October 2026
+ */
+
+void weak_estimate(
+    weak_estimator *pe
+);
+
+/**
+ * Frees all memory held by the estimator.
+ *
+ * @param[in] pe: Pointer to the estimator. May be NULL.
+ *
+ * @date 19th of October 2026
+ */
+
+void weak_destroy(
+    weak_estimator *pe
+);
+
+#endif
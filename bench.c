@@ -0,0 +1,732 @@
+/**
+* @snippet bench.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ImplicitEulerSolver.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+#include "CSTR.h"
+
+#define MAX_RESULTS 256
+#define NAME_LENGTH 64
+
+typedef struct bench_result{
+    char name[NAME_LENGTH];
+    double value;
+    const char *unit;
+} bench_result;
+
+static bench_result results[MAX_RESULTS];
+static int num_results = 0;
+
+// Smallest time spent on every repetition of a kernel
+static double min_time = 0.2;
+
+static void record(
+    const char *name,
+    double value,
+    const char *unit
+){
+    if (num_results < MAX_RESULTS){
+        snprintf(results[num_results].name,NAME_LENGTH,"%s",name);
+        results[num_results].value = value;
+        results[num_results].unit = unit;
+        num_results++;
+    }
+    printf("%-44s %14.4e %s\n",name,value,unit);
+}
+
+// A kernel does work_per_call units of work per call
+typedef void (*kernel_function)(void *pdata);
+
+// Best rate of three repetitions, each calling the kernel until min_time has passed
+static double rate(
+    kernel_function kernel,
+    void *pdata,
+    double work_per_call
+){
+    double best = 0;
+    int repetition;
+    for (repetition=0;repetition<3;repetition++){
+        long calls = 0;
+        double elapsed;
+        double timer = omp_get_wtime();
+        do {
+            kernel(pdata);
+            calls++;
+            elapsed = omp_get_wtime()-timer;
+        } while (elapsed < min_time);
+        best = fmax(best,calls*work_per_call/elapsed);
+    }
+    return best;
+}
+
+/*******************************************************************************
+Micro-benchmarks
+*******************************************************************************/
+
+#define MICRO_SIZE 4096
+
+typedef struct micro_data{
+    double *pbuffer;            // MICRO_SIZE values
+    double *puniform;           // MICRO_SIZE uniform values
+    double *pstates;            // 3*MICRO_SIZE states
+    double *ptemperatures;      // MICRO_SIZE temperatures of the states
+    double *poutput;            // 12*MICRO_SIZE values
+    double *pbatch;             // 2*MICRO_SIZE values for the batched drift
+    unsigned long *pgenerator;  // Mersenne Twister generator
+    double *pworkspace_lf;      // Solver workspace
+    int *pworkspace_d;          // Pivots
+    double *pt;                 // Time grid of the solver
+    double *px;                 // Solution of the solver
+    double *pdW;                // Noise of the solver
+    int steps;                  // Time steps per call to the solver
+    double u;                   // Flow rate [L / s]
+    CSTR_parameters params;     // Model parameters
+    CSTR_parameters table_params; // Model parameters with a table of the rate constant
+    double sink;                // Keeps the results alive
+} micro_data;
+
+static void mersenne_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    mersenne_twister(pm->pbuffer,pm->pgenerator,MICRO_SIZE);
+    pm->sink += pm->pbuffer[MICRO_SIZE-1];
+}
+
+static void box_muller_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    memcpy(pm->pbuffer,pm->puniform,MICRO_SIZE*sizeof(double));
+    box_muller(pm->pbuffer,MICRO_SIZE,0,1);
+    pm->sink += pm->pbuffer[MICRO_SIZE-1];
+}
+
+static void normal_seeded_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    d_rand_normal_seeded(pm->pbuffer,pm->pgenerator,MICRO_SIZE,2021,0,1);
+    pm->sink += pm->pbuffer[MICRO_SIZE-1];
+}
+
+static void two_point_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    d_rand_two_point_seeded(pm->pbuffer,pm->pgenerator,MICRO_SIZE,2021,1);
+    pm->sink += pm->pbuffer[MICRO_SIZE-1];
+}
+
+static void three_point_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    d_rand_three_point_seeded(pm->pbuffer,pm->pgenerator,MICRO_SIZE,2021,1);
+    pm->sink += pm->pbuffer[MICRO_SIZE-1];
+}
+
+static void drift_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->params,&pm->poutput[3*i]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void jacobian_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift_jacobian(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->params,&pm->poutput[9*i]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void arrhenius_exp_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        pm->poutput[i] = pm->params.k0*exp(pm->params.EaR*(-1/pm->pstates[3*i+2]));
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void arrhenius_table_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    CSTR_parameters *pP = &pm->table_params;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        pm->poutput[i] = arrhenius_rate(pP->parrhenius,pP->k0,pP->EaR,pm->pstates[3*i+2]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void arrhenius_batch_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    CSTR_parameters *pP = &pm->table_params;
+    arrhenius_rate_batch(pP->parrhenius,pP->k0,pP->EaR,pm->ptemperatures,pm->poutput,MICRO_SIZE);
+    pm->sink += pm->poutput[0];
+}
+
+static void drift_table_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->table_params,&pm->poutput[3*i]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void jacobian_table_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift_jacobian(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->table_params,&pm->poutput[9*i]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void drift_and_jacobian_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->params,&pm->poutput[12*i]);
+        CSTR_3D_drift_jacobian(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->params,&pm->poutput[12*i+3]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void jacobian_ad_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift_jacobian_ad(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->params,&pm->poutput[9*i]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void fused_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    int i;
+    for (i=0;i<MICRO_SIZE;i++){
+        CSTR_3D_drift_fused(NULL,&pm->pstates[3*i],&pm->u,NULL,&pm->params,&pm->poutput[12*i]);
+    }
+    pm->sink += pm->poutput[0];
+}
+
+static void fused_batch_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    CSTR_3D_drift_fused_batch(MICRO_SIZE,pm->pstates,&pm->u,0,&pm->params,pm->pbatch,pm->poutput);
+    pm->sink += pm->poutput[0];
+}
+
+static void newton_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double t = 0;
+    int i;
+    for (i=0;i<MICRO_SIZE/16;i++){
+        double *ppsi = &pm->pstates[3*i];
+        double x[3] = {ppsi[0], ppsi[1], ppsi[2]};
+        newton_solver(CSTR_3D_drift,CSTR_3D_drift_jacobian,20,10e-6,3,1.0,&t,x,ppsi,pm->pworkspace_lf,pm->pworkspace_d,
+            &pm->u,NULL,&pm->params);
+        pm->sink += x[2];
+    }
+}
+
+static void implicit_euler_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double x0[3] = {0.05, 0.25, pm->params.Tin};
+    vector_implicit_euler(pm->steps,3,1,pm->pt,pm->px,pm->pdW,pm->pworkspace_lf,pm->pworkspace_d,20,10e-6,
+        CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,&pm->u,NULL,&pm->params,x0);
+    pm->sink += pm->px[3*pm->steps+2];
+}
+
+static void implicit_euler_table_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double x0[3] = {0.05, 0.25, pm->params.Tin};
+    vector_implicit_euler(pm->steps,3,1,pm->pt,pm->px,pm->pdW,pm->pworkspace_lf,pm->pworkspace_d,20,10e-6,
+        CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,&pm->u,NULL,&pm->table_params,x0);
+    pm->sink += pm->px[3*pm->steps+2];
+}
+
+static void implicit_euler_fused_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double x0[3] = {0.05, 0.25, pm->params.Tin};
+    vector_implicit_euler(pm->steps,3,1,pm->pt,pm->px,pm->pdW,pm->pworkspace_lf,pm->pworkspace_d,20,10e-6,
+        CSTR_3D_drift_fused,CSTR_3D_diffusion,NULL,&pm->u,NULL,&pm->params,x0);
+    pm->sink += pm->px[3*pm->steps+2];
+}
+
+static void implicit_trapezoidal_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double x0[3] = {0.05, 0.25, pm->params.Tin};
+    vector_implicit_trapezoidal(pm->steps,3,1,pm->pt,pm->px,pm->pdW,pm->pworkspace_lf,pm->pworkspace_d,20,10e-6,
+        CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,&pm->u,NULL,&pm->params,x0);
+    pm->sink += pm->px[3*pm->steps+2];
+}
+
+static void exponential_euler_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double x0[3] = {0.05, 0.25, pm->params.Tin};
+    vector_exponential_euler(pm->steps,3,1,pm->pt,pm->px,pm->pdW,pm->pworkspace_lf,pm->pworkspace_d,20,10e-6,1,
+        CSTR_3D_dilution,CSTR_3D_reaction,CSTR_3D_diffusion,CSTR_3D_reaction_jacobian,&pm->u,NULL,&pm->params,x0);
+    pm->sink += pm->px[3*pm->steps+2];
+}
+
+static void exponential_euler_explicit_kernel(void *pdata){
+    micro_data *pm = (micro_data*) pdata;
+    double x0[3] = {0.05, 0.25, pm->params.Tin};
+    vector_exponential_euler(pm->steps,3,1,pm->pt,pm->px,pm->pdW,pm->pworkspace_lf,pm->pworkspace_d,20,10e-6,0,
+        CSTR_3D_dilution,CSTR_3D_reaction,CSTR_3D_diffusion,CSTR_3D_reaction_jacobian,&pm->u,NULL,&pm->params,x0);
+    pm->sink += pm->px[3*pm->steps+2];
+}
+
+static void micro_benchmarks(void){
+    micro_data m;
+    int i;
+    m.steps = 2100;
+    m.u = 400.0/(60*1000);
+    m.params = default_parameters();
+    m.table_params = m.params;
+    m.table_params.parrhenius = arrhenius_table_create(m.params.k0,m.params.EaR,250,450,1e-12);
+    m.sink = 0;
+    m.pbuffer = (double*) malloc(MICRO_SIZE*sizeof(double));
+    m.puniform = (double*) malloc(MICRO_SIZE*sizeof(double));
+    m.pstates = (double*) malloc(3*MICRO_SIZE*sizeof(double));
+    m.ptemperatures = (double*) malloc(MICRO_SIZE*sizeof(double));
+    m.poutput = (double*) malloc(12*MICRO_SIZE*sizeof(double));
+    m.pbatch = (double*) malloc(2*MICRO_SIZE*sizeof(double));
+    m.pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    m.pworkspace_lf = (double*) malloc(3*(8+2*3)*sizeof(double));
+    m.pworkspace_d = (int*) malloc(3*sizeof(int));
+    m.pt = (double*) malloc((m.steps+1)*sizeof(double));
+    m.px = (double*) malloc(3*(m.steps+1)*sizeof(double));
+    m.pdW = (double*) malloc(3*m.steps*sizeof(double));
+
+    // States spread over the operating range of the reactor
+    mersenne_twister_seeded(m.puniform,m.pgenerator,MICRO_SIZE,2021);
+    for (i=0;i<MICRO_SIZE;i++){
+        m.pstates[3*i] = 0.8*m.puniform[i];
+        m.pstates[3*i+1] = 1.2*m.puniform[(i+1)%MICRO_SIZE];
+        m.pstates[3*i+2] = 273.65+100*m.puniform[(i+2)%MICRO_SIZE];
+        m.ptemperatures[i] = m.pstates[3*i+2];
+    }
+    linspace(m.pt,0,m.steps,m.steps);
+    d_rand_normal_seeded(m.pdW,m.pgenerator,3*m.steps,2022,0,1);
+    set_seed(12345);
+
+    printf("Micro-benchmarks\n");
+
+    // Largest relative error of the table at the temperatures of the states and on a fine grid over the table
+    arrhenius_table *ptable = m.table_params.parrhenius;
+    double max_error = 0;
+    for (i=0;i<MICRO_SIZE+1000000;i++){
+        double T = (i < MICRO_SIZE) ? m.pstates[3*i+2] : ptable->T_min+(ptable->T_max-ptable->T_min)*(i-MICRO_SIZE)/1e6;
+        double k = m.params.k0*exp(m.params.EaR*(-1/T));
+        max_error = fmax(max_error,fabs(arrhenius_rate(ptable,m.params.k0,m.params.EaR,T)-k)/k);
+    }
+    printf("Arrhenius table: %d intervals, bound %.2e, largest relative error %.2e\n",ptable->num_intervals,
+        ptable->relative_error,max_error);
+
+    // Largest difference of the Jacobian by automatic differentiation to CSTR_3D_drift_jacobian(), relative to the
+    // largest element, and whether the fused drift is bitwise CSTR_3D_drift()
+    double max_difference = 0;
+    int identical = 1;
+    for (i=0;i<MICRO_SIZE;i++){
+        double pdrift[3], pjacobian[9], pfused[12];
+        double largest = 0;
+        int j;
+        CSTR_3D_drift(NULL,&m.pstates[3*i],&m.u,NULL,&m.params,pdrift);
+        CSTR_3D_drift_jacobian(NULL,&m.pstates[3*i],&m.u,NULL,&m.params,pjacobian);
+        CSTR_3D_drift_fused(NULL,&m.pstates[3*i],&m.u,NULL,&m.params,pfused);
+        identical &= memcmp(pdrift,pfused,3*sizeof(double)) == 0;
+        for (j=0;j<9;j++){
+            largest = fmax(largest,fabs(pjacobian[j]));
+        }
+        for (j=0;j<9;j++){
+            max_difference = fmax(max_difference,fabs(pfused[3+j]-pjacobian[j])/largest);
+        }
+    }
+    printf("Dual number Jacobian: largest relative difference %.2e, drift values %s\n",max_difference,
+        identical ? "identical" : "different");
+
+    record("mersenne_twister",rate(mersenne_kernel,&m,MICRO_SIZE),"uniforms/s");
+    record("box_muller",rate(box_muller_kernel,&m,MICRO_SIZE),"normals/s");
+    record("d_rand_normal_seeded",rate(normal_seeded_kernel,&m,MICRO_SIZE),"increments/s");
+    record("d_rand_two_point_seeded",rate(two_point_kernel,&m,MICRO_SIZE),"increments/s");
+    record("d_rand_three_point_seeded",rate(three_point_kernel,&m,MICRO_SIZE),"increments/s");
+    record("CSTR_3D_drift",rate(drift_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_jacobian",rate(jacobian_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("arrhenius_exp",rate(arrhenius_exp_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("arrhenius_table",rate(arrhenius_table_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("arrhenius_table_batch",rate(arrhenius_batch_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_table",rate(drift_table_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_jacobian_table",rate(jacobian_table_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_jacobian_ad",rate(jacobian_ad_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_and_jacobian",rate(drift_and_jacobian_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_fused",rate(fused_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("CSTR_3D_drift_fused_batch",rate(fused_batch_kernel,&m,MICRO_SIZE),"evaluations/s");
+    record("newton_solver_n3",rate(newton_kernel,&m,MICRO_SIZE/16),"solves/s");
+    record("vector_implicit_euler",rate(implicit_euler_kernel,&m,m.steps),"steps/s");
+    record("vector_implicit_euler_table",rate(implicit_euler_table_kernel,&m,m.steps),"steps/s");
+    record("vector_implicit_euler_fused",rate(implicit_euler_fused_kernel,&m,m.steps),"steps/s");
+    record("vector_implicit_trapezoidal",rate(implicit_trapezoidal_kernel,&m,m.steps),"steps/s");
+    record("vector_exponential_euler",rate(exponential_euler_kernel,&m,m.steps),"steps/s");
+    record("vector_exponential_euler_explicit",rate(exponential_euler_explicit_kernel,&m,m.steps),"steps/s");
+
+    if (m.sink == 12345.6789){
+        printf("\n");
+    }
+    arrhenius_table_destroy(m.table_params.parrhenius);
+    free(m.pdW);
+    free(m.px);
+    free(m.pt);
+    free(m.pworkspace_d);
+    free(m.pworkspace_lf);
+    free(m.pgenerator);
+    free(m.pbatch);
+    free(m.poutput);
+    free(m.ptemperatures);
+    free(m.pstates);
+    free(m.puniform);
+    free(m.pbuffer);
+}
+
+/*******************************************************************************
+Accuracy per CPU time
+*******************************************************************************/
+
+#define ACCURACY_METHODS 3
+
+static const char *accuracy_names[ACCURACY_METHODS] = {"implicit Euler", "exponential implicit", "exponential explicit"};
+
+// Simulates the experiment sample by sample with steps steps per sample and stores the state at every sample
+static void accuracy_path(
+    int method,
+    int num_samples,
+    int steps,
+    double sample_time,
+    double *pdW,
+    double *pu,
+    CSTR_parameters *pP,
+    double *ptrajectory,
+    double *pworkspace_lf,
+    int *pworkspace_d,
+    double *pstates
+){
+    double pt[481];
+    double x[3] = {0.05, 0.25, pP->Tin};
+    int j;
+    linspace(pt,0,sample_time,steps);
+    for (j=0;j<num_samples;j++){
+        double *pdW_sample = &pdW[3*steps*j];
+        if (method == 0){
+            vector_implicit_euler(steps,3,1,pt,ptrajectory,pdW_sample,pworkspace_lf,pworkspace_d,20,10e-6,
+                CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,&pu[j],NULL,pP,x);
+        }
+        else {
+            vector_exponential_euler(steps,3,1,pt,ptrajectory,pdW_sample,pworkspace_lf,pworkspace_d,20,10e-6,
+                method == 1,CSTR_3D_dilution,CSTR_3D_reaction,CSTR_3D_diffusion,CSTR_3D_reaction_jacobian,&pu[j],NULL,
+                pP,x);
+        }
+        memcpy(x,&ptrajectory[3*steps],3*sizeof(double));
+        memcpy(&pstates[3*j],x,3*sizeof(double));
+    }
+}
+
+// RMS error of the temperature at the samples against a fine implicit Euler reference on the same Brownian paths,
+// the error of the mean temperature over the paths and the CPU time per path, for the integrators at increasing step
+// sizes. A flow rate of 0 runs the experiment of project and any other value a constant flow rate in [mL / min].
+static void accuracy_benchmark(
+    int quick,
+    double constant_flow
+){
+    int num_paths = quick ? 8 : 32;
+    int num_samples = 35;
+    double sample_time = 60;
+    int reference_steps = 480;
+    int psteps[6] = {60, 30, 12, 6, 2, 1};
+    int num_sizes = 6;
+    CSTR_parameters params = default_parameters();
+    double pu[35];
+    double *pdW_fine = (double*) malloc(3*reference_steps*num_samples*sizeof(double));
+    double *pdW = (double*) malloc(3*reference_steps*num_samples*sizeof(double));
+    double *ptrajectory = (double*) malloc(3*(reference_steps+1)*sizeof(double));
+    double *preference = (double*) malloc(3*num_samples*sizeof(double));
+    double *pstates = (double*) malloc(3*num_samples*sizeof(double));
+    double *pworkspace_lf = (double*) malloc(3*(8+2*3)*sizeof(double));
+    int *pworkspace_d = (int*) malloc(3*sizeof(int));
+    unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    double psquared[6*ACCURACY_METHODS] = {0};
+    double pmean_error[6*ACCURACY_METHODS*35] = {0};
+    double pseconds[6*ACCURACY_METHODS] = {0};
+    char name[NAME_LENGTH];
+    int i, j, l, method, size;
+    flow_rate(pu);
+    for (j=0;j<num_samples;j++){
+        pu[j] = ((constant_flow > 0) ? constant_flow : pu[j])/(60*1000);
+    }
+
+    for (i=0;i<num_paths;i++){
+        d_rand_normal_seeded(pdW_fine,pgenerator,3*reference_steps*num_samples,mersenne_stream_seed(2023,i),0,
+            sqrt(sample_time/reference_steps));
+        accuracy_path(0,num_samples,reference_steps,sample_time,pdW_fine,pu,&params,ptrajectory,pworkspace_lf,
+            pworkspace_d,preference);
+        for (size=0;size<num_sizes;size++){
+            // The increments of a coarse step are sums of the fine increments it covers
+            int steps = psteps[size];
+            int ratio = reference_steps/steps;
+            memset(pdW,0,3*steps*num_samples*sizeof(double));
+            for (l=0;l<reference_steps*num_samples;l++){
+                for (j=0;j<3;j++){
+                    pdW[3*(l/ratio)+j] += pdW_fine[3*l+j];
+                }
+            }
+            for (method=0;method<ACCURACY_METHODS;method++){
+                double timer = omp_get_wtime();
+                accuracy_path(method,num_samples,steps,sample_time,pdW,pu,&params,ptrajectory,pworkspace_lf,
+                    pworkspace_d,pstates);
+                pseconds[ACCURACY_METHODS*size+method] += omp_get_wtime()-timer;
+                for (j=0;j<num_samples;j++){
+                    double error = pstates[3*j+2]-preference[3*j+2];
+                    psquared[ACCURACY_METHODS*size+method] += error*error/(num_samples*num_paths);
+                    pmean_error[num_samples*(ACCURACY_METHODS*size+method)+j] += error/num_paths;
+                }
+            }
+        }
+    }
+
+    printf("\nAccuracy per CPU time, %s, %d paths against implicit Euler with a step of %.3f s\n",
+        (constant_flow > 0) ? "constant flow rate" : "experiment",num_paths,sample_time/reference_steps);
+    printf("%8s %-22s %16s %18s %18s\n","step [s]","integrator","time/path [ms]","RMS error T [K]","error of mean T");
+    for (size=0;size<num_sizes;size++){
+        for (method=0;method<ACCURACY_METHODS;method++){
+            double error = sqrt(psquared[ACCURACY_METHODS*size+method]);
+            double mean_error = 0;
+            for (j=0;j<num_samples;j++){
+                mean_error = fmax(mean_error,fabs(pmean_error[num_samples*(ACCURACY_METHODS*size+method)+j]));
+            }
+            printf("%8.1f %-22s %16.4f %18.4e %18.4e\n",sample_time/psteps[size],accuracy_names[method],
+                1e3*pseconds[ACCURACY_METHODS*size+method]/num_paths,error,mean_error);
+        }
+    }
+
+    // The largest step which meets an RMS error of 1 K, and its rate in paths per second
+    for (method=0;method<ACCURACY_METHODS;method++){
+        snprintf(name,NAME_LENGTH,"accuracy_1K_%s_%s",(constant_flow > 0) ? "constant" : "experiment",
+            (method == 0) ? "implicit" : (method == 1) ? "exponential" : "exponential_explicit");
+        for (size=0;size<num_sizes && !(sqrt(psquared[ACCURACY_METHODS*size+method]) < 1);size++);
+        if (size < num_sizes){
+            record(name,num_paths/pseconds[ACCURACY_METHODS*size+method],"paths/s");
+        }
+        else {
+            printf("%-44s %14s\n",name,"not reached");
+        }
+    }
+
+    free(pgenerator);
+    free(pworkspace_d);
+    free(pworkspace_lf);
+    free(pstates);
+    free(preference);
+    free(ptrajectory);
+    free(pdW);
+    free(pdW_fine);
+}
+
+/*******************************************************************************
+Macro-benchmarks
+*******************************************************************************/
+
+// Time of an end-to-end open loop run of NS realizations on num_threads threads: noise and simulation
+static double end_to_end(
+    int NS,
+    int num_threads
+){
+    int n = 3;
+    int time_steps_per_sample = 60;
+    int number_of_samples = 35;
+    int N = number_of_samples*time_steps_per_sample;
+    int size_x = n*(N+1);
+    int size_dW = n*N;
+    CSTR_parameters params = default_parameters();
+    double *pX = (double*) malloc(size_x*NS*sizeof(double));
+    double *pdW = (double*) malloc(size_dW*NS*sizeof(double));
+    double *pT = (double*) malloc((N+1)*sizeof(double));
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    double *pworkspace_lf = (double*) malloc(num_threads*n*(5+2*n)*sizeof(double));
+    int *pworkspace_d = (int*) malloc(num_threads*n*sizeof(int));
+    unsigned long *pgenerators = (unsigned long*) malloc(num_threads*624*sizeof(unsigned long));
+    int i;
+    flow_rate(pflow_rate);
+    for (i=0;i<number_of_samples;i++){
+        pflow_rate[i] /= 60*1000;
+    }
+    linspace(pT,0,number_of_samples*60,N);
+
+    double timer = omp_get_wtime();
+    #pragma omp parallel for num_threads(num_threads) schedule(static)
+    for (i=0;i<NS;i++){
+        int thread_index = omp_get_thread_num();
+        d_rand_normal_seeded(&pdW[size_dW*i],&pgenerators[624*thread_index],size_dW,mersenne_stream_seed(2021,i),0,1);
+        pX[size_x*i] = 0.05;
+        pX[size_x*i+1] = 0.25;
+        pX[size_x*i+2] = params.Tin;
+        implicit_simulation(pT,&pX[size_x*i],&pdW[size_dW*i],&pworkspace_lf[n*(5+2*n)*thread_index],
+            &pworkspace_d[n*thread_index],20,10e-6,CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,
+            pflow_rate,NULL,&params,1,number_of_samples,time_steps_per_sample,N,n,0,0,0);
+    }
+    timer = omp_get_wtime()-timer;
+
+    free(pgenerators);
+    free(pworkspace_d);
+    free(pworkspace_lf);
+    free(pflow_rate);
+    free(pT);
+    free(pdW);
+    free(pX);
+    return timer;
+}
+
+static void macro_benchmarks(
+    int quick
+){
+    int max_threads = omp_get_max_threads();
+    int steps = 35*60;
+    int strong_NS = quick ? 64 : 512;
+    int weak_NS = quick ? 16 : 64;
+    char name[NAME_LENGTH];
+    int NS, p;
+    double time_1 = 0;
+
+    printf("\nEnd-to-end runs\n");
+    for (NS=strong_NS/8;NS<=strong_NS;NS*=2){
+        snprintf(name,NAME_LENGTH,"end_to_end_NS%d_threads%d",NS,max_threads);
+        record(name,NS*(double)steps/end_to_end(NS,max_threads),"steps/s");
+    }
+
+    printf("\nStrong scaling, %d realizations\n",strong_NS);
+    printf("%8s %12s %12s %12s\n","threads","time [s]","speedup","efficiency");
+    for (p=1;p<=max_threads;p=(p*2 > max_threads && p < max_threads) ? max_threads : p*2){
+        double time_p = end_to_end(strong_NS,p);
+        if (p == 1){
+            time_1 = time_p;
+        }
+        printf("%8d %12.4f %12.4f %12.4f\n",p,time_p,time_1/time_p,time_1/(p*time_p));
+        snprintf(name,NAME_LENGTH,"strong_scaling_threads%d",p);
+        record(name,strong_NS*(double)steps/time_p,"steps/s");
+    }
+
+    printf("\nWeak scaling, %d realizations per thread\n",weak_NS);
+    printf("%8s %12s %12s\n","threads","time [s]","efficiency");
+    for (p=1;p<=max_threads;p=(p*2 > max_threads && p < max_threads) ? max_threads : p*2){
+        double time_p = end_to_end(weak_NS*p,p);
+        if (p == 1){
+            time_1 = time_p;
+        }
+        printf("%8d %12.4f %12.4f\n",p,time_p,time_1/time_p);
+        snprintf(name,NAME_LENGTH,"weak_scaling_threads%d",p);
+        record(name,weak_NS*p*(double)steps/time_p,"steps/s");
+    }
+}
+
+/*******************************************************************************
+JSON output and comparison
+*******************************************************************************/
+
+// One result per line, such that a baseline can be read back with read_baseline()
+static int write_json(
+    const char *path
+){
+    FILE *pfile = fopen(path,"w");
+    if (pfile == NULL){
+        return -1;
+    }
+    int i;
+    fprintf(pfile,"{\n  \"threads\": %d,\n  \"results\": [\n",omp_get_max_threads());
+    for (i=0;i<num_results;i++){
+        fprintf(pfile,"    {\"name\": \"%s\", \"value\": %.6e, \"unit\": \"%s\"}%s\n",
+            results[i].name,results[i].value,results[i].unit,(i < num_results-1) ? "," : "");
+    }
+    fprintf(pfile,"  ]\n}\n");
+    fclose(pfile);
+    return 0;
+}
+
+// Compares the rates to a baseline written by write_json(). Returns the number of regressions.
+static int compare_baseline(
+    const char *path,
+    double tolerance
+){
+    FILE *pfile = fopen(path,"r");
+    if (pfile == NULL){
+        printf("Error: Could not read the baseline %s.\n",path);
+        return -1;
+    }
+    char line[512];
+    char name[NAME_LENGTH];
+    double value;
+    int regressions = 0;
+    int i;
+    printf("\nComparison with %s, regressions are slower by more than %.0f%%\n",path,100*tolerance);
+    printf("%-44s %14s %14s %10s\n","benchmark","baseline","current","ratio");
+    while (fgets(line,sizeof(line),pfile) != NULL){
+        char *pname = strstr(line,"\"name\": \"");
+        char *pvalue = strstr(line,"\"value\": ");
+        if (pname == NULL || pvalue == NULL || sscanf(pname+9,"%63[^\"]",name) != 1 || sscanf(pvalue+9,"%lf",&value) != 1){
+            continue;
+        }
+        for (i=0;i<num_results;i++){
+            if (strcmp(results[i].name,name) == 0){
+                double ratio = results[i].value/value;
+                int regression = ratio < 1-tolerance;
+                regressions += regression;
+                printf("%-44s %14.4e %14.4e %10.3f%s\n",name,value,results[i].value,ratio,regression ? "  REGRESSION" : "");
+                break;
+            }
+        }
+    }
+    fclose(pfile);
+    return regressions;
+}
+
+int main(int argc, char *argv[]){
+    int quick = 0;
+    const char *output = "bench.json";
+    const char *baseline = NULL;
+    int a;
+    for (a=1;a<argc;a++){
+        if (strcmp(argv[a],"--quick") == 0){
+            quick = 1;
+        }
+        else if (strcmp(argv[a],"--output") == 0 && a+1 < argc){
+            output = argv[++a];
+        }
+        else if (strcmp(argv[a],"--baseline") == 0 && a+1 < argc){
+            baseline = argv[++a];
+        }
+        else {
+            printf("Usage: ./bench [--quick] [--output results.json] [--baseline baseline.json]\n");
+            return 0;
+        }
+    }
+    if (quick){
+        min_time = 0.05;
+    }
+
+    micro_benchmarks();
+    accuracy_benchmark(quick,0);
+    accuracy_benchmark(quick,2000);
+    macro_benchmarks(quick);
+
+    if (write_json(output) != 0){
+        printf("Error: Could not write %s.\n",output);
+    }
+    else {
+        printf("\nResults written to %s\n",output);
+    }
+    if (baseline != NULL){
+        int regressions = compare_baseline(baseline,0.1);
+        return regressions > 0 ? 1 : 0;
+    }
+    return 0;
+}
@@ -0,0 +1,53 @@
+/**
+* @snippet bifurcation.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "SteadyState.h"
+#include "CSTR.h"
+
+int main(int argc, char *argv[]){
+    if (argc > 2){
+        printf("Please provide at most the number of segments.\n");
+        return 0;
+    }
+    int num_segments = (argc == 2) ? atoi(argv[1]) : 4*omp_get_max_threads();
+    if (num_segments < 1){
+        printf("Error: The number of segments must be larger than 0.\n");
+        return 0;
+    }
+
+    // Flow rates in [mL / min]
+    double F_min = 1;
+    double F_max = 1000;
+    CSTR_parameters params = default_parameters();
+
+    double timer = omp_get_wtime();
+    steady_state_curve *pcurve = steady_state_continuation(&params,F_min,F_max,0.05,num_segments);
+    timer = omp_get_wtime()-timer;
+    if (pcurve == NULL){
+        printf("Error: Could not trace the steady states.\n");
+        return 0;
+    }
+
+    printf("Points: %d, Newton iterations: %d, time: %lf ms\n",pcurve->num_points,pcurve->num_newton_iterations,1000*timer);
+    int i;
+    for (i=0;i<pcurve->num_folds;i++){
+        printf("Fold at F = %lf mL/min, T = %lf K, C_A = %lf, C_B = %lf\n",
+            pcurve->pfold_F[i],pcurve->pfold_x[3*i+2],pcurve->pfold_x[3*i],pcurve->pfold_x[3*i+1]);
+    }
+
+    // Saving the curve with columns F, C_A, C_B, T and stability
+    FILE *pfile = fopen("S.txt","w");
+    if (pfile != NULL){
+        for (i=0;i<pcurve->num_points;i++){
+            fprintf(pfile,"%lf %lf %lf %lf %d\n",pcurve->pF[i],pcurve->px[3*i],pcurve->px[3*i+1],pcurve->px[3*i+2],pcurve->pstable[i]);
+        }
+        fclose(pfile);
+    }
+
+    steady_state_curve_destroy(pcurve);
+    return 0;
+}
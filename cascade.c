@@ -0,0 +1,129 @@
+/**
+* @snippet cascade.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "CSTRCascade.h"
+#include "ImplicitEulerSolver.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+
+// Simulates the experiment sample by sample with the banded or the dense solver and returns the time spent
+static double simulate(
+    CSTR_cascade_parameters *pcascade,
+    int banded,
+    double *pt,
+    double *px,
+    double *pdW,
+    double *pu,
+    double *px0,
+    int num_samples,
+    int time_steps_per_sample
+){
+    int n = pcascade->n;
+    int LDAB = 2*pcascade->kl+pcascade->ku+1;
+    double *pworkspace_lf = (double*) malloc(n*(5+2*(banded ? LDAB : n))*sizeof(double));
+    int *pworkspace_d = (int*) malloc(n*sizeof(int));
+    int sample_size = n*time_steps_per_sample;
+    int j;
+    double timer = omp_get_wtime();
+    for (j=0;j<num_samples;j++){
+        double *px_sample = &px[j*sample_size];
+        if (banded){
+            vector_implicit_euler_banded(time_steps_per_sample,n,pcascade->kl,pcascade->ku,1,pt,px_sample,
+                &pdW[j*sample_size],pworkspace_lf,pworkspace_d,20,10e-6,CSTR_cascade_drift,CSTR_cascade_diffusion,
+                CSTR_cascade_drift_jacobian_banded,&pu[j],NULL,pcascade,(j == 0) ? px0 : px_sample);
+        }
+        else {
+            vector_implicit_euler(time_steps_per_sample,n,1,pt,px_sample,
+                &pdW[j*sample_size],pworkspace_lf,pworkspace_d,20,10e-6,CSTR_cascade_drift,CSTR_cascade_diffusion,
+                CSTR_cascade_drift_jacobian,&pu[j],NULL,pcascade,(j == 0) ? px0 : px_sample);
+        }
+    }
+    timer = omp_get_wtime()-timer;
+    free(pworkspace_d);
+    free(pworkspace_lf);
+    return timer;
+}
+
+int main(int argc, char *argv[]){
+    if (argc!=2){
+        printf("Please provide the number of tanks in series.\n");
+        return 0;
+    }
+    int num_tanks = atoi(argv[1]);
+    if (num_tanks < 1){
+        printf("Error: The number of tanks must be larger than 0.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+    int N = number_of_samples*time_steps_per_sample;
+
+    CSTR_parameters params = default_parameters();
+    CSTR_cascade_parameters *pcascade = CSTR_cascade_create(&params,num_tanks,NULL);
+    if (pcascade == NULL){
+        printf("Error: Could not allocate the cascade.\n");
+        return 0;
+    }
+    int n = pcascade->n;
+    double *pt = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    double *pu = (double*) malloc(number_of_samples*sizeof(double));
+    double *px0 = (double*) malloc(n*sizeof(double));
+    double *px_banded = (double*) malloc(n*(N+1)*sizeof(double));
+    double *px_dense = (double*) malloc(n*(N+1)*sizeof(double));
+    double *pdW = (double*) malloc((n*N+1)*sizeof(double));
+    unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    if (pt == NULL || pu == NULL || px0 == NULL || px_banded == NULL || px_dense == NULL || pdW == NULL || pgenerator == NULL){
+        printf("Error: Could not allocate the simulation.\n");
+        return 0;
+    }
+    linspace(pt,0,sample_time_seconds,time_steps_per_sample);
+    flow_rate(pu);
+    int i;
+    for (i=0;i<number_of_samples;i++){
+        pu[i] /= 60*1000;
+    }
+    for (i=0;i<num_tanks;i++){
+        px0[3*i] = 0;
+        px0[3*i+1] = 0;
+        px0[3*i+2] = params.Tin;
+    }
+    d_rand_normal_seeded(pdW,pgenerator,n*N+((n*N)&1),2021,0,sqrt(pt[1]-pt[0]));
+
+    printf("Tanks: %d, states: %d, subdiagonals: %d, superdiagonals: %d\n",num_tanks,n,pcascade->kl,pcascade->ku);
+    double time_banded = simulate(pcascade,1,pt,px_banded,pdW,pu,px0,number_of_samples,time_steps_per_sample);
+    printf("Banded solver: %lf s, final temperature of the last tank: %lf K\n",time_banded,px_banded[n*N+n-1]);
+
+    // The dense solver scales cubically and is only used for comparison on small cascades
+    if (num_tanks <= 100){
+        double time_dense = simulate(pcascade,0,pt,px_dense,pdW,pu,px0,number_of_samples,time_steps_per_sample);
+        double max_difference = 0;
+        for (i=0;i<n*(N+1);i++){
+            max_difference = fmax(max_difference,fabs(px_dense[i]-px_banded[i]));
+        }
+        printf("Dense solver: %lf s, speedup: %lf, largest difference: %.3e\n",time_dense,time_dense/time_banded,max_difference);
+    }
+
+    // Avoiding memory leakage
+    free(pgenerator);
+    free(pdW);
+    free(px_dense);
+    free(px_banded);
+    free(px0);
+    free(pu);
+    free(pt);
+    CSTR_cascade_destroy(pcascade);
+
+    return 0;
+}
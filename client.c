@@ -0,0 +1,115 @@
+/**
+* @snippet client.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "Service.h"
+#include "CSTRSession.h"
+
+int main(int argc, char *argv[]){
+    if (argc!=5){
+        printf("Please provide the path of the socket of a running server, the number of concurrent clients, the\n");
+        printf("number of requests of every client and the number of realizations of every request.\n");
+        return 0;
+    }
+    int num_clients = atoi(argv[2]);
+    int num_requests = atoi(argv[3]);
+    int num_realizations = atoi(argv[4]);
+    if (num_clients < 1 || num_requests < 1 || num_realizations < 1){
+        printf("Error: All numbers must be larger than 0.\n");
+        return 0;
+    }
+
+    // The open loop experiment of project
+    int number_of_samples = 35;
+    int time_steps_per_sample = 60;
+    double sample_time = 60;
+    int size_x = 3*(number_of_samples*time_steps_per_sample+1);
+    CSTR_parameters params = default_parameters();
+    double pflow_rate[35];
+    flow_rate(pflow_rate);
+
+    int failures = 0;
+    double queue_seconds = 0;
+    double service_seconds = 0;
+    double round_trip_seconds = 0;
+    double batch_requests = 0;
+    int cached = 0;
+    double *pfirst_mean = (double*) malloc(size_x*sizeof(double));
+    if (pfirst_mean == NULL){
+        printf("Error: Could not allocate memory.\n");
+        return 0;
+    }
+    double timer = omp_get_wtime();
+    #pragma omp parallel num_threads(num_clients) reduction(+:failures,queue_seconds,service_seconds,round_trip_seconds,batch_requests,cached)
+    {
+        int client = omp_get_thread_num();
+        int fd = service_connect(argv[1]);
+        int k;
+        failures += (fd < 0)*num_requests;
+        for (k=0;k<num_requests && fd >= 0;k++){
+            service_request_header request;
+            service_response_header response;
+            double *pvalues;
+            memset(&request,0,sizeof(request));
+            request.mode = SERVICE_STATISTICS;
+            request.num_realizations = num_realizations;
+            request.num_samples = number_of_samples;
+            request.time_steps_per_sample = time_steps_per_sample;
+            request.sample_time = sample_time;
+            request.px0[0] = 0.05;
+            request.px0[1] = 0.25;
+            request.px0[2] = params.Tin;
+            request.seed = 1000*client+k;
+            double round_trip = omp_get_wtime();
+            if (service_request(fd,&request,pflow_rate,&response,&pvalues) != 0 || response.status != 0){
+                failures++;
+                continue;
+            }
+            round_trip_seconds += omp_get_wtime()-round_trip;
+            queue_seconds += response.queue_seconds;
+            service_seconds += response.service_seconds;
+            batch_requests += response.batch_requests;
+            cached += response.cached;
+            if (client == 0 && k == 0){
+                memcpy(pfirst_mean,pvalues,size_x*sizeof(double));
+            }
+            free(pvalues);
+        }
+    }
+    timer = omp_get_wtime()-timer;
+    int answered = num_clients*num_requests-failures;
+    if (answered == 0){
+        printf("Error: No request was answered by the server at %s.\n",argv[1]);
+        free(pfirst_mean);
+        return 1;
+    }
+    printf("%d of %d requests answered in %lf s, %lf requests per second\n",answered,num_clients*num_requests,
+        timer,answered/timer);
+    printf("Mean round trip %.3f ms, queue %.3f ms, service %.3f ms, %.1f requests per batch\n",
+        1e3*round_trip_seconds/answered,1e3*queue_seconds/answered,1e3*service_seconds/answered,
+        batch_requests/answered);
+    if (cached > 0){
+        printf("%d requests answered from the cache of the server\n",cached);
+    }
+
+    // The first request is repeated locally with a session, which uses the same streams of noise
+    CSTR_session *psession = CSTR_session_create(&params,number_of_samples,time_steps_per_sample,sample_time,
+        num_realizations,0,0);
+    double *pmean = (double*) malloc(size_x*sizeof(double));
+    int identical = 0;
+    if (psession != NULL && pmean != NULL){
+        double x0[3] = {0.05, 0.25, params.Tin};
+        CSTR_session_run(psession,pflow_rate,x0,num_realizations);
+        CSTR_session_statistics(psession,pmean,NULL);
+        identical = memcmp(pmean,pfirst_mean,size_x*sizeof(double)) == 0;
+        printf("The first response is %s to a local session\n",identical ? "identical" : "not identical");
+    }
+    CSTR_session_destroy(psession);
+    free(pmean);
+    free(pfirst_mean);
+    return (failures == 0 && identical) ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+/**
+* @snippet ekf.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "ImplicitEulerSolver.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+#include "KalmanFilter.h"
+#include "CSTR.h"
+
+int main(int argc, char *argv[]){
+    if (argc!=2){
+        printf("Please provide the number of reactors.\n");
+        return 0;
+    }
+
+    // One filter per reactor
+    int NF = atoi(argv[1]);
+    if (NF < 1){
+        printf("Error: The number of reactors must be larger than 0.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+
+    // Number of states and measurements. Only the temperature is measured.
+    int n = 3;
+    int m = 1;
+    double H[3] = {0, 0, 1};
+    double R[1] = {0.25};
+
+    // Declaring default parameters
+    CSTR_parameters params = default_parameters();
+    params.sigma = 10;
+
+    // Inserting default flow rate in [L / s]
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    flow_rate(pflow_rate);
+    int i, j;
+    for (i=0;i<number_of_samples;i++){
+        pflow_rate[i] = pflow_rate[i]/(60*1000);
+    }
+
+    // The filters start from a wrong guess of the concentrations
+    double x0_true[3] = {0.05, 0.25, params.Tin};
+    double x0_guess[3] = {0.2, 0.4, params.Tin};
+    double P0[9] = {0.05, 0, 0, 0, 0.05, 0, 0, 0, 1};
+    ekf_batch *pekf = ekf_create(NF,m,time_steps_per_sample,sample_time_seconds,H,R,x0_guess,P0,&params);
+    if (pekf == NULL){
+        printf("Error: Could not allocate the filters.\n");
+        free(pflow_rate);
+        return 0;
+    }
+
+    // The plants are simulated with the implicit Euler scheme
+    double *pT = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    linspace(pT,0,sample_time_seconds,time_steps_per_sample);
+    double *pX = (double*) malloc(n*(time_steps_per_sample+1)*NF*sizeof(double));
+    double *pplant = (double*) malloc(n*NF*sizeof(double));
+    double *pdW = (double*) malloc(n*time_steps_per_sample*NF*sizeof(double));
+    double *py = (double*) malloc(m*NF*sizeof(double));
+    double *pv = (double*) malloc(m*NF*sizeof(double));
+    unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    double workspace_lf[(5+2*3)*3];
+    int workspace_d[3];
+    for (i=0;i<NF;i++){
+        for (j=0;j<n;j++){
+            pplant[i*n+j] = x0_true[j];
+        }
+    }
+
+    int sample;
+    double error_A, error_B;
+    for (sample=0;sample<number_of_samples;sample++){
+        // Advancing the plants and measuring the temperature
+        d_rand_normal_seeded(pdW,pgenerator,n*time_steps_per_sample*NF,mersenne_stream_seed(12345,sample),0,1);
+        d_rand_normal_seeded(pv,pgenerator,m*NF,mersenne_stream_seed(54321,sample),0,sqrt(R[0]));
+        for (i=0;i<NF;i++){
+            vector_implicit_euler(
+                time_steps_per_sample,
+                n,
+                1,
+                pT,
+                pX,
+                &pdW[i*n*time_steps_per_sample],
+                workspace_lf,
+                workspace_d,
+                20,
+                10e-6,
+                CSTR_3D_drift,
+                CSTR_3D_diffusion,
+                CSTR_3D_drift_jacobian,
+                &pflow_rate[sample],
+                NULL,
+                &params,
+                &pplant[i*n]
+            );
+            for (j=0;j<n;j++){
+                pplant[i*n+j] = pX[time_steps_per_sample*n+j];
+            }
+            py[i] = pplant[i*n+2]+pv[i];
+        }
+
+        // Filtering all reactors in parallel
+        ekf_step(pekf,&pflow_rate[sample],0,py);
+
+        error_A = 0;
+        error_B = 0;
+        for (i=0;i<NF;i++){
+            error_A += pow(pekf->px[i*n]-pplant[i*n],2);
+            error_B += pow(pekf->px[i*n+1]-pplant[i*n+1],2);
+        }
+        printf("Sample %2d: RMSE C_A = %lf, RMSE C_B = %lf, time = %lf ms\n",
+            sample,sqrt(error_A/NF),sqrt(error_B/NF),1000*pekf->last_step_time);
+    }
+    printf("Largest time per sample: %lf ms\n",1000*pekf->max_step_time);
+
+    // Avoiding memory leakage
+    ekf_destroy(pekf);
+    free(pgenerator);
+    free(pv);
+    free(py);
+    free(pdW);
+    free(pplant);
+    free(pX);
+    free(pT);
+    free(pflow_rate);
+
+    return 0;
+}
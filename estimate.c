@@ -0,0 +1,134 @@
+/**
+* @snippet estimate.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ImplicitEulerSolver.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+#include "ParameterEstimation.h"
+#include "CSTR.h"
+
+// Simulates the reactor with the default parameters and writes noisy temperature measurements to filename
+static int generate(const char *filename){
+    int time_steps_per_sample = 60;
+    int sample_time_seconds = 60;
+    int number_of_samples = 35;
+    int n = 3;
+
+    estimation_data *pdata = estimation_data_create(number_of_samples,1);
+    if (pdata == NULL){
+        return -1;
+    }
+
+    // Little process noise, since the estimator assumes that the measurement noise dominates
+    CSTR_parameters params = default_parameters();
+    params.sigma = 1;
+    pdata->sample_time = sample_time_seconds;
+    pdata->px0[0] = 0;
+    pdata->px0[1] = 0;
+    pdata->px0[2] = params.Tin;
+    pdata->poutputs[0] = 2;
+    pdata->pnoise_std[0] = 0.5;
+    flow_rate(pdata->pu);
+
+    double *pT = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    double *pX = (double*) malloc(n*(time_steps_per_sample+1)*sizeof(double));
+    double *pdW = (double*) malloc(n*time_steps_per_sample*sizeof(double));
+    unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    double workspace_lf[(5+2*3)*3];
+    int workspace_d[3];
+    double plant[3] = {pdata->px0[0], pdata->px0[1], pdata->px0[2]};
+    double u, v;
+    int sample, i;
+    linspace(pT,0,sample_time_seconds,time_steps_per_sample);
+    for (sample=0;sample<number_of_samples;sample++){
+        u = pdata->pu[sample]/(60*1000);
+        d_rand_normal_seeded(pdW,pgenerator,n*time_steps_per_sample,mersenne_stream_seed(12345,sample),0,sqrt(pT[1]-pT[0]));
+        d_rand_normal_seeded(&v,pgenerator,1,mersenne_stream_seed(54321,sample),0,pdata->pnoise_std[0]);
+        vector_implicit_euler(
+            time_steps_per_sample,
+            n,
+            1,
+            pT,
+            pX,
+            pdW,
+            workspace_lf,
+            workspace_d,
+            20,
+            10e-6,
+            CSTR_3D_drift,
+            CSTR_3D_diffusion,
+            CSTR_3D_drift_jacobian,
+            &u,
+            NULL,
+            &params,
+            plant
+        );
+        for (i=0;i<n;i++){
+            plant[i] = pX[time_steps_per_sample*n+i];
+        }
+        pdata->py[sample] = plant[2]+v;
+    }
+    int status = estimation_data_write(filename,pdata);
+
+    free(pgenerator);
+    free(pdW);
+    free(pX);
+    free(pT);
+    estimation_data_destroy(pdata);
+    return status;
+}
+
+int main(int argc, char *argv[]){
+    if (argc==3 && strcmp(argv[1],"generate")==0){
+        if (generate(argv[2]) != 0){
+            printf("Error: Could not write %s.\n",argv[2]);
+        }
+        return 0;
+    }
+    if (argc!=2){
+        printf("Please provide a data file, or use \"generate <file>\" to simulate one.\n");
+        return 0;
+    }
+
+    estimation_data *pdata = estimation_data_read(argv[1]);
+    if (pdata == NULL){
+        printf("Error: Could not read %s.\n",argv[1]);
+        return 0;
+    }
+
+    // Estimating k0, EaR and beta from a perturbed initial guess
+    CSTR_parameters nominal = default_parameters();
+    CSTR_parameters initial = nominal;
+    initial.k0 = 0.5*nominal.k0;
+    initial.EaR = 1.01*nominal.EaR;
+    initial.beta = 0.8*nominal.beta;
+    int selected[3] = {CSTR_SENSITIVITY_K0, CSTR_SENSITIVITY_EAR, CSTR_SENSITIVITY_BETA};
+    parameter_estimator *pe = estimator_create(pdata,&initial,selected,3,60);
+    if (pe == NULL){
+        printf("Error: Could not allocate the estimator.\n");
+        estimation_data_destroy(pdata);
+        return 0;
+    }
+
+    double timer = omp_get_wtime();
+    double cost = estimator_solve(pe);
+    timer = omp_get_wtime()-timer;
+
+    printf("Iterations: %d, simulations: %d, cost: %lf, time: %lf s\n",pe->iterations,pe->num_cost_evaluations,cost,timer);
+    printf("%-6s %18s %18s %18s %18s\n","","initial","estimate","standard error","default");
+    printf("%-6s %18.6e %18.6e %18.6e %18.6e\n","k0",initial.k0,pe->params.k0,pe->pstandard_error[0],nominal.k0);
+    printf("%-6s %18.6lf %18.6lf %18.6lf %18.6lf\n","EaR",initial.EaR,pe->params.EaR,pe->pstandard_error[1],nominal.EaR);
+    printf("%-6s %18.6lf %18.6lf %18.6lf %18.6lf\n","beta",initial.beta,pe->params.beta,pe->pstandard_error[2],nominal.beta);
+
+    // Avoiding memory leakage
+    estimator_destroy(pe);
+    estimation_data_destroy(pdata);
+
+    return 0;
+}
@@ -0,0 +1,198 @@
+/**
+* @snippet mixedprecision.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "ImplicitEulerSolver.h"
+#include "RandomProcesses.h"
+#include "MersenneTwister.h"
+#include "CSTR.h"
+
+// Welford update of the mean and the sum of squared deviations of every element of a trajectory
+static void welford(
+    double *pmean,
+    double *pM2,
+    double *px,
+    float *px_float,
+    int size,
+    int m
+){
+    int k;
+    for (k=0;k<size;k++){
+        double value = (px != NULL) ? px[k] : (double) px_float[k];
+        double delta = value-pmean[k];
+        pmean[k] += delta/m;
+        pM2[k] += delta*(value-pmean[k]);
+    }
+}
+
+int main(int argc, char *argv[]){
+    if (argc!=2){
+        printf("Please provide the number of realizations. The ensemble statistics of the mixed precision solver\n");
+        printf("are compared to those of the double precision solver with the same seeds.\n");
+        return 0;
+    }
+    int num_realizations = atoi(argv[1]);
+    if (num_realizations < 2){
+        printf("Error: The number of realizations must be larger than 1.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+
+    int n = 3;
+    int N = number_of_samples*time_steps_per_sample;
+    int size_x = n*(N+1);
+    int size_dW = n*N+1;
+    int batch_size = 256;
+    int num_threads = omp_get_max_threads();
+    int max_iterations = 20;
+    double tolerance = 10e-6;
+    unsigned long seed = 2021;
+
+    CSTR_parameters params = default_parameters();
+    double x0[3] = {0.05, 0.25, params.Tin};
+    double *pt = (double*) malloc((N+1)*sizeof(double));
+    double *pu = (double*) malloc(number_of_samples*sizeof(double));
+    double *pX = (double*) malloc(size_x*batch_size*sizeof(double));
+    float *pX_float = (float*) malloc(size_x*batch_size*sizeof(float));
+    double *pdW = (double*) malloc(size_dW*batch_size*sizeof(double));
+    float *pdW_float = (float*) malloc(size_dW*batch_size*sizeof(float));
+    double *pstatistics = (double*) calloc(4*size_x,sizeof(double));
+    double *pworkspace_lf = (double*) malloc(num_threads*n*(5+2*n)*sizeof(double));
+    float *pworkspace_f = (float*) malloc(num_threads*n*(2+2*n)*sizeof(float));
+    int *pworkspace_d = (int*) malloc(num_threads*n*sizeof(int));
+    unsigned long *pgenerators = (unsigned long*) malloc(num_threads*624*sizeof(unsigned long));
+    if (pt == NULL || pu == NULL || pX == NULL || pX_float == NULL || pdW == NULL || pdW_float == NULL
+        || pstatistics == NULL || pworkspace_lf == NULL || pworkspace_f == NULL || pworkspace_d == NULL
+        || pgenerators == NULL){
+        printf("Error: Could not allocate memory.\n");
+        return 0;
+    }
+    double *pmean = &pstatistics[0];
+    double *pM2 = &pstatistics[size_x];
+    double *pmean_float = &pstatistics[2*size_x];
+    double *pM2_float = &pstatistics[3*size_x];
+    linspace(pt,0,number_of_samples*sample_time_seconds,N);
+    flow_rate(pu);
+    int i, j, k;
+    for (i=0;i<number_of_samples;i++){
+        pu[i] /= (60*1000);
+    }
+    double sqrtdt = sqrt(pt[1]-pt[0]);
+
+    double pmax_path_difference[3] = {0, 0, 0};
+    double double_time = 0;
+    double mixed_time = 0;
+    int m = 0;
+    while (m < num_realizations){
+        int batch = (num_realizations-m < batch_size) ? num_realizations-m : batch_size;
+
+        // Double precision path
+        double timer = omp_get_wtime();
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic,1)
+        for (i=0;i<batch;i++){
+            int thread_index = omp_get_thread_num();
+            double *px = &pX[size_x*i];
+            double *pdW_i = &pdW[size_dW*i];
+            int s;
+            d_rand_normal_seeded(pdW_i,&pgenerators[624*thread_index],n*N+((n*N)&1),
+                mersenne_stream_seed(seed,(unsigned long) (m+i)),0,sqrtdt);
+            for (s=0;s<number_of_samples;s++){
+                int offset = s*time_steps_per_sample;
+                vector_implicit_euler(time_steps_per_sample,n,1,&pt[offset],&px[n*offset],&pdW_i[n*offset],
+                    &pworkspace_lf[n*(5+2*n)*thread_index],&pworkspace_d[n*thread_index],max_iterations,tolerance,
+                    CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,&pu[s],NULL,&params,
+                    (s == 0) ? x0 : &px[n*offset]);
+            }
+        }
+        double_time += omp_get_wtime()-timer;
+
+        // Mixed precision path with the same seeds and single precision storage
+        timer = omp_get_wtime();
+        #pragma omp parallel for num_threads(num_threads) schedule(dynamic,1)
+        for (i=0;i<batch;i++){
+            int thread_index = omp_get_thread_num();
+            float *px = &pX_float[size_x*i];
+            float *pdW_i = &pdW_float[size_dW*i];
+            double *pworkspace = &pworkspace_lf[n*(5+2*n)*thread_index];
+            double px_start[3];
+            int s, r;
+            s_rand_normal_seeded(pdW_i,&pgenerators[624*thread_index],n*N+((n*N)&1),
+                mersenne_stream_seed(seed,(unsigned long) (m+i)),0,(float) sqrtdt);
+            for (s=0;s<number_of_samples;s++){
+                int offset = s*time_steps_per_sample;
+                // The final state of the previous sample is kept in double precision by the workspace
+                for (r=0;r<n;r++){
+                    px_start[r] = (s == 0) ? x0[r] : pworkspace[r];
+                }
+                vector_implicit_euler_mixed(time_steps_per_sample,n,1,&pt[offset],&px[n*offset],1,&pdW_i[n*offset],
+                    pworkspace,&pworkspace_f[n*(2+2*n)*thread_index],&pworkspace_d[n*thread_index],max_iterations,
+                    tolerance,CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian_float,&pu[s],NULL,&params,
+                    px_start);
+            }
+        }
+        mixed_time += omp_get_wtime()-timer;
+
+        // Statistics in the order of the realizations
+        for (i=0;i<batch;i++){
+            m++;
+            welford(pmean,pM2,&pX[size_x*i],NULL,size_x,m);
+            welford(pmean_float,pM2_float,NULL,&pX_float[size_x*i],size_x,m);
+            for (k=0;k<size_x;k++){
+                double difference = fabs(pX[size_x*i+k]-(double) pX_float[size_x*i+k]);
+                pmax_path_difference[k%n] = fmax(pmax_path_difference[k%n],difference);
+            }
+        }
+    }
+
+    // Largest differences of the mean relative to its standard error and of the standard deviations
+    const char *pnames[3] = {"C_A", "C_B", "T"};
+    double pmean_error[3] = {0, 0, 0};
+    double pstd_error[3] = {0, 0, 0};
+    for (k=n;k<size_x;k++){
+        j = k%n;
+        double std = sqrt(pM2[k]/(m-1));
+        double std_float = sqrt(pM2_float[k]/(m-1));
+        if (std > 0){
+            pmean_error[j] = fmax(pmean_error[j],fabs(pmean[k]-pmean_float[k])/(std/sqrt(m)));
+            pstd_error[j] = fmax(pstd_error[j],fabs(std-std_float)/std);
+        }
+    }
+    int passed = 1;
+    printf("%-4s %24s %24s %24s\n","","max |dmean| / std.err.","max |dstd| / std","max pathwise |dx|");
+    for (j=0;j<n;j++){
+        printf("%-4s %24.3e %24.3e %24.3e\n",pnames[j],pmean_error[j],pstd_error[j],pmax_path_difference[j]);
+        passed &= pmean_error[j] < 0.1 && pstd_error[j] < 0.01;
+    }
+    printf("Realizations: %d, double: %lf s, mixed: %lf s\n",m,double_time,mixed_time);
+    printf("Trajectory storage: %zu bytes in double and %zu bytes in single precision per realization\n",
+        size_x*sizeof(double),size_x*sizeof(float));
+    printf("%s\n",passed ? "Passed: the ensemble statistics agree within 0.1 standard errors and 1%."
+        : "Failed: the ensemble statistics differ by more than 0.1 standard errors or 1%.");
+
+    // Avoiding memory leakage
+    free(pgenerators);
+    free(pworkspace_d);
+    free(pworkspace_f);
+    free(pworkspace_lf);
+    free(pstatistics);
+    free(pdW_float);
+    free(pdW);
+    free(pX_float);
+    free(pX);
+    free(pu);
+    free(pt);
+
+    return passed ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/**
+* @snippet particlefilter.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ImplicitEulerSolver.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+#include "ParticleFilter.h"
+#include "CSTR.h"
+
+int main(int argc, char *argv[]){
+    if (argc!=2 && argc!=3){
+        printf("Please provide the number of particles and optionally --enkf.\n");
+        return 0;
+    }
+    int use_enkf = (argc==3 && strcmp(argv[2],"--enkf")==0);
+    if (argc==3 && !use_enkf){
+        printf("Error: Unknown option %s.\n",argv[2]);
+        return 0;
+    }
+
+    int NP = atoi(argv[1]);
+    if (NP < 2){
+        printf("Error: The number of particles must be larger than 1.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+
+    // Number of states and measurements. Only the temperature is measured.
+    int n = 3;
+    int m = 1;
+    double H[3] = {0, 0, 1};
+    double R[1] = {0.25};
+
+    // Declaring default parameters
+    CSTR_parameters params = default_parameters();
+    params.sigma = 10;
+
+    // Inserting default flow rate in [L / s]
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    flow_rate(pflow_rate);
+    int i;
+    for (i=0;i<number_of_samples;i++){
+        pflow_rate[i] = pflow_rate[i]/(60*1000);
+    }
+
+    // The particles start from a wrong guess of the concentrations
+    double x0_true[3] = {0.05, 0.25, params.Tin};
+    double x0_guess[3] = {0.2, 0.4, params.Tin};
+    double P0[3] = {0.05, 0.05, 1};
+    particle_filter *ppf = pf_create(NP,m,time_steps_per_sample,sample_time_seconds,H,R,x0_guess,P0,&params,2021);
+    if (ppf == NULL){
+        printf("Error: Could not allocate the particles.\n");
+        free(pflow_rate);
+        return 0;
+    }
+
+    // The plant is simulated with the implicit Euler scheme
+    double *pT = (double*) malloc((time_steps_per_sample+1)*sizeof(double));
+    linspace(pT,0,sample_time_seconds,time_steps_per_sample);
+    double *pX = (double*) malloc(n*(time_steps_per_sample+1)*sizeof(double));
+    double *pdW = (double*) malloc(n*time_steps_per_sample*sizeof(double));
+    unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    double workspace_lf[(5+2*3)*3];
+    int workspace_d[3];
+    double plant[3] = {x0_true[0], x0_true[1], x0_true[2]};
+    double mean[3];
+    double y, v;
+
+    int sample;
+    double timer, elapsed;
+    double max_elapsed = 0;
+    double total_elapsed = 0;
+    for (sample=0;sample<number_of_samples;sample++){
+        // Advancing the plant and measuring the temperature
+        d_rand_normal_seeded(pdW,pgenerator,n*time_steps_per_sample,mersenne_stream_seed(12345,sample),0,1);
+        d_rand_normal_seeded(&v,pgenerator,1,mersenne_stream_seed(54321,sample),0,sqrt(R[0]));
+        vector_implicit_euler(
+            time_steps_per_sample,
+            n,
+            1,
+            pT,
+            pX,
+            pdW,
+            workspace_lf,
+            workspace_d,
+            20,
+            10e-6,
+            CSTR_3D_drift,
+            CSTR_3D_diffusion,
+            CSTR_3D_drift_jacobian,
+            &pflow_rate[sample],
+            NULL,
+            &params,
+            plant
+        );
+        for (i=0;i<n;i++){
+            plant[i] = pX[time_steps_per_sample*n+i];
+        }
+        y = plant[2]+v;
+
+        // Propagating and updating the particles
+        timer = omp_get_wtime();
+        pf_propagate(ppf,&pflow_rate[sample]);
+        if (use_enkf){
+            enkf_update(ppf,&y);
+        }
+        else {
+            pf_update(ppf,&y);
+        }
+        elapsed = omp_get_wtime()-timer;
+        total_elapsed += elapsed;
+        if (elapsed > max_elapsed){
+            max_elapsed = elapsed;
+        }
+
+        pf_mean(ppf,mean);
+        printf("Sample %2d: error C_A = %9lf, error C_B = %9lf, error T = %9lf, ESS = %9.0lf, time = %lf ms\n",
+            sample,mean[0]-plant[0],mean[1]-plant[1],mean[2]-plant[2],ppf->effective_sample_size,1000*elapsed);
+    }
+    printf("Resampled %d times, log likelihood = %lf\n",ppf->num_resamples,ppf->log_likelihood);
+    printf("Largest time per sample: %lf ms\n",1000*max_elapsed);
+    printf("Throughput: %.3e particles per second\n",(double) NP*number_of_samples/total_elapsed);
+
+    // Avoiding memory leakage
+    pf_destroy(ppf);
+    free(pgenerator);
+    free(pdW);
+    free(pX);
+    free(pT);
+    free(pflow_rate);
+
+    return 0;
+}
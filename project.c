@@ -4,28 +4,84 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <math.h>
 #include <time.h>
 #include <omp.h>
 #include "ImplicitEulerSolver.h"
 #include "MersenneTwister.h"
 #include "RandomProcesses.h"
 #include "CSTR.h"
+#include "NMPC.h"
+#include "Checkpoint.h"
+#include "Instrumentation.h"
+#include "Profiling.h"
+#include "Scenario.h"
 
 int main(int argc, char *argv[]){
-    if (argc!=2){
+    if (argc < 2 || argc > 8){
         printf("Please provide the number of realizations of noise.\n");
+        printf("Add --nmpc to simulate the closed loop with the NMPC instead of the open loop flow rate.\n");
+        printf("Add --resume to continue an interrupted run from its last checkpoint.\n");
+        printf("Add --profile to read hardware counters of every phase and compare them to a roofline of the host.\n");
+        printf("Add --scenarios <file> to read the horizon and the flow rates, initial states and parameters of the\n");
+        printf("realizations from a scenario file, see Scenario.h.\n");
+        printf("Add --arrhenius-table to evaluate the rate constant by interpolation in a table, see Arrhenius.h.\n");
         return 0;
     }
 
+    // Closed loop simulation with the nonlinear MPC and resuming from a checkpoint
+    int closed_loop = 0;
+    int resume = 0;
+    int profile = 0;
+    int use_table = 0;
+    const char *scenario_path = NULL;
+    int a;
+    for (a=2;a<argc;a++){
+        if (strcmp(argv[a],"--nmpc")==0){
+            closed_loop = 1;
+        }
+        else if (strcmp(argv[a],"--resume")==0){
+            resume = 1;
+        }
+        else if (strcmp(argv[a],"--profile")==0){
+            profile = 1;
+        }
+        else if (strcmp(argv[a],"--arrhenius-table")==0){
+            use_table = 1;
+        }
+        else if (strcmp(argv[a],"--scenarios")==0 && a+1 < argc){
+            scenario_path = argv[++a];
+        }
+        else {
+            printf("Error: Unknown option %s.\n",argv[a]);
+            return 0;
+        }
+    }
+
+    // Scenarios with their own flow rates, initial states and parameters
+    scenario_batch *pscenarios = NULL;
+    if (scenario_path != NULL){
+        int error_line;
+        pscenarios = scenario_read(scenario_path,&error_line);
+        if (pscenarios == NULL){
+            printf("Error: Could not read the scenarios in %s, line %d.\n",scenario_path,error_line);
+            return 0;
+        }
+        if (closed_loop){
+            printf("Error: The flow rates of --nmpc cannot be combined with --scenarios.\n");
+            return 0;
+        }
+    }
 
     // One time step is 1 seconds
-    int time_steps_per_sample = 60;
+    int time_steps_per_sample = (pscenarios != NULL) ? pscenarios->time_steps_per_sample : 60;
     
     // Sample time is one minute
-    int sample_time_seconds = 60;
+    double sample_time_seconds = (pscenarios != NULL) ? pscenarios->sample_time : 60;
     
     // Experiment takes 35 minutes
-    int number_of_samples = 35;
+    int number_of_samples = (pscenarios != NULL) ? pscenarios->num_samples : 35;
     
     int total_steps = number_of_samples*time_steps_per_sample;
 
@@ -43,7 +99,24 @@ int main(int argc, char *argv[]){
     int NS = atoi(argv[1]); // Number of realizations of noise
     if (NS < 1){
         printf("Error: The number of simulations must be larger than 0.\n");
+        return 0;
     }
+    if (pscenarios != NULL && pscenarios->num_realizations != NS){
+        printf("Error: The scenarios in %s have %d realizations.\n",scenario_path,pscenarios->num_realizations);
+        return 0;
+    }
+
+    // The realizations are simulated in blocks of 64 realizations per thread, which bound the memory, and a
+    // checkpoint is written after the block in which checkpoint_seconds have passed since the last one. Every
+    // realization draws its noise from its own stream, so the results depend on neither the block size nor the
+    // number of threads
+    int max_num_threads = 1;
+    #if defined(_OPENMP)
+    	max_num_threads = omp_get_max_threads();
+    #endif
+    int block_size = 64*max_num_threads;
+    int max_block = (NS < block_size) ? NS : block_size;
+    double checkpoint_seconds = 10;
     
     // Pointing to the drift
     functiontype f_func = CSTR_3D_drift;
@@ -54,11 +127,11 @@ int main(int argc, char *argv[]){
     // Pointing to the Jacobian
     functiontype J_func = CSTR_3D_drift_jacobian;    
 
-    // Allocating memory for the spatial solution
-    int problem_size_x = n*(N+1)*NS;
+    // Allocating memory for the spatial solution of one block
+    int problem_size_x = n*(N+1)*max_block;
     
     // The noise is shorter since there is no noise on the initial condition
-    int problem_size_dW = nw*N*NS;
+    int problem_size_dW = nw*N*max_block;
     double *pX = (double*) malloc(problem_size_x*sizeof(double));
 
     // Allocating memory for the white noise
@@ -67,22 +140,45 @@ int main(int argc, char *argv[]){
     // Allocating memory for the temporal solution
     double *pT = (double*) malloc((N+1)*sizeof(double));
 
-    // Allocating memory for seeding Mersenne Twister
-    unsigned long *pworkspace_ul = (unsigned long*) malloc(624*sizeof(unsigned long));
+    // Allocating memory for a Mersenne Twister generator per thread
+    unsigned long *pworkspace_ul = (unsigned long*) malloc(max_num_threads*624*sizeof(unsigned long));
 
     // Allocating memory for the implicit-explicit Euler scheme for vector drift
-    int max_num_threads = 1;
-    #if defined(_OPENMP)
-    	max_num_threads = omp_get_max_threads();
-    #endif
     double *pworkspace_lf = (double*) malloc(max_num_threads*(5+2*n)*n*sizeof(double));
 
     // Allocating memory for DGESV
     int workspace_d[max_num_threads*n];
     int *pworkspace_d = &workspace_d[0];
 
-    // Allocating memory for the flow rate
-    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    // Hardware counters of every thread, the first thread also counts the output
+    profile_counters *pprofiles = NULL;
+    if (profile){
+        pprofiles = (profile_counters*) calloc(max_num_threads,sizeof(profile_counters));
+        if (pprofiles == NULL){
+            printf("Error: Could not allocate the counters.\n");
+            return 0;
+        }
+    }
+
+    // Allocating memory for the flow rate, which is given for every realization of a block by the scenarios
+    double *pflow_rate = (double*) malloc(((pscenarios != NULL) ? max_block : 1)*number_of_samples*sizeof(double));
+    CSTR_parameters *pscenario_params = NULL;
+    if (pscenarios != NULL){
+        pscenario_params = (CSTR_parameters*) malloc(max_block*sizeof(CSTR_parameters));
+        if (pscenario_params == NULL){
+            printf("Error: Could not allocate the parameters of the scenarios.\n");
+            return 0;
+        }
+    }
+
+    // Allocating memory for the closed loop input profiles and the temperature reference
+    double *pclosed_loop_rate = NULL;
+    double *preference = NULL;
+    if (closed_loop){
+        pclosed_loop_rate = (double*) malloc(max_block*number_of_samples*sizeof(double));
+        preference = (double*) malloc(number_of_samples*sizeof(double));
+        temperature_reference(preference);
+    }
 
     ///! [allocating memory]
 
@@ -94,43 +190,89 @@ int main(int argc, char *argv[]){
     CSTR_parameters *pP = &params;
     pP->sigma = 10;
 
+    // Optional table of the rate constant over the temperatures the reactor can reach
+    if (use_table){
+        pP->parrhenius = arrhenius_table_create(pP->k0,pP->EaR,250,450,1e-12);
+        if (pP->parrhenius == NULL){
+            printf("Error: Could not build the table of the rate constant.\n");
+            return 0;
+        }
+    }
+
     // There are no disturbances in this model
     double *pd = NULL;
 
-    // Inserting default flow rate parameters for simulation
-    flow_rate(pflow_rate);
+    // Inserting default flow rate parameters for simulation, or those of the first realization of the scenarios
+    if (pscenarios != NULL){
+        memcpy(pflow_rate,pscenarios->pgroups[0].pu,number_of_samples*sizeof(double));
+    }
+    else {
+        flow_rate(pflow_rate);
+    }
     int i = 0;
-    FILE *F_file = fopen("F.txt", "w");
+    FILE *F_file;
+    if (!closed_loop && !resume){
+        F_file = fopen("F.txt", "w");
+        for (i=0;i<number_of_samples;i++){
+            fprintf(F_file,"%1.15f\n",pflow_rate[i]);
+        }
+        fclose(F_file);
+    }
     for (i=0;i<number_of_samples;i++){
-        fprintf(F_file,"%1.15f\n",pflow_rate[i]);
         pflow_rate[i] = pflow_rate[i]/(60*1000);
     }
-    fclose(F_file);
 
-    // Imposing initial condition
-    int x0_index = 0;
-    int x0_increment = n*(N+1);
-    for (i=0;i<NS;i++){
-        pX[x0_index+0] = 0.05;
-        pX[x0_index+1] = 0.25;
-        pX[x0_index+2] = params.Tin;
-        x0_index += x0_increment;
+    // The checkpoint holds the number of completed realizations, the base seed of the noise streams,
+    // the sizes of X.txt and U.txt and the sums of the temperature and its square at every time step
+    const char *checkpoint_path = "checkpoint.bin";
+
+    // Hash of the inputs which the number of realizations, the mode and N do not give: the rate table and the
+    // contents of the scenario file
+    unsigned long inputs = 0xcbf29ce484222325UL^(unsigned long) use_table;
+    if (scenario_path != NULL && checkpoint_hash_file(scenario_path,&inputs) != 0){
+        printf("Error: Could not read %s.\n",scenario_path);
+        return 0;
     }
-    
-    // Seeding the algorithm
-    set_seed(12345);
-    
-    // Generating the noise - despite the name of the function it is noise.
-    // It is not accumulated into a Brownian path
-    scalar_wiener_process(
-        pdW,
-        pworkspace_ul,
-        number_of_samples*sample_time_seconds, // to seconds
-        N,
-        nw,
-        NS
-    );
-    
+    campaign_checkpoint *pcheckpoint;
+    FILE *X_file;
+    FILE *U_file = NULL;
+    if (resume){
+        pcheckpoint = checkpoint_read(checkpoint_path);
+        if (pcheckpoint == NULL || pcheckpoint->num_realizations != NS || pcheckpoint->mode != closed_loop
+            || pcheckpoint->num_statistics != N+1){
+            printf("Error: No checkpoint of a run with %d realizations%s in %s.\n",NS,closed_loop ? " and --nmpc" : "",checkpoint_path);
+            return 0;
+        }
+        if (pcheckpoint->inputs != inputs){
+            printf("Error: The checkpoint in %s is of a run with another scenario file or --arrhenius-table setting.\n",
+                checkpoint_path);
+            return 0;
+        }
+
+        // Discarding output written after the checkpoint
+        if (checkpoint_truncate_output("X.txt",pcheckpoint->poutput_offsets[0]) != 0
+            || (closed_loop && checkpoint_truncate_output("U.txt",pcheckpoint->poutput_offsets[1]) != 0)){
+            printf("Error: The output files do not match the checkpoint.\n");
+            return 0;
+        }
+        X_file = fopen("X.txt", "a");
+        if (closed_loop){
+            U_file = fopen("U.txt", "a");
+        }
+        printf("Resuming after %lu of %d realizations\n",pcheckpoint->completed,NS);
+    }
+    else {
+        pcheckpoint = checkpoint_create(NS,closed_loop,inputs,2,N+1,12345);
+        X_file = fopen("X.txt", "w");
+        if (closed_loop){
+            U_file = fopen("U.txt", "w");
+        }
+    }
+    if (pcheckpoint == NULL || X_file == NULL || (closed_loop && U_file == NULL)){
+        printf("Error: Could not open the output files.\n");
+        return 0;
+    }
+
     // Generating equidistant time grid
     linspace(
         pT,
@@ -150,74 +292,301 @@ int main(int argc, char *argv[]){
     // and generate a vector of parameters structs
     int p_increment = 0;
 
+    // The same flow rates are used in every simulation, unless the scenarios give them per realization
+    int u_increment = 0;
+    if (pscenarios != NULL){
+        pP = pscenario_params;
+        p_increment = 1;
+        u_increment = number_of_samples;
+    }
+
     // A new realization of noise is used in every simulation
     int dw_increment = nw*N;
 
     // For OpenMP loop
     int size_x = n*(N+1);
 
+    // Estimated floating point operations of a normal random number and of an open loop time step, used by --profile.
+    // A transcendental function is counted as 10 operations and a step needs 1.4 Newton iterations on average
+    double flops_per_normal = 25;
+    double flops_per_step = 250;
+
+    // Standard deviation of the noise
+    double sqrtdt = sqrt(pT[1]-pT[0]);
+
     // OpenMP thread private variables:
     int thread_index, number_of_threads, thread_points, thread_start;
-    
-    // Starting timing
-    double timer = omp_get_wtime();
-    
-    #pragma omp parallel default(shared) private(thread_index,number_of_threads, thread_points, thread_start)
-    {   
+    int block_start, block, j, l;
+    int controller_failed = 0;
+    int failed_realizations = 0;
+
+    // Only the simulation is timed, the noise, the output and the checkpoints are not
+    double timer = 0;
+    double simulation_start = 0;
+    double last_checkpoint = omp_get_wtime();
+
+    #pragma omp parallel default(shared) private(thread_index,number_of_threads,thread_points,thread_start,block_start,block,i)
+    {
         thread_index = omp_get_thread_num();
-        number_of_threads =  omp_get_num_threads();
-        thread_points = (int) NS / number_of_threads;
-        thread_start = thread_index*thread_points;
-        if (thread_index == number_of_threads-1){
-            thread_points = NS - thread_start;
-        }
-        printf("Thread %d simulating experiment %d to %d\n",thread_index,thread_start,thread_start+thread_points);
-        implicit_simulation(
-            pT,
-            &pX[thread_start*size_x],
-            &pdW[thread_start*dw_increment],
-            &pworkspace_lf[(2*n+5)*n*thread_index],
-            &pworkspace_d[n*thread_index],
-            max_iterations,
-            tolerance,
-            f_func,
-            g_func,
-            J_func,
-            pflow_rate, //pu, for storing closed loop input profiles
-            pd,
-            pP,
-            thread_points,
-            number_of_samples,
-            time_steps_per_sample,
-            N,
-            n,
-            dw_increment, // if 0, the same measurement noise will be used in all simulations
-            p_increment // if 0, the same parameter vector will be used in all simulations
-        );
+        number_of_threads = omp_get_num_threads();
+        printf("Thread %d simulating its share of every block of up to %d experiments\n",thread_index,max_block);
+
+        // The counters are opened once, since the region runs on the same system threads throughout
+        if (profile){
+            profile_open(&pprofiles[thread_index]);
+        }
+
+        // Every thread has its own controller with a horizon of 10 samples, which runs on that thread only
+        nmpc_controller *pcontroller = NULL;
+        if (closed_loop){
+            pcontroller = nmpc_create(10,time_steps_per_sample,sample_time_seconds,pP,50,1000);
+            if (pcontroller == NULL){
+                #pragma omp atomic write
+                controller_failed = 1;
+            }
+        }
+        #pragma omp barrier
+
+        for (block_start=pcheckpoint->completed;block_start<NS && !controller_failed;block_start+=block){
+            block = (NS-block_start < block_size) ? NS-block_start : block_size;
+            thread_points = block / number_of_threads;
+            thread_start = thread_index*thread_points;
+            if (thread_index == number_of_threads-1){
+                thread_points = block - thread_start;
+            }
+
+            // Imposing initial condition
+            #pragma omp master
+            {
+                if (pscenarios != NULL){
+                    scenario_expand(pscenarios,block_start,block,pflow_rate,pX,size_x,pscenario_params);
+
+                    // Realizations with other rate parameters than the table evaluate exp()
+                    for (i=0;i<block;i++){
+                        pscenario_params[i].parrhenius = params.parrhenius;
+                    }
+                }
+                else for (i=0;i<block;i++){
+                    pX[i*size_x+0] = 0.05;
+                    pX[i*size_x+1] = 0.25;
+                    pX[i*size_x+2] = params.Tin;
+                }
+            }
+
+            // Generating the noise of the realizations of the thread, realization i from stream i
+            INSTRUMENT_PHASE_BEGIN(noise_timer);
+            if (profile){
+                profile_begin(&pprofiles[thread_index]);
+            }
+            for (i=thread_start;i<thread_start+thread_points;i++){
+                d_rand_normal_seeded(
+                    &pdW[i*dw_increment],
+                    &pworkspace_ul[624*thread_index],
+                    dw_increment,
+                    mersenne_stream_seed(pcheckpoint->seed,(unsigned long) (block_start+i)),
+                    0,
+                    sqrtdt
+                );
+            }
+            INSTRUMENT_PHASE_END(noise_timer,INSTRUMENTATION_PHASE_NOISE);
+            if (profile){
+                profile_end(&pprofiles[thread_index],INSTRUMENTATION_PHASE_NOISE);
+                pprofiles[thread_index].pflops[INSTRUMENTATION_PHASE_NOISE] += flops_per_normal*dw_increment*thread_points;
+            }
+            #pragma omp barrier
+            #pragma omp master
+            simulation_start = omp_get_wtime();
+
+            INSTRUMENT_PHASE_BEGIN(simulation_timer);
+            if (profile){
+                profile_begin(&pprofiles[thread_index]);
+            }
+            if (pcontroller != NULL){
+                closed_loop_simulation(
+                    pcontroller,
+                    pT,
+                    &pX[thread_start*size_x],
+                    &pdW[thread_start*dw_increment],
+                    &pworkspace_lf[(2*n+5)*n*thread_index],
+                    &pworkspace_d[n*thread_index],
+                    max_iterations,
+                    tolerance,
+                    &pclosed_loop_rate[thread_start*number_of_samples],
+                    preference,
+                    pP,
+                    thread_points,
+                    number_of_samples,
+                    time_steps_per_sample,
+                    N,
+                    n,
+                    dw_increment,
+                    p_increment
+                );
+            }
+            else {
+                int failed = implicit_simulation(
+                    pT,
+                    &pX[thread_start*size_x],
+                    &pdW[thread_start*dw_increment],
+                    &pworkspace_lf[(2*n+5)*n*thread_index],
+                    &pworkspace_d[n*thread_index],
+                    max_iterations,
+                    tolerance,
+                    f_func,
+                    g_func,
+                    J_func,
+                    &pflow_rate[thread_start*u_increment], //pu, for storing closed loop input profiles
+                    pd,
+                    &pP[thread_start*p_increment],
+                    thread_points,
+                    number_of_samples,
+                    time_steps_per_sample,
+                    N,
+                    n,
+                    dw_increment, // if 0, the same measurement noise will be used in all simulations
+                    p_increment, // if 0, the same parameter vector will be used in all simulations
+                    u_increment // if 0, the same flow rates will be used in all simulations
+                );
+                #pragma omp atomic
+                failed_realizations += failed;
+            }
+            INSTRUMENT_PHASE_END(simulation_timer,INSTRUMENTATION_PHASE_SIMULATION);
+            if (profile){
+                profile_end(&pprofiles[thread_index],INSTRUMENTATION_PHASE_SIMULATION);
+                pprofiles[thread_index].pflops[INSTRUMENTATION_PHASE_SIMULATION] += flops_per_step*N*thread_points;
+            }
+            #pragma omp barrier
+
+            // Appending the block to the output files while the other threads wait for the next block
+            #pragma omp master
+            {
+                timer += omp_get_wtime()-simulation_start;
+                INSTRUMENT_PHASE_BEGIN(io_timer);
+                if (profile){
+                    profile_begin(&pprofiles[0]);
+                }
+                for (j=0;j<size_x*block;j++){
+                    fprintf(X_file,"%1.15f\n",pX[j]);
+                }
+
+                // In closed loop F.txt holds the flow rate of the first realization
+                // and U.txt the flow rates of all realizations in [mL / min]
+                if (closed_loop){
+                    if (block_start == 0){
+                        F_file = fopen("F.txt", "w");
+                        for (i=0;i<number_of_samples;i++){
+                            fprintf(F_file,"%1.15f\n",pclosed_loop_rate[i]*60*1000);
+                        }
+                        fclose(F_file);
+                    }
+                    for (i=0;i<block*number_of_samples;i++){
+                        fprintf(U_file,"%1.15f\n",pclosed_loop_rate[i]*60*1000);
+                    }
+                }
+
+                // Accumulating the temperature statistics in the order of the realizations
+                for (i=0;i<block;i++){
+                    for (l=0;l<(N+1);l++){
+                        double temperature = pX[i*size_x+l*n+2];
+                        pcheckpoint->psum[l] += temperature;
+                        pcheckpoint->psum_squares[l] += temperature*temperature;
+                    }
+                }
+                pcheckpoint->completed = block_start+block;
+
+                // The output files are flushed to disk before the checkpoint which records their sizes
+                if (pcheckpoint->completed == (unsigned long) NS || omp_get_wtime()-last_checkpoint >= checkpoint_seconds){
+                    pcheckpoint->poutput_offsets[0] = checkpoint_sync_output(X_file);
+                    if (closed_loop){
+                        pcheckpoint->poutput_offsets[1] = checkpoint_sync_output(U_file);
+                    }
+                    if (pcheckpoint->poutput_offsets[0] < 0 || (closed_loop && pcheckpoint->poutput_offsets[1] < 0)
+                        || checkpoint_write(checkpoint_path,pcheckpoint) != 0){
+                        printf("Warning: Could not write the checkpoint.\n");
+                    }
+                    last_checkpoint = omp_get_wtime();
+                }
+                INSTRUMENT_PHASE_END(io_timer,INSTRUMENTATION_PHASE_IO);
+                if (profile){
+                    profile_end(&pprofiles[0],INSTRUMENTATION_PHASE_IO);
+                }
+            }
+        }
+        nmpc_destroy(pcontroller);
+        if (profile){
+            profile_close(&pprofiles[thread_index]);
+        }
+    }
+
+    if (controller_failed){
+        printf("Error: Could not allocate the controller.\n");
+        return 0;
     }
     
-    // Finishing timing
-    timer = omp_get_wtime()-timer;
+    // Time of the simulation
     printf("%lf\n", timer);
-    
-    
-    FILE* X_file;
+    if (failed_realizations > 0){
+        printf("Warning: The Newton solver did not converge in %d realizations.\n",failed_realizations);
+    }
+
+    // Closing the output files
+    fclose(X_file);
+    if (closed_loop){
+        fclose(U_file);
+    }
+
     FILE* T_file;
-    X_file = fopen("X.txt", "w");
+    FILE* M_file;
     T_file = fopen("T.txt", "w");
-    int j,l;
-    for (j=0;j<(N+1)*n*NS;j++){
-        fprintf(X_file,"%1.15f\n",pX[j]);
-    }
+    M_file = fopen("M.txt", "w");
     for (l=0;l<(N+1);l++){
         fprintf(T_file,"%1.15f\n",pT[l]/60);
     }
+
+    // Mean and standard deviation of the temperature over all realizations
+    for (l=0;l<(N+1);l++){
+        double mean = pcheckpoint->psum[l]/NS;
+        double variance = (NS > 1) ? (pcheckpoint->psum_squares[l]-NS*mean*mean)/(NS-1) : 0;
+        fprintf(M_file,"%1.15f %1.15f\n",mean,variance > 0 ? sqrt(variance) : 0);
+    }
     
     // Closing files
+    fclose(M_file);
     fclose(T_file);
-    fclose(X_file);
+
+    // Solver counters and time per phase when compiled with -DCSTR_INSTRUMENTATION
+    #ifdef CSTR_INSTRUMENTATION
+    FILE *I_file = fopen("instrumentation.json", "w");
+    if (I_file != NULL){
+        instrumentation_write_json(I_file);
+        fclose(I_file);
+    }
+    #endif
     
+    // Hardware counters of every thread and of all threads compared to the roofline of the host
+    if (profile){
+        profile_counters total;
+        roofline roof;
+        memset(&total,0,sizeof(total));
+        printf("Simulation per thread:\n");
+        for (i=0;i<max_num_threads;i++){
+            double *pv = pprofiles[i].pvalues[INSTRUMENTATION_PHASE_SIMULATION];
+            printf("Thread %d: %lf s, IPC %lf\n",i,pprofiles[i].pseconds[INSTRUMENTATION_PHASE_SIMULATION],
+                pv[PROFILE_CYCLES] > 0 ? pv[PROFILE_INSTRUCTIONS]/pv[PROFILE_CYCLES] : 0);
+            profile_add(&total,&pprofiles[i]);
+        }
+        profile_roofline(&roof,max_num_threads);
+        profile_report(stdout,&total,&roof);
+    }
+
     // Avoiding memory leakage
+    free(pprofiles);
+    checkpoint_destroy(pcheckpoint);
+    free(preference);
+    free(pclosed_loop_rate);
+    free(pscenario_params);
+    arrhenius_table_destroy(params.parrhenius);
+    scenario_destroy(pscenarios);
     free(pflow_rate);
     free(pworkspace_lf);
     free(pworkspace_ul);
@@ -227,4 +596,3 @@ int main(int argc, char *argv[]){
 
     return 0;
 }
-
@@ -0,0 +1,92 @@
+/**
+* @snippet realtime.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "RealTime.h"
+#include "CSTR.h"
+
+int main(int argc, char *argv[]){
+    if (argc!=3){
+        printf("Please provide the number of realizations of noise and the horizon in samples.\n");
+        return 0;
+    }
+
+    // Number of realizations in every prediction
+    int NS = atoi(argv[1]);
+
+    // Prediction horizon in samples
+    int horizon = atoi(argv[2]);
+    if (NS < 1 || horizon < 1){
+        printf("Error: The number of simulations and the horizon must be larger than 0.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+
+    // Number of states
+    int n = 3;
+
+    // Declaring default parameters
+    CSTR_parameters params = default_parameters();
+    params.sigma = 10;
+
+    // Inserting default flow rate in [L / s]
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    flow_rate(pflow_rate);
+    int i,j;
+    for (i=0;i<number_of_samples;i++){
+        pflow_rate[i] = pflow_rate[i]/(60*1000);
+    }
+
+    // Everything used in the loop is allocated up front
+    realtime_context *pctx = realtime_create(
+        NS,
+        horizon,
+        time_steps_per_sample,
+        sample_time_seconds,
+        &params,
+        12345,
+        0
+    );
+    if (pctx == NULL){
+        printf("Error: Could not allocate the real-time predictor.\n");
+        free(pflow_rate);
+        return 0;
+    }
+    double *pu = (double*) malloc(horizon*sizeof(double));
+    double *pmean = (double*) malloc(n*(horizon+1)*sizeof(double));
+    double *pstd = (double*) malloc(n*(horizon+1)*sizeof(double));
+    double x[3] = {0.05, 0.25, params.Tin};
+
+    // One prediction per sample. The plant is replaced by the predicted mean.
+    for (i=0;i<number_of_samples;i++){
+        for (j=0;j<horizon;j++){
+            pu[j] = pflow_rate[(i+j < number_of_samples) ? i+j : number_of_samples-1];
+        }
+        realtime_predict(pctx,x,pu,horizon,pmean,pstd);
+        for (j=0;j<n;j++){
+            x[j] = pmean[n+j];
+        }
+        printf("Sample %2d: T = %lf K, std(T) at end of horizon = %lf K\n",i,x[2],pstd[n*horizon+2]);
+    }
+    realtime_latency_report(pctx,stdout);
+
+    // Avoiding memory leakage
+    realtime_destroy(pctx);
+    free(pstd);
+    free(pmean);
+    free(pu);
+    free(pflow_rate);
+
+    return 0;
+}
@@ -0,0 +1,214 @@
+/**
+* @snippet selftest.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+#include "Scenario.h"
+#include "ImplicitEulerSolver.h"
+#include "SequentialMonteCarlo.h"
+
+static int compare_seeds(
+    const void *pa,
+    const void *pb
+){
+    unsigned long a = *(const unsigned long*) pa;
+    unsigned long b = *(const unsigned long*) pb;
+    return (a > b) - (a < b);
+}
+
+// Number of equal neighbours of a sorted array
+static long count_duplicates(
+    unsigned long *pvalues,
+    long count
+){
+    long i;
+    long duplicates = 0;
+    qsort(pvalues,count,sizeof(unsigned long),compare_seeds);
+    for (i=1;i<count;i++){
+        duplicates += (pvalues[i] == pvalues[i-1]);
+    }
+    return duplicates;
+}
+
+// The streams of a base seed have distinct seeds and distinct first random numbers
+static int check_streams(void){
+    long num_seeds = 4000000;
+    long num_streams = 200000;
+    unsigned long seed = 2021;
+    unsigned long *pvalues = (unsigned long*) malloc(num_seeds*sizeof(unsigned long));
+    unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+    if (pvalues == NULL || pgenerator == NULL){
+        free(pgenerator);
+        free(pvalues);
+        printf("Error: Could not allocate the streams.\n");
+        return 1;
+    }
+    long i;
+    for (i=0;i<num_seeds;i++){
+        pvalues[i] = mersenne_stream_seed(seed,(unsigned long) i);
+    }
+    long seed_duplicates = count_duplicates(pvalues,num_seeds);
+
+    // The first two uniform numbers of a stream hold 64 random bits
+    for (i=0;i<num_streams;i++){
+        double pu[2];
+        mersenne_twister_seeded(pu,pgenerator,2,mersenne_stream_seed(seed,(unsigned long) i));
+        pvalues[i] = ((unsigned long) (pu[0]*4294967296.0) << 32) | (unsigned long) (pu[1]*4294967296.0);
+    }
+    long stream_duplicates = count_duplicates(pvalues,num_streams);
+    free(pgenerator);
+    free(pvalues);
+    printf("%-40s %ld duplicate seeds in %ld streams, %ld duplicate samples in %ld streams\n","Random number streams",
+        seed_duplicates,num_seeds,stream_duplicates,num_streams);
+    return seed_duplicates > 0 || stream_duplicates > 0;
+}
+
+// A scenario which only sets DeltaH has another temperature trajectory than the default scenario
+static int check_scenario_heat(void){
+    const char *path = "selftest_scenarios.txt";
+    FILE *pfile = fopen(path,"w");
+    if (pfile == NULL){
+        printf("Error: Could not write %s.\n",path);
+        return 1;
+    }
+    fprintf(pfile,"samples 35\nsteps_per_sample 10\nscenario 1\nscenario 1\nDeltaH -280000\n");
+    fclose(pfile);
+    int error_line;
+    scenario_batch *pb = scenario_read(path,&error_line);
+    remove(path);
+    if (pb == NULL){
+        printf("Error: Could not read the scenarios, line %d.\n",error_line);
+        return 1;
+    }
+    int n = 3;
+    int N = pb->num_samples*pb->time_steps_per_sample;
+    double pt[N+1];
+    double pu[2*pb->num_samples];
+    double px[2*n*(N+1)];
+    double pdW[n*N];
+    double pworkspace_lf[(5+2*n)*n];
+    int pworkspace_d[n];
+    CSTR_parameters pparams[2];
+    memset(pdW,0,sizeof(pdW));
+    linspace(pt,0,pb->num_samples*pb->sample_time,N);
+    scenario_expand(pb,0,2,pu,px,n*(N+1),pparams);
+
+    // Without noise, the realizations only differ by DeltaH
+    implicit_simulation(pt,px,pdW,pworkspace_lf,pworkspace_d,20,10e-6,CSTR_3D_drift,CSTR_3D_diffusion,
+        CSTR_3D_drift_jacobian,pu,NULL,pparams,2,pb->num_samples,pb->time_steps_per_sample,N,n,0,1,pb->num_samples);
+    double difference = 0;
+    int k;
+    for (k=0;k<=N;k++){
+        difference = fmax(difference,fabs(px[n*k+2]-px[n*(N+1)+n*k+2]));
+    }
+    scenario_destroy(pb);
+    printf("%-40s beta %.4f and %.4f, temperatures differ by up to %.3f K\n","Scenario with DeltaH",
+        pparams[0].beta,pparams[1].beta,difference);
+    return !(fabs(pparams[1].beta-0.5*pparams[0].beta) < 1e-3) || !(difference > 1);
+}
+
+// Drift x/h with the step h of check_singular_newton(), for which I - J*h vanishes
+static void singular_drift(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    pxdot[0] = px[0]/0.5;
+}
+
+static void singular_jacobian(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    pxdot[0] = 1/0.5;
+}
+
+static void zero_column(
+    double *pt,
+    double *px,
+    double *pu,
+    double *pd,
+    void *pP,
+    double *pxdot
+){
+    pxdot[0] = 0;
+}
+
+// A singular Newton system is reported and the sensitivities are not solved for with its factorization
+static int check_singular_newton(void){
+    double pt[3] = {0, 0.5, 1};
+    double px[3];
+    double pS[3];
+    double pdW[2] = {0, 0};
+    double pworkspace_lf[1*(5+2*1+2*1+1)];
+    int pworkspace_d[1];
+    int pcolumns[1] = {0};
+    double px0 = 1;
+    double pS0 = 1;
+    int failures = vector_implicit_euler_sensitivity(2,1,1,pt,px,pS,pdW,pworkspace_lf,pworkspace_d,20,10e-6,
+        singular_drift,zero_column,singular_jacobian,zero_column,zero_column,1,pcolumns,NULL,NULL,NULL,&px0,&pS0);
+    printf("%-40s %d failed Newton solves, final sensitivity %g\n","Singular Newton system",failures,pS[2]);
+    return failures != 2 || !isnan(pS[1]) || !isnan(pS[2]);
+}
+
+static void final_temperature(
+    double *px,
+    int N,
+    int n,
+    void *pdata,
+    double *pvalue
+){
+    pvalue[0] = px[N*n+2];
+}
+
+// The sequential estimate stops at the same realization for any batch size
+static int check_sequential_stopping(void){
+    CSTR_parameters params = default_parameters();
+    double x0[3] = {0.05, 0.25, params.Tin};
+    double pflow_rate[35];
+    double target = 0.4;
+    int pbatch_size[2] = {64, 7};
+    int prealizations[2];
+    double pmean[2];
+    int b;
+    flow_rate(pflow_rate);
+    for (b=0;b<2;b++){
+        sequential_mc *pmc = sequential_mc_create(&params,pflow_rate,10,10,60,x0,1,final_temperature,NULL,
+            pbatch_size[b],2021);
+        if (pmc == NULL){
+            printf("Error: Could not allocate the estimator.\n");
+            return 1;
+        }
+        prealizations[b] = sequential_mc_run(pmc,100000,&target);
+        pmean[b] = pmc->pmean[0];
+        if (!pmc->converged){
+            prealizations[b] = -1;
+        }
+        sequential_mc_destroy(pmc);
+    }
+    printf("%-40s %d and %d realizations for batches of %d and %d\n","Sequential stopping rule",prealizations[0],
+        prealizations[1],pbatch_size[0],pbatch_size[1]);
+    return prealizations[0] < 0 || prealizations[0] != prealizations[1] || pmean[0] != pmean[1];
+}
+
+int main(void){
+    int failures = 0;
+    failures += check_streams();
+    failures += check_scenario_heat();
+    failures += check_singular_newton();
+    failures += check_sequential_stopping();
+    printf("%d checks failed\n",failures);
+    return failures > 0;
+}
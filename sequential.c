@@ -0,0 +1,82 @@
+/**
+* @snippet sequential.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "SequentialMonteCarlo.h"
+#include "CSTR.h"
+
+// Final concentration of B and the indicator of the temperature exceeding the threshold in pdata
+static void final_CB_and_excursion(
+    double *px,
+    int N,
+    int n,
+    void *pdata,
+    double *pvalue
+){
+    double threshold = *(double*) pdata;
+    int k;
+    pvalue[0] = px[N*n+1];
+    pvalue[1] = 0;
+    for (k=0;k<=N;k++){
+        if (px[k*n+2] > threshold){
+            pvalue[1] = 1;
+            break;
+        }
+    }
+}
+
+int main(int argc, char *argv[]){
+    if (argc!=5){
+        printf("Please provide the largest number of realizations, the target half-width of the mean final\n");
+        printf("concentration of B in [mol / L], a temperature threshold in [K] and the target half-width of the\n");
+        printf("probability that the temperature exceeds the threshold.\n");
+        return 0;
+    }
+    int max_realizations = atoi(argv[1]);
+    double ptarget[2] = {atof(argv[2]), atof(argv[4])};
+    double threshold = atof(argv[3]);
+    if (max_realizations < 1){
+        printf("Error: The number of realizations must be larger than 0.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+
+    CSTR_parameters params = default_parameters();
+    double x0[3] = {0.05, 0.25, params.Tin};
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    flow_rate(pflow_rate);
+
+    sequential_mc *pmc = sequential_mc_create(&params,pflow_rate,number_of_samples,time_steps_per_sample,
+        sample_time_seconds,x0,2,final_CB_and_excursion,&threshold,64,2021);
+    if (pmc == NULL){
+        printf("Error: Could not allocate the estimator.\n");
+        free(pflow_rate);
+        return 0;
+    }
+
+    double timer = omp_get_wtime();
+    sequential_mc_run(pmc,max_realizations,ptarget);
+    timer = omp_get_wtime()-timer;
+
+    printf("Realizations: %d of at most %d, %s, time: %lf s\n",pmc->num_realizations,max_realizations,
+        pmc->converged ? "converged" : "not converged",timer);
+    printf("Mean final C_B = %lf mol/L +- %.3e\n",pmc->pmean[0],pmc->phalf_width[0]);
+    printf("P(T > %lf K) = %lf +- %.3e\n",threshold,pmc->pmean[1],pmc->phalf_width[1]);
+
+    // Avoiding memory leakage
+    sequential_mc_destroy(pmc);
+    free(pflow_rate);
+
+    return 0;
+}
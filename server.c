@@ -0,0 +1,30 @@
+/**
+* @snippet server.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "Service.h"
+
+int main(int argc, char *argv[]){
+    if (argc < 2 || argc > 6){
+        printf("Please provide the path of the socket. Optionally, add the batching window in milliseconds\n");
+        printf("(default 2) and the number of realizations which starts a batch at once (default 10000). With a\n");
+        printf("directory and a size in MB (default 256) as well, results are cached in the directory.\n");
+        return 0;
+    }
+    double window = (argc > 2) ? atof(argv[2])/1000 : 0.002;
+    int max_batch_realizations = (argc > 3) ? atoi(argv[3]) : 10000;
+    const char *cache_directory = (argc > 4) ? argv[4] : NULL;
+    double cache_megabytes = (argc > 5) ? atof(argv[5]) : 256;
+    if (window < 0 || max_batch_realizations < 1 || !(cache_megabytes > 0)){
+        printf("Error: The window must be positive, a batch must have at least one realization and the cache must\n");
+        printf("have a positive size.\n");
+        return 0;
+    }
+    if (service_run(argv[1],window,max_batch_realizations,0,cache_directory,(long) (cache_megabytes*1024*1024)) != 0){
+        printf("Error: Could not listen on %s or open the cache.\n",argv[1]);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,95 @@
+/**
+* @snippet session.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <omp.h>
+#include "CSTRSession.h"
+
+int main(int argc, char *argv[]){
+    if (argc!=2){
+        printf("Please provide the number of realizations of every session.\n");
+        return 0;
+    }
+    int num_realizations = atoi(argv[1]);
+    if (num_realizations < 1){
+        printf("Error: The number of realizations must be larger than 0.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds, the sample time is one minute and the experiment takes 35 minutes
+    int time_steps_per_sample = 60;
+    int number_of_samples = 35;
+    double sample_time_seconds = 60;
+    int size_x = 3*(number_of_samples*time_steps_per_sample+1);
+
+    CSTR_parameters params = default_parameters();
+    double x0[3] = {0.05, 0.25, params.Tin};
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    double *pmean = (double*) malloc(4*size_x*sizeof(double));
+    CSTR_session *psessions[2];
+    int s;
+    for (s=0;s<2;s++){
+        psessions[s] = CSTR_session_create(&params,number_of_samples,time_steps_per_sample,sample_time_seconds,
+            num_realizations,0,2021+s);
+    }
+    if (pflow_rate == NULL || pmean == NULL || psessions[0] == NULL || psessions[1] == NULL){
+        printf("Error: Could not allocate memory.\n");
+        return 0;
+    }
+    flow_rate(pflow_rate);
+
+    // The sessions one after the other
+    double timer = omp_get_wtime();
+    for (s=0;s<2;s++){
+        CSTR_session_run(psessions[s],pflow_rate,x0,num_realizations);
+        CSTR_session_statistics(psessions[s],&pmean[s*size_x],NULL);
+    }
+    double sequential_time = omp_get_wtime()-timer;
+
+    // The sessions concurrently from two threads, repeating the same realizations
+    omp_set_max_active_levels(2);
+    timer = omp_get_wtime();
+    #pragma omp parallel for num_threads(2)
+    for (s=0;s<2;s++){
+        CSTR_session_seed(psessions[s],2021+s);
+        CSTR_session_run(psessions[s],pflow_rate,x0,num_realizations);
+        CSTR_session_statistics(psessions[s],&pmean[(2+s)*size_x],NULL);
+    }
+    double concurrent_time = omp_get_wtime()-timer;
+
+    int identical = memcmp(pmean,&pmean[2*size_x],2*size_x*sizeof(double)) == 0;
+    printf("Mean final temperature of the sessions: %lf K and %lf K\n",pmean[size_x-1],pmean[2*size_x-1]);
+    printf("Sequential: %lf s, concurrent: %lf s, the concurrent runs are %s\n",sequential_time,concurrent_time,
+        identical ? "identical" : "different");
+
+    // An edit of the last five samples of the first session, compared with a full run of the second session with
+    // the seed of the first session
+    for (s=number_of_samples-5;s<number_of_samples;s++){
+        pflow_rate[s] = 500;
+    }
+    timer = omp_get_wtime();
+    int first_sample = CSTR_session_edit(psessions[0],pflow_rate);
+    double edit_time = omp_get_wtime()-timer;
+    CSTR_session_statistics(psessions[0],pmean,NULL);
+    CSTR_session_seed(psessions[1],2021);
+    timer = omp_get_wtime();
+    CSTR_session_run(psessions[1],pflow_rate,x0,num_realizations);
+    double run_time = omp_get_wtime()-timer;
+    CSTR_session_statistics(psessions[1],&pmean[size_x],NULL);
+    int edit_identical = memcmp(pmean,&pmean[size_x],size_x*sizeof(double)) == 0;
+    printf("Edit from sample %d: %lf s, full run: %lf s, the results are %s\n",first_sample,edit_time,run_time,
+        edit_identical ? "identical" : "different");
+    identical &= edit_identical;
+
+    // Avoiding memory leakage
+    for (s=0;s<2;s++){
+        CSTR_session_destroy(psessions[s]);
+    }
+    free(pmean);
+    free(pflow_rate);
+
+    return identical ? 0 : 1;
+}
@@ -0,0 +1,87 @@
+/**
+* @snippet splitting.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <omp.h>
+#include "RareEvents.h"
+#include "CSTR.h"
+
+int main(int argc, char *argv[]){
+    if (argc!=5){
+        printf("Please provide the number of trajectories per level, the number of replicates,\n");
+        printf("the temperature threshold in [K] and the number of levels.\n");
+        printf("With one level the probability is estimated with plain Monte Carlo and with 0 levels\n");
+        printf("the levels are chosen by a pilot run.\n");
+        return 0;
+    }
+    int num_trajectories = atoi(argv[1]);
+    int num_replicates = atoi(argv[2]);
+    double threshold = atof(argv[3]);
+    int num_levels = atoi(argv[4]);
+    if (num_trajectories < 1 || num_replicates < 1 || num_levels < 0){
+        printf("Error: The number of trajectories and replicates must be larger than 0.\n");
+        return 0;
+    }
+
+    // One time step is 1 seconds
+    int time_steps_per_sample = 60;
+
+    // Sample time is one minute
+    int sample_time_seconds = 60;
+
+    // Experiment takes 35 minutes
+    int number_of_samples = 35;
+
+    CSTR_parameters params = default_parameters();
+    double x0[3] = {0, 0, params.Tin};
+    double *pflow_rate = (double*) malloc(number_of_samples*sizeof(double));
+    flow_rate(pflow_rate);
+
+    // Levels spaced evenly from the upper steady state at the lowest flow rate to the threshold
+    double T_base = 345;
+    int adaptive = (num_levels == 0);
+    if (adaptive){
+        num_levels = 1;
+    }
+    double *plevels = (double*) malloc(num_levels*sizeof(double));
+    int i;
+    for (i=0;i<num_levels;i++){
+        plevels[i] = (num_levels == 1) ? threshold : T_base+(threshold-T_base)*i/(num_levels-1);
+    }
+
+    splitting_estimator *pe = splitting_create(&params,pflow_rate,number_of_samples,time_steps_per_sample,
+        sample_time_seconds,x0,plevels,num_levels,num_trajectories,2021);
+    if (pe == NULL){
+        printf("Error: Could not allocate the estimator. The threshold must be above %lf K.\n",T_base);
+        free(plevels);
+        free(pflow_rate);
+        return 0;
+    }
+
+    double timer = omp_get_wtime();
+    if (adaptive){
+        // Every stage is passed by about a fifth of the trajectories
+        if (splitting_choose_levels(pe,threshold,0.2,50) < 0){
+            printf("Error: Could not choose the levels.\n");
+        }
+        printf("Pilot run: %d levels, %.3e time steps\n",pe->num_levels,pe->simulated_steps);
+    }
+    splitting_estimate(pe,num_replicates);
+    timer = omp_get_wtime()-timer;
+
+    for (i=0;i<pe->num_levels;i++){
+        printf("Level %2d: T = %lf K, conditional probability = %lf\n",i,pe->plevels[i],pe->pstage_probability[i]);
+    }
+    printf("P(T > %lf K) = %.6e, standard error = %.3e, 95%% CI = [%.6e, %.6e]\n",
+        threshold,pe->probability,pe->standard_error,pe->ci_low,pe->ci_high);
+    printf("Simulated time steps: %.3e, time: %lf s\n",pe->simulated_steps,timer);
+
+    // Avoiding memory leakage
+    splitting_destroy(pe);
+    free(plevels);
+    free(pflow_rate);
+
+    return 0;
+}
@@ -0,0 +1,138 @@
+/**
+* @snippet tree.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <omp.h>
+#include "ScenarioTree.h"
+#include "ImplicitEulerSolver.h"
+#include "MersenneTwister.h"
+#include "RandomProcesses.h"
+
+int main(int argc, char *argv[]){
+    if (argc != 3){
+        printf("Please provide the number of branches of every node and the number of stages which branch, the\n");
+        printf("robust horizon. The tree has 10 samples and does not branch after the robust horizon.\n");
+        return 0;
+    }
+    int num_branches = atoi(argv[1]);
+    int robust_horizon = atoi(argv[2]);
+    int num_stages = 10;
+    if (num_branches < 1 || robust_horizon < 0 || robust_horizon > num_stages){
+        printf("Error: The number of branches must be positive and the robust horizon at most %d.\n",num_stages);
+        return 0;
+    }
+    int time_steps_per_sample = 60;
+    double sample_time = 60;
+    unsigned long seed = 2021;
+    int n = 3;
+    int pbranching[10];
+    int l;
+    for (l=0;l<num_stages;l++){
+        pbranching[l] = (l < robust_horizon) ? num_branches : 1;
+    }
+    scenario_tree *ptree = scenario_tree_create(num_stages,pbranching,time_steps_per_sample,sample_time,0);
+    CSTR_parameters *pparams = (CSTR_parameters*) malloc(num_branches*sizeof(CSTR_parameters));
+    if (ptree == NULL || pparams == NULL){
+        printf("Error: Could not allocate the tree.\n");
+        return 0;
+    }
+
+    // The branches are realizations of the pre-exponential factor within +-5 %, and the flow rate of every node
+    // is that of its sample in the experiment of project
+    int c;
+    for (c=0;c<num_branches;c++){
+        pparams[c] = default_parameters();
+        pparams[c].k0 *= 1+((num_branches > 1) ? 0.1*c/(num_branches-1)-0.05 : 0);
+    }
+    double pflow_rate[35];
+    flow_rate(pflow_rate);
+    long num_inner = ptree->plevel_start[num_stages];
+    long num_leaves = ptree->num_nodes-num_inner;
+    double *pu = (double*) malloc(num_inner*sizeof(double));
+    double *pleaves = (double*) malloc(n*num_leaves*sizeof(double));
+    if (pu == NULL || pleaves == NULL){
+        printf("Error: Could not allocate memory.\n");
+        return 0;
+    }
+    for (l=0;l<num_stages;l++){
+        long k;
+        for (k=ptree->plevel_start[l];k<ptree->plevel_start[l+1];k++){
+            pu[k] = pflow_rate[l];
+        }
+    }
+    double x0[3] = {0.05, 0.25, pparams[0].Tin};
+
+    double timer = omp_get_wtime();
+    scenario_tree_simulate(ptree,x0,pu,pparams,1,seed);
+    double tree_time = omp_get_wtime()-timer;
+
+    // Every leaf simulated from the root along its path with the noise of the nodes of the path
+    double sqrtdt = sqrt(ptree->pt[1]-ptree->pt[0]);
+    timer = omp_get_wtime();
+    #pragma omp parallel
+    {
+        double *ptrajectory = (double*) malloc(n*(time_steps_per_sample+1)*sizeof(double));
+        double *pdW = (double*) malloc((n*time_steps_per_sample+1)*sizeof(double));
+        double *pworkspace_lf = (double*) malloc(n*(5+2*n)*sizeof(double));
+        int *pworkspace_d = (int*) malloc(n*sizeof(int));
+        unsigned long *pgenerator = (unsigned long*) malloc(624*sizeof(unsigned long));
+        long ppath[11];
+        int pbranch[11];
+        long leaf;
+        int j;
+        #pragma omp for schedule(static)
+        for (leaf=0;leaf<num_leaves;leaf++){
+            double x[3];
+            ppath[num_stages] = num_inner+leaf;
+            for (j=num_stages;j>0;j--){
+                ppath[j-1] = scenario_tree_parent(ptree,ppath[j],&pbranch[j]);
+            }
+            memcpy(x,x0,n*sizeof(double));
+            for (j=0;j<num_stages;j++){
+                double u = pu[ppath[j]]/(60*1000);
+                d_rand_normal_seeded(pdW,pgenerator,n*time_steps_per_sample+((n*time_steps_per_sample)&1),
+                    mersenne_stream_seed(seed,(unsigned long) ppath[j+1]),0,sqrtdt);
+                vector_implicit_euler(time_steps_per_sample,n,1,&ptree->pt[j*time_steps_per_sample],ptrajectory,
+                    pdW,pworkspace_lf,pworkspace_d,20,10e-6,CSTR_3D_drift,CSTR_3D_diffusion,CSTR_3D_drift_jacobian,
+                    &u,NULL,&pparams[pbranch[j+1]],x);
+                memcpy(x,&ptrajectory[n*time_steps_per_sample],n*sizeof(double));
+            }
+            memcpy(&pleaves[n*leaf],x,n*sizeof(double));
+        }
+        free(pgenerator);
+        free(pworkspace_d);
+        free(pworkspace_lf);
+        free(pdW);
+        free(ptrajectory);
+    }
+    double path_time = omp_get_wtime()-timer;
+
+    // Statistics of the final temperature over the equally likely leaves
+    double mean = 0;
+    double minimum = INFINITY;
+    double maximum = -INFINITY;
+    long leaf;
+    for (leaf=0;leaf<num_leaves;leaf++){
+        double T = ptree->px[n*(num_inner+leaf)+2];
+        mean += T/num_leaves;
+        minimum = (T < minimum) ? T : minimum;
+        maximum = (T > maximum) ? T : maximum;
+    }
+    int identical = memcmp(&ptree->px[n*num_inner],pleaves,n*num_leaves*sizeof(double)) == 0;
+    printf("%ld nodes, %ld leaves\n",ptree->num_nodes,num_leaves);
+    printf("Final temperature: mean %lf K, min %lf K, max %lf K\n",mean,minimum,maximum);
+    printf("Tree: %lf s for %ld samples, paths: %lf s for %ld samples, the leaves are %s\n",tree_time,
+        ptree->num_nodes-1,path_time,num_leaves*num_stages,identical ? "identical" : "different");
+
+    // Avoiding memory leakage
+    scenario_tree_destroy(ptree);
+    free(pleaves);
+    free(pu);
+    free(pparams);
+
+    return identical ? 0 : 1;
+}
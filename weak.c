@@ -0,0 +1,81 @@
+/**
+* @snippet weak.c
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include <omp.h>
+#include "WeakExpectation.h"
+#include "CSTR.h"
+
+int main(int argc, char *argv[]){
+    if (argc != 3){
+        printf("Please provide the number of paths and the number of time steps per sample. The mean temperature\n");
+        printf("of the experiment of project is estimated with weak schemes and compared with the trapezoidal rule\n");
+        printf("with Gaussian increments and 60 time steps per sample.\n");
+        return 0;
+    }
+    int num_paths = atoi(argv[1]);
+    int time_steps_per_sample = atoi(argv[2]);
+    if (num_paths < 2 || time_steps_per_sample < 1){
+        printf("Error: At least 2 paths and 1 time step per sample are needed.\n");
+        return 0;
+    }
+
+    // Sample time is one minute and the experiment takes 35 minutes
+    double sample_time = 60;
+    int number_of_samples = 35;
+    int reference_steps = 60;
+    unsigned long seed = 2021;
+    int n = 3;
+
+    CSTR_parameters params = default_parameters();
+    double x0[3] = {0.05, 0.25, params.Tin};
+    double pflow_rate[35];
+    flow_rate(pflow_rate);
+
+    // Scheme, increments and extrapolation of every estimate, the first is the reference
+    int num_estimates = 6;
+    int porder[6] = {2, 1, 1, 1, 2, 2};
+    weak_increments pincrements[6] = {WEAK_GAUSSIAN, WEAK_GAUSSIAN, WEAK_TWO_POINT, WEAK_TWO_POINT, WEAK_THREE_POINT,
+        WEAK_THREE_POINT};
+    int pextrapolate[6] = {0, 0, 0, 1, 0, 1};
+    const char *pnames[6] = {"trapezoidal, Gaussian", "implicit Euler, Gaussian", "implicit Euler, two-point",
+        "implicit Euler, two-point, extrapolated", "trapezoidal, three-point", "trapezoidal, three-point, extrapolated"};
+    double preference[36];
+
+    printf("%-40s %12s %12s %12s %12s %10s %10s %8s\n","Scheme","T final [K]","error [K]","max error [K]",
+        "std. error [K]","steps","time [s]","failed");
+    int e;
+    for (e=0;e<num_estimates;e++){
+        int steps = (e == 0) ? reference_steps : time_steps_per_sample;
+        weak_estimator *pe = weak_create(&params,pflow_rate,number_of_samples,steps,sample_time,x0,num_paths,
+            porder[e],pincrements[e],pextrapolate[e],seed);
+        if (pe == NULL){
+            printf("Error: Could not allocate the estimator.\n");
+            return 0;
+        }
+        double timer = omp_get_wtime();
+        weak_estimate(pe);
+        timer = omp_get_wtime()-timer;
+
+        // Errors of the mean temperature at the end and over all sample times against the reference
+        int s;
+        double max_error = 0;
+        for (s=0;s<=number_of_samples;s++){
+            if (e == 0){
+                preference[s] = pe->pmean[n*s+2];
+            }
+            double error = fabs(pe->pmean[n*s+2]-preference[s]);
+            max_error = (error > max_error || isnan(error)) ? error : max_error;
+        }
+        double T_final = pe->pmean[n*number_of_samples+2];
+        printf("%-40s %12.6lf %12.3e %12.3e %12.3e %10.3e %10.3lf %8d\n",pnames[e],T_final,
+            T_final-preference[number_of_samples],max_error,pe->pstandard_error[n*number_of_samples+2],
+            pe->simulated_steps,timer,pe->failed_paths);
+        weak_destroy(pe);
+    }
+
+    return 0;
+}